@@ -55,12 +55,13 @@ static const char* kModule = "alsa";
 #define THROW(x) throw( AudioEngine::exception(x) )
 
 unsigned int ALSAEngine::_instances = 0;
-snd_mixer_t* ALSAEngine::_mixer = NULL;
+snd_mixer_t* ALSAEngine::_snd_mixer = NULL;
 
 ALSAEngine::ALSAEngine() :
-    AudioEngine(),
+    PullAudioEngine(),
     _sample_size(1),
-    _pcm_handle(0)
+    _pcm_handle(0),
+    _drop( false )
 {
     initialize();
 }
@@ -190,10 +191,10 @@ bool ALSAEngine::shutdown()
 
     if ( _instances == 0 )
     {
-        if ( _mixer )
-            snd_mixer_close( _mixer );
+        if ( _snd_mixer )
+            snd_mixer_close( _snd_mixer );
 
-        _mixer = NULL;
+        _snd_mixer = NULL;
     }
     return true;
 }
@@ -210,38 +211,38 @@ float ALSAEngine::volume() const
     //
     char buf[1024];
 
-    if ( !_mixer )
+    if ( !_snd_mixer )
     {
         try {
             int err;
-            if ( (err = snd_mixer_open(&_mixer, 0)) < 0) {
+            if ( (err = snd_mixer_open(&_snd_mixer, 0)) < 0) {
                 sprintf( buf, _("Mixer %s open error: %s\n"),
                          device().c_str(), snd_strerror(err) );
                 THROW(buf);
             }
 
-            if ( (err = snd_mixer_attach( _mixer, device().c_str() )) < 0) {
+            if ( (err = snd_mixer_attach( _snd_mixer, device().c_str() )) < 0) {
                 sprintf(buf, _("Mixer attach %s error: %s"),
                         device().c_str(), snd_strerror(err) );
-                snd_mixer_close( _mixer );
-                _mixer = NULL;
+                snd_mixer_close( _snd_mixer );
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
-            if ((err = snd_mixer_selem_register(_mixer, NULL, NULL)) < 0) {
+            if ((err = snd_mixer_selem_register(_snd_mixer, NULL, NULL)) < 0) {
                 sprintf( buf, _("Mixer register error: %s"),
                          snd_strerror(err));
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
-            err = snd_mixer_load( _mixer );
+            err = snd_mixer_load( _snd_mixer );
             if (err < 0) {
                 sprintf( buf, _("Mixer %s load error: %s"),
                          device().c_str(), snd_strerror(err));
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
@@ -250,12 +251,12 @@ float ALSAEngine::volume() const
             snd_mixer_selem_id_alloca(&sid);
             snd_mixer_selem_id_set_name( sid, N_("PCM") );
 
-            snd_mixer_elem_t* elem = snd_mixer_find_selem( _mixer, sid);
+            snd_mixer_elem_t* elem = snd_mixer_find_selem( _snd_mixer, sid);
             if ( !elem )
             {
                 // Try with master
                 snd_mixer_selem_id_set_name(sid, "Master");
-                elem = snd_mixer_find_selem( _mixer, sid );
+                elem = snd_mixer_find_selem( _snd_mixer, sid );
             }
 
             if ( !elem )
@@ -264,8 +265,8 @@ float ALSAEngine::volume() const
                          _("Unable to find simple control '%s', id: %i\n"),
                          snd_mixer_selem_id_get_name(sid),
                          snd_mixer_selem_id_get_index(sid) );
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
@@ -276,8 +277,8 @@ float ALSAEngine::volume() const
                 sprintf( buf, _("Unable to find volume range '%s', id: %i\n"),
                          snd_mixer_selem_id_get_name(sid),
                          snd_mixer_selem_id_get_index(sid) );
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
@@ -313,7 +314,7 @@ float ALSAEngine::volume() const
 
 void ALSAEngine::volume( float v )
 {
-    _volume = v;
+    PullAudioEngine::volume( v );
 
 #if 0
 
@@ -323,37 +324,37 @@ void ALSAEngine::volume( float v )
     char buf[1024];
 
     try {
-        if ( !_mixer )
+        if ( !_snd_mixer )
         {
             int err;
-            if ( (err = snd_mixer_open(&_mixer, 0)) < 0) {
+            if ( (err = snd_mixer_open(&_snd_mixer, 0)) < 0) {
                 sprintf( buf, _("Mixer %s open error: %s\n"),
                          device().c_str(), snd_strerror(err) );
                 THROW(buf);
             }
 
-            if ( (err = snd_mixer_attach( _mixer, device().c_str() )) < 0) {
+            if ( (err = snd_mixer_attach( _snd_mixer, device().c_str() )) < 0) {
                 sprintf(buf, _("Mixer attach %s error: %s"),
                         device().c_str(), snd_strerror(err) );
-                snd_mixer_close( _mixer );
-                _mixer = NULL;
+                snd_mixer_close( _snd_mixer );
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
-            if ((err = snd_mixer_selem_register(_mixer, NULL, NULL)) < 0) {
+            if ((err = snd_mixer_selem_register(_snd_mixer, NULL, NULL)) < 0) {
                 sprintf( buf, _("Mixer register error: %s"),
                          snd_strerror(err));
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
 
-            err = snd_mixer_load( _mixer );
+            err = snd_mixer_load( _snd_mixer );
             if (err < 0) {
                 sprintf( buf, _("Mixer %s load error: %s"),
                          device().c_str(), snd_strerror(err));
-                snd_mixer_close(_mixer);
-                _mixer = NULL;
+                snd_mixer_close(_snd_mixer);
+                _snd_mixer = NULL;
                 THROW(buf);
             }
         }
@@ -364,13 +365,13 @@ void ALSAEngine::volume( float v )
         snd_mixer_selem_id_set_index( sid, 0 );
         snd_mixer_selem_id_set_name( sid, N_("PCM") );
 
-        snd_mixer_elem_t* elem = snd_mixer_find_selem( _mixer, sid);
+        snd_mixer_elem_t* elem = snd_mixer_find_selem( _snd_mixer, sid);
         if ( !elem )
         {
             // Try with master
             snd_mixer_selem_id_set_index( sid, 0 );
             snd_mixer_selem_id_set_name(sid, "Master");
-            elem = snd_mixer_find_selem( _mixer, sid );
+            elem = snd_mixer_find_selem( _snd_mixer, sid );
         }
 
         if ( !elem )
@@ -379,8 +380,8 @@ void ALSAEngine::volume( float v )
                      _("Unable to find simple control '%s', id: %i\n"),
                      snd_mixer_selem_id_get_name(sid),
                      snd_mixer_selem_id_get_index(sid) );
-            snd_mixer_close(_mixer);
-            _mixer = NULL;
+            snd_mixer_close(_snd_mixer);
+            _snd_mixer = NULL;
             THROW(buf);
         }
 
@@ -391,8 +392,8 @@ void ALSAEngine::volume( float v )
             sprintf( buf, _("Unable to find volume range '%s', id: %i\n"),
                      snd_mixer_selem_id_get_name(sid),
                      snd_mixer_selem_id_get_index(sid) );
-            snd_mixer_close(_mixer);
-            _mixer = NULL;
+            snd_mixer_close(_snd_mixer);
+            _snd_mixer = NULL;
             THROW(buf);
         }
 
@@ -662,10 +663,25 @@ bool ALSAEngine::open( const unsigned channels,
             THROW(buf);
         }
 
+        snd_pcm_uframes_t buffer_size;
+        status = snd_pcm_get_params( _pcm_handle, &buffer_size, &period_size );
+        if ( status < 0 )
+        {
+            sprintf(buf, _("Couldn't get period size: %s"),
+                    snd_strerror(status));
+            THROW(buf);
+        }
+
+        if ( ! open_ring( _channels, exact_rate, _audio_format ) )
+            THROW( _("Couldn't open audio ring") );
+
         // All okay, enable device
         _enabled = true;
         _old_device_idx = _device_idx;
 
+        _drop = false;
+        start_writer( snd_pcm_frames_to_bytes( _pcm_handle, period_size ) );
+
 
         /* We're ready to rock and roll. :-) */
         return true;
@@ -684,75 +700,26 @@ bool ALSAEngine::open( const unsigned channels,
 }
 
 
-bool ALSAEngine::play( const char* orig, const size_t size )
+bool ALSAEngine::write_period( const char* data, const size_t bytes )
 {
-    if ( !_enabled )   return true;
-
-    if ( !_pcm_handle || size == 0 || orig == NULL )
-        return false;
-
-    long int           status = 0;
-
-    uint8_t* data = (uint8_t*)orig;
-
-    unsigned sample_len = (unsigned)size / _sample_size;
-
-    if ( _volume < 0.99f )
+    if ( _drop.exchange( false ) )
     {
-        data = new uint8_t[size];
-        memcpy( data, orig, size );
-
-        int i = sample_len * _channels;
-        switch( _pcm_format )
-        {
-        case SND_PCM_FORMAT_U8:
-        {
-            uint8_t* d = (uint8_t*)data;
-            while ( i-- )
-            {
-                d[i] *= _volume;
-            }
-            break;
-        }
-        case SND_PCM_FORMAT_S16_LE:
-        case SND_PCM_FORMAT_S16_BE:
-        {
-            int16_t* d = (int16_t*)data;
-            while ( i-- )
-            {
-                d[i] *= _volume;
-            }
-            break;
-        }
-        case SND_PCM_FORMAT_S24_LE:
-        case SND_PCM_FORMAT_S24_BE:
-        case SND_PCM_FORMAT_S32_LE:
-        case SND_PCM_FORMAT_S32_BE:
-        {
-            int32_t* d = (int32_t*)data;
-            while ( i-- )
-            {
-                d[i] *= _volume;
-            }
-            break;
-        }
-        case SND_PCM_FORMAT_FLOAT_LE:
-        case SND_PCM_FORMAT_FLOAT_BE:
+        int err = snd_pcm_drop( _pcm_handle );
+        if ( err >= 0 ) err = snd_pcm_prepare( _pcm_handle );
+        if ( err < 0 )
         {
-            float* d = (float*)data;
-            while ( i-- )
-            {
-                d[i] *= _volume;
-            }
-            break;
-        }
+            LOG_ERROR( _("snd_pcm_drop failed with ")
+                       << _( snd_strerror(err) ) );
         }
     }
 
+    long int           status = 0;
 
-    const uint8_t* sample_buf = data;
+    const uint8_t* sample_buf = (const uint8_t*)data;
+    snd_pcm_uframes_t sample_len = snd_pcm_bytes_to_frames( _pcm_handle,
+                                                            bytes );
 
-    while ( sample_len > 0 ) {
+    while ( sample_len > 0 && _writing ) {
         status = snd_pcm_writei(_pcm_handle, sample_buf, sample_len);
         if ( status < 0 ) {
             if ( status == -EAGAIN ) {
@@ -782,18 +749,12 @@ bool ALSAEngine::play( const char* orig, const size_t size )
             }
             if ( status < 0 ) {
                 /* Hmm, not much we can do - abort */
-                _enabled = false;
                 return false;
             }
             continue;
         }
-        sample_buf += status * _sample_size;
-        sample_len -= (unsigned)status;
-    }
-
-    if ( (uint8_t*)orig != data )
-    {
-        delete [] data;
+        sample_buf += snd_pcm_frames_to_bytes( _pcm_handle, status );
+        sample_len -= status;
     }
 
     return true;
@@ -802,34 +763,36 @@ bool ALSAEngine::play( const char* orig, const size_t size )
 
 void ALSAEngine::flush()
 {
-    if ( _pcm_handle ) {
-        int err = snd_pcm_drop( _pcm_handle );
-        if ( err < 0 )
-        {
-            LOG_ERROR( _("snd_pcm_drop failed with ")
-                       << _( snd_strerror(err) ) );
-        }
-    }
+    // The device is only touched by the writer thread.
+    PullAudioEngine::flush();
+    _drop = true;
 }
 
 
 bool ALSAEngine::close()
 {
+    _enabled = false;
+    stop_writer();
 
     if ( _pcm_handle )
     {
-        flush();
+        int err = snd_pcm_drop( _pcm_handle );
+        if ( err < 0 )
+        {
+            LOG_ERROR( _("snd_pcm_drop failed with ")
+                       << _( snd_strerror(err) ) );
+        }
 
-        int err = snd_pcm_close( _pcm_handle );
+        err = snd_pcm_close( _pcm_handle );
         if ( err < 0 )
         {
             LOG_ERROR( _("snd_pcm_close failed with ")
                        << _( snd_strerror(err) ) );
         }
         _pcm_handle = NULL;
-        _enabled = false;
     }
 
+    close_ring();
     return true;
 }
 
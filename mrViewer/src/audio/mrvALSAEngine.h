@@ -33,14 +33,14 @@
 
 #include <alsa/asoundlib.h>
 
-#include "mrvAudioEngine.h"
+#include "core/mrvPullAudioEngine.h"
 
 typedef struct _snd_pcm   snd_pcm_t;
 typedef struct _snd_mixer snd_mixer_t;
 
 namespace mrv {
 
-class ALSAEngine : public mrv::AudioEngine
+class ALSAEngine : public mrv::PullAudioEngine
 {
 public:
     ALSAEngine();
@@ -59,10 +59,6 @@ public:
         const unsigned int bits
     );
 
-    // Play some samples (this function does not return until
-    // playback has finished)
-    virtual bool play( const char* data, const size_t size );
-
     // Retrieve current master volume
     virtual float volume() const;
 
@@ -83,13 +79,17 @@ protected:
     // device for playback
     virtual bool initialize();
 
+    // Writer thread.  Blocks in snd_pcm_writei.
+    virtual bool write_period( const char* data, const size_t bytes );
+
 protected:
     unsigned int _sample_size;
     snd_pcm_t*   _pcm_handle;
+    std::atomic<bool> _drop;   //!< set by flush(), done by the writer
 
 protected:
     static unsigned int _instances;
-    static snd_mixer_t* _mixer;
+    static snd_mixer_t* _snd_mixer;
     snd_pcm_format_t    _pcm_format;
     snd_pcm_hw_params_t* hwparams;
     snd_pcm_sw_params_t* swparams;
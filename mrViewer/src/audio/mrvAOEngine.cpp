@@ -41,6 +41,10 @@ namespace
 
 const char* kModule = "ao";
 
+// ao_play blocks until the driver took the data, so the writer thread
+// hands it periods this long (in 1/n seconds).
+const unsigned kPeriodsPerSecond = 50;
+
 }
 
 
@@ -51,10 +55,9 @@ namespace mrv {
 unsigned int     AOEngine::_instances = 0;
 
 AOEngine::AOEngine() :
-    AudioEngine(),
+    PullAudioEngine(),
     _sample_size(0),
     _audio_device(0),
-    _volume( 1.0f ),
     _format( NULL ),
     _device( NULL ),
     _options( NULL )
@@ -150,18 +153,6 @@ bool AOEngine::shutdown()
 }
 
 
-float AOEngine::volume() const
-{
-
-    return _volume;
-}
-
-void AOEngine::volume( float v )
-{
-    if (!_device) return;
-    _volume = v;
-}
-
 AOEngine::AudioFormat AOEngine::default_format()
 {
     return kS32LSB;
@@ -192,7 +183,7 @@ bool AOEngine::open( const unsigned channels,
 {
     try
     {
-        flush();
+        close();
 
         _enabled = false;
         ao_sample_format fmt;
@@ -236,9 +227,18 @@ bool AOEngine::open( const unsigned channels,
         _channels = channels;
         _old_device_idx = _device_idx;
 
+        if ( ! open_ring( channels, freq, format ) )
+        {
+            close();
+            return false;
+        }
+
         // All okay, enable device
         _enabled = true;
 
+        start_writer( size_t( freq / kPeriodsPerSecond ) *
+                      _mixer.frame_size() );
+
         return true;
     }
     catch( const AudioEngine::exception& e )
@@ -250,77 +250,18 @@ bool AOEngine::open( const unsigned channels,
 }
 
 
-bool AOEngine::play( const char* d, const size_t size )
+bool AOEngine::write_period( const char* data, const size_t bytes )
 {
-
-    if ( !_device) return false;
-    if ( !_enabled ) return true;
-
-    int16_t* data = (int16_t*)d;
-    if ( _volume < 0.99f )
-    {
-        switch ( _audio_format )
-        {
-        case kU8:
-        {
-            data = (int16_t*)new uint8_t[size];
-            memcpy( data, d, size );
-            for ( size_t i = 0; i < size; ++i )
-            {
-                data[i] *= _volume;
-            }
-            break;
-        }
-        case kS32LSB:
-        {
-            size_t samples = size / 4;
-            int32_t* s32data = new int32_t[samples];
-            memcpy( s32data, d, size );
-            for ( size_t i = 0; i < samples; ++i )
-            {
-                s32data[i] *= _volume;
-            }
-            data = (int16_t*) s32data;
-            break;
-        }
-        default:
-        case kS16LSB:
-        {
-            size_t samples = size / 2;
-            data = new int16_t[samples];
-            memcpy( data, d, size );
-            for ( size_t i = 0; i < samples; ++i )
-            {
-                data[i] *= _volume;
-            }
-            break;
-        }
-        }
-    }
-
-    int ok = ao_play( _device, (char*)data, size );
-
-    if ( ok == 0 )
-    {
-        LOG_ERROR( _("Error playing sample") );
-        close();
-        return false;
-    }
-
-
-    return true;
-}
-
-void AOEngine::flush()
-{
-    if ( _device )
-    {
-    }
+    return ao_play( _device, (char*)data, (uint_32)bytes ) != 0;
 }
 
 
 bool AOEngine::close()
 {
+    _enabled = false;
+    stop_writer();
+    close_ring();
+
     if ( _device )
     {
         int ok = ao_close( _device );
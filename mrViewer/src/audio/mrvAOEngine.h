@@ -28,7 +28,7 @@
 #ifndef mrvAOEngine_h
 #define mrvAOEngine_h
 
-#include "core/mrvAudioEngine.h"
+#include "core/mrvPullAudioEngine.h"
 
 struct ao_sample_format;
 struct ao_device;
@@ -37,7 +37,7 @@ struct ao_option;
 
 namespace mrv {
 
-class AOEngine : public mrv::AudioEngine
+class AOEngine : public mrv::PullAudioEngine
 {
 public:
     AOEngine();
@@ -62,18 +62,6 @@ public:
 
     bool enabled() const { return _enabled; }
 
-    // Play some samples (this function does not return until
-    // playback has finished)
-    virtual bool play( const char* data, const size_t size );
-
-    virtual float volume() const;
-
-    // Change volume of playback
-    virtual void volume( float f );
-
-    // Flush all audio sent for playback
-    virtual void flush();
-
     // Close an audio stream
     virtual bool close();
 
@@ -85,11 +73,12 @@ protected:
     // device for playback
     virtual bool initialize();
 
+    // Writer thread.  Blocks in ao_play.
+    virtual bool write_period( const char* data, const size_t bytes );
 
 protected:
     unsigned int _sample_size;
     unsigned int _audio_device;
-    float        _volume;
 
     ao_sample_format* _format;
     ao_device*        _device;
@@ -0,0 +1,214 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvNullEngine.cpp
+ * @author gga
+ * @date   Sun Oct 18 17:05:48 2026
+ *
+ * @brief  Audio engine without hardware.  Drains audio in real time and
+ *         optionally records it to a WAV file.
+ *
+ */
+
+#include <algorithm>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <FL/fl_utf8.h>
+
+#include "gui/mrvIO.h"
+#include "audio/mrvNullEngine.h"
+
+namespace {
+const char* kModule = "nullaudio";
+
+// Length of a sink period.  Close to what ALSA and CoreAudio use.
+const unsigned kPeriodsPerSecond = 100;
+
+// If the sink thread falls this far behind (machine suspended, debugger)
+// restart the pacing instead of pulling a burst to catch up.
+const int64_t kMaxLagUs = 200000;
+
+void put16( FILE* f, uint16_t v )
+{
+    unsigned char b[2] = { (unsigned char)(v & 0xff),
+                           (unsigned char)(v >> 8) };
+    fwrite( b, 1, 2, f );
+}
+
+void put32( FILE* f, uint32_t v )
+{
+    unsigned char b[4] = { (unsigned char)(v & 0xff),
+                           (unsigned char)((v >> 8) & 0xff),
+                           (unsigned char)((v >> 16) & 0xff),
+                           (unsigned char)(v >> 24) };
+    fwrite( b, 1, 4, f );
+}
+
+}
+
+namespace mrv {
+
+NullEngine::NullEngine( const std::string& wavfile ) :
+    PullAudioEngine(),
+    _wavfile( wavfile ),
+    _file( NULL ),
+    _data_bytes( 0 ),
+    _period_us( 0 )
+{
+    initialize();
+}
+
+NullEngine::~NullEngine()
+{
+    shutdown();
+}
+
+bool NullEngine::initialize()
+{
+    if ( _devices.empty() )
+    {
+        Device def( "default", _("Default Audio Device") );
+        _devices.push_back( def );
+    }
+    return true;
+}
+
+bool NullEngine::shutdown()
+{
+    return close();
+}
+
+bool NullEngine::open( const unsigned channels,
+                       const unsigned freq,
+                       const AudioFormat format,
+                       const unsigned bits )
+{
+    close();
+
+    switch( format )
+    {
+    case kU8:
+    case kS16LSB:
+    case kS32LSB:
+    case kFloatLSB:
+    case kDoubleLSB:
+        break;
+    default:
+        // Let CMedia::open_audio fall back to another format
+        return false;
+    }
+
+    if ( !open_ring( channels, freq, format ) )
+        return false;
+
+    if ( !_wavfile.empty() )
+    {
+        _file = fl_fopen( _wavfile.c_str(), "wb" );
+        if ( !_file )
+        {
+            LOG_ERROR( _("Could not open ") << _wavfile
+                       << _(" for writing") );
+            close_ring();
+            return false;
+        }
+        _data_bytes = 0;
+        write_header();
+    }
+
+    _enabled = true;
+    _old_device_idx = _device_idx;
+
+    const unsigned frames = std::max( 1U, _frequency / kPeriodsPerSecond );
+    _period_us = int64_t(frames) * 1000000 / _frequency;
+    _next = boost::posix_time::microsec_clock::universal_time();
+    start_writer( size_t(frames) * _mixer.frame_size() );
+    return true;
+}
+
+bool NullEngine::close()
+{
+    _enabled = false;
+
+    stop_writer();
+    close_ring();
+
+    if ( _file )
+    {
+        finish_header();
+        fclose( _file );
+        _file = NULL;
+    }
+    return true;
+}
+
+bool NullEngine::write_period( const char* data, const size_t bytes )
+{
+    using namespace boost::posix_time;
+
+    if ( _file )
+    {
+        fwrite( data, 1, bytes, _file );
+        _data_bytes += bytes;
+    }
+
+    _next += microseconds( _period_us );
+    ptime now = microsec_clock::universal_time();
+    if ( ( now - _next ).total_microseconds() > kMaxLagUs )
+        _next = now;
+    else if ( _next > now )
+        boost::this_thread::sleep( _next );
+    return true;
+}
+
+bool NullEngine::write_header()
+{
+    const unsigned bps = bits_for_format( _audio_format );
+    const bool is_float = ( _audio_format == kFloatLSB ||
+                            _audio_format == kDoubleLSB );
+
+    fwrite( "RIFF", 1, 4, _file );
+    put32( _file, 36 );   // patched in finish_header()
+    fwrite( "WAVE", 1, 4, _file );
+
+    fwrite( "fmt ", 1, 4, _file );
+    put32( _file, 16 );
+    put16( _file, is_float ? 3 : 1 );   // IEEE float or PCM
+    put16( _file, uint16_t( _channels ) );
+    put32( _file, _frequency );
+    put32( _file, _frequency * _channels * bps );
+    put16( _file, uint16_t( _channels * bps ) );
+    put16( _file, uint16_t( bps * 8 ) );
+
+    fwrite( "data", 1, 4, _file );
+    put32( _file, 0 );    // patched in finish_header()
+    return ferror( _file ) == 0;
+}
+
+void NullEngine::finish_header()
+{
+    // WAV sizes are 32 bits.  Past 4Gb leave them saturated.
+    uint32_t data = _data_bytes > 0xffffffd0ULL ? 0xffffffd0U :
+                    uint32_t( _data_bytes );
+    fseek( _file, 4, SEEK_SET );
+    put32( _file, 36 + data );
+    fseek( _file, 40, SEEK_SET );
+    put32( _file, data );
+}
+
+} // namespace mrv
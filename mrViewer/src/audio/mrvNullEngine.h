@@ -0,0 +1,90 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvNullEngine.h
+ * @author gga
+ * @date   Sun Oct 18 17:05:48 2026
+ *
+ * @brief  Audio engine without hardware.  Drains audio in real time and
+ *         optionally records it to a WAV file.
+ *
+ */
+
+#ifndef mrvNullEngine_h
+#define mrvNullEngine_h
+
+#include <cstdio>
+#include <string>
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "core/mrvPullAudioEngine.h"
+
+namespace mrv {
+
+class NullEngine : public mrv::PullAudioEngine
+{
+public:
+    // If wavfile is not empty, everything played is also written there.
+    NullEngine( const std::string& wavfile = "" );
+    virtual ~NullEngine();
+
+    // Name of audio engine
+    virtual const char* name() {
+        return _wavfile.empty() ? "Null" : "WAV";
+    }
+
+    // Open an audio stream for playback
+    virtual bool open(
+        const unsigned int channels,
+        const unsigned int frequency,
+        const AudioFormat  format,
+        const unsigned int bits
+    );
+
+    // Close an audio stream
+    virtual bool close();
+
+protected:
+    // Shutdown the audio engine
+    virtual bool shutdown();
+
+    // Initialize the audio engine if needed and choose default
+    // device for playback
+    virtual bool initialize();
+
+    // Writer thread.  Takes one period at a time, paced by the wall
+    // clock like a sound card would be.
+    virtual bool write_period( const char* data, const size_t bytes );
+
+    bool write_header();
+    void finish_header();
+
+protected:
+    std::string        _wavfile;
+    FILE*              _file;
+    uint64_t           _data_bytes;
+    int64_t            _period_us;
+    boost::posix_time::ptime _next;   //!< when the next period is due
+};
+
+
+} // namespace mrv
+
+
+#endif // mrvNullEngine_h
@@ -50,40 +50,23 @@ namespace mrv {
 
     unsigned int RtAudioEngine::_instances = 0;
 
-unsigned int frameCounter = 0;
-bool checkCount = false;
-unsigned int nFrames = 0;
-const unsigned int callbackReturnValue = 1;
-
-// Two-channel sawtooth wave generator.
-    int myCallback( void *outputBuffer, void * /*inputBuffer*/,
-                    unsigned int nBufferFrames,
-                    double /*streamTime*/, RtAudioStreamStatus status,
-                    void *userData )
-    {
-        unsigned int i, j;
-        double *buffer = (double *) outputBuffer;
-        double *lastValues = (double *) userData;
-        if ( status )
-            LOG_ERROR( "Stream underflow detected!" );
-        // Write interleaved audio data.
-        for ( i=0; i<nBufferFrames; i++ ) {
-            for ( j=0; j<2; j++ ) {
-                *buffer++ = lastValues[j];
-                lastValues[j] += 0.005 * (j+1+(j*0.1));
-                if ( lastValues[j] >= 1.0 ) lastValues[j] -= 2.0;
-            }
-        }
-
-        frameCounter += nBufferFrames;
-        if ( checkCount && ( frameCounter >= nFrames ) )
-            return callbackReturnValue;
+int RtAudioEngine::callback( void *outputBuffer, void * /*inputBuffer*/,
+                             unsigned int nBufferFrames,
+                             double /*streamTime*/,
+                             RtAudioStreamStatus status,
+                             void *userData )
+{
+    RtAudioEngine* engine = (RtAudioEngine*) userData;
+    if ( status )
+        LOG_ERROR( "Stream underflow detected!" );
 
-        return 0;
-    }
+    engine->pull( (char*) outputBuffer,
+                  size_t(nBufferFrames) * engine->mixer().frame_size() );
+    return 0;
+}
 
 RtAudioEngine::RtAudioEngine() :
-    AudioEngine(),
+    PullAudioEngine(),
     audio( RtAudio::MACOSX_CORE )
 {
     initialize();
@@ -139,17 +122,6 @@ bool RtAudioEngine::shutdown()
 }
 
 
-float RtAudioEngine::volume() const
-{
-    return _volume;
-}
-
-void RtAudioEngine::volume( float v )
-{
-    _volume = v;
-}
-
-
 bool RtAudioEngine::open( const unsigned channels,
                           const unsigned freq,
                           const AudioFormat format,
@@ -185,31 +157,30 @@ bool RtAudioEngine::open( const unsigned channels,
         unsigned int bufferFrames = 512; // 256 sample frames
 
         RtAudio::StreamOptions options;
-        options.flags = RTAUDIO_HOG_DEVICE |
-                        RTAUDIO_NONINTERLEAVED | RTAUDIO_MINIMIZE_LATENCY |
+        options.flags = RTAUDIO_HOG_DEVICE | RTAUDIO_MINIMIZE_LATENCY |
                         RTAUDIO_SCHEDULE_REALTIME;
 
-        double *data = (double*) calloc( channels, sizeof( double ) );
+        // The ring must exist before the callback can run.
+        if ( ! open_ring( channels, freq, format ) )
+            return false;
 
         audio.showWarnings( true );
 
         try {
             audio.openStream( &parameters, NULL, fmt,
-                              sampleRate, &bufferFrames, &myCallback,
-                              (void*)&data, &options );
+                              sampleRate, &bufferFrames, &callback,
+                              (void*)this, &options );
+            // bufferFrames now holds what the device settled on
+            _mixer.period( size_t(bufferFrames) * _mixer.frame_size() );
             audio.startStream();
         }
         catch ( RtAudioError& e ) {
             LOG_ERROR( e.getMessage() );
+            close_ring();
             return false;
         }
 
 
-        _audio_format = format;
-
-        _channels = channels;
-
-
         // All okay, enable device
         _enabled = true;
         _old_device_idx = parameters.deviceId;
@@ -228,29 +199,22 @@ bool RtAudioEngine::open( const unsigned channels,
 }
 
 
-bool RtAudioEngine::play( const char* orig, const size_t size )
+bool RtAudioEngine::play( const char* data, const size_t size )
 {
     if ( !_enabled )   return true;
 
-    if ( audio.isStreamRunning() ) return true;
-
-    audio.startStream();
-
-    return true;
-}
-
+    if ( ! audio.isStreamRunning() ) audio.startStream();
 
-void RtAudioEngine::flush()
-{
-    if ( audio.isStreamRunning() ) audio.abortStream();
+    return PullAudioEngine::play( data, size );
 }
 
 
 bool RtAudioEngine::close()
 {
     _enabled = false;
-    flush();
+    if ( audio.isStreamRunning() ) audio.abortStream();
     if ( audio.isStreamOpen() ) audio.closeStream();
+    close_ring();
 
     return true;
 }
@@ -32,12 +32,12 @@
 
 #include "RtAudio.h"
 
-#include "mrvAudioEngine.h"
+#include "core/mrvPullAudioEngine.h"
 
 
 namespace mrv {
 
-class RtAudioEngine : public mrv::AudioEngine
+class RtAudioEngine : public mrv::PullAudioEngine
 {
 public:
     RtAudioEngine();
@@ -56,19 +56,9 @@ public:
         const unsigned int bits
     );
 
-    // Play some samples (this function does not return until
-    // playback has finished)
+    // Queue some samples for the device callback
     virtual bool play( const char* data, const size_t size );
 
-    // Retrieve current master volume
-    virtual float volume() const;
-
-    // Change volume of playback
-    virtual void volume( float f );
-
-    // Flush all audio sent for playback
-    virtual void flush();
-
     // Close an audio stream
     virtual bool close();
 
@@ -80,6 +70,13 @@ protected:
     // device for playback
     virtual bool initialize();
 
+protected:
+    // Device callback.  Drains the mixer into RtAudio's buffer.
+    static int callback( void* outputBuffer, void* inputBuffer,
+                         unsigned int nBufferFrames,
+                         double streamTime, RtAudioStreamStatus status,
+                         void* userData );
+
 protected:
     RtAudio  audio;
 protected:
@@ -29,6 +29,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>
 
 #include <iostream>
 
@@ -43,6 +44,10 @@
 namespace
 {
 const char* kModule = "wmm";
+
+// Length of a header, in 1/n seconds.  The writer thread fills one at a
+// time as the device returns them.
+const unsigned kPeriodsPerSecond = 50;
 }
 
 
@@ -95,15 +100,16 @@ static void MMerror(char *function, MMRESULT code)
 
 
 WaveEngine::WaveEngine() :
-    AudioEngine(),
+    PullAudioEngine(),
     _sample_size(0),
     _audio_device( NULL ),
     _buffer( NULL ),
     _data( NULL ),
-    _samples_per_block( 48000 ),  // 1 second of 48khz audio
+    _samples_per_block( 960 ),  // 20 ms of 48khz audio
     bytesPerBlock( 0 ),
-    _num_buffers( 3 ),
-    _idx( 0 )
+    _num_buffers( 4 ),
+    _idx( 0 ),
+    _reset( false )
 {
     initialize();
 }
@@ -416,48 +422,6 @@ bool WaveEngine::shutdown()
 }
 
 
-float WaveEngine::volume() const
-{
-    if (!_audio_device) return 1.0;
-
-    DWORD vol;
-    MMRESULT result = waveOutGetVolume( _audio_device, &vol );
-    if ( result != MMSYSERR_NOERROR )
-    {
-        MMerror( "waveOutGetVolume", result );
-        return 1.0;
-    }
-
-    unsigned short left = unsigned(0xFFFF & vol);
-    unsigned short right = unsigned(0xFFFF & (vol >> 16));
-
-    float v = (float)left / 0xFFFF;;
-    v += (float)right / 0xFFFF;
-    if ( right > 0x0000 ) v /= 2.0f;
-
-    return v;
-}
-
-
-void WaveEngine::volume( float v )
-{
-    if (!_audio_device) return;
-
-    _volume = v;
-    unsigned short left = unsigned(0xFFFF * v);
-    unsigned short right = unsigned(0xFFFF * v);
-
-    unsigned long x = left + (right << 16);
-
-    MMRESULT result = waveOutSetVolume( _audio_device, x );
-    if ( result != MMSYSERR_NOERROR )
-    {
-        MMerror( "waveOutSetVolume", result );
-        return;
-    }
-}
-
-
 inline WAVEHDR* WaveEngine::get_header()
 {
     return &( _buffer[ _idx ] );
@@ -557,7 +521,15 @@ bool WaveEngine::open( const unsigned channels,
 
         _audio_format = format;
 
-        // Allocate internal sound buffer
+        if ( ! open_ring( channels, freq, format ) )
+        {
+            close();
+            _enabled = false;
+            return false;
+        }
+
+        // Allocate internal sound buffers, each one writer period long
+        _samples_per_block = std::max( 1U, freq / kPeriodsPerSecond );
         bytesPerBlock = wavefmt.Format.nBlockAlign * _samples_per_block;
         assert( bytesPerBlock > 16 );
         size_t bytes = _num_buffers * bytesPerBlock;
@@ -590,6 +562,9 @@ bool WaveEngine::open( const unsigned channels,
         DBGM3( "enabled ok" );
         // All okay, enable device
         _enabled = true;
+        _idx = 0;
+        _reset = false;
+        start_writer( bytesPerBlock );
         return true;
     }
     catch( const AudioEngine::exception& e )
@@ -602,34 +577,47 @@ bool WaveEngine::open( const unsigned channels,
 
 void WaveEngine::wait_audio()
 {
-    while ( _audio_device &&
-            _enabled &&
+    while ( _audio_device && _writing &&
             ( ( _buffer[ _idx ].dwFlags & WHDR_DONE ) == 0 ) )
     {
-        Sleep(10);
+        Sleep(2);
     }
 }
 
-bool WaveEngine::play( const char* data, const size_t size )
+bool WaveEngine::write_period( const char* data, const size_t size )
 {
-    wait_audio();
+    MMRESULT result;
 
-    if ( !_audio_device) {
-        return false;
-    }
-    if ( !_enabled ) {
-        return true;
+    if ( _reset.exchange( false ) )
+    {
+        // Returns all queued headers as done
+        result = waveOutReset( _audio_device );
+        if ( result != MMSYSERR_NOERROR )
+        {
+            MMerror( "waveOutReset", result);
+        }
     }
 
-    MMRESULT result;
+    wait_audio();
+    if ( !_writing ) return true;
 
     WAVEHDR* hdr = get_header();
 
     assert( size > 0 );
-    assert( size < bytesPerBlock );
+    assert( size <= bytesPerBlock );
     assert( data != NULL );
     assert( hdr->lpData != NULL );
 
+    if ( hdr->dwFlags & WHDR_PREPARED )
+    {
+        result = waveOutUnprepareHeader( _audio_device, hdr,
+                                         sizeof(WAVEHDR) );
+        if ( result != MMSYSERR_NOERROR )
+        {
+            MMerror( "waveOutUnprepareHeader", result);
+            return false;
+        }
+    }
 
     // Copy data
     memcpy( hdr->lpData, data, size );
@@ -644,7 +632,6 @@ bool WaveEngine::play( const char* data, const size_t size )
 
     if ( result != MMSYSERR_NOERROR || !(hdr->dwFlags & WHDR_PREPARED) )
     {
-        _enabled = false;
         MMerror( "waveOutPrepareHeader", result);
         return false;
     }
@@ -653,7 +640,6 @@ bool WaveEngine::play( const char* data, const size_t size )
 
     if ( result != MMSYSERR_NOERROR )
     {
-        _enabled = false;
         MMerror("waveOutWrite", result);
         return false;
     }
@@ -665,7 +651,7 @@ bool WaveEngine::play( const char* data, const size_t size )
 
 void WaveEngine::free_headers()
 {
-    if (! _audio_device ) return;
+    if (! _audio_device || ! _buffer ) return;
 
     MMRESULT result;
 
@@ -685,36 +671,39 @@ void WaveEngine::free_headers()
     }
 
     delete [] _data;
+    _data = NULL;
 }
 
 void WaveEngine::flush()
 {
-    if ( !_audio_device ) return;
+    // The device is only written to by the writer thread.
+    PullAudioEngine::flush();
+    _reset = true;
+}
 
-    MMRESULT result = waveOutReset( _audio_device );
+
+bool WaveEngine::close()
+{
     _enabled = false;
+    stop_writer();
+    close_ring();
+
+    if (!_audio_device) return false;
+
+    MMRESULT result = waveOutReset( _audio_device );
     if ( result != MMSYSERR_NOERROR )
     {
         MMerror( "waveOutReset", result);
     }
 
     free_headers();
-}
 
-
-bool WaveEngine::close()
-{
-    if (!_audio_device) return false;
-
-    flush();
-
-    MMRESULT result = waveOutClose( _audio_device );
+    result = waveOutClose( _audio_device );
     if ( result != MMSYSERR_NOERROR )
     {
         MMerror( "waveOutClose", result);
     }
 
-    _enabled = false;
     _audio_device = NULL;
     return true;
 }
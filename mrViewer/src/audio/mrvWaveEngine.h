@@ -39,12 +39,12 @@
 #include <mmsystem.h>
 
 #include "core/mrvAlignedData.h"
-#include "core/mrvAudioEngine.h"
+#include "core/mrvPullAudioEngine.h"
 
 
 namespace mrv {
 
-class WaveEngine : public mrv::AudioEngine
+class WaveEngine : public mrv::PullAudioEngine
 {
 public:
     WaveEngine();
@@ -67,16 +67,6 @@ public:
         const unsigned int bits
     );
 
-    // Play some samples (this function does not return until
-    // playback has finished)
-    virtual bool play( const char* data, const size_t size );
-
-    // Retrieve current master volume
-    virtual float volume() const;
-
-    // Change volume of playback
-    virtual void volume( float f );
-
     // Flush all audio sent for playback
     virtual void flush();
 
@@ -92,6 +82,9 @@ protected:
     // device for playback
     virtual bool initialize();
 
+    // Writer thread.  Waits for a free header and queues data on it.
+    virtual bool write_period( const char* data, const size_t bytes );
+
     inline WAVEHDR* get_header();
 
     void free_headers();
@@ -106,6 +99,7 @@ protected:
     unsigned int _samples_per_block;
     unsigned int _num_buffers;
     size_t        bytesPerBlock;
+    std::atomic<bool> _reset;    //!< set by flush(), done by the writer
 
 protected:
     static unsigned int     _instances;
@@ -35,6 +35,7 @@
 #endif
 
 #include <cstdio>     // for snprintf
+#include <cstring>    // for strcmp
 
 #define  __STDC_CONSTANT_MACROS
 
@@ -47,6 +48,7 @@ extern "C" {
 
 
 #include <iostream>
+#include <sstream>
 #include <algorithm>  // for std::min, std::abs
 #include <limits>
 
@@ -59,6 +61,7 @@ extern "C" {
 
 #include <boost/cstdint.hpp>
 #include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 namespace fs = boost::filesystem;
@@ -74,6 +77,8 @@ namespace fs = boost::filesystem;
 #include <ImfStringAttribute.h>
 #include <ImfTimeCodeAttribute.h>
 #include <ImfVecAttribute.h>
+#include <ImfStdIO.h>
+#include <ImfVersion.h>
 
 
 //#include <MagickWand/MagickWand.h>
@@ -89,8 +94,11 @@ namespace fs = boost::filesystem;
 #include "core/mrvColorProfile.h"
 #include "core/mrvException.h"
 #include "core/mrvThread.h"
+#include "core/mrvDiskCache.h"
+#include "core/mrvFrameRegistry.h"
 #include "core/mrvI8N.h"
 #include "core/mrvOS.h"
+#include "core/mrvParallel.h"
 #include "core/mrvTimer.h"
 #include "gui/mrvIO.h"
 #include "gui/mrvPreferences.h"
@@ -99,6 +107,25 @@ namespace {
 
 const char* kModule = "img";
 
+// Serialized value of an attribute, to compare attributes of any type
+std::string attribute_value( const Imf::Attribute& attr )
+{
+    try
+    {
+        Imf::StdOSStream os;
+        attr.writeValueTo( os, Imf::EXR_VERSION );
+        return os.str();
+    }
+    catch( const std::exception& )
+    {
+        // Never the same as another
+        char buf[32];
+        sprintf( buf, "\n%p", (const void*)&attr );
+        return buf;
+    }
+}
+
+
 }
 
 
@@ -159,6 +186,7 @@ bool CMedia::_all_layers = false;
 bool CMedia::_cache_active = true;
 bool CMedia::_preload_cache = true;
 bool CMedia::_8bit_cache = false;
+bool CMedia::_packed_cache = false;
 int  CMedia::_cache_scale = 0;
 
 static const char* const kDecodeStatus[] = {
@@ -366,6 +394,8 @@ av_sync_type( CMedia::AV_SYNC_AUDIO_MASTER ),
 _has_deep_data( false ),
 _w( 0 ),
 _h( 0 ),
+_proxy_level( 0 ),
+_roi_grow( 0 ),
 _internal( false ),
 _is_thumbnail( false ),
 _is_sequence( false ),
@@ -438,6 +468,7 @@ _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
 _actual_frame_rate( 0 ),
+_attrs_frame( AV_NOPTS_VALUE ),
 _context(NULL),
 _video_ctx( NULL ),
 _acontext(NULL),
@@ -484,6 +515,8 @@ av_sync_type( other->av_sync_type ),
 _has_deep_data( other->_has_deep_data ),
 _w( 0 ),
 _h( 0 ),
+_proxy_level( 0 ),
+_roi_grow( 0 ),
 _is_thumbnail( false ),
 _is_sequence( false ),
 _is_stereo( false ),
@@ -548,6 +581,7 @@ _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
 _actual_frame_rate( 0 ),
+_attrs_frame( AV_NOPTS_VALUE ),
 _context(NULL),
 _video_ctx( NULL ),
 _acontext(NULL),
@@ -599,6 +633,8 @@ av_sync_type( other->av_sync_type ),
 _has_deep_data( other->_has_deep_data ),
 _w( 0 ),
 _h( 0 ),
+_proxy_level( 0 ),
+_roi_grow( 0 ),
 _is_thumbnail( other->_is_thumbnail ),
 _is_sequence( other->_is_sequence ),
 _is_stereo( other->_is_stereo ),
@@ -664,6 +700,7 @@ _playback( kStopped ),
 _sequence( NULL ),
 _right( NULL ),
 _actual_frame_rate( 0 ),
+_attrs_frame( AV_NOPTS_VALUE ),
 _context(NULL),
 _video_ctx( NULL ),
 _acontext(NULL),
@@ -753,6 +790,10 @@ void CMedia::clear_cache()
         }
     }
 
+    if ( _packed ) _packed->clear();
+
+    clear_layer_caches();
+
     if ( _stereo[0] )
     {
         _stereo[0].reset();
@@ -778,6 +819,11 @@ void CMedia::update_frame( const int64_t& f )
     boost::uint64_t i = f - _frame_start;
     if ( _sequence[i] )        _sequence[i].reset();
     if ( _right && _right[i] )    _right[i].reset();
+    if ( _packed )             _packed->erase( i );
+
+    LayerCaches::iterator l = _layer_caches.begin();
+    for ( ; l != _layer_caches.end(); ++l )
+        l->second[i].reset();
 
     _hires.reset();
     _stereo[0].reset();
@@ -882,6 +928,8 @@ CMedia::~CMedia()
     delete [] _right;
     _right = NULL;
 
+    _packed.reset();
+
 
 
 
@@ -938,6 +986,11 @@ CMedia::~CMedia()
                 delete d.second;
             }
         }
+
+        for ( const auto& d : _base_attrs )
+        {
+            delete d.second;
+        }
     }
 
     _context = _acontext = NULL;
@@ -955,30 +1008,136 @@ void CMedia::hires( const mrv::image_type_ptr pic)
 
 CMedia::Attributes& CMedia::attributes()  {
     static Attributes empty;
-    AttributesFrame::iterator i;
+    int64_t f;
     if ( dynamic_cast< aviImage* >( this )  != NULL ||
          dynamic_cast< R3dImage* >( this )  != NULL ||
          start_frame() == end_frame() )
-        i = _attrs.find( start_frame() );
+        f = start_frame();
     else
-        i = _attrs.find( _frame );
+        f = _frame;
+
+    SCOPED_LOCK( _attrs_mutex );
+
+    if ( f != _attrs_frame )
+    {
+        // Only one frame is kept whole at a time
+        int64_t old = _attrs_frame;
+        _attrs_frame = f;
+        if ( old != AV_NOPTS_VALUE ) intern_attributes( old );
+
+        // A frame read in full from its header has no shared attributes
+        // to add back
+        if ( load_attributes( f ) )
+            _interned.erase( f );
+        else
+            whole_attributes( f );
+    }
+    else if ( _partial_attrs.find( f ) != _partial_attrs.end() &&
+              load_attributes( f ) )
+    {
+        // Its header was read in the background meanwhile
+        _interned.erase( f );
+    }
+
+    AttributesFrame::iterator i = _attrs.find( f );
     if ( i != _attrs.end() )
         return i->second;
     return empty;
 }
 
-const CMedia::Attributes& CMedia::attributes() const {
-    static Attributes empty;
-    AttributesFrame::const_iterator i;
-    if ( dynamic_cast< const aviImage* const >( this )  != NULL ||
-         dynamic_cast< const R3dImage* const >( this )  != NULL ||
-         start_frame() == end_frame() )
-        i = _attrs.find( start_frame() );
-    else
-        i = _attrs.find( _frame );
-    if ( i != _attrs.end() )
-        return i->second;
-    return empty;
+void CMedia::copy_attributes( const CMedia* other )
+{
+    Mutex::scoped_lock lk_other( other->_attrs_mutex );
+    SCOPED_LOCK( _attrs_mutex );
+
+    for ( const auto& i : other->_attrs )
+    {
+        int64_t frame = i.first;
+        _attrs.insert( std::make_pair( frame, Attributes() ) );
+        for ( const auto& j: i.second )
+        {
+            _attrs[frame][j.first] = j.second->copy();
+        }
+    }
+
+    for ( const auto& j : other->_base_attrs )
+    {
+        _base_attrs[j.first] = j.second->copy();
+    }
+    _base_values = other->_base_values;
+    _interned    = other->_interned;
+    _partial_attrs = other->_partial_attrs;
+}
+
+void CMedia::intern_attributes( const int64_t frame )
+{
+    if ( !is_sequence() ) return;
+
+    SCOPED_LOCK( _attrs_mutex );
+
+    // Its attributes may be in use
+    if ( frame == _attrs_frame ) return;
+
+    AttributesFrame::iterator it = _attrs.find( frame );
+    if ( it == _attrs.end() ) return;
+
+    Attributes& attrs = it->second;
+
+    // Frames whose headers were only partly read keep a few of the
+    // shared attributes and are interned all the same
+    const bool partial = ( _partial_attrs.find( frame ) !=
+                           _partial_attrs.end() );
+
+    if ( _base_attrs.empty() )
+    {
+        if ( partial ) return;
+        for ( const auto& j : attrs )
+        {
+            _base_attrs[j.first] = j.second->copy();
+            _base_values[j.first] = attribute_value( *j.second );
+        }
+    }
+
+    if ( !partial && _interned.find( frame ) == _interned.end() )
+    {
+        for ( const auto& j : _base_attrs )
+        {
+            if ( attrs.find( j.first ) == attrs.end() ) return;
+        }
+    }
+
+    Attributes::iterator i = attrs.begin();
+    while ( i != attrs.end() )
+    {
+        Attributes::const_iterator b = _base_attrs.find( i->first );
+        if ( b != _base_attrs.end() &&
+             strcmp( b->second->typeName(), i->second->typeName() ) == 0 &&
+             attribute_value( *i->second ) == _base_values[ i->first ] )
+        {
+            delete i->second;
+            attrs.erase( i++ );
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    _interned.insert( frame );
+}
+
+void CMedia::whole_attributes( const int64_t frame )
+{
+    SCOPED_LOCK( _attrs_mutex );
+
+    if ( _interned.erase( frame ) == 0 ) return;
+
+    Attributes& attrs = _attrs[frame];
+    for ( const auto& j : _base_attrs )
+    {
+        if ( attrs.find( j.first ) == attrs.end() )
+            attrs.insert( std::make_pair( j.first, j.second->copy() ) );
+    }
 }
 
 
@@ -1524,6 +1683,11 @@ void CMedia::sequence( const char* fileroot,
     av_free( _fileroot );
     _fileroot = av_strdup( fileroot );
 
+    {
+        SCOPED_LOCK( _data_mutex );
+        _key_mtimes.clear();
+    }
+
     std::string f = _fileroot;
     size_t idx = f.find( N_("%V") );
     if ( idx != std::string::npos )
@@ -1545,6 +1709,8 @@ void CMedia::sequence( const char* fileroot,
     _sequence = NULL;
     delete [] _right;
     _right = NULL;
+    _packed.reset();
+    clear_layer_caches();
 
     uint64_t num = _frame_end - _frame_start + 1;
 
@@ -1713,6 +1879,47 @@ std::string CMedia::sequence_filename( const int64_t frame ) const
     return std::string( buf );
 }
 
+std::string CMedia::cache_key( const int64_t frame ) const
+{
+    if ( !is_sequence() ) return "";
+
+    std::string path = sequence_filename( frame );
+
+    std::time_t mtime;
+    bool known;
+    {
+        SCOPED_LOCK( _data_mutex );
+        FrameTimes::const_iterator i = _key_mtimes.find( frame );
+        known = ( i != _key_mtimes.end() );
+        if ( known ) mtime = i->second;
+    }
+
+    if ( !known )
+    {
+        try
+        {
+            if ( !fs::is_regular_file( path ) ) return "";
+            mtime = fs::last_write_time( path );
+        }
+        catch( const fs::filesystem_error& )
+        {
+            return "";
+        }
+
+        SCOPED_LOCK( _data_mutex );
+        _key_mtimes[ frame ] = mtime;
+    }
+
+    std::ostringstream key;
+    key << path << '\n' << mtime << '\n' << frame << '\n'
+        << _8bit_cache << _cache_scale << ( _stereo_output != kNoStereo );
+    // 8-bit caches have the gamma applied
+    if ( _8bit_cache ) key << ' ' << gamma();
+    key << '\n';
+    if ( _channel ) key << _channel;
+    return key.str();
+}
+
 
 
 
@@ -1754,8 +1961,13 @@ bool CMedia::has_changed()
              _sequence[idx]->ctime() != sbuf.st_ctime )
         {
             assert( f == _sequence[idx]->frame() );
+            {
+                SCOPED_LOCK( _data_mutex );
+                _key_mtimes.erase( f );
+            }
             // update frame...
             _sequence[idx].reset();
+            if ( _packed ) _packed->erase( idx );
 
             _is_thumbnail = true;  // to avoid printing errors
             image_type_ptr canvas;
@@ -2051,6 +2263,8 @@ void CMedia::channel( const char* c )
 
     bool to_fetch = false;
 
+    std::string old;
+    if ( _channel ) old = _channel;
 
     if ( _channel != c )
     {
@@ -2136,10 +2350,23 @@ void CMedia::channel( const char* c )
 
     if (to_fetch)
     {
-        clear_cache();
         int64_t f = _frame;
         image_type_ptr canvas;
-        if ( fetch( canvas, f ) )
+
+        // A layer shown before may have the frame cached already
+        bool cached = false;
+        if ( switch_layer_cache( old, ch ) )
+        {
+            SCOPED_LOCK( _mutex );
+            if ( f >= _frame_start && f <= _frame_end )
+                cached = bool( _sequence[f - _frame_start] );
+        }
+        else
+        {
+            clear_cache();
+        }
+
+        if ( !cached && fetch( canvas, f ) )
         {
             if ( !is_sequence() ) _hires = canvas;
             cache( canvas );
@@ -2786,6 +3013,15 @@ bool CMedia::frame( const int64_t f )
     pkt.size = 0;
     pkt.data = NULL;
 
+    // Decompress or map frames ahead of the playhead here, in the reader
+    // thread
+    if ( _sequence && _dts >= _frame_start && _dts <= _frame_end )
+    {
+        const int64_t idx = _dts - _frame_start;
+        if ( !shared_frame( idx ) && !unpack_frame( idx ) )
+            map_frame( idx );
+    }
+
     if ( ! is_cache_filled( _dts ) )
     {
         image_type_ptr canvas;
@@ -2927,6 +3163,8 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
             np.reset( np->resize( w, h ) );
         }
 
+        np->proxy( pic->proxy() );
+        np->full_window( pic->full_window() );
         seq[idx] = np;
     }
     else
@@ -2936,6 +3174,8 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
             w /= (1 << _cache_scale);
             h /= (1 << _cache_scale);
             np.reset( pic->resize( w, h ) );
+            np->proxy( pic->proxy() );
+            np->full_window( pic->full_window() );
             seq[idx] = np;
         }
         else
@@ -2949,8 +3189,17 @@ void CMedia::update_cache_pic( mrv::image_type_ptr*& seq,
 
     DBG;
 
-    _w = w;
-    _h = h;
+    // Keep the frame another image has cached already, if any
+    if ( seq == _sequence && _stereo_output == kNoStereo )
+        seq[idx] = share_frame( seq[idx] );
+
+    // Proxies are stretched to the image size on display and partial
+    // frames are placed in it
+    if ( pic->proxy() == 0 && !pic->partial() )
+    {
+        _w = w;
+        _h = h;
+    }
     DBG;
 
     timestamp(idx, seq);
@@ -2995,7 +3244,7 @@ void CMedia::cache( mrv::image_type_ptr& pic )
          dynamic_cast< const brawImage* >( this ) != NULL )
         return;
 
-
+    if ( is_sequence() && pic ) intern_attributes( pic->frame() );
 
     if ( !is_sequence() || !_cache_active || !pic )
         return;
@@ -3026,6 +3275,179 @@ void CMedia::cache( mrv::image_type_ptr& pic )
 }
 
 
+void CMedia::proxy_level( unsigned l )
+{
+    if ( l > kMaxProxyLevel ) l = kMaxProxyLevel;
+    _proxy_level = l;
+    if ( _right_eye ) _right_eye->proxy_level( l );
+}
+
+void CMedia::roi( const mrv::Recti& r )
+{
+    SCOPED_LOCK( _data_mutex );
+    _roi = r;
+}
+
+mrv::Recti CMedia::roi() const
+{
+    Mutex& mtx = const_cast< Mutex& >( _data_mutex );
+    SCOPED_LOCK( mtx );
+    return _roi;
+}
+
+bool CMedia::roi_region( const mrv::Recti& full, mrv::Recti& region,
+                         const int tw, const int th ) const
+{
+    const uint64_t pixels = uint64_t( full.w() ) * full.h();
+    if ( pixels < kRoiMinPixels ) return false;
+
+    mrv::Recti r = roi();
+    if ( r.w() <= 0 || r.h() <= 0 ) return false;
+
+    // Decode a margin around what is shown, so small pans need no
+    // decode.  The margin doubles with each step of the fill done
+    // while idle, up to kRoiMaxPixels.
+    unsigned grow = std::min( _roi_grow.load(), 30U );
+    for (;;)
+    {
+        int64_t mx = int64_t( std::max( 1, r.w() / 2 ) ) << grow;
+        int64_t my = int64_t( std::max( 1, r.h() / 2 ) ) << grow;
+        mx = std::min( mx, int64_t( full.w() ) );
+        my = std::min( my, int64_t( full.h() ) );
+        region = mrv::Recti( r.x() - int(mx), r.y() - int(my),
+                             r.w() + 2 * int(mx), r.h() + 2 * int(my) );
+        region.intersect( full );
+
+        // Readers decode whole tiles or whole scanlines
+        if ( tw <= 0 )
+        {
+            region.x( full.x() );
+            region.w( full.w() );
+        }
+        else
+        {
+            int x0 = full.x() + ( ( region.x() - full.x() ) / tw ) * tw;
+            int x1 = full.x() + ( ( region.r() - full.x() + tw - 1 ) / tw ) * tw;
+            region.x( x0 );
+            region.w( x1 - x0 );
+        }
+        if ( th > 1 )
+        {
+            int y0 = full.y() + ( ( region.y() - full.y() ) / th ) * th;
+            int y1 = full.y() + ( ( region.b() - full.y() + th - 1 ) / th ) * th;
+            region.y( y0 );
+            region.h( y1 - y0 );
+        }
+        region.intersect( full );
+
+        if ( grow == 0 ||
+             uint64_t( region.w() ) * region.h() <= kRoiMaxPixels ) break;
+        --grow;
+    }
+
+    if ( region.w() <= 0 || region.h() <= 0 ) return false;
+
+    // Not worth it if most of the image is needed
+    return uint64_t( region.w() ) * region.h() * 4 < pixels * 3;
+}
+
+bool CMedia::roi_stale( const mrv::image_type_ptr& pic ) const
+{
+    if ( !pic || !pic->partial() ) return false;
+
+    mrv::Recti need = roi();
+    if ( need.w() <= 0 || need.h() <= 0 ) return true;
+    need.intersect( pic->full_window() );
+
+    const mrv::Recti& held = data_window( pic->frame() );
+    return ( need.x() < held.x() || need.y() < held.y() ||
+             need.r() > held.r() || need.b() > held.b() );
+}
+
+bool CMedia::roi_canvas( mrv::image_type_ptr& canvas,
+                         const mrv::image_type_ptr& held,
+                         const mrv::Recti& region,
+                         std::vector< mrv::Recti >& bands ) const
+{
+    CMedia* self = const_cast< CMedia* >( this );
+    if ( !self->allocate_pixels( canvas, held->frame(), held->channels(),
+                                 held->format(), held->pixel_type(),
+                                 region.w(), region.h() ) )
+        return false;
+
+    canvas->repeat( held->repeat() );
+    canvas->pts( held->pts() );
+    canvas->mtime( held->mtime() );
+
+    const mrv::Recti& full = held->full_window();
+    if ( region != full ) canvas->full_window( full );
+
+    // Pixels held already are copied, a row at a time
+    mrv::Recti have = data_window( held->frame() );
+    mrv::Recti in = have;
+    in.intersect( region );
+    bands.clear();
+    if ( in.w() <= 0 || in.h() <= 0 )
+    {
+        bands.push_back( region );
+        return true;
+    }
+
+    const size_t pixbytes = size_t( held->pixel_size() ) * held->channels();
+    const size_t row = size_t( in.w() ) * pixbytes;
+    const uint8_t* src = (const uint8_t*) held->data().get();
+    uint8_t* dst = (uint8_t*) canvas->data().get();
+    for ( int y = in.y(); y < in.b(); ++y )
+    {
+        const size_t s = ( size_t( y - have.y() ) * have.w() +
+                           ( in.x() - have.x() ) ) * pixbytes;
+        const size_t d = ( size_t( y - region.y() ) * region.w() +
+                           ( in.x() - region.x() ) ) * pixbytes;
+        memcpy( dst + d, src + s, row );
+    }
+
+    // What is left: full rows above and below, then both sides
+    if ( in.y() > region.y() )
+        bands.push_back( mrv::Recti( region.x(), region.y(), region.w(),
+                                     in.y() - region.y() ) );
+    if ( in.b() < region.b() )
+        bands.push_back( mrv::Recti( region.x(), in.b(), region.w(),
+                                     region.b() - in.b() ) );
+    if ( in.x() > region.x() )
+        bands.push_back( mrv::Recti( region.x(), in.y(),
+                                     in.x() - region.x(), in.h() ) );
+    if ( in.r() < region.r() )
+        bands.push_back( mrv::Recti( in.r(), in.y(),
+                                     region.r() - in.r(), in.h() ) );
+    return true;
+}
+
+bool CMedia::fetch_roi()
+{
+    // Decoding many megapixels must not hold the locks the cache checks
+    // and the draw take, so the region is filled into a canvas of its
+    // own and swapped in at the end.
+    image_type_ptr held = left();
+    if ( !held || !held->partial() ) return false;
+
+    image_type_ptr canvas;
+    mrv::Recti region;
+    if ( !fill_region( canvas, held, region ) ) return false;
+
+    SCOPED_LOCK( _mutex );
+
+    // Moved to another frame meanwhile
+    if ( left() != held ) return false;
+
+    const int64_t f = held->frame();
+    data_window( region.x(), region.y(), region.r() - 1, region.b() - 1, f );
+    if ( !is_sequence() ) _hires = canvas;
+    cache( canvas );
+    refresh();
+    image_damage( image_damage() | kDamageData );
+    return true;
+}
+
 /**
  * Check if cache is already filled for a frame
  *
@@ -3046,10 +3468,18 @@ CMedia::Cache CMedia::is_cache_filled(int64_t frame)
 
     CMedia::Cache cache = kNoCache;
     mrv::image_type_ptr pic = _sequence[i];
-    if ( !pic ) return cache;
+    if ( !pic )
+    {
+        // Still in memory, compressed
+        if ( _packed && _packed->has( i ) ) return kLeftCache;
+        return cache;
+    }
 
     if ( !pic->valid() ) return kInvalidFrame;
 
+    // A proxy coarser than what the view needs now must be decoded again
+    if ( pic->proxy() > _proxy_level || roi_stale( pic ) ) return kNoCache;
+
     cache = kLeftCache;
 
     if ( _stereo_output != kNoStereo )
@@ -3530,6 +3960,10 @@ uint64_t CMedia::max_image_frames()
     else
         return std::numeric_limits<int>::max() / 3;
 #else
+    // With compressed caching only the playback window is kept as is
+    if ( _packed )
+        return std::max< uint64_t >( 8, uint64_t( fps() + 0.5 ) );
+
     if ( _hires )
     {
         return (uint64_t)(Preferences::max_memory /
@@ -3649,6 +4083,13 @@ void CMedia::limit_video_store( const int64_t f )
 
     if ( !_sequence ) return;
 
+    uint64_t num  = _frame_end - _frame_start + 1;
+
+    if ( _packed_cache && !_packed )
+        _packed.reset( new PackedCache( num ) );
+    else if ( !_packed_cache && _packed )
+        _packed.reset();
+
     uint64_t max_frames = max_image_frames();
 
 #undef timercmp
@@ -3666,10 +4107,31 @@ void CMedia::limit_video_store( const int64_t f )
     };
 
 
-    uint64_t num  = _frame_end - _frame_start + 1;
-
     typedef std::map< timeval, uint64_t, customMore > TimedSeqMap;
 
+    // Frames of the layers not shown go first, oldest first
+    if ( !_layer_caches.empty() && memory_used >= Preferences::max_memory )
+    {
+        typedef std::multimap< timeval, mrv::image_type_ptr*,
+                               customMore > TimedLayerMap;
+        TimedLayerMap frames;
+        LayerCaches::iterator l = _layer_caches.begin();
+        for ( ; l != _layer_caches.end(); ++l )
+        {
+            for ( uint64_t i = 0; i < num; ++i )
+            {
+                if ( !l->second[i] ) continue;
+                frames.insert( std::make_pair( l->second[i]->ptime(),
+                                               l->second + i ) );
+            }
+        }
+
+        TimedLayerMap::iterator i = frames.begin();
+        for ( ; i != frames.end() &&
+                  memory_used >= Preferences::max_memory; ++i )
+            i->second->reset();
+    }
+
     TimedSeqMap tmp;
     uint64_t image_count = 0;
     for ( uint64_t i = 0; i < num; ++i )
@@ -3684,6 +4146,46 @@ void CMedia::limit_video_store( const int64_t f )
 
     TimedSeqMap::iterator it = tmp.begin();
 
+    if ( _packed )
+    {
+        if ( memory_used < Preferences::max_memory ) return;
+
+        // Compress all but the newest frames instead of dropping them
+        for ( ; it != tmp.end() && image_count > max_frames; ++it )
+        {
+            uint64_t idx = it->second;
+            spill_frame( idx );
+            _packed->pack( idx, _sequence[idx] );
+            _sequence[ idx ].reset();
+            --image_count;
+
+            if ( _right && _right[idx] ) {
+                std::string file = sequence_filename( _right[idx]->frame() );
+                struct stat sbuf;
+                int result = stat( file.c_str(), &sbuf );
+                if ( result == 0 ) {
+                    _disk_space -= sbuf.st_size;
+                }
+                _right[ idx ].reset();
+            }
+        }
+
+        // If that is not enough, drop the frames compressed longest ago.
+        // Frames still being compressed count as already done.
+        size_t idx;
+        while ( memory_used - (int64_t) _packed->pending_bytes() >=
+                Preferences::max_memory && _packed->drop_oldest( idx ) )
+        {
+            std::string file = sequence_filename( idx + _frame_start );
+            struct stat sbuf;
+            int result = stat( file.c_str(), &sbuf );
+            if ( result == 0 ) {
+                _disk_space -= sbuf.st_size;
+            }
+        }
+        return;
+    }
+
     // Erase enough frames to make sure memory used is less than max memory
     for ( ; it != tmp.end() && memory_used >= Preferences::max_memory; ++it )
     {
@@ -3698,6 +4200,7 @@ void CMedia::limit_video_store( const int64_t f )
             if ( result == 0 ) {
                 _disk_space -= sbuf.st_size;
             }
+            spill_frame( idx );
             _sequence[ idx ].reset();
             --image_count;
         }
@@ -3715,6 +4218,134 @@ void CMedia::limit_video_store( const int64_t f )
 
 }
 
+bool CMedia::unpack_frame( const int64_t idx )
+{
+    if ( !_packed || !_sequence || _sequence[idx] ) return false;
+
+    mrv::image_type_ptr pic = _packed->take( idx );
+    if ( !pic ) return false;
+
+    SCOPED_LOCK( _mutex );
+    _sequence[idx] = pic;
+    return true;
+}
+
+void CMedia::spill_frame( const int64_t idx )
+{
+    const mrv::image_type_ptr& pic = _sequence[idx];
+    if ( !pic || !DiskCache::enabled() ) return;
+
+    DiskCache::spill( cache_key( pic->frame() ), pic );
+}
+
+bool CMedia::map_frame( const int64_t idx )
+{
+    if ( !_sequence || _sequence[idx] || !DiskCache::enabled() ) return false;
+
+    std::string key = cache_key( idx + _frame_start );
+    if ( key.empty() ) return false;
+
+    mrv::image_type_ptr pic = DiskCache::map( key );
+    if ( !pic ) return false;
+
+    SCOPED_LOCK( _mutex );
+    _sequence[idx] = share_frame( pic );
+    return true;
+}
+
+bool CMedia::shared_frame( const int64_t idx )
+{
+    if ( !_sequence || _sequence[idx] || _stereo_output != kNoStereo )
+        return false;
+
+    const int64_t f = idx + _frame_start;
+    FrameRegistry::Entries found;
+    FrameRegistry::find( cache_key( f ), found );
+
+    for ( size_t i = 0; i < found.size(); ++i )
+    {
+        const FrameRegistry::Entry& e = found[i];
+        if ( e.pic->proxy() > _proxy_level || roi_stale( e.pic ) ) continue;
+
+        // The windows fetch() would have set for the frame
+        const mrv::Recti& d = e.data;
+        const mrv::Recti& w = e.display;
+        data_window( d.x(), d.y(), d.r() - 1, d.b() - 1, f );
+        display_window( w.x(), w.y(), w.r() - 1, w.b() - 1, f );
+
+        SCOPED_LOCK( _mutex );
+        _sequence[idx] = e.pic;
+        return true;
+    }
+    return false;
+}
+
+mrv::image_type_ptr CMedia::share_frame( const mrv::image_type_ptr& pic )
+{
+    if ( !pic || !_sequence ) return pic;
+
+    const int64_t f = pic->frame();
+    const int64_t idx = f - _frame_start;
+    const int64_t num = _frame_end - _frame_start + 1;
+    if ( idx < 0 || idx >= num ) return pic;
+
+    mrv::Recti data, display;
+    {
+        SCOPED_LOCK( _data_mutex );
+        if ( _dataWindow )    data = _dataWindow[idx];
+        if ( _displayWindow ) display = _displayWindow[idx];
+    }
+
+    return FrameRegistry::share( cache_key( f ), pic, data, display );
+}
+
+bool CMedia::switch_layer_cache( const std::string& from,
+                                 const std::string& to )
+{
+    if ( !_sequence || !is_sequence() || _stereo_output != kNoStereo )
+        return false;
+
+    SCOPED_LOCK( _mutex );
+
+    // Everything else cached is of the old layer
+    boost::uint64_t num = _frame_end - _frame_start + 1;
+    for ( boost::uint64_t i = 0; i < num; ++i )
+    {
+        if ( _right && _right[i] ) _right[i].reset();
+    }
+    if ( _packed ) _packed->clear();
+    _stereo[0].reset();
+    _stereo[1].reset();
+
+    LayerCaches::iterator i = _layer_caches.find( from );
+    if ( i != _layer_caches.end() ) delete [] i->second;
+    _layer_caches[ from ] = _sequence;
+
+    i = _layer_caches.find( to );
+    if ( i != _layer_caches.end() )
+    {
+        _sequence = i->second;
+        _layer_caches.erase( i );
+    }
+    else
+    {
+        _sequence = new mrv::image_type_ptr[ (unsigned) num ];
+    }
+
+    image_damage( image_damage() | kDamageCache | kDamageContents );
+    return true;
+}
+
+void CMedia::clear_layer_caches()
+{
+    SCOPED_LOCK( _mutex );
+
+    LayerCaches::iterator i = _layer_caches.begin();
+    for ( ; i != _layer_caches.end(); ++i )
+        delete [] i->second;
+    _layer_caches.clear();
+}
+
 void CMedia::preroll( const int64_t f )
 {
     // nothing to do for image sequences
@@ -3839,10 +4470,14 @@ void CMedia::debug_video_stores(const int64_t frame,
 
 CMedia::DecodeStatus CMedia::decode_video( int64_t& frame )
 {
-    if ( stopped() && _right_eye && _stereo_output ) {
-        int64_t f = frame;
-        _right_eye->decode_video(f);
-    }
+    // The right eye decodes at the same time as this one,
+    // on a thread of the shared pool, waited for when leaving scope.
+    int64_t rf = frame;
+    boost::scoped_ptr< ParallelTask > right;
+    if ( stopped() && _right_eye && _stereo_output )
+        right.reset( new ParallelTask( boost::bind( &CMedia::decode_video,
+                                                    _right_eye,
+                                                    boost::ref( rf ) ) ) );
 
     mrv::PacketQueue::Mutex& vpm = _video_packets.mutex();
     SCOPED_LOCK( vpm );
@@ -3962,8 +4597,14 @@ int64_t CMedia::loops_offset( int64_t f,
 
 bool CMedia::find_image( int64_t& frame )
 {
+    // The right eye is fetched at the same time as this one,
+    // on a thread of the shared pool, waited for when leaving scope.
+    int64_t rf = frame;
+    boost::scoped_ptr< ParallelTask > right;
     if ( stopped() && _right_eye && _stereo_output )
-        _right_eye->find_image(frame);
+        right.reset( new ParallelTask( boost::bind( &CMedia::find_image,
+                                                    _right_eye,
+                                                    boost::ref( rf ) ) ) );
 
 
     int64_t f = frame;
@@ -3989,7 +4630,13 @@ bool CMedia::find_image( int64_t& frame )
     // the cache.
     bool limit = false;
 
-    if ( _sequence && _sequence[idx] && _sequence[idx]->valid() )
+    if ( !shared_frame( idx ) && !unpack_frame( idx ) ) map_frame( idx );
+
+    bool stale = ( _sequence && _sequence[idx] &&
+                   ( _sequence[idx]->proxy() > _proxy_level ||
+                     roi_stale( _sequence[idx] ) ) );
+
+    if ( _sequence && _sequence[idx] && _sequence[idx]->valid() && !stale )
     {
         SCOPED_LOCK( _mutex );
 
@@ -4017,7 +4664,7 @@ bool CMedia::find_image( int64_t& frame )
     std::string file = sequence_filename(f);
     std::string old  = sequence_filename(_frame);
 
-    if ( !internal() && file != old  )
+    if ( !internal() && ( file != old || stale ) )
     {
         should_load = true;
         av_free( _filename );
@@ -61,6 +61,7 @@
 
 #include "core/mrvString.h"
 #include "core/mrvPacketQueue.h"
+#include "core/mrvPackedCache.h"
 #include "core/mrvImagePixel.h"
 #include "core/mrvRectangle.h"
 #include "core/mrvAudioEngine.h"
@@ -466,7 +467,7 @@ public:
 
 
     /// Save the image under a new filename, with options opts
-    bool save( const char* filename, const ImageOpts* const opts ) const;
+    bool save( const char* filename, const ImageOpts* const opts );
 
     /// Set the image pixel ratio
     inline void  pixel_ratio( double f ) {
@@ -1152,6 +1153,16 @@ public:
         return _audio_info[ _audio_index ].context;
     }
 
+    // File holding audio stream i: the clip or a separate audio file
+    inline std::string audio_filename( unsigned int i ) const
+    {
+        assert( i < _audio_info.size() );
+        if ( _acontext && _audio_info[ i ].context == _acontext )
+            return _audio_file;
+        const char* file = fileroot();
+        return file ? file : "";
+    }
+
     AudioEngine::AudioFormat audio_format() const {
         return _audio_format;
     }
@@ -1224,18 +1235,19 @@ public:
     virtual bool find_image( int64_t& frame );
 
 
+    // Attributes of the current frame.  Frames of sequences only keep the
+    // attributes that differ from the ones shared by all frames and are
+    // made whole again here, one frame at a time.  Decoding changes them,
+    // so hold attrs_mutex() while using them.
     Attributes& attributes();
 
-    const Attributes& attributes() const;
+    // Copy the attributes of all frames of other
+    void copy_attributes( const CMedia* other );
 
     const Attributes& clip_attributes() const {
         return _clip_attrs;
     }
 
-    const AttributesFrame attrs_frames() const {
-        return _attrs;
-    }
-
     static void default_profile( const char* c );
 
     void flush_all();
@@ -1285,6 +1297,9 @@ public:
     inline Mutex& data_mutex()             {
         return _data_mutex;
     };
+    inline Mutex& attrs_mutex() const       {
+        return _attrs_mutex;
+    };
     inline Mutex& video_mutex()             {
         return _mutex;
     };
@@ -1366,6 +1381,13 @@ public:
     // Return the sequence filename for frame 'frame'
     std::string sequence_filename( const int64_t frame ) const;
 
+    // Return the key naming the pixels cached for frame 'frame': file,
+    // modification time, frame, layer and cache settings.  Empty for
+    // frames that do not come from a file on disk.  The file is looked
+    // at once per frame; has_changed() and loading the sequence again
+    // look again.
+    std::string cache_key( const int64_t frame ) const;
+
     // Return the video clock as a double
     double video_clock() const {
         return _video_clock;
@@ -1443,6 +1465,82 @@ public:
 
     virtual void limit_video_store( const int64_t frame );
 
+    // Move frame idx of the sequence out of the compressed cache, if it
+    // is there and not cached already.  Returns true if it was moved.
+    bool unpack_frame( const int64_t idx );
+
+    // Queue frame idx of the sequence for the disk cache, when it is on
+    void spill_frame( const int64_t idx );
+
+    // Map frame idx of the sequence back from the disk cache, if it is
+    // there and not cached already.  Returns true if it was mapped.
+    bool map_frame( const int64_t idx );
+
+    // Take frame idx of the sequence from another image caching the same
+    // pixels, if it is not cached already.  Returns true if it was found.
+    bool shared_frame( const int64_t idx );
+
+    // Frame pic of the sequence, or the same one cached by another image
+    mrv::image_type_ptr share_frame( const mrv::image_type_ptr& pic );
+
+    // Keep the cache of layer from and bring back the cache of layer to,
+    // if it was shown before.  Returns false if the layer caches do not
+    // apply, like for stereo, and the cache must be cleared instead.
+    bool switch_layer_cache( const std::string& from,
+                             const std::string& to );
+
+    // Forget the caches of all layers not shown
+    void clear_layer_caches();
+
+    // Maximum resolution reduction (1/2^n) used for display
+    static const unsigned kMaxProxyLevel = 3;
+
+    // Set the resolution reduction (1/2^n) that the view can display
+    // without loss.  Frames decoded from now on may be decoded at that
+    // resolution.  Cached frames coarser than this are decoded again.
+    void proxy_level( unsigned l );
+    inline unsigned proxy_level() const {
+        return _proxy_level;
+    }
+
+    // Images larger than this many pixels decode only the region the
+    // view shows, when zoomed in
+    static const uint64_t kRoiMinPixels = 32 * 1024 * 1024;
+
+    // Most pixels the progressive fill around the region of interest
+    // grows to, so the whole frame is never needed in memory
+    static const uint64_t kRoiMaxPixels = 16 * 1024 * 1024;
+
+    // Set the region of the image the view shows, in data window pixels.
+    // An empty rectangle means the whole image.
+    void roi( const mrv::Recti& r );
+    mrv::Recti roi() const;
+
+    // Margin decoded around the region of interest, as a power of two
+    // of half its size.  Grown while idle to fill the surroundings.
+    inline void roi_grow( unsigned g ) {
+        _roi_grow = g;
+    }
+    inline unsigned roi_grow() const {
+        return _roi_grow;
+    }
+
+    // Region of full to decode, aligned to tw x th tiles (tw == 0 for
+    // whole scanlines).  Returns false if the whole image should be
+    // decoded instead.
+    bool roi_region( const mrv::Recti& full, mrv::Recti& region,
+                     const int tw = 0, const int th = 1 ) const;
+
+    // True if pic holds only part of the image and the view shows
+    // pixels outside of it.
+    bool roi_stale( const mrv::image_type_ptr& pic ) const;
+
+    // Grow the partial picture shown to the current region of interest.
+    // Only what it lacks is decoded, without holding the image's locks.
+    // False if there was nothing new to decode or the picture shown
+    // changed meanwhile.
+    bool fetch_roi();
+
     inline void is_thumbnail(bool t) {
         _is_thumbnail = t;
     }
@@ -1597,6 +1695,15 @@ public:
         return _8bit_cache;
     }
 
+    // Whether sequence frames out of the playback window are kept
+    // compressed in memory instead of being dropped
+    static void packed_caches( bool x ) {
+        _packed_cache = x;
+    }
+    static bool packed_caches() {
+        return _packed_cache;
+    }
+
     static void preload_cache( bool x ) {
         _preload_cache = x;
     }
@@ -1719,6 +1826,66 @@ protected:
     void update_cache_pic( mrv::image_type_ptr*& seq,
                            const mrv::image_type_ptr& pic );
 
+    /**
+     * Drop the attributes of a frame of a sequence that are the same as
+     * the ones shared by all frames.  The first frame seen gives those.
+     * Frames missing any of them are kept whole.
+     *
+     * @param frame  frame to intern
+     */
+    void intern_attributes( const int64_t frame );
+
+    /**
+     * Give an interned frame back the attributes shared by all frames.
+     *
+     * @param frame  frame to make whole
+     */
+    void whole_attributes( const int64_t frame );
+
+    /**
+     * Read the attributes of a frame left out when its header was read.
+     * Called when its attributes are asked for, until it returns true.
+     * Must not read files, as it runs in the interface thread.  It may
+     * queue the header to be read in the background and return false,
+     * to be called again later.
+     *
+     * @param frame  frame to read the attributes of
+     *
+     * @return true if the frame was in _partial_attrs and is now whole
+     */
+    virtual bool load_attributes( const int64_t frame ) { return false; }
+
+    /**
+     * Decode the region of interest of the frame of a partial picture,
+     * for fetch_roi().  Runs without the image's locks, so it must not
+     * change the image.
+     *
+     * @param canvas  picture for region, filled
+     * @param held    partial picture of the frame shown
+     * @param region  data window of canvas
+     *
+     * @return false if nothing new would be decoded
+     */
+    virtual bool fill_region( mrv::image_type_ptr& canvas,
+                              const mrv::image_type_ptr& held,
+                              mrv::Recti& region ) const { return false; }
+
+    /**
+     * Allocate canvas for region in the layout of held and copy into it
+     * the pixels held has.  Used by fill_region().
+     *
+     * @param canvas  picture to allocate
+     * @param held    partial picture of the same frame
+     * @param region  data window of canvas
+     * @param bands   parts of region left to decode
+     *
+     * @return false if out of memory
+     */
+    bool roi_canvas( mrv::image_type_ptr& canvas,
+                     const mrv::image_type_ptr& held,
+                     const mrv::Recti& region,
+                     std::vector< mrv::Recti >& bands ) const;
+
     /**
      * Given a frame number, returns whether audio for that frame is already
      * in packet queue.
@@ -1893,6 +2060,9 @@ protected:
 
 
     std::atomic<size_t>  _w, _h;     //!< width and height of image
+    std::atomic<unsigned> _proxy_level; //!< resolution reduction for display
+    mrv::Recti             _roi;         //!< region of interest (data window)
+    std::atomic<unsigned>  _roi_grow;    //!< margin around region of interest
     bool   _internal;      //!< image is internal with no filename
     bool   _is_thumbnail;     //!< image is a thumbnail (no printing of errors)
     bool   _is_sequence;      //!< true if a sequence
@@ -1903,6 +2073,8 @@ protected:
     char*  _fileroot;         //!< root name of image sequence
     char*  _filename;         //!< generated filename of a frame
     time_t _ctime, _mtime;    //!< creation and modification time of image
+    typedef std::map< int64_t, time_t > FrameTimes;
+    mutable FrameTimes _key_mtimes;  //!< of cache_key(), under _data_mutex
     size_t _disk_space;       //!< disk space used by image
 
     mutable Mutex  _mutex;          //!< to mark image routines
@@ -2017,6 +2189,11 @@ protected:
     mrv::image_type_ptr* _sequence; //!< For sequences, holds each float frame
     mrv::image_type_ptr* _right;    //!< For stereo sequences, holds each
     //!  right float frame
+    mrv::PackedCachePtr  _packed;   //!< Compressed frames of _sequence
+
+    typedef std::map< std::string, mrv::image_type_ptr* > LayerCaches;
+    LayerCaches _layer_caches;      //!< Caches of layers shown before, by
+    //!  layer name.  _sequence is the cache of the layer shown.
     ACES::ASC_CDL _sops;            //!< Slope,Offset,Pivot,Saturation
     ACES::ACESclipReader::GradeRefs _grade_refs; //!< SOPS Nodes in ASCII
 
@@ -2030,6 +2207,12 @@ protected:
 
     Attributes      _clip_attrs;
     AttributesFrame _attrs;                    //!< All attributes
+    int64_t         _attrs_frame;     //!< frame with its attributes whole
+    Attributes      _base_attrs;      //!< attributes shared by all frames
+    std::map< std::string, std::string > _base_values; //!< and their values
+    std::set< int64_t > _interned;    //!< frames keeping only differences
+    std::set< int64_t > _partial_attrs; //!< frames with attributes left to read
+    mutable Mutex   _attrs_mutex;     //!< to mark attribute routines
 
     // Audio/Video
     AVFormatContext* _context;           //!< current read file context
@@ -2079,6 +2262,7 @@ protected:
     static bool _ocio_color_space;
     static bool _all_layers;
     static bool _8bit_cache;
+    static bool _packed_cache;
     static bool _cache_active;
     static bool _preload_cache;
     static int  _cache_scale;
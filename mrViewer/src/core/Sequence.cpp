@@ -927,6 +927,39 @@ bool parse_reel( mrv::LoadList& sequences, bool& edl,
                 }
                 continue;
             }
+            else if ( cmd == "GLPathShapeD" )
+            {
+                std::string points;
+                GLPathShape* shape = new GLPathShape;
+                std::getline( is, points );
+                is.str( points );
+                is.clear();
+                is >> shape->stroke >> shape->r >> shape->g >> shape->b
+                   >> shape->a >> shape->pen_size >> shape->frame;
+                shape->receive_points( is );
+                if ( !sequences.empty() )
+                {
+                    sequences.back().shapes.push_back(
+                        mrv::shape_type_ptr(shape) );
+                }
+                continue;
+            }
+            else if ( cmd == "GLErasePathShapeD" )
+            {
+                std::string points;
+                GLErasePathShape* shape = new GLErasePathShape;
+                std::getline( is, points );
+                is.str( points );
+                is.clear();
+                is >> shape->stroke >> shape->pen_size >> shape->frame;
+                shape->receive_points( is );
+                if ( !sequences.empty() )
+                {
+                    sequences.back().shapes.push_back(
+                        mrv::shape_type_ptr(shape) );
+                }
+                continue;
+            }
             else if ( cmd == "GLErasePathShape" )
             {
                 Point xy;
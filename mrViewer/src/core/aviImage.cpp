@@ -40,6 +40,7 @@
 #include <algorithm>
 #include <limits>
 #include <cstring>
+#include <set>
 using namespace std;
 
 
@@ -66,6 +67,9 @@ extern "C" {
 
 
 #include <boost/filesystem.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 namespace fs = boost::filesystem;
 
 #include <ImfStringAttribute.h>
@@ -77,6 +81,7 @@ namespace fs = boost::filesystem;
 #include "core/mrvFrameFunctors.h"
 #include "core/mrvThread.h"
 #include "core/mrvCPU.h"
+#include "core/mrvParallel.h"
 #include "core/mrvColorSpaces.h"
 #include "core/YouTube.h"
 #include "gui/mrvPreferences.h"
@@ -124,6 +129,119 @@ const char* kModule = "avi";
 
 namespace {
 const unsigned int  kMaxCacheImages = 70;
+
+// Contexts decoding intra-only streams at the same time
+const unsigned int  kMaxIntraContexts = 8;
+
+// Bands a conversion is split in, and the fewest rows worth a thread
+const unsigned int  kMaxSlices = 8;
+const unsigned int  kMinSliceRows = 128;
+
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+const uint64_t kPseudoPal = AV_PIX_FMT_FLAG_PSEUDOPAL;
+#else
+const uint64_t kPseudoPal = 0;
+#endif
+
+// Extra bytes after decoder buffers, for codecs that read past the end
+const unsigned int  kDirectPadding = 64;
+
+// Buffer a decoder writes its pictures to, laid out as our images
+struct DirectBuffer
+{
+    mrv::VideoFrame::PixelData data;
+    size_t size;
+};
+
+// Buffers handed to decoders and not freed yet, to tell them from the
+// decoders' own
+boost::mutex                  _direct_mutex;
+std::set< const uint8_t* >    _direct_buffers;
+
+void free_direct( void* opaque, uint8_t* data )
+{
+    {
+        boost::mutex::scoped_lock lk( _direct_mutex );
+        _direct_buffers.erase( data );
+    }
+    delete (DirectBuffer*) opaque;
+}
+
+bool is_direct( const AVBufferRef* buf )
+{
+    boost::mutex::scoped_lock lk( _direct_mutex );
+    return _direct_buffers.find( buf->data ) != _direct_buffers.end();
+}
+
+// One horizontal band of a conversion
+struct Slice
+{
+    SwsContext* ctx;
+    uint8_t*    src[4];
+    int         src_linesize[4];
+    uint8_t*    dst[4];
+    int         dst_linesize[4];
+    int         rows;
+};
+
+void scale_slices( std::vector< Slice >* slices, const size_t first,
+                   const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        Slice* s = &(*slices)[i];
+        sws_scale( s->ctx, s->src, s->src_linesize, 0, s->rows,
+                   s->dst, s->dst_linesize );
+    }
+}
+
+// Point the planes of an image of format fmt at row y
+void offset_planes( uint8_t* const data[4], const int linesize[4],
+                    const AVPixelFormat fmt, const int y, uint8_t* out[4] )
+{
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get( fmt );
+    const bool yuv = !( desc->flags & AV_PIX_FMT_FLAG_RGB );
+    for ( int i = 0; i < 4; ++i )
+    {
+        if ( !data[i] ) { out[i] = NULL; continue; }
+        int rows = ( yuv && ( i == 1 || i == 2 ) ) ?
+                   ( y >> desc->log2_chroma_h ) : y;
+        out[i] = data[i] + rows * linesize[i];
+    }
+}
+
+// Move the planes of a picture decoded into a padded buffer to the
+// layout of our images, which starts at the same address.  No row
+// moves to a higher address, so it is done in place, in order.
+void crop_planes( AVFrame* f )
+{
+    const AVPixelFormat fmt = (AVPixelFormat) f->format;
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get( fmt );
+
+    uint8_t* dst[4];
+    int dst_linesize[4];
+    av_image_fill_arrays( dst, dst_linesize, f->data[0], fmt,
+                          f->width, f->height, 1 );
+
+    for ( int i = 0; i < 4 && dst[i]; ++i )
+    {
+        if ( dst[i] == f->data[i] && dst_linesize[i] == f->linesize[i] )
+            continue;
+
+        int rows = f->height;
+        if ( i == 1 || i == 2 )
+            rows = ( rows + ( 1 << desc->log2_chroma_h ) - 1 ) >>
+                   desc->log2_chroma_h;
+
+        for ( int y = 0; y < rows; ++y )
+            memmove( dst[i] + y * dst_linesize[i],
+                     f->data[i] + y * f->linesize[i], dst_linesize[i] );
+
+        f->data[i] = dst[i];
+        f->linesize[i] = dst_linesize[i];
+    }
+}
+
 }
 
 namespace mrv {
@@ -232,6 +350,10 @@ aviImage::~aviImage()
         _convert_ctx = NULL;
     }
 
+    for ( size_t i = 0; i < _slice_ctx.size(); ++i )
+        sws_freeContext( _slice_ctx[i] );
+    _slice_ctx.clear();
+
     if ( filter_graph )
         avfilter_graph_free(&filter_graph);
 
@@ -828,6 +950,8 @@ void aviImage::open_video_codec()
 
     avcodec_parameters_from_context( stream->codecpar, _video_ctx );
 
+    direct_decode( _video_ctx, video_codec );
+
     AVDictionary* info = NULL;
     if (!av_dict_get(info, "threads", NULL, 0))
         av_dict_set(&info, "threads", Preferences::video_threads.c_str(), 0 );
@@ -840,10 +964,77 @@ void aviImage::open_video_codec()
             avcodec_open2( _video_ctx, video_codec, &info ) < 0 )
         _video_index = -1;
 
+    av_dict_free( &info );
+
+    if ( _video_index >= 0 ) open_intra_pool( stream, video_codec );
+}
+
+// Every packet of an intra-only stream is a whole picture, so several
+// can be decoded at once by separate contexts.  Slice threads scale
+// poorly for these codecs and not all of them have frame threads.
+void aviImage::open_intra_pool( const AVStream* stream,
+                                const AVCodec* codec )
+{
+    close_intra_pool();
+
+    const AVCodecDescriptor* desc =
+        avcodec_descriptor_get( stream->codecpar->codec_id );
+    if ( !desc || !( desc->props & AV_CODEC_PROP_INTRA_ONLY ) ) return;
+
+    unsigned n = atoi( Preferences::video_threads.c_str() );
+    if ( n == 0 ) n = boost::thread::hardware_concurrency();
+    n = std::min( n, kMaxIntraContexts );
+    if ( n < 2 ) return;
+
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        AVCodecContext* ctx = avcodec_alloc_context3( codec );
+        if ( !ctx ) break;
+
+        AVDictionary* info = NULL;
+        av_dict_set( &info, "threads", "1", 0 );
+        av_dict_set( &info, "refcounted_frames", "1", 0 );
+
+        int r = avcodec_parameters_to_context( ctx, stream->codecpar );
+        if ( r >= 0 )
+        {
+            direct_decode( ctx, codec );
+            r = avcodec_open2( ctx, codec, &info );
+        }
+        av_dict_free( &info );
+
+        if ( r < 0 )
+        {
+            avcodec_free_context( &ctx );
+            break;
+        }
+
+        _intra_ctx.push_back( ctx );
+        _intra_frames.push_back( av_frame_alloc() );
+    }
+
+    _intra_got.resize( _intra_ctx.size() );
+
+    // A pool of one is no better than the main context
+    if ( _intra_ctx.size() < 2 ) close_intra_pool();
+}
+
+void aviImage::close_intra_pool()
+{
+    for ( size_t i = 0; i < _intra_ctx.size(); ++i )
+    {
+        avcodec_free_context( &_intra_ctx[i] );
+        av_frame_free( &_intra_frames[i] );
+    }
+    _intra_ctx.clear();
+    _intra_frames.clear();
+    _intra_got.clear();
 }
 
 void aviImage::close_video_codec()
 {
+    close_intra_pool();
+
     if ( _video_ctx && _video_index >= 0 )
     {
         avcodec_free_context( &_video_ctx );
@@ -859,6 +1050,8 @@ void aviImage::flush_video()
     {
         avcodec_flush_buffers( _video_ctx );
     }
+    for ( size_t i = 0; i < _intra_ctx.size(); ++i )
+        avcodec_flush_buffers( _intra_ctx[i] );
 }
 
 
@@ -902,6 +1095,36 @@ CMedia::Cache aviImage::is_cache_filled( int64_t frame )
     return (CMedia::Cache) ok;
 }
 
+int64_t aviImage::keyframe_before( const int64_t frame )
+{
+    AVStream* stream = get_video_stream();
+    if ( !stream || _has_image_seq ) return frame;
+
+    if ( !_keyframes )
+        _keyframes = KeyframeIndex::find( fileroot(), video_stream_index() );
+    if ( !_keyframes ) return frame;
+
+    // Same mapping as seek_to_position
+    int64_t start = frame - _start_number;
+    if ( start < 1 ) return frame;
+
+    int64_t pts = frame2pts( stream, start );
+    if ( stream->start_time != AV_NOPTS_VALUE )
+        pts += stream->start_time;
+
+    KeyframeIndex::Keyframe k;
+    if ( !_keyframes->before( pts, k ) ) return frame;
+
+    pts = k.pts;
+    if ( stream->start_time != AV_NOPTS_VALUE )
+        pts -= stream->start_time;
+
+    int64_t f = pts2frame( stream, pts ) + _start_number;
+    if ( f > frame ) f = frame;
+    if ( f < first_frame() ) f = first_frame();
+    return f;
+}
+
 // Seek to the requested frame
 bool aviImage::seek_to_position( const int64_t frame )
 {
@@ -973,7 +1196,39 @@ bool aviImage::seek_to_position( const int64_t frame )
     int flag = AVSEEK_FLAG_BACKWARD;
     if ( !skip )
     {
-        ret = av_seek_frame( _context, -1, offset, flag );
+        AVStream* stream = got_video ? NULL : get_video_stream();
+        if ( stream && !_keyframes && !_has_image_seq )
+            _keyframes = KeyframeIndex::find( fileroot(),
+                                              video_stream_index() );
+
+        KeyframeIndex::Keyframe k;
+        bool indexed = false;
+        int64_t pts = 0;
+        if ( stream )
+        {
+            pts = frame2pts( stream, start + 1 );
+            if ( stream->start_time != AV_NOPTS_VALUE )
+                pts += stream->start_time;
+        }
+
+        if ( stream && _keyframes && _keyframes->before( pts, k ) )
+        {
+            // Go straight to the keyframe before the frame.  Byte
+            // offsets are used for streams whose timestamps cannot be
+            // trusted to seek, like MPEG transport streams.
+            const AVInputFormat* fmt = _context->iformat;
+            if ( k.pos >= 0 && ( fmt->flags & AVFMT_TS_DISCONT ) &&
+                 !( fmt->flags & AVFMT_NO_BYTE_SEEK ) )
+                ret = av_seek_frame( _context, stream->index, k.pos,
+                                     flag | AVSEEK_FLAG_BYTE );
+            else
+                ret = av_seek_frame( _context, stream->index, k.dts, flag );
+            indexed = ( ret >= 0 );
+        }
+
+        // No index yet, or the demuxer refused
+        if ( !indexed )
+            ret = av_seek_frame( _context, -1, offset, flag );
         // ret = avformat_seek_file( _context, -1,
         //                        std::numeric_limits<int64_t>::min(), offset,
         //                        std::numeric_limits<int64_t>::max(), flag );
@@ -1130,38 +1385,156 @@ mrv::image_type_ptr aviImage::allocate_image( const int64_t& frame,
 }
 
 
-void aviImage::store_image( const int64_t frame,
-                            const int64_t pts )
+// Decoders that take our buffers write pictures straight into the
+// layout of our images.  Only intra-only streams do so, as the
+// pictures of other codecs are kept as references and would be
+// changed under the images that share them.
+void aviImage::direct_decode( AVCodecContext* ctx, const AVCodec* codec )
 {
-    mrv::image_type_ptr image;
-    try {
-        image = allocate_image( frame, pts );
+    if ( !codec || !( codec->capabilities & AV_CODEC_CAP_DR1 ) ) return;
+
+    const AVCodecDescriptor* desc = avcodec_descriptor_get( codec->id );
+    if ( !desc || !( desc->props & AV_CODEC_PROP_INTRA_ONLY ) ) return;
+
+    ctx->opaque      = this;
+    ctx->get_buffer2 = aviImage::get_buffer;
+#if FF_API_THREAD_SAFE_CALLBACKS
+    ctx->thread_safe_callbacks = 1;
+#endif
+}
+
+bool aviImage::direct_layout( const AVCodecContext* ctx, const int fmt,
+                              const int w, const int h,
+                              int linesize[4], int& rows ) const
+{
+    if ( fmt != _av_dst_pix_fmt ) return false;
+    if ( ctx->width != (int)width() || ctx->height != (int)height() )
+        return false;
+    if ( w < ctx->width || h < ctx->height ) return false;
+    if ( ctx->width > (int)mrv::GLEngine::maxTexWidth() ||
+         ctx->height > (int)mrv::GLEngine::maxTexHeight() ) return false;
+
+    // Decoders may write up to the aligned size of the picture (1080
+    // rows are decoded as 1088, say), so buffers are allocated that
+    // large and cropped to our layout once decoded.
+    int aw = w;
+    rows = h;
+    int align[AV_NUM_DATA_POINTERS];
+    avcodec_align_dimensions2( const_cast< AVCodecContext* >( ctx ),
+                               &aw, &rows, align );
+
+    if ( av_image_fill_linesizes( linesize, (AVPixelFormat) fmt, aw ) < 0 )
+        return false;
+
+    for ( int i = 0; i < 4; ++i )
+    {
+        if ( linesize[i] && align[i] )
+            linesize[i] = ( linesize[i] + align[i] - 1 ) / align[i] *
+                          align[i];
+    }
+    return true;
+}
+
+int aviImage::get_buffer( AVCodecContext* ctx, AVFrame* frame,
+                          int flags )
+{
+    const aviImage* img = (const aviImage*) ctx->opaque;
+    int linesize[4];
+    int rows;
+    if ( !img || !img->direct_layout( ctx, frame->format,
+                                      frame->width, frame->height,
+                                      linesize, rows ) )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    AVPixelFormat fmt = (AVPixelFormat) frame->format;
+    uint8_t* planes[4];
+    int size = av_image_fill_pointers( planes, fmt, rows, NULL, linesize );
+    if ( size <= 0 )
+        return avcodec_default_get_buffer2( ctx, frame, flags );
+
+    DirectBuffer* db = new DirectBuffer;
+    db->size = size;
+    try
+    {
+        db->data.reset( new aligned16_uint8_t[ size + kDirectPadding ] );
     }
     catch ( const std::bad_alloc& e )
     {
-        LOG_ERROR( _("Not enough memory for image") );
-        return;
+        delete db;
+        return AVERROR(ENOMEM);
     }
-    catch ( const std::exception& e )
+
+    uint8_t* ptr = (uint8_t*) db->data.get();
+    frame->buf[0] = av_buffer_create( ptr, size + kDirectPadding,
+                                      free_direct, db, 0 );
+    if ( !frame->buf[0] )
     {
-        LOG_ERROR( _("Problem allocating image ") << e.what() );
-        return;
+        delete db;
+        return AVERROR(ENOMEM);
     }
 
+    {
+        boost::mutex::scoped_lock lk( _direct_mutex );
+        _direct_buffers.insert( ptr );
+    }
+
+    av_image_fill_pointers( frame->data, fmt, rows, ptr, linesize );
+    for ( int i = 0; i < 4; ++i )
+        frame->linesize[i] = linesize[i];
+    frame->extended_data = frame->data;
+    return 0;
+}
+
+bool aviImage::direct_image( const int64_t frame, const int64_t pts,
+                             mrv::image_type_ptr& image )
+{
+    // Conversions sws_scale would still do on the same format
+    if ( _inv_table || ( filter_graph && _subtitle_index >= 0 ) )
+        return false;
 
-    if ( ! image )
+    if ( !_av_frame->buf[0] || _av_frame->buf[1] ||
+         !is_direct( _av_frame->buf[0] ) ||
+         _av_frame->format != _av_dst_pix_fmt ||
+         _av_frame->width != (int)width() ||
+         _av_frame->height != (int)height() )
+        return false;
+
+    DirectBuffer* db =
+        (DirectBuffer*) av_buffer_get_opaque( _av_frame->buf[0] );
+    if ( _av_frame->data[0] != (uint8_t*) db->data.get() )
+        return false;
+
+    crop_planes( _av_frame );
+
+    try {
+        image.reset( new image_type( frame, width(), height(),
+                                     (unsigned short) _num_channels,
+                                     _pix_fmt, _ptype, db->data,
+                                     _av_frame->repeat_pict, pts ) );
+    }
+    catch ( const std::exception& e )
     {
-        IMG_ERROR( "No memory for video frame" );
-        IMG_ERROR( "Audios #" << _audio.size() );
-        IMG_ERROR( "Videos #" << _images.size() );
-        return;
+        return false;
     }
 
+    if ( image->data_size() > db->size )
+    {
+        image.reset();
+        return false;
+    }
+    return true;
+}
+
+// Convert _av_frame into image.  Without scaling and when source and
+// destination subsample chroma rows alike, rows are independent and the
+// picture is converted in bands by parallel_for.
+bool aviImage::convert_image( const mrv::image_type_ptr& image )
+{
     AVFrame output = { 0 };
     boost::uint8_t* ptr = (boost::uint8_t*)image->data().get();
 
-    unsigned int w = width();
-    unsigned int h = height();
+    unsigned int w = image->width();
+    unsigned int h = image->height();
 
     // Fill the fields of AVPicture output based on _av_dst_pix_fmt
     // avpicture_fill( &output, ptr, _av_dst_pix_fmt, w, h );
@@ -1202,7 +1575,7 @@ void aviImage::store_image( const int64_t frame,
     if ( _convert_ctx == NULL )
     {
         IMG_ERROR( _("Could not get image conversion context.") );
-        return;
+        return false;
     }
 
     int in_full, out_full, brightness, contrast, saturation;
@@ -1255,8 +1628,114 @@ void aviImage::store_image( const int64_t frame,
 
     _av_frame->color_range = out_full ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
 
-    sws_scale(_convert_ctx, _av_frame->data, _av_frame->linesize,
-              0, _video_ctx->height, output.data, output.linesize);
+    unsigned n = 1;
+    const AVPixFmtDescriptor* sd = av_pix_fmt_desc_get( fmt );
+    const AVPixFmtDescriptor* dd = av_pix_fmt_desc_get( _av_dst_pix_fmt );
+    if ( sws_flags == 0 && sd && dd &&
+         (int)w == _video_ctx->width && (int)h == _video_ctx->height &&
+         sd->log2_chroma_h == dd->log2_chroma_h &&
+         !( sd->flags & AV_PIX_FMT_FLAG_PAL ) &&
+         !( sd->flags & kPseudoPal ) )
+    {
+        n = std::min( parallel_threads(), kMaxSlices );
+        n = std::min( n, h / kMinSliceRows );
+    }
+
+    if ( n < 2 )
+    {
+        sws_scale(_convert_ctx, _av_frame->data, _av_frame->linesize,
+                  0, _video_ctx->height, output.data, output.linesize);
+        return true;
+    }
+
+    // Bands start on rows that are whole for any chroma subsampling
+    unsigned rows = ( ( h / n ) + 15 ) & ~15U;
+    n = ( h + rows - 1 ) / rows;
+
+    if ( _slice_ctx.size() < n ) _slice_ctx.resize( n, NULL );
+
+    std::vector< Slice > slices( n );
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        Slice& s = slices[i];
+        unsigned y = i * rows;
+        s.rows = std::min( rows, h - y );
+
+        _slice_ctx[i] = sws_getCachedContext( _slice_ctx[i], w, s.rows, fmt,
+                                              w, s.rows, _av_dst_pix_fmt,
+                                              sws_flags, NULL, NULL, NULL );
+        if ( !_slice_ctx[i] )
+        {
+            IMG_ERROR( _("Could not get image conversion context.") );
+            return false;
+        }
+        sws_setColorspaceDetails( _slice_ctx[i], inv_table, in_full,
+                                  table, out_full,
+                                  brightness, contrast, saturation );
+
+        s.ctx = _slice_ctx[i];
+        offset_planes( _av_frame->data, _av_frame->linesize, fmt, y, s.src );
+        offset_planes( output.data, output.linesize, _av_dst_pix_fmt, y,
+                       s.dst );
+        memcpy( s.src_linesize, _av_frame->linesize, sizeof(s.src_linesize) );
+        memcpy( s.dst_linesize, output.linesize, sizeof(s.dst_linesize) );
+    }
+
+    parallel_for( 0, n, 1, boost::bind( scale_slices, &slices, _1, _2 ) );
+
+    return true;
+}
+
+void aviImage::store_image( const int64_t frame,
+                            const int64_t pts )
+{
+    // When playing zoomed out, scale down to what the view can show.
+    // The image keeps its size and the frame is stretched to it.
+    const unsigned proxy = proxy_level();
+
+    mrv::image_type_ptr image;
+
+    // Pixels decoded straight into our layout are used as they are
+    if ( proxy > 0 || !direct_image( frame, pts, image ) )
+    {
+        try {
+            if ( proxy > 0 )
+            {
+                unsigned pw = std::max( 1U, unsigned( width() )  >> proxy );
+                unsigned ph = std::max( 1U, unsigned( height() ) >> proxy );
+                image.reset( new image_type( frame, pw, ph,
+                                             (unsigned short) _num_channels,
+                                             _pix_fmt, _ptype,
+                                             _av_frame->repeat_pict, pts ) );
+                image->proxy( (unsigned short) proxy );
+            }
+            else
+            {
+                image = allocate_image( frame, pts );
+            }
+        }
+        catch ( const std::bad_alloc& e )
+        {
+            LOG_ERROR( _("Not enough memory for image") );
+            return;
+        }
+        catch ( const std::exception& e )
+        {
+            LOG_ERROR( _("Problem allocating image ") << e.what() );
+            return;
+        }
+
+
+        if ( ! image )
+        {
+            IMG_ERROR( "No memory for video frame" );
+            IMG_ERROR( "Audios #" << _audio.size() );
+            IMG_ERROR( "Videos #" << _images.size() );
+            return;
+        }
+
+        if ( ! convert_image( image ) ) return;
+    }
 
     if ( _av_frame->interlaced_frame )
         _interlaced = ( _av_frame->top_field_first ?
@@ -1494,6 +1973,93 @@ aviImage::decode_video_packet( int64_t& ptsframe,
 
 
 
+void aviImage::decode_intra( const std::vector< const AVPacket* >* pkts,
+                             const size_t first, const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        bool eof = false;
+        int got = 0;
+        av_frame_unref( _intra_frames[i] );
+        if ( decode( _intra_ctx[i], _intra_frames[i], &got,
+                     (AVPacket*)(*pkts)[i], eof ) < 0 )
+            got = 0;
+        _intra_got[i] = got;
+    }
+}
+
+CMedia::DecodeStatus aviImage::decode_intra_packets( const int64_t frame )
+{
+    AVStream* stream = get_video_stream();
+    assert0( stream != NULL );
+
+    // The run stops at the first marker, at a frame already stored or
+    // at one too far ahead.
+    std::vector< const AVPacket* > pkts;
+    mrv::PacketQueue::const_iterator i = _video_packets.begin();
+    mrv::PacketQueue::const_iterator e = _video_packets.end();
+    for ( ; i != e && pkts.size() < _intra_ctx.size(); ++i )
+    {
+        if ( mrv::PacketQueue::is_marker( *i ) ) break;
+
+        int64_t pktframe = get_frame( stream, *i );
+        if ( pktframe == AV_NOPTS_VALUE ) pktframe = frame;
+        if ( !pkts.empty() &&
+             ( in_video_store( pktframe ) ||
+               pktframe > _frame + max_video_frames() ) )
+            break;
+
+        pkts.push_back( &(*i) );
+    }
+
+    // End of stream packets are for the main context
+    if ( pkts.empty() )
+    {
+        DecodeStatus status = decode_image( frame, _video_packets.front() );
+        _video_packets.pop_front();
+        return status;
+    }
+
+    parallel_for( 0, pkts.size(), 1,
+                  boost::bind( &aviImage::decode_intra, this, &pkts,
+                               _1, _2 ) );
+
+    DecodeStatus status = kDecodeMissingFrame;
+    for ( size_t j = 0; j < pkts.size(); ++j )
+    {
+        const AVPacket& pkt = *pkts[j];
+        if ( _intra_got[j] )
+        {
+            AVFrame* f = _intra_frames[j];
+            int64_t pts = f->best_effort_timestamp;
+            if ( pts == AV_NOPTS_VALUE ) pts = pkt.pts;
+            if ( pts == AV_NOPTS_VALUE ) pts = pkt.dts;
+
+            int64_t ptsframe;
+            if ( pts == AV_NOPTS_VALUE )
+            {
+                ptsframe = get_frame( stream, pkt );
+                if ( ptsframe == AV_NOPTS_VALUE ) ptsframe = frame;
+            }
+            else
+            {
+                ptsframe = pts2frame( stream, pts );
+            }
+            f->pts = pts;
+
+            // store_image() converts _av_frame
+            std::swap( _av_frame, _intra_frames[j] );
+            store_image( ptsframe, _av_frame->pts );
+            std::swap( _av_frame, _intra_frames[j] );
+            av_frame_unref( _intra_frames[j] );
+            status = kDecodeOK;
+        }
+        _video_packets.pop_front();
+    }
+
+    return status;
+}
+
 // Decode the image
 CMedia::DecodeStatus
 aviImage::decode_image( const int64_t frame, AVPacket& pkt )
@@ -2959,10 +3525,24 @@ bool aviImage::initialize()
             av_format_inject_global_side_data(_context);
 
             // Change probesize and analyze duration to 30 secs
-            // to detect subtitles and other streams.
+            // to detect subtitles and other streams.  Not needed if the
+            // container lists its streams in its header and the file was
+            // opened before (it has a keyframe index).
             if ( _context )
             {
-                probe_size( 30 * AV_TIME_BASE );
+                bool known = false;
+                if ( !( _context->ctx_flags & AVFMTCTX_NOHEADER ) )
+                {
+                    for ( unsigned i = 0; i < _context->nb_streams; ++i )
+                    {
+                        if ( KeyframeIndex::known( fileroot(), i ) )
+                        {
+                            known = true;
+                            break;
+                        }
+                    }
+                }
+                if ( !known ) probe_size( 30 * AV_TIME_BASE );
             }
 
             DBGM1( "avformat_find_stream_info " << fileroot() );
@@ -2982,6 +3562,11 @@ bool aviImage::initialize()
             populate();
             DBGM1( "populated " << fileroot() );
             _initialize = true;
+
+            // Start indexing the keyframes in the background
+            if ( has_video() && !_has_image_seq )
+                _keyframes = KeyframeIndex::find( fileroot(),
+                                                  video_stream_index() );
         }
         else
         {
@@ -3835,6 +4420,15 @@ CMedia::DecodeStatus aviImage::decode_video( int64_t& f )
             }
 
 
+            // Intra-only streams decode several packets at once while
+            // playing.  Scrubbing keeps to one frame at a time.
+            if ( !_intra_ctx.empty() && !stopped() && !saving() &&
+                 !( filter_graph && _subtitle_index >= 0 ) )
+            {
+                got_video = decode_intra_packets( frame );
+                continue;
+            }
+
             got_video = decode_image( pktframe, pkt );
             _video_packets.pop_front();
             continue;
@@ -4016,6 +4610,20 @@ void aviImage::do_seek()
 
     if ( saving() ) _seek_req = false;
 
+    // Drop proxies coarser than what the view needs now so the frames
+    // are decoded again at the right resolution.
+    if ( stopped() )
+    {
+        SCOPED_LOCK( _mutex );
+        const unsigned proxy = proxy_level();
+        video_cache_t::iterator i = _images.begin();
+        while ( i != _images.end() )
+        {
+            if ( (*i)->proxy() > proxy ) i = _images.erase( i );
+            else ++i;
+        }
+    }
+
     bool got_video = !has_video();
     bool got_audio = !has_audio();
 
@@ -34,6 +34,7 @@ extern "C" {
 }
 
 #include "CMedia.h"
+#include "mrvKeyframeIndex.h"
 
 class AviSaveUI;
 class ViewerUI;
@@ -99,6 +100,10 @@ public:
 
     virtual bool find_image( int64_t& frame );
 
+    /// Frame of the last keyframe at or before frame, once the keyframe
+    /// index of the video stream is built.  frame itself until then.
+    int64_t keyframe_before( const int64_t frame );
+
     virtual boost::uint64_t video_pts() {
         return frame2pts( get_video_stream(), _frame );
     }
@@ -128,7 +133,7 @@ public:
         return _video_info.size();
     }
 
-    static bool open_movie( const char* filename, const CMedia* img,
+    static bool open_movie( const char* filename, CMedia* img,
                             AviSaveUI* opts );
     static bool save_movie_frame( CMedia* img );
     static bool close_movie( const CMedia* img );
@@ -221,6 +226,46 @@ protected:
     DecodeStatus decode_image( const int64_t frame,
                                AVPacket& pkt );
 
+    /**
+     * Decode a run of consecutive packets at the front of the queue at
+     * the same time, one per context of the intra-only pool, and store
+     * the images in order.
+     *
+     * @param frame frame to use (if packets have no pts)
+     *
+     * @return kDecodeOK if any image was stored
+     */
+    DecodeStatus decode_intra_packets( const int64_t frame );
+
+    // Decode packets [first, last) of pkts, each with the context of
+    // the intra-only pool of the same index
+    void decode_intra( const std::vector< const AVPacket* >* pkts,
+                       const size_t first, const size_t last );
+
+    void open_intra_pool( const AVStream* stream, const AVCodec* codec );
+    void close_intra_pool();
+
+    // Have ctx decode into buffers laid out as our images, when its
+    // pictures are never kept as references
+    void direct_decode( AVCodecContext* ctx, const AVCodec* codec );
+
+    // Whether a picture of format fmt and size w x h can be decoded by
+    // ctx straight into a buffer that crops to the layout of our
+    // images.  Fills the lines and rows of that padded buffer.
+    bool direct_layout( const AVCodecContext* ctx, const int fmt,
+                        const int w, const int h,
+                        int linesize[4], int& rows ) const;
+
+    static int get_buffer( AVCodecContext* ctx, AVFrame* frame, int flags );
+
+    // Crop the pixels of _av_frame, if decoded into our buffers, to our
+    // layout and wrap them in image
+    bool direct_image( const int64_t frame, const int64_t pts,
+                       mrv::image_type_ptr& image );
+
+    // Convert _av_frame into image with sws_scale
+    bool convert_image( const mrv::image_type_ptr& image );
+
     void open_subtitle_codec();
     void close_subtitle_codec();
     void subtitle_rect_to_image( const AVSubtitleRect& rect );
@@ -316,6 +361,7 @@ protected:
     AVFrame*              _filt_frame;
     AVCodecContext*       _subtitle_ctx;           //!< current video context
     SwsContext*           _convert_ctx;
+    std::vector< SwsContext* > _slice_ctx;   //!< one per band of a conversion
 
     video_info_list_t     _video_info;
 
@@ -335,6 +381,13 @@ protected:
     AVFilterGraph*        filter_graph;
     subtitle_cache_t      _subtitles;
     AVSubtitle            _sub;
+
+    KeyframeIndex::IndexPtr _keyframes;   //!< of the video stream, once built
+
+    // Contexts decoding packets of intra-only streams side by side
+    std::vector< AVCodecContext* > _intra_ctx;
+    std::vector< AVFrame* >        _intra_frames;
+    std::vector< int >             _intra_got;
 };
 
 } // namespace mrv
@@ -458,7 +458,7 @@ static AVStream *add_stream(AVFormatContext *oc, AVCodec **codec,
 
 
 static bool open_sound(AVFormatContext *oc, AVCodec* codec,
-                       AVStream* st, const CMedia* img,
+                       AVStream* st, CMedia* img,
                        const AviSaveUI* opts)
 
 {
@@ -497,6 +497,7 @@ static bool open_sound(AVFormatContext *oc, AVCodec* codec,
 
     if ( opts->metadata )
     {
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
         const CMedia::Attributes& attrs = img->attributes();
         CMedia::Attributes::const_iterator i = attrs.begin();
         CMedia::Attributes::const_iterator e = attrs.end();
@@ -954,7 +955,7 @@ static AVFrame *alloc_picture(enum AVPixelFormat pix_fmt, int width, int height)
 
 
 static bool open_video(AVFormatContext *oc, AVCodec* codec, AVStream *st,
-                       const CMedia* img, const AviSaveUI* opts )
+                       CMedia* img, const AviSaveUI* opts )
 {
     AVCodecContext* c = enc_ctx[st->id];
 
@@ -984,6 +985,7 @@ static bool open_video(AVFormatContext *oc, AVCodec* codec, AVStream *st,
 
     if ( opts->metadata )
     {
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
         const CMedia::Attributes& attrs = img->attributes();
         CMedia::Attributes::const_iterator i = attrs.begin();
         CMedia::Attributes::const_iterator e = attrs.end();
@@ -1248,7 +1250,7 @@ audio_type_ptr CMedia::get_audio_frame(const int64_t f )
 
 
 
-bool aviImage::open_movie( const char* filename, const CMedia* img,
+bool aviImage::open_movie( const char* filename, CMedia* img,
                            AviSaveUI* opts )
 {
     assert( filename != NULL );
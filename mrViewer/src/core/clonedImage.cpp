@@ -90,17 +90,7 @@ namespace mrv {
     }
 
 
-    { // Copy attributes
-        for ( const auto& i : other->attrs_frames() )
-        {
-            int64_t frame = i.first;
-            _attrs.insert( std::make_pair( frame, Attributes() ) );
-            for ( const auto& j: i.second )
-            {
-                _attrs[frame][j.first] = j.second->copy();
-            }
-        }
-    }
+    copy_attributes( other );
 
     const char* profile = other->icc_profile();
     if ( profile )  icc_profile( profile );
@@ -38,6 +38,7 @@
 #include <halfFunction.h>
 
 #include "mrvIO.h"
+#include "core/mrvBCn.h"
 
 namespace {
 
@@ -236,309 +237,35 @@ void ddsImage::ReadColor(unsigned short Data, Color8888* Out)
 void ddsImage::DecompressDXT1(mrv::image_type_ptr& canvas,
                               unsigned char* src )
 {
-    unsigned int x, y;
-    int i, j, k, Select;
-    unsigned char* Temp = src;
-    Color8888	colours[4], *col;
-    unsigned short	color_0, color_1;
-    unsigned int	bitmask;
-
-    colours[0].a = 0xFF;
-    colours[1].a = 0xFF;
-    colours[2].a = 0xFF;
-
-    Pixel* pixels = (Pixel*)canvas->data().get();
-
-    unsigned int dh = height();
-    unsigned int dw = width();
-    for (y = 0; y < dh; y += 4) {
-        for (x = 0; x < dw; x += 4) {
-            color_0 = *((unsigned short*)Temp);
-            color_1 = *((unsigned short*)(Temp + 2));
-
-#ifdef MRV_BIG_ENDIAN
-            MSBOrderShort((unsigned char*)&color_0, sizeof(short));
-            MSBOrderShort((unsigned char*)&color_1, sizeof(short));
-#endif
-
-            ReadColor(color_0, colours);
-            ReadColor(color_1, colours + 1);
-            bitmask = ((unsigned int*)Temp)[1];
-
-#ifdef MRV_BIG_ENDIAN
-            MSBOrderLong((unsigned char*)&bitmask, sizeof(long));
-#endif
-
-            Temp += 8;
-
-            if (color_0 > color_1) {
-                /* Four-color block: derive the other two colors.
-                   00 = color_0, 01 = color_1, 10 = color_2, 11 = color_3
-                   These 2-bit codes correspond to the 2-bit fields
-                   stored in the 64-bit block. */
-                colours[2].b = (2 * colours[0].b + colours[1].b + 1) / 3;
-                colours[2].g = (2 * colours[0].g + colours[1].g + 1) / 3;
-                colours[2].r = (2 * colours[0].r + colours[1].r + 1) / 3;
-
-                colours[3].b = (colours[0].b + 2 * colours[1].b + 1) / 3;
-                colours[3].g = (colours[0].g + 2 * colours[1].g + 1) / 3;
-                colours[3].r = (colours[0].r + 2 * colours[1].r + 1) / 3;
-                colours[3].a = 0xFF;
-            }
-            else {
-                /* Three-color block: derive the other color.
-                   00 = color_0,  01 = color_1,  10 = color_2,
-                   11 = transparent.
-                   These 2-bit codes correspond to the 2-bit fields
-                   stored in the 64-bit block. */
-                colours[2].b = (colours[0].b + colours[1].b) / 2;
-                colours[2].g = (colours[0].g + colours[1].g) / 2;
-                colours[2].r = (colours[0].r + colours[1].r) / 2;
-
-                colours[3].b = (colours[0].b + 2 * colours[1].b + 1) / 3;
-                colours[3].g = (colours[0].g + 2 * colours[1].g + 1) / 3;
-                colours[3].r = (colours[0].r + 2 * colours[1].r + 1) / 3;
-                colours[3].a = 0x00;
-            }
-
-            for (j = 0, k = 0; j < 4; j++) {
-                for (i = 0; i < 4; i++, k++) {
-
-                    Select = (bitmask & (0x03 << k*2)) >> k*2;
-                    col = &colours[Select];
-
-                    if (((x + i) < dw) && ((y + j) < dh)) {
-                        CMedia::Pixel& p = pixels[ x+i + (y+j) * dw ];
-                        p.r = (float) col->r / 255.0f;
-                        p.g = (float) col->g / 255.0f;
-                        p.b = (float) col->b / 255.0f;
-                        p.a = (float) col->a / 255.0f;
-                    }
-                }
-            }
-        }
-    }
-}
-
-void ddsImage::CorrectPreMult(mrv::image_type_ptr& canvas )
-{
-    unsigned int x,y;
-    unsigned int dh = height();
-    unsigned int dw = width();
-    Pixel* pixels = (Pixel*)canvas->data().get();
-    for (y = 0; y < dh; ++y) {
-        for (x = 0; x < dw; ++x) {
-            CMedia::Pixel& p = pixels[ x + y * dw ];
-            if ( p.a == 0.0f ) continue;
-
-            p.r /= p.a;
-            p.g /= p.a;
-            p.b /= p.a;
-        }
-    }
+    bcn::decode( bcn::kBC1, src, (uint8_t*)canvas->data().get(),
+                 width(), height() );
 }
 
 void ddsImage::DecompressDXT2(mrv::image_type_ptr& canvas, unsigned char* src )
 {
-    DecompressDXT1( canvas, src );
-    CorrectPreMult( canvas );
+    DecompressDXT3( canvas, src );
+    bcn::unpremultiply( (uint8_t*)canvas->data().get(),
+                        size_t(width()) * height() );
 }
 
 void ddsImage::DecompressDXT3( mrv::image_type_ptr& canvas, unsigned char* src )
 {
-    unsigned int x, y;
-    int i, j, k, Select;
-    unsigned char* Temp = src;
-
-    Color8888    colours[4], *col;
-    unsigned int         bitmask;
-    unsigned short word;
-    unsigned char* alpha;
-
-    Pixel* pixels = (Pixel*)canvas->data().get();
-
-    unsigned int dw = width();
-    unsigned int dh = height();
-    for (y = 0; y < dh; y += 4) {
-        for (x = 0; x < dw; x += 4) {
-
-            /* Skip 64-bits of alpha data */
-            alpha = Temp;
-            Temp += 8;
-
-            /* Read 64-bits of color data */
-            ReadColors(Temp, colours);
-            bitmask = ((unsigned int*)Temp)[1];
-
-#ifdef MRV_BIG_ENDIAN
-            MSBOrderLong((unsigned char*)&bitmask, 4);
-#endif
-
-            Temp += 8;
-            /* Four-color block: derive the other two colors.
-               00 = color_0, 01 = color_1, 10 = color_2, 11 = color_3
-               These 2-bit codes correspond to the 2-bit fields
-               stored in the 64-bit block. */
-            colours[2].b = (2 * colours[0].b + colours[1].b + 1) / 3;
-            colours[2].g = (2 * colours[0].g + colours[1].g + 1) / 3;
-            colours[2].r = (2 * colours[0].r + colours[1].r + 1) / 3;
-
-            colours[3].b = (colours[0].b + 2 * colours[1].b + 1) / 3;
-            colours[3].g = (colours[0].g + 2 * colours[1].g + 1) / 3;
-            colours[3].r = (colours[0].r + 2 * colours[1].r + 1) / 3;
-
-            k = 0;
-
-            for (j = 0; j < 4; j++) {
-                word = alpha[2*j] + 256*alpha[2*j+1];
-
-                for (i = 0; i < 4; i++, k++) {
-                    Select = (bitmask & (0x03 << k*2)) >> k*2;
-                    col = &colours[Select];
-                    if (((x + i) < dw) && ((y + j) < dh))
-                    {
-                        unsigned char pxl[4];
-                        pxl[0] = col->r;
-                        pxl[1] = col->g;
-                        pxl[2] = col->b;
-                        pxl[3] = word & 0x0F;
-                        pxl[3] = pxl[3] | (pxl[3] << 4);
-
-                        CMedia::Pixel& p = pixels[ x+i + (y+j)*dw ];
-                        p.r = (float) pxl[0] / 255.0f;
-                        p.g = (float) pxl[1] / 255.0f;
-                        p.b = (float) pxl[2] / 255.0f;
-                        p.a = (float) pxl[3] / 255.0f;
-                    }
-                }
-
-                word >>= 4;
-            }
-
-        }
-    }
+    bcn::decode( bcn::kBC2, src, (uint8_t*)canvas->data().get(),
+                 width(), height() );
 }
 
 
 void ddsImage::DecompressDXT4(mrv::image_type_ptr& canvas, unsigned char* src )
 {
-    DecompressDXT3( canvas, src );
-    CorrectPreMult( canvas );
+    DecompressDXT5( canvas, src );
+    bcn::unpremultiply( (uint8_t*)canvas->data().get(),
+                        size_t(width()) * height() );
 }
 
 void ddsImage::DecompressDXT5( mrv::image_type_ptr& canvas, unsigned char* src )
 {
-    unsigned int x, y;
-    int i, j, k, Select;
-    unsigned char* Temp = src;
-    Color8888	colours[4], *col;
-    unsigned int	bitmask;
-    unsigned char	alphas[8], *alphamask;
-    unsigned int	bits;
-
-    Pixel* pixels = (Pixel*)canvas->data().get();
-
-    unsigned int dw = width();
-    unsigned int dh = height();
-    for (y = 0; y < dh; y += 4) {
-        for (x = 0; x < dw; x += 4) {
-
-            alphas[0] = Temp[0];
-            alphas[1] = Temp[1];
-            alphamask = Temp + 2;
-            Temp += 8;
-
-            ReadColors(Temp, colours);
-
-            bitmask = ((unsigned int*)Temp)[1];
-
-#ifdef MRV_BIG_ENDIAN
-            MSBOrderLong((unsigned char*)&bitmask, 4);
-#endif
-
-            Temp += 8;
-
-            /* Four-color block: derive the other two colors.
-               00 = color_0, 01 = color_1, 10 = color_2, 11 = color_3
-               These 2-bit codes correspond to the 2-bit fields
-               stored in the 64-bit block. */
-            colours[2].b = (2 * colours[0].b + colours[1].b + 1) / 3;
-            colours[2].g = (2 * colours[0].g + colours[1].g + 1) / 3;
-            colours[2].r = (2 * colours[0].r + colours[1].r + 1) / 3;
-
-            colours[3].b = (colours[0].b + 2 * colours[1].b + 1) / 3;
-            colours[3].g = (colours[0].g + 2 * colours[1].g + 1) / 3;
-            colours[3].r = (colours[0].r + 2 * colours[1].r + 1) / 3;
-
-            k = 0;
-            for (j = 0; j < 4; j++) {
-                for (i = 0; i < 4; i++, k++) {
-
-                    Select = (bitmask & (0x03 << k*2)) >> k*2;
-                    col = &colours[Select];
-
-                    /* only put pixels out < width or height */
-                    if (((x + i) < dw) && ((y + j) < dh)) {
-                        CMedia::Pixel& p = pixels[ x+i + (y+j)*dw ];
-                        p.r = ((float)col->r) / 255.0f;
-                        p.g = ((float)col->g) / 255.0f;
-                        p.b = ((float)col->b) / 255.0f;
-                    }
-                }
-            }
-
-            /* 8-alpha or 6-alpha block? */
-            if (alphas[0] > alphas[1]) {
-                /* 8-alpha block:  derive the other six alphas.
-                   Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated. */
-                alphas[2] = (6 * alphas[0] + 1 * alphas[1] + 3) / 7; /* bit code 010 */
-                alphas[3] = (5 * alphas[0] + 2 * alphas[1] + 3) / 7; /* bit code 011 */
-                alphas[4] = (4 * alphas[0] + 3 * alphas[1] + 3) / 7; /* bit code 100 */
-                alphas[5] = (3 * alphas[0] + 4 * alphas[1] + 3) / 7; /* bit code 101 */
-                alphas[6] = (2 * alphas[0] + 5 * alphas[1] + 3) / 7; /* bit code 110 */
-                alphas[7] = (1 * alphas[0] + 6 * alphas[1] + 3) / 7; /* bit code 111 */
-            }
-            else {
-                /* 6-alpha block.
-                   Bit code 000 = alpha_0, 001 = alpha_1, others are interpolated. */
-                alphas[2] = (4 * alphas[0] + 1 * alphas[1] + 2) / 5; /* bit code 010 */
-                alphas[3] = (3 * alphas[0] + 2 * alphas[1] + 2) / 5; /* bit code 011 */
-                alphas[4] = (2 * alphas[0] + 3 * alphas[1] + 2) / 5; /* bit code 100 */
-                alphas[5] = (1 * alphas[0] + 4 * alphas[1] + 2) / 5; /* bit code 101 */
-                alphas[6] = 0x00;        /* bit code 110 */
-                alphas[7] = 0xFF;        /* bit code 111 */
-            }
-
-            /* Note: Have to separate the next two loops,
-               it operates on a 6-byte system. */
-
-            /* First three bytes */
-            bits = (alphamask[0]) | (alphamask[1] << 8) | (alphamask[2] << 16);
-            for (j = 0; j < 2; j++) {
-                for (i = 0; i < 4; i++) {
-                    /* only put pixels out < width or height */
-                    if (((x + i) < dw) && ((y + j) < dh)) {
-                        CMedia::Pixel& p = pixels[ x+i + (y+j)*dw ];
-                        p.a = (float) ( alphas[bits & 0x07] ) / 255.0f;
-                    }
-                    bits >>= 3;
-                }
-            }
-
-            /* Last three bytes */
-            bits = (alphamask[3]) | (alphamask[4] << 8) | (alphamask[5] << 16);
-            for (j = 2; j < 4; j++) {
-                for (i = 0; i < 4; i++) {
-                    /* only put pixels out < width or height */
-                    if (((x + i) < dw) && ((y + j) < dh)) {
-                        CMedia::Pixel& p = pixels[ x+i + (y+j)*dw ];
-                        p.a = (float) ( alphas[bits & 0x07] ) / 255.0f;
-                    }
-                    bits >>= 3;
-                }
-            }
-        }
-    }
+    bcn::decode( bcn::kBC3, src, (uint8_t*)canvas->data().get(),
+                 width(), height() );
 }
 
 void ddsImage::GetBitsFromMask(unsigned int Mask,
@@ -1291,7 +1018,16 @@ bool ddsImage::fetch( mrv::image_type_ptr& canvas,
 
     image_size( ddsd.dwWidth, ddsd.dwHeight );
 
-    allocate_pixels(canvas, frame);
+    GetBytesPerBlock( &sourceDataSize, &bytesPerBlock, &compFormat, f, &ddsd );
+
+    // DXT blocks hold 8-bit colors.  Keep them at that depth.
+    if ( compFormat == PF_DXT1 || compFormat == PF_DXT2 ||
+         compFormat == PF_DXT3 || compFormat == PF_DXT4 ||
+         compFormat == PF_DXT5 )
+        allocate_pixels(canvas, frame, 4, image_type::kRGBA,
+                        image_type::kByte );
+    else
+        allocate_pixels(canvas, frame);
 
     _gamma = 1.0f;
 
@@ -1304,7 +1040,6 @@ bool ddsImage::fetch( mrv::image_type_ptr& canvas,
     /*
       Decode scanlines
     */
-    GetBytesPerBlock( &sourceDataSize, &bytesPerBlock, &compFormat, f, &ddsd );
     data = (unsigned char*) av_malloc( sourceDataSize );
     memset( data, 0, sourceDataSize );
 
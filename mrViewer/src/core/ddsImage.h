@@ -73,7 +73,6 @@ protected:
     void ReadColors(const unsigned char* Data, Color8888* Out);
     void ReadColor(unsigned short Data, Color8888* Out);
     void DecompressDXT1(mrv::image_type_ptr& canvas, unsigned char* src );
-    void CorrectPreMult(mrv::image_type_ptr& canvas );
     void GetBitsFromMask(unsigned int Mask,
                          unsigned int* ShiftLeft,
                          unsigned int* ShiftRight);
@@ -32,6 +32,8 @@
 #include <algorithm>
 #include <limits>       // for quietNaN
 
+#include <boost/bind.hpp>
+
 #include <Iex.h>
 #include <ImfVersion.h> // for MAGIC
 #include <ImfChannelList.h>
@@ -58,9 +60,12 @@
 #include <ImfTimeCodeAttribute.h>
 #include <ImfFramesPerSecond.h>
 #include <ImfRgbaYca.h>
+#include <ImfInt64.h>
 
 #include "core/mrvACES.h"
 #include "core/mrvThread.h"
+#include "core/mrvParallel.h"
+#include "core/mrvBackgroundCache.h"
 #include "core/Sequence.h"
 #include "core/exrImage.h"
 #include "core/mrvImageOpts.h"
@@ -79,6 +84,43 @@ using namespace std;
 namespace
 {
 const char* kModule = "exr";
+
+// Headers read for the attributes of frames, kept in memory
+const size_t kMaxMemoryHeaders = 16;
+
+// Headers waiting to be read.  Only the newest frames are worth it.
+const size_t kMaxQueuedHeaders = 4;
+
+struct HeaderRequest
+{
+    std::string file;
+    int         part;
+};
+
+bool read_header( const HeaderRequest& r, Imf::Header& h )
+{
+    try
+    {
+        Imf::MultiPartInputFile in( r.file.c_str() );
+        int part = r.part;
+        if ( part < 0 || part >= in.parts() ) part = 0;
+        h = in.header( part );
+    }
+    catch( const std::exception& e )
+    {
+        LOG_ERROR( r.file << " - " << e.what() );
+        return false;
+    }
+    return true;
+}
+
+typedef mrv::BackgroundCache< HeaderRequest, Imf::Header > HeaderCache;
+
+HeaderCache _headers( &read_header, HeaderCache::Startup(),
+                      kMaxMemoryHeaders,
+                      HeaderCache::kNewestFirst | HeaderCache::kRememberFailures,
+                      1, kMaxQueuedHeaders );
+
 }
 
 
@@ -88,6 +130,7 @@ const char* kModule = "exr";
 namespace mrv {
 
 float exrImage::_default_gamma = 2.2f;
+bool  exrImage::_joint_layers = false;
 Imf::Compression exrImage::_default_compression = Imf::PIZ_COMPRESSION;
 float exrImage::_default_dwa_compression = 45.0f;
 
@@ -191,7 +234,10 @@ exrImage::exrImage() :
     _numparts( -1 ),
     _lineOrder( (Imf::LineOrder) 0 ),
     _compression( (Imf::Compression) 0 ),
-    _aces( false )
+    _aces( false ),
+    _deep_frame( std::numeric_limits< boost::int64_t >::min() ),
+    _keep_deep( false ),
+    _deep_file_frame( std::numeric_limits< boost::int64_t >::min() )
 {
     st[0] = st[1] = -1;
 
@@ -235,7 +281,8 @@ bool exrImage::channels_order(
                               Imf::ChannelList::ConstIterator& e,
                               const Imf::ChannelList& channels,
                               const Imf::Header& h,
-                              Imf::FrameBuffer& fb
+                              Imf::FrameBuffer& fb,
+                              const char* layer
                               )
 {
     SCOPED_LOCK( _mutex );
@@ -261,7 +308,7 @@ bool exrImage::channels_order(
 
     bool Zchannel = false;
     std::string c;
-    if ( channel() ) c = channel();
+    if ( layer ) c = layer;
     std::string ext = c;
     size_t pos = ext.rfind( '.' );
     if ( pos != std::string::npos )
@@ -350,10 +397,10 @@ bool exrImage::channels_order(
 
     if ( numChannels == 0 )
     {
-        if ( channel() )
+        if ( layer )
             IMG_ERROR( _("Image file \"") << filename() <<
                        _("\" has no channels named with prefix \"")
-                       << channel() << "\"." );
+                       << layer << "\"." );
         else
         {
             IMG_ERROR( _("Image file \"") << filename() <<
@@ -504,8 +551,8 @@ void exrImage::ycc2rgba( const Imf::Header& hdr, const boost::int64_t& frame,
 
     V3f yw = Imf::RgbaYca::computeYw(cr);
 
-    unsigned w = width();
-    unsigned h = height();
+    unsigned w = canvas->width();
+    unsigned h = canvas->height();
 
     image_type::Format format = ( has_alpha() ?
                                   image_type::kRGBA :
@@ -527,16 +574,26 @@ void exrImage::ycc2rgba( const Imf::Header& hdr, const boost::int64_t& frame,
         }
     }
 
+    rgba->proxy( canvas->proxy() );
+    rgba->full_window( canvas->full_window() );
     canvas = rgba;
 }
 
 /**
- * Fetch the current EXR image
+ * Fetch a mipmap or ripmap level of the current EXR image
+ *
+ * @param canvas image to fill
+ * @param frame  frame to fetch
+ * @param proxy  if not 0, read the mipmap level closest to this resolution
+ *               reduction (1/2^proxy) but keep the windows of the full
+ *               image, so the level is stretched to it on display.
+ *               If 0, read the level set with levelX() and levelY().
  *
  * @return true if success, false if not
  */
 bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
-                              const boost::int64_t& frame )
+                              const boost::int64_t& frame,
+                              const unsigned proxy )
 {
 
     try {
@@ -548,22 +605,38 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
 
         int numXLevels = in.numXLevels();
         int numYLevels = in.numYLevels();
-        if (_levelX > numXLevels-1 ) _levelX = numXLevels-1;
-        if (_levelY > numYLevels-1 ) _levelY = numYLevels-1;
 
-        if (!in.isValidLevel (_levelX, _levelY))
+        int levelX, levelY;
+        if ( proxy > 0 )
         {
-            THROW (Iex::InputExc, "Level (" << _levelX << ", "
-                   << _levelY << ") does "
+            // Diagonal levels exist in both mipmaps and ripmaps
+            levelX = std::min( std::min( numXLevels, numYLevels ) - 1,
+                               (int) proxy );
+            levelY = levelX;
+        }
+        else
+        {
+            if (_levelX > numXLevels-1 ) _levelX = numXLevels-1;
+            if (_levelY > numYLevels-1 ) _levelY = numYLevels-1;
+            levelX = _levelX;
+            levelY = _levelY;
+        }
+
+        if (!in.isValidLevel (levelX, levelY))
+        {
+            THROW (Iex::InputExc, "Level (" << levelX << ", "
+                   << levelY << ") does "
                    "not exist in file " << fileName << ".");
         }
 
         Imf::Header h = in.header();
-        h.dataWindow() = in.dataWindowForLevel(_levelX, _levelY);
-        h.displayWindow() = h.dataWindow();
+        h.dataWindow() = in.dataWindowForLevel(levelX, levelY);
+        if ( proxy == 0 ) h.displayWindow() = h.dataWindow();
 
-        const Imath::Box2i& dataWindow = h.dataWindow();
-        const Imath::Box2i& displayWindow = h.displayWindow();
+        // A proxy keeps the windows of the full resolution image
+        const Imf::Header& full = proxy > 0 ? in.header() : h;
+        const Imath::Box2i& dataWindow = full.dataWindow();
+        const Imath::Box2i& displayWindow = full.displayWindow();
         data_window( dataWindow.min.x, dataWindow.min.y,
                      dataWindow.max.x, dataWindow.max.y, frame );
 
@@ -578,6 +651,11 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
         bool ok = find_channels( canvas, h, fb, frame );
         if ( !ok ) return false;
 
+        // find_channels sized the image from the level read
+        if ( proxy > 0 )
+            image_size( dataWindow.max.x - dataWindow.min.x + 1,
+                        dataWindow.max.y - dataWindow.min.y + 1 );
+
         _pixel_ratio = h.pixelAspectRatio();
         _lineOrder   = h.lineOrder();
         _compression = h.compression();
@@ -585,8 +663,8 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
         in.setFrameBuffer(fb);
 
 
-        int tx = in.numXTiles( _levelX );
-        int ty = in.numYTiles( _levelY );
+        int tx = in.numXTiles( levelX );
+        int ty = in.numYTiles( levelY );
 
         //
         // For maximum speed, try to read the tiles in
@@ -597,13 +675,20 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
         {
             for (int y = 0; y < ty; ++y)
                 for (int x = 0; x < tx; ++x)
-                    in.readTile (x, y, _levelX, _levelY);
+                    in.readTile (x, y, levelX, levelY);
         }
         else
         {
             for (int y = ty - 1; y >= 0; --y)
                 for (int x = 0; x < tx; ++x)
-                    in.readTile (x, y, _levelX, _levelY);
+                    in.readTile (x, y, levelX, levelY);
+        }
+
+        if ( proxy > 0 )
+        {
+            if ( _use_yca && !supports_yuv() )
+                ycc2rgba( h, frame, canvas );
+            canvas->proxy( (unsigned short) levelX );
         }
 
         return true;
@@ -617,6 +702,214 @@ bool exrImage::fetch_mipmap(  mrv::image_type_ptr& canvas,
     }
 }
 
+/**
+ * Fetch only a region of a single part EXR image.  Used to show very
+ * large images zoomed in.
+ *
+ * @param canvas   image to fill with the region
+ * @param inmaster file to read from
+ * @param frame    frame to fetch
+ * @param region   part of the data window to read, aligned to whole
+ *                 scanlines or tiles (see CMedia::roi_region)
+ *
+ * @return true if success, false if not
+ */
+bool exrImage::fetch_region( mrv::image_type_ptr& canvas,
+                             Imf::MultiPartInputFile& inmaster,
+                             const boost::int64_t& frame,
+                             const mrv::Recti& region )
+{
+    Imf::Header h = inmaster.header(0);
+    if ( h.hasType() ) _type = h.type();
+    else _type = SCANLINEIMAGE;
+
+    read_header_attr( h, frame );
+
+    _curpart = 0;
+
+    const Box2i full = h.dataWindow();
+    const Box2i& displayWindow = h.displayWindow();
+    h.dataWindow() = Box2i( V2i( region.x(), region.y() ),
+                            V2i( region.r() - 1, region.b() - 1 ) );
+    const Box2i& dataWindow = h.dataWindow();
+
+    data_window( dataWindow.min.x, dataWindow.min.y,
+                 dataWindow.max.x, dataWindow.max.y, frame );
+
+    display_window( displayWindow.min.x, displayWindow.min.y,
+                    displayWindow.max.x, displayWindow.max.y, frame );
+
+    FrameBuffer fb;
+    bool ok = find_channels( canvas, h, fb, frame );
+    if (!ok) {
+        IMG_ERROR( _("Could not locate channels in header") );
+        return false;
+    }
+
+    // Remember where each channel goes in a pixel, so fill_region()
+    // can read more of the frame into a canvas of its own
+    {
+        const size_t pixbytes = size_t( canvas->pixel_size() ) *
+                                canvas->channels();
+        const char* pixels = (const char*)canvas->data().get();
+        const ptrdiff_t start = ( ptrdiff_t( region.x() ) +
+                                  ptrdiff_t( region.y() ) * region.w() ) *
+                                ptrdiff_t( pixbytes );
+        RoiSlices slices;
+        FrameBuffer::ConstIterator i = fb.begin();
+        FrameBuffer::ConstIterator e = fb.end();
+        for ( ; i != e; ++i )
+        {
+            const Slice& sl = i.slice();
+            if ( sl.xStride != pixbytes || sl.xSampling != 1 ||
+                 sl.ySampling != 1 )
+            {
+                slices.clear();
+                break;
+            }
+            RoiSlice r;
+            r.name   = i.name();
+            r.type   = sl.type;
+            r.offset = size_t( ( sl.base - pixels ) + start );
+            slices.push_back( r );
+        }
+
+        SCOPED_LOCK( _data_mutex );
+        _roi_slices.swap( slices );
+    }
+
+    // find_channels sized the image from the region
+    const int fw = full.max.x - full.min.x + 1;
+    const int fh = full.max.y - full.min.y + 1;
+    image_size( fw, fh );
+    canvas->full_window( mrv::Recti( full.min.x, full.min.y, fw, fh ) );
+
+    _pixel_ratio = h.pixelAspectRatio();
+    _lineOrder   = h.lineOrder();
+    _compression = h.compression();
+
+    try
+    {
+        if ( _type == TILEDIMAGE )
+        {
+            // Only tiles touching the region are decoded
+            const Imf::TileDescription& desc = h.tileDescription();
+            TiledInputPart in( inmaster, 0 );
+            in.setFrameBuffer( fb );
+            in.readTiles( ( dataWindow.min.x - full.min.x ) / desc.xSize,
+                          ( dataWindow.max.x - full.min.x ) / desc.xSize,
+                          ( dataWindow.min.y - full.min.y ) / desc.ySize,
+                          ( dataWindow.max.y - full.min.y ) / desc.ySize,
+                          0, 0 );
+        }
+        else
+        {
+            InputPart in( inmaster, 0 );
+            in.setFrameBuffer( fb );
+            in.readPixels( dataWindow.min.y, dataWindow.max.y );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        IMG_ERROR( e.what() );
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Read the region of interest of the frame of a partial picture, keeping
+ * the pixels it holds already and reading only the scanlines or tiles it
+ * lacks.  Touches nothing in the image but its own file.
+ *
+ * @param canvas   image to fill with the region
+ * @param held     partial picture read by fetch_region()
+ * @param region   data window of canvas
+ *
+ * @return false if there is nothing new to read or on error
+ */
+bool exrImage::fill_region( mrv::image_type_ptr& canvas,
+                            const mrv::image_type_ptr& held,
+                            mrv::Recti& region ) const
+{
+    RoiSlices slices;
+    {
+        SCOPED_LOCK( _data_mutex );
+        slices = _roi_slices;
+    }
+    if ( slices.empty() ) return false;
+
+    const boost::int64_t frame = held->frame();
+    const size_t pixbytes = size_t( held->pixel_size() ) * held->channels();
+
+    try
+    {
+        MultiPartInputFile inmaster( sequence_filename(frame).c_str() );
+        if ( inmaster.parts() != 1 ) return false;
+
+        const Imf::Header& h = inmaster.header(0);
+        const Box2i& dw = h.dataWindow();
+        mrv::Recti full( dw.min.x, dw.min.y,
+                         dw.max.x - dw.min.x + 1,
+                         dw.max.y - dw.min.y + 1 );
+        if ( full != held->full_window() ) return false;
+
+        bool tiled = h.hasTileDescription() &&
+                     ( !h.hasType() || h.type() == Imf::TILEDIMAGE );
+        int tw = tiled ? (int) h.tileDescription().xSize : 0;
+        int th = tiled ? (int) h.tileDescription().ySize : 1;
+        if ( !roi_region( full, region, tw, th ) ) region = full;
+        if ( region == data_window( frame ) ) return false;
+
+        std::vector< mrv::Recti > bands;
+        if ( !roi_canvas( canvas, held, region, bands ) ) return false;
+
+        char* base = (char*)canvas->data().get() -
+                     ( ptrdiff_t( region.x() ) +
+                       ptrdiff_t( region.y() ) * region.w() ) *
+                     ptrdiff_t( pixbytes );
+        FrameBuffer fb;
+        RoiSlices::const_iterator i = slices.begin();
+        RoiSlices::const_iterator e = slices.end();
+        for ( ; i != e; ++i )
+        {
+            if ( i->offset >= pixbytes ) return false;
+            fb.insert( i->name, Slice( i->type, base + i->offset, pixbytes,
+                                       pixbytes * region.w() ) );
+        }
+
+        std::vector< mrv::Recti >::const_iterator b = bands.begin();
+        std::vector< mrv::Recti >::const_iterator be = bands.end();
+        if ( tiled )
+        {
+            const Imf::TileDescription& desc = h.tileDescription();
+            TiledInputPart in( inmaster, 0 );
+            in.setFrameBuffer( fb );
+            for ( ; b != be; ++b )
+                in.readTiles( ( b->x() - full.x() ) / desc.xSize,
+                              ( b->r() - 1 - full.x() ) / desc.xSize,
+                              ( b->y() - full.y() ) / desc.ySize,
+                              ( b->b() - 1 - full.y() ) / desc.ySize,
+                              0, 0 );
+        }
+        else
+        {
+            InputPart in( inmaster, 0 );
+            in.setFrameBuffer( fb );
+            for ( ; b != be; ++b )
+                in.readPixels( b->y(), b->b() - 1 );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        IMG_ERROR( e.what() );
+        return false;
+    }
+
+    return true;
+}
+
 bool exrImage::find_layers( const Imf::Header& h )
 {
 
@@ -962,7 +1255,8 @@ bool exrImage::handle_stereo( mrv::image_type_ptr& canvas,
         e = channels.end();
     }
 
-    bool ok = channels_order( canvas, frame, s, e, channels, h, fb );
+    bool ok = channels_order( canvas, frame, s, e, channels, h, fb,
+                              channel() );
 
     // If 3d is because of different headers exit now
     if ( !_multiview )
@@ -993,7 +1287,8 @@ bool exrImage::handle_stereo( mrv::image_type_ptr& canvas,
         e = channels.end();
     }
 
-    ok = channels_order( canvas, frame, s, e, channels, h, fb );
+    ok = channels_order( canvas, frame, s, e, channels, h, fb,
+                         channel() );
     _stereo[0] = canvas; //_hires;
 
     return ok;
@@ -1003,6 +1298,15 @@ bool exrImage::find_channels( mrv::image_type_ptr& canvas,
                               const Imf::Header& h,
                               Imf::FrameBuffer& fb,
                               const boost::int64_t& frame )
+{
+    return find_channels( canvas, h, fb, frame, _channel );
+}
+
+bool exrImage::find_channels( mrv::image_type_ptr& canvas,
+                              const Imf::Header& h,
+                              Imf::FrameBuffer& fb,
+                              const boost::int64_t& frame,
+                              const char* layer )
 {
     bool ok = find_layers( h );
     if ( !ok ) return false;
@@ -1010,7 +1314,7 @@ bool exrImage::find_channels( mrv::image_type_ptr& canvas,
     const Imf::ChannelList& channels = h.channels();
 
     char* channelPrefix = NULL;
-    if ( _channel ) channelPrefix = av_strdup( _channel );
+    if ( layer ) channelPrefix = av_strdup( layer );
 
 
     // If channel starts with #, we are dealing with a multipart exr
@@ -1105,13 +1409,15 @@ bool exrImage::find_channels( mrv::image_type_ptr& canvas,
         av_free( channelPrefix );
         channelPrefix = NULL;
 
-        return channels_order( canvas, frame, s, e, channels, h, fb );
+        return channels_order( canvas, frame, s, e, channels, h, fb,
+                               layer );
     }
     else
     {
         Imf::ChannelList::ConstIterator s = channels.begin();
         Imf::ChannelList::ConstIterator e = channels.end();
-        return channels_order( canvas, frame, s, e, channels, h, fb );
+        return channels_order( canvas, frame, s, e, channels, h, fb,
+                               layer );
     }
 }
 
@@ -1168,6 +1474,18 @@ void exrImage::read_header_attr( const Imf::Header& h,
         }
     }
 
+    // The rest is only shown to the user.  Frames of sequences read it
+    // when their attributes are asked for.
+    if ( is_sequence() && frame != start_frame() )
+    {
+        SCOPED_LOCK( _attrs_mutex );
+        if ( frame != _attrs_frame )
+        {
+            _partial_attrs.insert( frame );
+            return;
+        }
+    }
+
     {
         const Imf::StringAttribute *attr =
             h.findTypedAttribute<Imf::StringAttribute>( N_("chromaticitiesName") );
@@ -1421,60 +1739,86 @@ void exrImage::read_header_attr( const Imf::Header& h,
     }
 }
 
-
-void exrImage::findZBound( float& zmin, float& zmax, float farPlane,
-                           int zsize,
-                           Imf::Array<float*>&       zbuff,
-                           Imf::Array<unsigned int>& sampleCount )
+bool exrImage::load_attributes( const int64_t frame )
 {
-    //
-    // find zmax and zmin values of deep data to set bound
-    //
-    zmax = limits<float>::min();
-    zmin = limits<float>::max();
-
-    unsigned maxCount = 0;
-
-    for (int k = 0; k < zsize; k++)
     {
-        float* z = zbuff[k];
-        unsigned int count = sampleCount[k];
+        SCOPED_LOCK( _attrs_mutex );
+        if ( _partial_attrs.find( frame ) == _partial_attrs.end() )
+            return false;
+    }
 
-        if (maxCount < count)
-            maxCount = count;
+    // The header is read in the background, not in the interface thread
+    HeaderRequest r;
+    r.file = sequence_filename( frame );
+    r.part = _curpart;
 
-        for (unsigned int i = 0; i < count; i++)
-        {
-            double val = double(z[i]);
-            if (val > zmax && val < farPlane)
-                zmax = float(val);
-            if (val < zmin)
-                zmin = float(val);
-        }
+    char buf[64];
+    sprintf( buf, "\n%d\n", r.part );
+    std::string key = cache_key( frame );
+    if ( key.empty() ) key = r.file;
+    key += buf;
+
+    Imf::Header h;
+    if ( !_headers.find( key, h ) )
+    {
+        _headers.request( key, r );
+        return false;
     }
 
-    if ( zmax < zmin)
+    // Read them all again, so those kept from the first read are not
+    // left over
     {
-        float tmp = zmax;
-        zmax = zmin;
-        zmin = tmp;
-        // cout << "z max: "<< zmax << ", z min: " << zmin << endl;
-        // _chart->bounds (zmin, zmax);
+        SCOPED_LOCK( _attrs_mutex );
+        _partial_attrs.erase( frame );
+        Attributes& attrs = _attrs[frame];
+        for ( const auto& i : attrs )
+            delete i.second;
+        attrs.clear();
     }
 
+    read_header_attr( h, frame );
+    return true;
 }
 
-void exrImage::loadDeepData( int& zsize,
-                             Imf::Array<float*>&       zbuff,
-                             Imf::Array<unsigned int>& sampleCount )
+bool exrImage::attributes_ready()
 {
+    return _headers.ready();
+}
+
+void exrImage::shutdown()
+{
+    _headers.shutdown();
+}
 
+
+DeepSamplesPtr exrImage::loadDeepData()
+{
     assert( _curpart >= 0 );
 
+    {
+        SCOPED_LOCK( _data_mutex );
+        if ( _deep && _deep_frame == _frame ) return _deep;
+    }
+
+    _keep_deep = true;
+
+    // fetch() left the file of the frame open
+    boost::shared_ptr< Imf::MultiPartInputFile > file;
+    {
+        SCOPED_LOCK( _data_mutex );
+        if ( _deep_file_frame == _frame ) file = _deep_file;
+        _deep_file.reset();
+    }
+
+    DeepSamplesPtr deep( new DeepSamples );
+
     try {
-        Imf::MultiPartInputFile inmaster( sequence_filename(_frame).c_str() );
+        if ( !file )
+            file.reset( new Imf::MultiPartInputFile(
+                            sequence_filename(_frame).c_str() ) );
+        Imf::MultiPartInputFile& inmaster = *file;
 
-        if ( ! inmaster.partComplete( _curpart ) ) return;
+        if ( ! inmaster.partComplete( _curpart ) ) return DeepSamplesPtr();
 
 
         const Imf::Header& h = inmaster.header( _curpart );
@@ -1484,15 +1828,39 @@ void exrImage::loadDeepData( int& zsize,
 
         image_type_ptr canvas;
         if ( _type == DEEPSCANLINE )
-            loadDeepScanlineImage( inmaster, zsize, zbuff, sampleCount, true );
+            loadDeepScanlineImage( inmaster, *deep );
         else if ( _type == DEEPTILE )
-            loadDeepTileImage( canvas, inmaster, zsize, zbuff, sampleCount, true );
+            loadDeepTileImage( canvas, inmaster, *deep, true );
+        else
+            return DeepSamplesPtr();
     }
     catch( const std::exception& e )
     {
         IMG_ERROR( _("loadDeepData error: ") << e.what() );
+        return DeepSamplesPtr();
     }
 
+    keep_deep( deep, _frame );
+    return deep;
+}
+
+void exrImage::drop_deep()
+{
+    _keep_deep = false;
+
+    SCOPED_LOCK( _data_mutex );
+    _deep.reset();
+    _deep_file.reset();
+    _deep_frame = _deep_file_frame =
+                  std::numeric_limits< boost::int64_t >::min();
+}
+
+void exrImage::keep_deep( const DeepSamplesPtr& deep,
+                          const boost::int64_t frame )
+{
+    SCOPED_LOCK( _data_mutex );
+    _deep = deep;
+    _deep_frame = frame;
 }
 
 
@@ -1500,9 +1868,7 @@ void
 exrImage::loadDeepTileImage(
                             mrv::image_type_ptr& canvas,
                             Imf::MultiPartInputFile& inmaster,
-                            int &zsize,
-                            Imf::Array<float*>&       zbuff,
-                            Imf::Array<unsigned int>& sampleCount,
+                            DeepSamples& deep,
                             bool deepComp )
 {
     _has_deep_data = true;
@@ -1536,24 +1902,6 @@ exrImage::loadDeepTileImage(
     memset( (void*)pixels, 0, canvas->data_size() ); // Needed
 
 
-    Array< half* > dataR;
-    Array< half* > dataG;
-    Array< half* > dataB;
-
-    Array< float* > zback;
-    Array< half* > alpha;
-
-    zsize = dw * dh;
-    zbuff.resizeErase (zsize);
-    zback.resizeErase (zsize);
-    alpha.resizeErase (zsize);
-
-    dataR.resizeErase (zsize);
-    dataG.resizeErase (zsize);
-    dataB.resizeErase (zsize);
-
-    sampleCount.resizeErase (zsize);
-
     int rgbflag = 0;
     int deepCompflag = 0;
 
@@ -1581,23 +1929,19 @@ exrImage::loadDeepTileImage(
         }
     }
 
+    deep.resize( dw, dh, rgbflag != 0 );
+
     DeepFrameBuffer fb;
 
     fb.insertSampleCountSlice (Slice (Imf::UINT,
-                                      (char *) (&sampleCount[0]
+                                      (char *) (deep.sample_counts()
                                               - dx- dy * dw),
                                       sizeof (unsigned int) * 1,
                                       sizeof (unsigned int) * dw));
 
     fb.insert ("Z",
                DeepSlice (Imf::FLOAT,
-                          (char *) (&zbuff[0] - dx- dy * dw),
-                          sizeof (float *) * 1,    // xStride for pointer array
-                          sizeof (float *) * dw,   // yStride for pointer array
-                          sizeof (float) * 1));    // stride for z data sample
-    fb.insert ("ZBack",
-               DeepSlice (Imf::FLOAT,
-                          (char *) (&zback[0] - dx- dy * dw),
+                          (char *) (deep.z() - dx- dy * dw),
                           sizeof (float *) * 1,    // xStride for pointer array
                           sizeof (float *) * dw,   // yStride for pointer array
                           sizeof (float) * 1));    // stride for z data sample
@@ -1606,21 +1950,21 @@ exrImage::loadDeepTileImage(
     {
         fb.insert ("R",
                    DeepSlice (Imf::HALF,
-                              (char *) (&dataR[0] - dx- dy * dw),
+                              (char *) (deep.red() - dx- dy * dw),
                               sizeof (half *) * 1,
                               sizeof (half *) * dw,
                               sizeof (half) * 1));
 
         fb.insert ("G",
                    DeepSlice (Imf::HALF,
-                              (char *) (&dataG[0] - dx- dy * dw),
+                              (char *) (deep.green() - dx- dy * dw),
                               sizeof (half *) * 1,
                               sizeof (half *) * dw,
                               sizeof (half) * 1));
 
         fb.insert ("B",
                    DeepSlice (Imf::HALF,
-                              (char *) (&dataB[0] - dx- dy * dw),
+                              (char *) (deep.blue() - dx- dy * dw),
                               sizeof (half *) * 1,
                               sizeof (half *) * dw,
                               sizeof (half) * 1));
@@ -1630,7 +1974,7 @@ exrImage::loadDeepTileImage(
 
     fb.insert ("A",
                DeepSlice (Imf::HALF,
-                          (char *) (&alpha[0] - dx- dy * dw),
+                          (char *) (deep.alpha() - dx- dy * dw),
                           sizeof (half *) * 1,    // xStride for pointer array
                           sizeof (half *) * dw,   // yStride for pointer array
                           sizeof (half) * 1,      // stride for z data sample
@@ -1644,80 +1988,56 @@ exrImage::loadDeepTileImage(
 
     in.readPixelSampleCounts (0, numXTiles - 1, 0, numYTiles - 1);
 
-    for (int i = 0; i < zsize; i++)
-    {
-        int num = sampleCount[i];
-        zbuff[i] = new float[num];
-        zback[i] = new float[num];
-        alpha[i] = new half[num];
-        if (rgbflag)
-        {
-            dataR[i] = new half[num];
-            dataG[i] = new half[num];
-            dataB[i] = new half[num];
-        }
-    }
+    deep.allocate();
 
+    // OpenEXR decodes the tiles of a single call in its own thread pool
     in.readTiles (0, numXTiles - 1, 0, numYTiles - 1);
 
-    if (deepCompflag)
-    {
-        int count = 0;
-        // Loop over all the pixels and comp manually
-        // @ToDo implent deep compositing for the DeepTile case
-        for (int i=0; i<zsize; ++i)
-        {
-            if ( sampleCount[i] == 0 ) continue;
+    // @ToDo implent deep compositing for the DeepTile case
+    deep.flatten( pixels, deepCompflag != 0 );
+}
 
-            pixels[i].a = alpha[i][0];
-            pixels[i].r = dataR[i][0];
-            pixels[i].g = dataG[i][0];
-            pixels[i].b = dataB[i][0];
+namespace {
 
-            for(unsigned s=1; s<sampleCount[i]; s++)
-            {
-                float a = pixels[i].a;
-                if( a>=1.f)
-                    break;
+// Compressed chunk of deep scanlines, read from disk to be decoded in
+// another thread
+struct DeepChunk
+{
+    int y1, y2;
+    std::vector< char > data;
+};
 
-                pixels[i].r += (1.f - a) * dataR[i][s];
-                pixels[i].g += (1.f - a) * dataG[i][s];
-                pixels[i].b += (1.f - a) * dataB[i][s];
-                pixels[i].a += (1.f - a) * alpha[i][s];
-            }
-        }
+typedef std::vector< DeepChunk > DeepChunkList;
+
+void deep_sample_counts( const DeepScanLineInputPart* in,
+                         const DeepFrameBuffer* fb,
+                         const DeepChunkList* chunks,
+                         const size_t first, const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        const DeepChunk& c = (*chunks)[i];
+        in->readPixelSampleCounts( &c.data[0], *fb, c.y1, c.y2 );
     }
-    else
+}
+
+void deep_samples( const DeepScanLineInputPart* in,
+                   const DeepFrameBuffer* fb,
+                   const DeepChunkList* chunks,
+                   const size_t first, const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
     {
-        for (int i = 0; i < zsize; i++)
-        {
-            if (sampleCount[i] > 0)
-            {
-                pixels[i].a = alpha[i][0];
-                if (rgbflag)
-                {
-                    pixels[i].r = dataR[i][0];
-                    pixels[i].g = dataG[i][0];
-                    pixels[i].b = dataB[i][0];
-                }
-                else
-                {
-                    pixels[i].r = zbuff[i][0];
-                    pixels[i].g = zbuff[i][0];
-                    pixels[i].b = zbuff[i][0];
-                }
-            }
-        }
+        const DeepChunk& c = (*chunks)[i];
+        in->readPixels( &c.data[0], *fb, c.y1, c.y2 );
     }
+}
 
 }
 
 void
 exrImage::loadDeepScanlineImage ( Imf::MultiPartInputFile& inmaster,
-                                  int &zsize,
-                                  Imf::Array<float*>&       zbuff,
-                                  Imf::Array<unsigned int>& sampleCount,
-                                  bool deepComp)
+                                  DeepSamples& deep )
 {
 
     _has_deep_data = true;
@@ -1731,53 +2051,51 @@ exrImage::loadDeepScanlineImage ( Imf::MultiPartInputFile& inmaster,
     int dx = dataWindow.min.x;
     int dy = dataWindow.min.y;
 
-
-
-    Array< float* > zback;
-    Array< half* > alpha;
-
-    zsize = dw * dh;
-    zbuff.resizeErase (zsize);
-
-    sampleCount.resizeErase (zsize);
-
-    int rgbflag = 0;
-    int deepCompflag = 0;
-
-    if (header.channels().findChannel ("Z") &&
-            header.channels().findChannel ("A") &&
-            deepComp)
-    {
-        deepCompflag = 1;
-    }
+    deep.resize( dw, dh, false );
 
     DeepFrameBuffer fb;
 
     fb.insertSampleCountSlice (Slice (Imf::UINT,
-                                      (char *) (&sampleCount[0]
+                                      (char *) (deep.sample_counts()
                                               - dx- dy * dw),
                                       sizeof (unsigned int) * 1,
                                       sizeof (unsigned int) * dw));
 
     fb.insert ("Z",
                DeepSlice (Imf::FLOAT,
-                          (char *) (&zbuff[0] - dx- dy * dw),
+                          (char *) (deep.z() - dx- dy * dw),
                           sizeof (float *) * 1,    // xStride for pointer array
                           sizeof (float *) * dw,   // yStride for pointer array
                           sizeof (float) * 1));    // stride for z data sample
 
     in.setFrameBuffer (fb);
 
-    in.readPixelSampleCounts (dataWindow.min.y, dataWindow.max.y);
-
-    for (int i = 0; i < dh * dw; i++)
+    // Reading the file is serial, but decompressing is not.  Pull all
+    // the compressed chunks first and decode them in parallel.
+    DeepChunkList chunks;
+    for ( int y = dataWindow.min.y; y <= dataWindow.max.y; )
     {
-        zbuff[i] = new float[sampleCount[i]];
+        DeepChunk c;
+        c.y1 = in.firstScanLineInChunk( y );
+        c.y2 = std::min( in.lastScanLineInChunk( y ), dataWindow.max.y );
+
+        Imf::Int64 size = 0;
+        in.rawPixelData( c.y1, NULL, size );
+        c.data.resize( size );
+        in.rawPixelData( c.y1, &c.data[0], size );
+
+        chunks.push_back( c );
+        y = c.y2 + 1;
     }
 
-    in.readPixels (dataWindow.min.y, dataWindow.max.y);
+    parallel_for( 0, chunks.size(), 1,
+                  boost::bind( deep_sample_counts, &in, &fb, &chunks,
+                               _1, _2 ) );
 
+    deep.allocate();
 
+    parallel_for( 0, chunks.size(), 1,
+                  boost::bind( deep_samples, &in, &fb, &chunks, _1, _2 ) );
 }
 
 bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
@@ -2225,6 +2543,23 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
             // Quick exit if stereo is off or multiview
             if ( _stereo_output == kNoStereo ) break;
 
+            // Both views of a multiview part were read above in one pass
+            // by handle_stereo().  Reading the part again for the right
+            // eye would only decode the same pixels twice.
+            if ( _multiview && st[0] == st[1] )
+            {
+                data_window2( dataWindow.min.x * pct, dataWindow.min.y * pct,
+                              dataWindow.max.x * pct, dataWindow.max.y * pct,
+                              frame );
+
+                display_window2( displayWindow.min.x * pct,
+                                 displayWindow.min.y * pct,
+                                 displayWindow.max.x * pct,
+                                 displayWindow.max.y * pct,
+                                 frame );
+                break;
+            }
+
             if ( st[0] != st[1] )
             {
                 if ( i == 0 ) update_cache_pic( _sequence, canvas );
@@ -2248,11 +2583,9 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
 
             read_header_attr( header, frame );
 
-            int zsize;
-            Imf::Array< float* > zbuff;
-            Imf::Array< unsigned > sampleCount;
-            loadDeepTileImage( canvas, inmaster, zsize, zbuff,
-                               sampleCount, true );
+            DeepSamplesPtr deep( new DeepSamples );
+            loadDeepTileImage( canvas, inmaster, *deep, true );
+            if ( _keep_deep ) keep_deep( deep, frame );
             return true;
         }
 
@@ -2331,6 +2664,9 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
         }
         else
         {
+            LayerPics pics;
+            add_cached_layers( pics, header, fb, frame );
+
             try
             {
                 in.setFrameBuffer(fb);
@@ -2341,6 +2677,8 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
                 IMG_ERROR( e.what() );
                 return false;
             }
+
+            store_cached_layers( pics );
         }
 
     }
@@ -2348,6 +2686,72 @@ bool exrImage::fetch_multipart(  mrv::image_type_ptr& canvas,
     return true;
 }
 
+void exrImage::add_cached_layers( LayerPics& pics, const Imf::Header& h,
+                                  Imf::FrameBuffer& fb,
+                                  const boost::int64_t& frame )
+{
+    if ( !_joint_layers || !is_sequence() || _use_yca ) return;
+    if ( _type != SCANLINEIMAGE && _type != TILEDIMAGE ) return;
+    if ( frame < _frame_start || frame > _frame_end ) return;
+
+    const boost::uint64_t idx = frame - _frame_start;
+
+    stringArray names;
+    {
+        SCOPED_LOCK( _mutex );
+        LayerCaches::const_iterator i = _layer_caches.begin();
+        LayerCaches::const_iterator e = _layer_caches.end();
+        for ( ; i != e; ++i )
+        {
+            // Layers of other parts are not in this read
+            if ( !i->first.empty() && i->first[0] == '#' ) continue;
+            if ( !i->second[idx] ) names.push_back( i->first );
+        }
+    }
+
+    bool alpha = _has_alpha;
+
+    for ( size_t i = 0; i < names.size(); ++i )
+    {
+        const char* layer = names[i].empty() ? NULL : names[i].c_str();
+
+        mrv::image_type_ptr pic;
+        Imf::FrameBuffer lfb;
+        if ( ! find_channels( pic, h, lfb, frame, layer ) ) continue;
+
+        // A layer sharing channels with one read already cannot be read
+        // in the same pass
+        bool shared = false;
+        Imf::FrameBuffer::ConstIterator s = lfb.begin();
+        Imf::FrameBuffer::ConstIterator e = lfb.end();
+        for ( ; s != e; ++s )
+        {
+            if ( fb.findSlice( s.name() ) ) shared = true;
+        }
+        if ( shared ) continue;
+
+        for ( s = lfb.begin(); s != e; ++s )
+            fb.insert( s.name(), s.slice() );
+
+        pics.push_back( std::make_pair( names[i], pic ) );
+    }
+
+    _has_alpha = alpha;
+}
+
+void exrImage::store_cached_layers( const LayerPics& pics )
+{
+    if ( pics.empty() ) return;
+
+    SCOPED_LOCK( _mutex );
+    for ( size_t i = 0; i < pics.size(); ++i )
+    {
+        LayerCaches::iterator it = _layer_caches.find( pics[i].first );
+        if ( it == _layer_caches.end() ) continue;
+        update_cache_pic( it->second, pics[i].second );
+    }
+}
+
 /**
  * Fetch the current EXR image
  *
@@ -2366,14 +2770,70 @@ bool exrImage::fetch(  mrv::image_type_ptr& canvas,
             return fetch_mipmap( canvas, frame );
         }
 
-        MultiPartInputFile inmaster( sequence_filename(frame).c_str() );
+        boost::shared_ptr< MultiPartInputFile > file(
+            new MultiPartInputFile( sequence_filename(frame).c_str() ) );
+        MultiPartInputFile& inmaster = *file;
         _numparts = inmaster.parts();
 
+        // When playing zoomed out, read a coarser mipmap level instead
+        // of the full image.  Only for plain single part files, where
+        // the tiled level reader sees the same channels.
+        if ( proxy_level() > 0 && _numparts == 1 && !_is_stereo )
+        {
+            const Imf::Header& h = inmaster.header(0);
+            if ( h.hasTileDescription() &&
+                 h.tileDescription().mode != Imf::ONE_LEVEL &&
+                 ( !h.hasType() || h.type() == Imf::TILEDIMAGE ) )
+                return fetch_mipmap( canvas, frame, proxy_level() );
+        }
+
+        // Zoomed in on a very large image, read only what is shown.
+        // Scanline files decode whole lines, tiled files whole tiles.
+        // Subsampled luminance/chroma channels are always read whole.
+        if ( _numparts == 1 && !_is_stereo && cache_scale() == 0 )
+        {
+            const Imf::Header& h = inmaster.header(0);
+            const Imf::ChannelList& chs = h.channels();
+            bool tiled = h.hasTileDescription();
+            bool plain = ( !h.hasType() || h.type() == Imf::SCANLINEIMAGE ||
+                           h.type() == Imf::TILEDIMAGE );
+            if ( plain && !chs.findChannel( "RY" ) && !chs.findChannel( "BY" ) )
+            {
+                const Box2i& dw = h.dataWindow();
+                mrv::Recti full( dw.min.x, dw.min.y,
+                                 dw.max.x - dw.min.x + 1,
+                                 dw.max.y - dw.min.y + 1 );
+                mrv::Recti region;
+                int tw = tiled ? (int) h.tileDescription().xSize : 0;
+                int th = tiled ? (int) h.tileDescription().ySize : 1;
+                if ( roi_region( full, region, tw, th ) )
+                    return fetch_region( canvas, inmaster, frame, region );
+            }
+        }
+
         if ( _numparts > 0 )
         {
             if ( !  fetch_multipart( canvas, inmaster, frame ) )
                 return false;
 
+            // Someone showed the deep samples.  Read them for this frame
+            // too while the file is open.  Otherwise keep the file open,
+            // so the first loadDeepData() does not open it again.
+            const Imf::Header& h = inmaster.header( _curpart );
+            if ( _keep_deep && h.hasType() && h.type() == DEEPSCANLINE )
+            {
+                DeepSamplesPtr deep( new DeepSamples );
+                loadDeepScanlineImage( inmaster, *deep );
+                keep_deep( deep, frame );
+            }
+            else if ( !_keep_deep && h.hasType() &&
+                      ( h.type() == DEEPSCANLINE || h.type() == DEEPTILE ) )
+            {
+                SCOPED_LOCK( _data_mutex );
+                _deep_file = file;
+                _deep_file_frame = frame;
+            }
+
             if ( _use_yca && !supports_yuv() )
             {
                 const Imf::Header& h = inmaster.header(0);
@@ -2393,7 +2853,7 @@ bool exrImage::fetch(  mrv::image_type_ptr& canvas,
 }
 
 static
-void save_attributes( const CMedia* img, Header& hdr,
+void save_attributes( CMedia* img, Header& hdr,
                       const EXROpts* opts )
 {
     stringSet attrs;
@@ -2415,6 +2875,7 @@ void save_attributes( const CMedia* img, Header& hdr,
     }
 
 
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     const CMedia::Attributes& attributes = img->attributes();
     CMedia::Attributes::const_iterator it = attributes.find( _( "UTC Offset" ) );
     if ( it != attributes.end() )
@@ -2821,7 +3282,7 @@ void add_layer( HeaderList& headers, FrameBufferList& fbs,
 
 
 
-bool save_deep_data(const char* file, const CMedia* img,
+bool save_deep_data(const char* file, CMedia* img,
                     const EXROpts* opts )
 {
     using namespace Imf;
@@ -2911,7 +3372,7 @@ bool save_deep_data(const char* file, const CMedia* img,
     return true;
 }
 
-bool exrImage::save( const char* file, const CMedia* img,
+bool exrImage::save( const char* file, CMedia* img,
                      const ImageOpts* const ipts )
 {
 
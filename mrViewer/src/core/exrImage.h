@@ -39,6 +39,8 @@
 #include <ImfMultiPartInputFile.h>
 #include <ImfFrameBuffer.h>
 
+#include "core/mrvDeepSamples.h"
+
 
 
 namespace mrv {
@@ -89,7 +91,7 @@ public:
     virtual bool fetch( mrv::image_type_ptr& canvas,
 			const boost::int64_t frame );
 
-    static bool save( const char* file, const CMedia* img,
+    static bool save( const char* file, CMedia* img,
                       const ImageOpts* const opts );
 
     std::string type() const {
@@ -120,29 +122,38 @@ public:
 
     int numparts() const { return _numparts; }
 
-    void loadDeepData( int& zsize,
-                       Imf::Array<float*>&       zbuff,
-                       Imf::Array<unsigned int>& sampleCount );
+    /// Deep samples of the current frame.  The first call reads them
+    /// from the file fetch() left open; from then on fetch() keeps the
+    /// samples of every frame it reads, so the file is not opened twice.
+    DeepSamplesPtr loadDeepData();
+
+    /// Stop keeping deep samples and files, once they are not shown
+    void drop_deep();
+
+    /// True once after headers were read in the background for the
+    /// attributes of frames, so they are asked for again
+    static bool attributes_ready();
+
+    /// Stop the thread reading headers for attributes
+    static void shutdown();
+
+    /// Whether a frame read also fills the caches of the other layers
+    /// shown before, from the same read of the file
+    static bool joint_layers() { return _joint_layers; }
+    static void joint_layers( const bool x ) { _joint_layers = x; }
 
-    void findZBound( float& zmin, float& zmax, float farPlane,
-                     int zsize,
-                     Imf::Array<float*>&       zbuff,
-                     Imf::Array<unsigned int>& sampleCount );
-    
 protected:
 
     void loadDeepTileImage( mrv::image_type_ptr& canvas,
 			    Imf::MultiPartInputFile& inmaster,
-                            int &zsize,
-                            Imf::Array<float*>&       zbuff,
-                            Imf::Array<unsigned int>& sampleCount,
+                            DeepSamples& deep,
                             bool deepComp );
 
-    void loadDeepScanlineImage (Imf::MultiPartInputFile& inmaster,
-                                int &zsize,
-                                Imf::Array<float*>&       zbuff,
-                                Imf::Array<unsigned int>& sampleCount,
-                                bool deepComp);
+    void loadDeepScanlineImage( Imf::MultiPartInputFile& inmaster,
+                                DeepSamples& deep );
+
+    /// Keep deep samples read by fetch() for loadDeepData()
+    void keep_deep( const DeepSamplesPtr& deep, const boost::int64_t frame );
 
     bool find_layers( const Imf::Header& h );
     bool handle_stereo( mrv::image_type_ptr& canvas,
@@ -156,21 +167,49 @@ protected:
 			Imf::ChannelList::ConstIterator& e,
 			const Imf::ChannelList& channels,
 			const Imf::Header& hdr,
-			Imf::FrameBuffer& fb
+			Imf::FrameBuffer& fb,
+			const char* layer
 			);
     void ycc2rgba( const Imf::Header& hdr, const boost::int64_t& frame,
 		   mrv::image_type_ptr& canvas );
     bool fetch_mipmap(  mrv::image_type_ptr& canvas,
-			const boost::int64_t& frame );
+			const boost::int64_t& frame,
+                        const unsigned proxy = 0 );
+    bool fetch_region( mrv::image_type_ptr& canvas,
+                       Imf::MultiPartInputFile& inmaster,
+                       const boost::int64_t& frame,
+                       const mrv::Recti& region );
+    virtual bool fill_region( mrv::image_type_ptr& canvas,
+                              const mrv::image_type_ptr& held,
+                              mrv::Recti& region ) const;
     bool fetch_multipart(  mrv::image_type_ptr& canvas,
 			   Imf::MultiPartInputFile& inmaster,
                           const boost::int64_t& frame );
     bool find_channels( mrv::image_type_ptr& canvas,
 			const Imf::Header& h, Imf::FrameBuffer& fb,
                         const boost::int64_t& frame );
+    bool find_channels( mrv::image_type_ptr& canvas,
+			const Imf::Header& h, Imf::FrameBuffer& fb,
+                        const boost::int64_t& frame,
+                        const char* layer );
+
+    typedef std::vector< std::pair< std::string,
+                                    mrv::image_type_ptr > > LayerPics;
+
+    /// Add to fb the channels of the cached layers missing frame, each
+    /// to a picture of its own in pics
+    void add_cached_layers( LayerPics& pics, const Imf::Header& h,
+                            Imf::FrameBuffer& fb,
+                            const boost::int64_t& frame );
+
+    /// Store pictures read by add_cached_layers() in their caches
+    void store_cached_layers( const LayerPics& pics );
     void read_header_attr( const Imf::Header& h,
                            const boost::int64_t& frame );
 
+    /// Read the attributes of frame that read_header_attr() left out
+    virtual bool load_attributes( const int64_t frame );
+
     /// Returns true if image has an alpha channel
     virtual bool  has_alpha() const {
         return _has_alpha;
@@ -221,11 +260,29 @@ protected:
     std::string         _type;
     float               farPlane;
     bool                deepComp;
+    DeepSamplesPtr      _deep;        //!< samples of _deep_frame
+    boost::int64_t      _deep_frame;
+    std::atomic<bool>   _keep_deep;   //!< whether fetch() keeps samples
+    boost::shared_ptr< Imf::MultiPartInputFile > _deep_file; //!< of frame
+    boost::int64_t      _deep_file_frame;  //!< read last by fetch()
+
+    // Channels read by the last fetch_region(), for fill_region()
+    struct RoiSlice
+    {
+        std::string     name;
+        Imf::PixelType  type;
+        size_t          offset;   //!< bytes into a pixel
+    };
+    typedef std::vector< RoiSlice > RoiSlices;
+    RoiSlices           _roi_slices;  //!< under _data_mutex
 
 public:
     static float _default_gamma;
     static Imf::Compression _default_compression;
     static float _default_dwa_compression;
+
+protected:
+    static bool _joint_layers;
 };
 
 }
@@ -87,7 +87,7 @@ ImageTypes image_filetypes[] =
     { exrImage::test,   NULL,            exrImage::get },
     { iffImage::test,   NULL,            iffImage::get },
     { mapImage::test,   NULL,            mapImage::get },
-    //{ hdrImage::test,   NULL,            hdrImage::get }, // broken
+    { hdrImage::test,   NULL,            hdrImage::get },
     { picImage::test,   NULL,            picImage::get },
     { NULL,             brawImage::test, brawImage::get },
     { aviImage::test,   NULL,            aviImage::get },
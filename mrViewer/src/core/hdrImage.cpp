@@ -28,23 +28,38 @@
 
 #include  <stdio.h>
 
+#include <cmath>
+#include <vector>
 #include <iostream>
 #include <algorithm>
 
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 #include <FL/fl_utf8.h>
 #include <FL/Fl.H>
 
 #include <ImathMath.h> // for Math:: functions
 #include <ImfStringAttribute.h>
+#include <half.h>
 
 #include "hdrImage.h"
 #include "mrvException.h"
 #include "mrvOS.h"
 #include "core/mrvColorOps.h"
+#include "core/mrvParallel.h"
 #include "gui/mrvPreferences.h"
 #include "gui/mrvIO.h"
 #include "mrViewer.h"
 
+#if defined(MR_SSE) && ( defined(__SSE2__) || defined(_M_X64) || \
+                         ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+#  define MRV_HDR_SSE2
+#  include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -71,8 +86,137 @@ const char* kModule = "hdr";
 #define  copycolr(c1,c2)	(c1[0]=c2[0],c1[1]=c2[1],       \
                                  c1[2]=c2[2],c1[3]=c2[3])
 
+namespace bip = boost::interprocess;
+
 namespace mrv {
 
+namespace {
+
+// Scanlines handed to a thread at a time
+const size_t kRowGrain = 16;
+
+typedef hdrImage::COLR COLR;
+
+struct Scanlines
+{
+    std::vector< const unsigned char* > rows;  // start of each scanline
+    const unsigned char* end;
+    void*    pixels;
+    bool     use_half;
+    unsigned width;
+    unsigned height;
+    bool     flipX;
+    bool     flipY;
+};
+
+// Like fgets, but out of a block of memory
+bool next_line( char* line, const size_t max, const char* data,
+                const size_t size, size_t& pos )
+{
+    if ( pos >= size ) return false;
+
+    size_t n = 0;
+    while ( pos < size && n < max - 1 )
+    {
+        char c = data[pos++];
+        line[n++] = c;
+        if ( c == '\n' ) break;
+    }
+    line[n] = 0;
+    return true;
+}
+
+// 2^(e - 136): the exponent excess plus the 8 bits of the mantissa
+inline float rgbe_scale( const unsigned e )
+{
+    if ( e == 0 ) return 0.0f;
+    if ( e <= 9 ) return ldexpf( 1.0f, int(e) - (COLXS+8) );
+
+    union { unsigned i; float f; } s;
+    s.i = ( e - 9 ) << 23;
+    return s.f;
+}
+
+void convert_row( const Scanlines* job, const COLR* scanline,
+                  const size_t r )
+{
+    const unsigned w = job->width;
+    const size_t y = job->flipY ? job->height - 1 - r : r;
+    const size_t row = y * w;
+
+    if ( job->use_half )
+    {
+        half* pixels = (half*) job->pixels + row * 4;
+        for ( unsigned i = 0; i < w; ++i )
+        {
+            const unsigned char* c = scanline[i];
+            const unsigned x = job->flipX ? w - 1 - i : i;
+            half* p = pixels + x * 4;
+            const float f = rgbe_scale( c[EXP] );
+            p[0] = half( ( c[RED] + 0.5f ) * f );
+            p[1] = half( ( c[GRN] + 0.5f ) * f );
+            p[2] = half( ( c[BLU] + 0.5f ) * f );
+            p[3] = half( 1.0f );
+        }
+        return;
+    }
+
+    float* pixels = (float*) job->pixels + row * 4;
+
+#ifdef MRV_HDR_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128  bias = _mm_set1_ps( 0.5f );
+    const __m128  rgb  = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+    const __m128  one  = _mm_set_ps( 1.0f, 0.0f, 0.0f, 0.0f );
+    for ( unsigned i = 0; i < w; ++i )
+    {
+        const unsigned char* c = scanline[i];
+        const unsigned x = job->flipX ? w - 1 - i : i;
+
+        int bytes;
+        memcpy( &bytes, c, 4 );
+        __m128i v = _mm_unpacklo_epi8( _mm_cvtsi32_si128( bytes ), zero );
+        v = _mm_unpacklo_epi16( v, zero );
+        __m128 f = _mm_add_ps( _mm_cvtepi32_ps( v ), bias );
+        f = _mm_mul_ps( f, _mm_set1_ps( rgbe_scale( c[EXP] ) ) );
+        f = _mm_or_ps( _mm_and_ps( f, rgb ), one );
+        _mm_storeu_ps( pixels + x * 4, f );
+    }
+#else
+    for ( unsigned i = 0; i < w; ++i )
+    {
+        const unsigned char* c = scanline[i];
+        const unsigned x = job->flipX ? w - 1 - i : i;
+        float* p = pixels + x * 4;
+        const float f = rgbe_scale( c[EXP] );
+        p[0] = ( c[RED] + 0.5f ) * f;
+        p[1] = ( c[GRN] + 0.5f ) * f;
+        p[2] = ( c[BLU] + 0.5f ) * f;
+        p[3] = 1.0f;
+    }
+#endif
+}
+
+void decode_rows( const Scanlines* job, const size_t first,
+                  const size_t last )
+{
+    boost::scoped_array< unsigned char > buf(
+        new unsigned char[ job->width * sizeof(COLR) ] );
+    COLR* scanline = (COLR*) buf.get();
+
+    for ( size_t r = first; r < last; ++r )
+    {
+        // Already checked by skip_rle, so this does not fail
+        hdrImage::read_colors( scanline, job->width, job->rows[r],
+                               job->end );
+        convert_row( job, scanline, r );
+    }
+}
+
+}
+
+bool hdrImage::_half_float = false;
+
 
 hdrImage::hdrImage() :
     CMedia(),
@@ -101,7 +245,7 @@ bool hdrImage::test(const boost::uint8_t *data, unsigned)
 }
 
 
-void hdrImage::read_header( FILE* f )
+size_t hdrImage::read_header( const char* data, const size_t size )
 {
     char line[256];
 
@@ -115,7 +259,8 @@ void hdrImage::read_header( FILE* f )
 
     _attrs.insert( std::make_pair( _frame.load(), Attributes() ) );
 
-    while ( fgets( line, 256, f ) != NULL )
+    size_t pos = 0;
+    while ( next_line( line, 256, data, size, pos ) )
     {
         char* s = line;
         while(isspace(*s)) ++s;   // skip spaces
@@ -144,6 +289,7 @@ void hdrImage::read_header( FILE* f )
             }
 
             char* val = strtok_r( NULL, "=", &state );
+            if ( !val ) EXCEPTION("missing Radiance HDR format");
 
             if ( strcasecmp( val, "32-bit_rle_rgbe" ) == 0 )
             {
@@ -164,7 +310,8 @@ void hdrImage::read_header( FILE* f )
         else if ( strcasecmp( keyword, "OWNER" ) == 0 )
         {
             static const std::string key = _("Owner");
-            std::string val = strtok_r( NULL, "=", &state );
+            const char* val = strtok_r( NULL, "=", &state );
+            if ( !val ) continue;
             Imf::StringAttribute attr( val );
             _attrs[_frame].insert( std::make_pair( key, attr.copy() ) );
         }
@@ -197,6 +344,7 @@ void hdrImage::read_header( FILE* f )
         {
             static const std::string key = _("Exposure");
             char* val = strtok_r( NULL, "=", &state );
+            if ( !val ) continue;
             Imf::StringAttribute attr( val );
             _attrs[_frame].insert( std::make_pair( key, attr.copy() ) );
 
@@ -206,8 +354,8 @@ void hdrImage::read_header( FILE* f )
         else if ( strcasecmp( keyword, "COLORCORR" ) == 0 )
         {
             const char* val = strtok_r( NULL, "=", &state );
-            if ( sscanf( val, "%f %f %f ",
-                         &corr[0], &corr[1], &corr[2] ) != 3 )
+            if ( !val || sscanf( val, "%f %f %f ",
+                                 &corr[0], &corr[1], &corr[2] ) != 3 )
                 continue;
 
             continue;
@@ -215,7 +363,8 @@ void hdrImage::read_header( FILE* f )
         else if ( strcasecmp( keyword, "SOFTWARE" ) == 0 )
         {
             static const std::string key = _("Software");
-            std::string val = strtok_r( NULL, "=", &state );
+            const char* val = strtok_r( NULL, "=", &state );
+            if ( !val ) continue;
             Imf::StringAttribute attr( val );
             _attrs[_frame].insert( std::make_pair( key, attr.copy() ) );
             continue;
@@ -223,6 +372,7 @@ void hdrImage::read_header( FILE* f )
         else if ( strcasecmp( keyword, "PIXASPECT" ) == 0 )
         {
             const char* val = strtok_r( NULL, "=", &state );
+            if ( !val ) continue;
             _pixel_ratio = (float) atof( val );
 
             if ( _pixel_ratio <= 0.0f ) _pixel_ratio = 1.0f;
@@ -237,11 +387,11 @@ void hdrImage::read_header( FILE* f )
         else if ( strcasecmp( s, "PRIMARIES" ) == 0 )
         {
             const char* val = strtok_r( NULL, "=", &state );
-            if ( sscanf( val, "%f %f %f %f %f %f %f %f",
-                         &cieXY[0].x, &cieXY[0].y,
-                         &cieXY[1].x, &cieXY[1].y,
-                         &cieXY[2].x, &cieXY[2].y,
-                         &cieXY[3].x, &cieXY[3].y ) != 8 )
+            if ( !val || sscanf( val, "%f %f %f %f %f %f %f %f",
+                                 &cieXY[0].x, &cieXY[0].y,
+                                 &cieXY[1].x, &cieXY[1].y,
+                                 &cieXY[2].x, &cieXY[2].y,
+                                 &cieXY[3].x, &cieXY[3].y ) != 8 )
                 continue;
 
 
@@ -260,17 +410,18 @@ void hdrImage::read_header( FILE* f )
                 if ( ptr[0] != '-' ) flipY = true;
 
                 ptr = strtok_r( NULL, " ", &state ); // Y value
+                if ( !ptr ) break;
                 h = atoi( ptr );
 
                 ptr = strtok_r( NULL, " ", &state ); // X keyword
-                if ( !ptr || strlen(ptr) != 2 ) continue;
+                if ( !ptr || strlen(ptr) != 2 ) break;
 
                 if ( ptr[1] == 'X' )
                 {
                     if ( ptr[0] != '+' ) flipX = true;
 
                     ptr = strtok_r( NULL, " ", &state ); // X value
-                    w = atoi( ptr );
+                    if ( ptr ) w = atoi( ptr );
                 }
                 break;
             }
@@ -287,11 +438,16 @@ void hdrImage::read_header( FILE* f )
     if ( w == 0 || h == 0 ) EXCEPTION("resolution not found");
 
     image_size( w, h );
+
+    // Pixels start right after the resolution line
+    return pos;
 }
 
 
-int
-hdrImage::oldreadcolrs(COLR* scanline, int len, FILE* fp)
+const unsigned char*
+hdrImage::oldreadcolrs(COLR* scanline, int len,
+                       const unsigned char* p, const unsigned char* end,
+                       const COLR* start)
 {
     int  rshift;
     int  i;
@@ -299,16 +455,19 @@ hdrImage::oldreadcolrs(COLR* scanline, int len, FILE* fp)
     rshift = 0;
 
     while (len > 0) {
-        scanline[0][RED] = getc(fp);
-        scanline[0][GRN] = getc(fp);
-        scanline[0][BLU] = getc(fp);
-        scanline[0][EXP] = getc(fp);
-        if (feof(fp) || ferror(fp))
-            return(-1);
+        if ( end - p < 4 )
+            return NULL;
+        scanline[0][RED] = *p++;
+        scanline[0][GRN] = *p++;
+        scanline[0][BLU] = *p++;
+        scanline[0][EXP] = *p++;
         if (scanline[0][RED] == 1 &&
                 scanline[0][GRN] == 1 &&
                 scanline[0][BLU] == 1) {
-            for (i = scanline[0][EXP] << rshift; i > 0; i--) {
+            // A repeat needs a previous color in this scanline
+            if ( scanline == start )
+                return NULL;
+            for (i = scanline[0][EXP] << rshift; i > 0 && len > 0; i--) {
                 copycolr(scanline[0], scanline[-1]);
                 scanline++;
                 len--;
@@ -320,76 +479,80 @@ hdrImage::oldreadcolrs(COLR* scanline, int len, FILE* fp)
             rshift = 0;
         }
     }
-    return(0);
+    return p;
 }
 
 
-int
-hdrImage::read_colors(COLR* scanline, int len, FILE* fp)
+const unsigned char*
+hdrImage::read_colors(COLR* scanline, int len,
+                      const unsigned char* p, const unsigned char* end)
 {
     int  i, j;
     int  code, val;
     /* determine scanline type */
     if ((len < MINELEN) | (len > MAXELEN))
-        return(oldreadcolrs(scanline, len, fp));
-    if ((i = getc(fp)) == EOF)
-        return(-1);
-    if (i != 2) {
-        ungetc(i, fp);
-        return(oldreadcolrs(scanline, len, fp));
-    }
-    scanline[0][GRN] = getc(fp);
-    scanline[0][BLU] = getc(fp);
-    if ((i = getc(fp)) == EOF)
-        return(-1);
-    if (scanline[0][GRN] != 2 || scanline[0][BLU] & 128) {
-        scanline[0][RED] = 2;
-        scanline[0][EXP] = i;
-        return(oldreadcolrs(scanline+1, len-1, fp));
-    }
-    if ((scanline[0][BLU]<<8 | i) != len)
-        return(-1);		/* length mismatch! */
+        return(oldreadcolrs(scanline, len, p, end, scanline));
+    if ( end - p < 4 )
+        return NULL;
+    if (p[0] != 2 || p[1] != 2 || (p[2] & 128))
+        return(oldreadcolrs(scanline, len, p, end, scanline));
+    if ((p[2]<<8 | p[3]) != len)
+        return NULL;		/* length mismatch! */
+    p += 4;
     /* read each component */
     for (i = 0; i < 4; i++)
         for (j = 0; j < len; ) {
-            if ((code = getc(fp)) == EOF)
-                return(-1);
+            if (p == end)
+                return NULL;
+            code = *p++;
             if (code > 128) {	/* run */
                 code &= 127;
-                if ((val = getc(fp)) == EOF)
-                    return -1;
+                if (p == end)
+                    return NULL;
+                val = *p++;
                 if (j + code > len)
-                    return -1;	/* overrun */
+                    return NULL;	/* overrun */
                 while (code--)
                     scanline[j++][i] = val;
             } else {		/* non-run */
-                if (j + code > len)
-                    return -1;	/* overrun */
-                while (code--) {
-                    if ((val = getc(fp)) == EOF)
-                        return -1;
-                    scanline[j++][i] = val;
-                }
+                if (code == 0 || j + code > len || end - p < code)
+                    return NULL;	/* overrun */
+                while (code--)
+                    scanline[j++][i] = *p++;
             }
         }
-    return(0);
+    return p;
 }
 
 
-void hdrImage::colr2color( Pixel& col, COLR clr )
+const unsigned char*
+hdrImage::skip_rle( int len, const unsigned char* p,
+                    const unsigned char* end )
 {
-    double  f;
-
-    col.a = 1.0;
-
-    if (clr[EXP] == 0)
-        col.r = col.g = col.b = 0.0;
-    else {
-        f = ldexp(1.0, (int)clr[EXP]-(COLXS+8));
-        col.r = float( (clr[RED] + 0.5)*f );
-        col.g = float( (clr[GRN] + 0.5)*f );
-        col.b = float( (clr[BLU] + 0.5)*f );
-    }
+    if ((len < MINELEN) | (len > MAXELEN))
+        return NULL;
+    if ( end - p < 4 || p[0] != 2 || p[1] != 2 || (p[2] & 128) ||
+         (p[2]<<8 | p[3]) != len )
+        return NULL;
+    p += 4;
+    for (int i = 0; i < 4; i++)
+        for (int j = 0; j < len; ) {
+            if (p == end)
+                return NULL;
+            int code = *p++;
+            if (code > 128) {	/* run */
+                code &= 127;
+                ++p;
+            } else {		/* non-run */
+                if (code == 0)
+                    return NULL;
+                p += code;
+            }
+            j += code;
+            if (j > len || p > end)
+                return NULL;
+        }
+    return p;
 }
 
 
@@ -410,56 +573,93 @@ bool hdrImage::fetch( mrv::image_type_ptr& canvas,
 
     try {
 
-        FILE* f = fl_fopen( sequence_filename(frame).c_str(), "rb" );
-        if ( f == NULL ) EXCEPTION("could not open file");
-
-        read_header(f);
-        allocate_pixels(canvas, frame, 4, image_type::kRGBA,
-                        image_type::kFloat );
+        const std::string file = sequence_filename(frame);
 
-        unsigned w = width();
-        COLR* scanline = (COLR*) av_malloc( sizeof(COLR) * w );
-        if ( !scanline ) EXCEPTION("could not allocate scanline");
+        // Map the file if we can, otherwise read it all in one go
+        boost::scoped_ptr< bip::file_mapping > mapping;
+        boost::scoped_ptr< bip::mapped_region > region;
+        std::vector< char > buffer;
+        const char* data = NULL;
+        size_t size = 0;
 
-        unsigned h = height();
-        unsigned y = 0;
-        unsigned ylast = h;
-        int      ys = 1;
-
-        if ( flipY )
+        try
         {
-            y = h;
-            ylast = 0;
-            ys = -1;
+            mapping.reset( new bip::file_mapping( file.c_str(),
+                                                  bip::read_only ) );
+            region.reset( new bip::mapped_region( *mapping,
+                                                  bip::read_only ) );
+            data = (const char*) region->get_address();
+            size = region->get_size();
         }
-
-        Pixel* pixels = (Pixel*)canvas->data().get();
-        for ( ; y != ylast; y += ys )
+        catch( const bip::interprocess_exception& )
         {
-            memset( scanline, 0, w*sizeof(COLR) );
-            read_colors(scanline, w, f);
+            region.reset();
+            mapping.reset();
 
-            unsigned x = 0;
-            int xs = 1;
-            unsigned xlast = w;
-            if ( flipX )
-            {
-                x = w;
-                xlast = 0;
-                xs = -1;
-            }
+            FILE* f = fl_fopen( file.c_str(), "rb" );
+            if ( f == NULL ) EXCEPTION("could not open file");
 
-            for ( ; x != xlast; x += xs )
+            fseek( f, 0, SEEK_END );
+            long len = ftell( f );
+            fseek( f, 0, SEEK_SET );
+            if ( len > 0 )
             {
-                Pixel& p = pixels[ y * w + x];
-                colr2color( p, scanline[x] );
+                buffer.resize( len );
+                size = fread( &buffer[0], 1, len, f );
+                data = &buffer[0];
             }
+            fclose(f);
+        }
+
+        if ( size == 0 ) EXCEPTION("empty file");
+
+        size_t offset = read_header( data, size );
 
+        const bool half_pixels = _half_float;
+        allocate_pixels(canvas, frame, 4, image_type::kRGBA,
+                        half_pixels ? image_type::kHalf : image_type::kFloat );
+
+        Scanlines job;
+        job.end    = (const unsigned char*) data + size;
+        job.pixels = canvas->data().get();
+        job.use_half = half_pixels;
+        job.width  = width();
+        job.height = height();
+        job.flipX  = flipX;
+        job.flipY  = flipY;
+
+        // Find where each run-length encoded scanline starts in one pass.
+        // Those can be decoded in parallel; anything else (flat or old
+        // style scanlines) is decoded in order afterwards.
+        const unsigned char* p = (const unsigned char*) data + offset;
+        job.rows.reserve( job.height );
+        while ( job.rows.size() < job.height )
+        {
+            const unsigned char* next = skip_rle( job.width, p, job.end );
+            if ( !next ) break;
+            job.rows.push_back( p );
+            p = next;
         }
 
-        av_free( scanline );
+        parallel_for( 0, job.rows.size(), kRowGrain,
+                      boost::bind( decode_rows, &job, _1, _2 ) );
 
-        fclose(f);
+        if ( job.rows.size() < job.height )
+        {
+            const size_t indexed = job.rows.size();
+            job.rows.resize( job.height );
+            boost::scoped_array< unsigned char > buf(
+                new unsigned char[ job.width * sizeof(COLR) ] );
+            COLR* scanline = (COLR*) buf.get();
+            for ( size_t r = indexed; r < job.height; ++r )
+            {
+                memset( scanline, 0, job.width * sizeof(COLR) );
+                // A truncated file keeps what was read and leaves the
+                // rest black, as before.
+                if ( p ) p = read_colors( scanline, job.width, p, job.end );
+                convert_row( &job, scanline, r );
+            }
+        }
 
     }
     catch( const std::exception& e )
@@ -56,17 +56,36 @@ public:
     bool save( const boost::int64_t frame );
     bool fetch( mrv::image_type_ptr& canvas,
 		const boost::int64_t frame );
-protected:
+
+    /// Whether pictures are decoded to half floats instead of floats
+    static bool half_float() { return _half_float; }
+    static void half_float( const bool x ) { _half_float = x; }
 
     typedef unsigned char COLR[4];
 
-    void read_header( FILE* f );
-    int read_colors(COLR* scanline, int len, FILE* f);
-    int oldreadcolrs(COLR* scanline, int len, FILE* fp);
+    /// Decode the scanline at p (of at most end).  Returns the byte past
+    /// it, or NULL if the data is corrupt.
+    static const unsigned char* read_colors( COLR* scanline, int len,
+                                             const unsigned char* p,
+                                             const unsigned char* end );
+
+protected:
+    /// Parse the header of the file in data.  Returns the offset of the
+    /// first scanline.
+    size_t read_header( const char* data, const size_t size );
+
+    static const unsigned char* oldreadcolrs( COLR* scanline, int len,
+                                              const unsigned char* p,
+                                              const unsigned char* end,
+                                              const COLR* start );
 
-    void colr2color( Pixel& col, COLR clr );
+    /// Byte past the run-length encoded scanline at p, without decoding
+    /// it, or NULL if it is not one.
+    static const unsigned char* skip_rle( int len, const unsigned char* p,
+                                          const unsigned char* end );
 
 protected:
+    static bool _half_float;
 
 
     bool  cieXYZ;
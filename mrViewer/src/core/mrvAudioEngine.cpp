@@ -26,6 +26,7 @@
  */
 
 
+#include <cstdlib>
 #include <iostream>
 
 #include "mrvException.h"
@@ -43,6 +44,8 @@
 #    include "audio/mrvAOEngine.h"
 #endif
 
+#include "audio/mrvNullEngine.h"
+
 namespace mrv {
 
 AudioEngine::DeviceList AudioEngine::_devices;
@@ -176,6 +179,19 @@ AudioEngine* AudioEngine::factory()
 {
     AudioEngine* r = NULL;
 
+    // MRV_AUDIO_ENGINE=null plays to no device at all, and
+    // MRV_AUDIO_ENGINE=wav:file.wav records what would have been heard.
+    // Both keep real time, so A/V sync can be checked without a sound card.
+    const char* env = getenv( "MRV_AUDIO_ENGINE" );
+    if ( env )
+    {
+        std::string engine = env;
+        if ( engine == "null" )
+            return new mrv::NullEngine();
+        if ( engine.substr( 0, 4 ) == "wav:" && engine.size() > 4 )
+            return new mrv::NullEngine( engine.substr( 4 ) );
+    }
+
 #if defined(_WIN32) || defined(_WIN64)
     //r = new mrv::DirectXEngine();
     r = new mrv::WaveEngine();
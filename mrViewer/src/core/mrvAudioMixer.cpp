@@ -0,0 +1,289 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioMixer.cpp
+ * @author gga
+ * @date   Sun Oct 18 16:20:05 2026
+ *
+ * @brief  Mixes several PCM rings into a single device buffer.
+ *
+ */
+
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <boost/thread/thread.hpp>
+
+#include "core/mrvThread.h"
+#include "core/mrvAudioMixer.h"
+
+namespace mrv {
+
+namespace {
+
+template< typename T >
+inline T clamp_sample( const double v, const double lo, const double hi )
+{
+    if ( v < lo ) return T( lo );
+    if ( v > hi ) return T( hi );
+    return T( v );
+}
+
+}
+
+AudioMixer::AudioMixer() :
+    _active( 0 ),
+    _volume( 1.0f ),
+    _format( AudioEngine::kFloatLSB ),
+    _channels( 2 ),
+    _frame_size( 8 ),
+    _scratch( kDefaultPeriod )
+{
+}
+
+AudioMixer::~AudioMixer()
+{
+}
+
+void AudioMixer::format( const AudioEngine::AudioFormat f,
+                         const unsigned channels )
+{
+    _format = f;
+    _channels = channels;
+    _frame_size = AudioEngine::bits_for_format( f ) * channels;
+}
+
+void AudioMixer::period( const size_t bytes )
+{
+    if ( bytes > _scratch.size() ) _scratch.resize( bytes );
+}
+
+int AudioMixer::add_source( const size_t bytes )
+{
+    SCOPED_LOCK( _mutex );
+    for ( int i = 0; i < kMaxSources; ++i )
+    {
+        Slot& s = _slots[i];
+        if ( s.active ) continue;
+
+        s.ring.resize( bytes );
+        s.gain = 1.0f;
+        s.active = true;
+        ++_active;
+        return i;
+    }
+    return -1;
+}
+
+void AudioMixer::remove_source( const int id )
+{
+    if ( id < 0 || id >= kMaxSources ) return;
+
+    SCOPED_LOCK( _mutex );
+    Slot& s = _slots[id];
+    if ( !s.active ) return;
+
+    s.active = false;
+    --_active;
+
+    // A mix() already past the active check may still be reading.
+    while ( s.busy ) boost::this_thread::yield();
+}
+
+AudioRing* AudioMixer::source( const int id )
+{
+    if ( id < 0 || id >= kMaxSources ) return NULL;
+    return &_slots[id].ring;
+}
+
+void AudioMixer::gain( const int id, const float g )
+{
+    if ( id < 0 || id >= kMaxSources ) return;
+    _slots[id].gain = g;
+}
+
+void AudioMixer::silence( char* out, const size_t bytes ) const
+{
+    memset( out, _format == AudioEngine::kU8 ? 0x80 : 0, bytes );
+}
+
+void AudioMixer::scale( char* out, const size_t bytes, const float g ) const
+{
+    switch( _format )
+    {
+    case AudioEngine::kU8:
+    {
+        uint8_t* d = (uint8_t*) out;
+        for ( size_t i = 0; i < bytes; ++i )
+            d[i] = clamp_sample<uint8_t>( ( d[i] - 128.0 ) * g + 128.0,
+                                          0.0, 255.0 );
+        break;
+    }
+    case AudioEngine::kS16LSB:
+    {
+        int16_t* d = (int16_t*) out;
+        const size_t n = bytes / sizeof(int16_t);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] = clamp_sample<int16_t>( d[i] * g, INT16_MIN, INT16_MAX );
+        break;
+    }
+    case AudioEngine::kS32LSB:
+    {
+        int32_t* d = (int32_t*) out;
+        const size_t n = bytes / sizeof(int32_t);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] = clamp_sample<int32_t>( double(d[i]) * g,
+                                          INT32_MIN, INT32_MAX );
+        break;
+    }
+    case AudioEngine::kFloatLSB:
+    {
+        float* d = (float*) out;
+        const size_t n = bytes / sizeof(float);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] *= g;
+        break;
+    }
+    case AudioEngine::kDoubleLSB:
+    {
+        double* d = (double*) out;
+        const size_t n = bytes / sizeof(double);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] *= g;
+        break;
+    }
+    default:
+        // Big endian and 24-bit layouts are passed through untouched.
+        break;
+    }
+}
+
+void AudioMixer::accumulate( char* out, const char* in, const size_t bytes,
+                             const float g ) const
+{
+    switch( _format )
+    {
+    case AudioEngine::kU8:
+    {
+        uint8_t* d = (uint8_t*) out;
+        const uint8_t* s = (const uint8_t*) in;
+        for ( size_t i = 0; i < bytes; ++i )
+            d[i] = clamp_sample<uint8_t>( d[i] + ( s[i] - 128.0 ) * g,
+                                          0.0, 255.0 );
+        break;
+    }
+    case AudioEngine::kS16LSB:
+    {
+        int16_t* d = (int16_t*) out;
+        const int16_t* s = (const int16_t*) in;
+        const size_t n = bytes / sizeof(int16_t);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] = clamp_sample<int16_t>( d[i] + s[i] * g,
+                                          INT16_MIN, INT16_MAX );
+        break;
+    }
+    case AudioEngine::kS32LSB:
+    {
+        int32_t* d = (int32_t*) out;
+        const int32_t* s = (const int32_t*) in;
+        const size_t n = bytes / sizeof(int32_t);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] = clamp_sample<int32_t>( double(d[i]) + double(s[i]) * g,
+                                          INT32_MIN, INT32_MAX );
+        break;
+    }
+    case AudioEngine::kFloatLSB:
+    {
+        float* d = (float*) out;
+        const float* s = (const float*) in;
+        const size_t n = bytes / sizeof(float);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] += s[i] * g;
+        break;
+    }
+    case AudioEngine::kDoubleLSB:
+    {
+        double* d = (double*) out;
+        const double* s = (const double*) in;
+        const size_t n = bytes / sizeof(double);
+        for ( size_t i = 0; i < n; ++i )
+            d[i] += s[i] * g;
+        break;
+    }
+    default:
+        // Cannot sum these layouts here; the first source wins.
+        break;
+    }
+}
+
+size_t AudioMixer::mix( char* out, const size_t bytes )
+{
+    silence( out, bytes );
+
+    // Whole frames, so a pass never splits a sample
+    size_t chunk = _scratch.size();
+    if ( _frame_size > 0 ) chunk -= chunk % _frame_size;
+
+    const float master = _volume;
+    size_t filled = 0;
+    bool first = true;
+
+    for ( int i = 0; i < kMaxSources; ++i )
+    {
+        Slot& s = _slots[i];
+        if ( !s.active ) continue;
+
+        s.busy = true;
+        if ( !s.active )
+        {
+            s.busy = false;
+            continue;
+        }
+
+        const float g = s.gain * master;
+        size_t got;
+        if ( first )
+        {
+            // The first source is read in place, which is all the work
+            // needed in the common single source case.
+            got = s.ring.read( out, bytes );
+            if ( g != 1.0f ) scale( out, got, g );
+            first = false;
+        }
+        else
+        {
+            got = 0;
+            while ( got < bytes )
+            {
+                size_t n = s.ring.read( &_scratch[0],
+                                        std::min( chunk, bytes - got ) );
+                accumulate( out + got, &_scratch[0], n, g );
+                got += n;
+                if ( n < chunk ) break;
+            }
+        }
+        s.busy = false;
+
+        filled = std::max( filled, got );
+    }
+
+    return filled;
+}
+
+} // namespace mrv
@@ -0,0 +1,127 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioMixer.h
+ * @author gga
+ * @date   Sun Oct 18 16:20:05 2026
+ *
+ * @brief  Mixes several PCM rings into a single device buffer.
+ *
+ */
+
+#ifndef mrvAudioMixer_h
+#define mrvAudioMixer_h
+
+#include <atomic>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvAudioRing.h"
+#include "core/mrvAudioEngine.h"
+
+namespace mrv {
+
+//
+// Fixed set of source slots, each one an AudioRing fed by its own
+// producer.  Adding and removing sources takes a mutex, but mix() only
+// looks at per-slot atomics so the device callback never blocks.
+// All sources share the mixer's sample format and channel count.
+//
+class AudioMixer
+{
+  public:
+    typedef boost::mutex Mutex;
+
+    enum { kMaxSources = 8 };
+
+    /// Size of the summing buffer until period() is called
+    enum { kDefaultPeriod = 16384 };
+
+  public:
+    AudioMixer();
+    ~AudioMixer();
+
+    /// Set the sample layout all sources are mixed in.  Only call it
+    /// while no source is active.
+    void format( const AudioEngine::AudioFormat f, const unsigned channels );
+
+    inline AudioEngine::AudioFormat format() const { return _format; }
+    inline unsigned frame_size() const { return _frame_size; }
+
+    /// Size the buffer mix() sums sources in for device periods of up
+    /// to bytes.  Call it when the device opens, before it starts
+    /// pulling, as mix() never allocates; longer periods are summed in
+    /// several passes.
+    void period( const size_t bytes );
+
+    /// Register a new source with a ring of at least bytes.  Returns its
+    /// id or -1 if all slots are taken.
+    int  add_source( const size_t bytes );
+
+    /// Unregister a source.  Waits for a running mix() to let go of it.
+    void remove_source( const int id );
+
+    /// Ring of a source, for its producer to write into.
+    AudioRing* source( const int id );
+
+    /// Per-source gain
+    void gain( const int id, const float g );
+
+    /// Master gain applied after summing
+    inline void volume( const float v ) { _volume = v; }
+    inline float volume() const { return _volume; }
+
+    /// Number of active sources
+    inline unsigned sources() const { return _active; }
+
+    /// Consumer side.  Fills out with bytes of mixed audio, padding with
+    /// silence.  Returns how many bytes came from the sources.
+    size_t mix( char* out, const size_t bytes );
+
+    /// Fill a buffer with silence for the current format.
+    void silence( char* out, const size_t bytes ) const;
+
+  protected:
+    void accumulate( char* out, const char* in, const size_t bytes,
+                     const float g ) const;
+    void scale( char* out, const size_t bytes, const float g ) const;
+
+    struct Slot
+    {
+        AudioRing           ring;
+        std::atomic<bool>   active;
+        std::atomic<bool>   busy;
+        std::atomic<float>  gain;
+
+        Slot() : active( false ), busy( false ), gain( 1.0f ) {}
+    };
+
+    Mutex                    _mutex;
+    Slot                     _slots[kMaxSources];
+    std::atomic<unsigned>    _active;
+    std::atomic<float>       _volume;
+    AudioEngine::AudioFormat _format;
+    unsigned                 _channels;
+    unsigned                 _frame_size;
+    std::vector< char >      _scratch;
+};
+
+} // namespace mrv
+
+#endif // mrvAudioMixer_h
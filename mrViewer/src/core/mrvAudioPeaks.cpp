@@ -0,0 +1,442 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioPeaks.cpp
+ * @author gga
+ * @date   Sun Oct 18 23:41:12 2026
+ *
+ * @brief  Precomputed peaks of audio streams, to draw their waveforms.
+ *
+ */
+
+#define __STDC_FORMAT_MACROS
+#define __STDC_LIMIT_MACROS
+#define __STDC_CONSTANT_MACROS
+#include <inttypes.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <limits>
+#include <algorithm>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libswresample/swresample.h>
+}
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/filesystem.hpp>
+
+#include "core/CMedia.h"
+#include "core/mrvHome.h"
+#include "core/mrvThread.h"
+#include "core/mrvBackgroundCache.h"
+#include "core/mrvAudioPeaks.h"
+#include "gui/mrvIO.h"
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const char* kModule = "peaks";
+
+// Pyramids kept in memory.  An hour at 48Khz is about 11Mb.
+const size_t kMaxMemoryPeaks = 32;
+
+// Files kept on disk before the oldest ones are removed.
+const size_t kMaxDiskPeaks = 1024;
+
+// Keys of streams kept for redraws, and how often their files are
+// checked again for changes, in seconds.
+const size_t kMaxKeys = 256;
+const std::time_t kKeyCheck = 2;
+
+const char* kMagic = "mrvpeaks 1";
+
+typedef boost::mutex Mutex;
+
+struct Key
+{
+    std::string path;
+    int         index;
+    std::string key;
+    std::time_t checked;
+
+    Key() : index( -1 ), checked( 0 ) {}
+};
+
+typedef std::map< std::pair< const mrv::CMedia*, int >, Key > Keys;
+
+Mutex  _keys_mutex;
+Keys   _keys;
+
+typedef mrv::BackgroundCache< mrv::AudioPeaks::Request,
+                              mrv::AudioPeaks::PyramidPtr > Cache;
+
+Cache _cache( &mrv::AudioPeaks::process, &mrv::AudioPeaks::trim_disk,
+              kMaxMemoryPeaks, Cache::kRememberFailures );
+
+std::string filename( const std::string& key )
+{
+    return mrv::CacheFile::name( mrv::AudioPeaks::directory(), key,
+                                 ".peaks" );
+}
+
+}
+
+namespace mrv {
+
+bool AudioPeaks::Pyramid::range( const double t0, const double t1,
+                                 float& lo, float& hi ) const
+{
+    if ( levels.empty() || rate == 0 || t1 <= t0 ) return false;
+
+    double s0 = t0 * rate;
+    double s1 = t1 * rate;
+    if ( s1 <= 0.0 ) return false;
+    if ( s0 < 0.0 ) s0 = 0.0;
+
+    // The coarsest level with bins no longer than the span
+    size_t l = 0;
+    while ( l + 1 < levels.size() &&
+            double( kBinSamples << ( l + 1 ) ) <= s1 - s0 )
+        ++l;
+
+    const Level& level = levels[l];
+    const double n = double( kBinSamples << l );
+    size_t b0 = size_t( s0 / n );
+    size_t b1 = size_t( std::ceil( s1 / n ) );
+    if ( b0 >= level.size() ) return false;
+    if ( b1 > level.size() ) b1 = level.size();
+    if ( b1 <= b0 ) b1 = b0 + 1;
+
+    lo = level[b0].lo;
+    hi = level[b0].hi;
+    for ( size_t b = b0 + 1; b < b1; ++b )
+    {
+        lo = std::min( lo, level[b].lo );
+        hi = std::max( hi, level[b].hi );
+    }
+    return true;
+}
+
+std::string AudioPeaks::directory()
+{
+    return mrv::prefspath() + "peaks/";
+}
+
+std::string AudioPeaks::key( const CMedia* img, const int stream )
+{
+    if ( !img || stream < 0 ||
+         stream >= (int) img->number_of_audio_streams() )
+        return "";
+
+    std::string path = img->audio_filename( stream );
+
+    std::time_t mtime;
+    try
+    {
+        if ( !fs::is_regular_file( path ) ) return "";
+        mtime = fs::last_write_time( path );
+    }
+    catch( const fs::filesystem_error& )
+    {
+        return "";
+    }
+
+    char buf[64];
+    sprintf( buf, "\n%" PRId64 "\n%d\n", int64_t(mtime),
+             img->audio_info( stream ).stream_index );
+    return path + buf;
+}
+
+AudioPeaks::PyramidPtr AudioPeaks::find( const CMedia* img, const int stream )
+{
+    if ( !img || stream < 0 ||
+         stream >= (int) img->number_of_audio_streams() )
+        return PyramidPtr();
+
+    // This is called on every redraw of the timeline, so the file is
+    // only looked at again every few seconds.
+    const std::string path = img->audio_filename( stream );
+    const int index = img->audio_info( stream ).stream_index;
+    const std::time_t now = time( NULL );
+
+    std::string k;
+    {
+        SCOPED_LOCK( _keys_mutex );
+        const Keys::key_type id( img, stream );
+        Keys::iterator i = _keys.find( id );
+        if ( i == _keys.end() )
+        {
+            if ( _keys.size() >= kMaxKeys ) _keys.clear();
+            i = _keys.insert( Keys::value_type( id, Key() ) ).first;
+        }
+
+        Key& e = i->second;
+        if ( e.path != path || e.index != index ||
+             now - e.checked >= kKeyCheck || now < e.checked )
+        {
+            e.path    = path;
+            e.index   = index;
+            e.key     = key( img, stream );
+            e.checked = now;
+        }
+        k = e.key;
+    }
+    if ( k.empty() ) return PyramidPtr();
+
+    PyramidPtr p;
+    if ( _cache.find( k, p ) ) return p;
+
+    Request r;
+    r.key   = k;
+    r.file  = path;
+    r.index = index;
+    _cache.request( k, r );
+    return PyramidPtr();
+}
+
+bool AudioPeaks::process( const Request& r, PyramidPtr& ptr )
+{
+    Pyramid* p = new Pyramid;
+    ptr.reset( p );
+    bool ok = load( r.key, *p );
+    if ( !ok && build( r.file, r.index, *p ) )
+    {
+        save( r.key, *p );
+        ok = true;
+    }
+
+    if ( ok ) build_levels( *p );
+    return ok;
+}
+
+bool AudioPeaks::build( const std::string& file, const int index,
+                        Pyramid& p )
+{
+    AVFormatContext* ctx = NULL;
+    if ( avformat_open_input( &ctx, file.c_str(), NULL, NULL ) < 0 )
+    {
+        LOG_ERROR( _("Could not open ") << file );
+        return false;
+    }
+
+    AVCodecContext* avctx = NULL;
+    SwrContext* swr = NULL;
+    AVFrame* frame = NULL;
+    bool ok = false;
+
+    p.levels.assign( 1, Level() );
+    Level& level = p.levels[0];
+    Peak peak = { std::numeric_limits<float>::max(),
+                  -std::numeric_limits<float>::max() };
+    unsigned count = 0;
+    std::vector< float > samples;
+
+    do
+    {
+        if ( avformat_find_stream_info( ctx, NULL ) < 0 ) break;
+        if ( index < 0 || unsigned(index) >= ctx->nb_streams ) break;
+
+        AVStream* st = ctx->streams[index];
+        if ( st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO ) break;
+
+        for ( unsigned i = 0; i < ctx->nb_streams; ++i )
+            if ( int(i) != index ) ctx->streams[i]->discard = AVDISCARD_ALL;
+
+        AVCodec* codec = avcodec_find_decoder( st->codecpar->codec_id );
+        if ( !codec ) break;
+
+        avctx = avcodec_alloc_context3( codec );
+        if ( !avctx ||
+             avcodec_parameters_to_context( avctx, st->codecpar ) < 0 ||
+             avcodec_open2( avctx, codec, NULL ) < 0 )
+            break;
+
+        p.rate = avctx->sample_rate;
+        frame = av_frame_alloc();
+
+        AVPacket pkt;
+        av_init_packet( &pkt );
+        pkt.data = NULL;
+        pkt.size = 0;
+
+        bool eof = false;
+        while ( !_cache.stopped() )
+        {
+            if ( !eof )
+            {
+                if ( av_read_frame( ctx, &pkt ) < 0 )
+                {
+                    eof = true;
+                    avcodec_send_packet( avctx, NULL );
+                }
+                else
+                {
+                    int ret = 0;
+                    if ( pkt.stream_index == index )
+                        ret = avcodec_send_packet( avctx, &pkt );
+                    av_packet_unref( &pkt );
+                    if ( ret < 0 && ret != AVERROR(EAGAIN) ) continue;
+                }
+            }
+
+            int ret;
+            while ( ( ret = avcodec_receive_frame( avctx, frame ) ) == 0 )
+            {
+                const int channels = frame->channels;
+                if ( channels <= 0 || frame->nb_samples <= 0 ) continue;
+
+                if ( !swr )
+                {
+                    int64_t layout = frame->channel_layout;
+                    if ( !layout )
+                        layout = av_get_default_channel_layout( channels );
+                    swr = swr_alloc_set_opts( NULL, layout,
+                                              AV_SAMPLE_FMT_FLT,
+                                              frame->sample_rate,
+                                              layout,
+                                              (AVSampleFormat)frame->format,
+                                              frame->sample_rate, 0, NULL );
+                    if ( !swr || swr_init( swr ) < 0 ) break;
+                }
+
+                samples.resize( size_t(frame->nb_samples) * channels );
+                uint8_t* out = (uint8_t*) &samples[0];
+                int n = swr_convert( swr, &out, frame->nb_samples,
+                                     (const uint8_t**) frame->extended_data,
+                                     frame->nb_samples );
+
+                // Channels are mixed into one waveform
+                const float* s = &samples[0];
+                for ( int i = 0; i < n; ++i )
+                {
+                    for ( int c = 0; c < channels; ++c, ++s )
+                    {
+                        peak.lo = std::min( peak.lo, *s );
+                        peak.hi = std::max( peak.hi, *s );
+                    }
+                    if ( ++count == kBinSamples )
+                    {
+                        level.push_back( peak );
+                        peak.lo = std::numeric_limits<float>::max();
+                        peak.hi = -std::numeric_limits<float>::max();
+                        count = 0;
+                    }
+                }
+            }
+
+            if ( eof && ret == AVERROR_EOF ) break;
+        }
+
+        if ( count > 0 ) level.push_back( peak );
+        ok = !_cache.stopped() && !level.empty();
+    }
+    while ( 0 );
+
+    av_frame_free( &frame );
+    swr_free( &swr );
+    avcodec_free_context( &avctx );
+    avformat_close_input( &ctx );
+    return ok;
+}
+
+void AudioPeaks::build_levels( Pyramid& p )
+{
+    p.levels.resize( 1 );
+    while ( p.levels.back().size() > 1 )
+    {
+        const Level& below = p.levels.back();
+        Level up( ( below.size() + 1 ) / 2 );
+        for ( size_t i = 0; i < up.size(); ++i )
+        {
+            up[i] = below[ 2*i ];
+            if ( 2*i + 1 < below.size() )
+            {
+                up[i].lo = std::min( up[i].lo, below[ 2*i + 1 ].lo );
+                up[i].hi = std::max( up[i].hi, below[ 2*i + 1 ].hi );
+            }
+        }
+        p.levels.push_back( up );
+    }
+}
+
+bool AudioPeaks::load( const std::string& key, Pyramid& p )
+{
+    FILE* f = CacheFile::open( filename( key ), kMagic, key );
+    if ( !f ) return false;
+
+    bool ok = false;
+    unsigned rate;
+    unsigned long bins;
+    if ( fscanf( f, "%u %lu", &rate, &bins ) == 2 &&
+         fgetc( f ) == '\n' && rate > 0 && bins > 0 &&
+         bins <= CacheFile::remaining( f ) / sizeof(Peak) )
+    {
+        Level level( bins );
+        if ( fread( &level[0], sizeof(Peak), bins, f ) == bins )
+        {
+            p.rate = rate;
+            p.levels.assign( 1, level );
+            ok = true;
+        }
+    }
+    fclose( f );
+    return ok;
+}
+
+bool AudioPeaks::write( FILE* f, const Pyramid& p )
+{
+    const Level& level = p.levels[0];
+    fprintf( f, "%u %lu\n", p.rate, (unsigned long) level.size() );
+    return ( fwrite( &level[0], sizeof(Peak), level.size(), f ) ==
+             level.size() );
+}
+
+void AudioPeaks::save( const std::string& key, const Pyramid& p )
+{
+    CacheFile::save( filename( key ), kMagic, key,
+                     boost::bind( &AudioPeaks::write, _1,
+                                  boost::cref( p ) ) );
+}
+
+void AudioPeaks::trim_disk()
+{
+    CacheFile::trim( directory(), ".peaks", kMaxDiskPeaks );
+}
+
+bool AudioPeaks::ready()
+{
+    return _cache.ready();
+}
+
+void AudioPeaks::shutdown()
+{
+    _cache.shutdown();
+
+    SCOPED_LOCK( _keys_mutex );
+    _keys.clear();
+}
+
+} // namespace mrv
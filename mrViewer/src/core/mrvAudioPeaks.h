@@ -0,0 +1,122 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioPeaks.h
+ * @author gga
+ * @date   Sun Oct 18 23:41:12 2026
+ *
+ * @brief  Precomputed peaks of audio streams, to draw their waveforms.
+ *
+ */
+
+#ifndef mrvAudioPeaks_h
+#define mrvAudioPeaks_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace mrv {
+
+class CMedia;
+
+//
+// Each audio stream is decoded once, by a background thread, into the
+// lowest and highest sample of every kBinSamples samples.  Coarser levels
+// merge two bins of the level below, until one bin is left, so a waveform
+// is drawn at any zoom by reading a few bins per pixel.  The finest level
+// is stored in ~/.filmaura/peaks, keyed by file, modification time and
+// stream, and the others are rebuilt when it is read back.
+//
+class AudioPeaks
+{
+  public:
+    /// Samples in a bin of the finest level
+    static const unsigned kBinSamples = 256;
+
+    struct Peak
+    {
+        float lo;
+        float hi;
+    };
+
+    typedef std::vector< Peak > Level;
+
+    struct Pyramid
+    {
+        unsigned             rate;    //!< samples per second
+        std::vector< Level > levels;  //!< bins of level i hold kBinSamples << i
+
+        Pyramid() : rate( 0 ) {}
+
+        /// Lowest and highest sample between seconds t0 and t1 of the
+        /// stream.  False if there are none.
+        bool range( const double t0, const double t1,
+                    float& lo, float& hi ) const;
+    };
+
+    typedef boost::shared_ptr< const Pyramid > PyramidPtr;
+
+    struct Request
+    {
+        std::string key;
+        std::string file;
+        int         index;   //!< of the stream in the file
+    };
+
+  public:
+    /// Build the key for an audio stream of img.  Empty for streams that
+    /// do not come from a file on disk.
+    static std::string key( const CMedia* img, const int stream );
+
+    /// Peaks of an audio stream of img.  If they are not in memory, they
+    /// are queued to be read or built in the background and NULL is
+    /// returned; ready() tells when to look again.  The key of each
+    /// stream is kept for a few seconds, so redraws do not stat files.
+    static PyramidPtr find( const CMedia* img, const int stream );
+
+    /// True once after one or more queued pyramids became available.
+    static bool ready();
+
+    /// Stop the background thread, dropping queued streams.
+    static void shutdown();
+
+    /// Directory where peaks are stored
+    static std::string directory();
+
+    /// Read or build the peaks of a stream.  Run by the background
+    /// thread.
+    static bool process( const Request& r, PyramidPtr& p );
+
+    /// Remove the oldest files when there are too many
+    static void trim_disk();
+
+  protected:
+    static bool build( const std::string& file, const int index,
+                       Pyramid& p );
+    static void build_levels( Pyramid& p );
+    static bool load( const std::string& key, Pyramid& p );
+    static bool write( FILE* f, const Pyramid& p );
+    static void save( const std::string& key, const Pyramid& p );
+};
+
+} // namespace mrv
+
+#endif // mrvAudioPeaks_h
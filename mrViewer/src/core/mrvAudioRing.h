@@ -0,0 +1,154 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvAudioRing.h
+ * @author gga
+ * @date   Sun Oct 18 16:02:31 2026
+ *
+ * @brief  Lock-free byte ring used to hand PCM from the decoder to the
+ *         audio device callback.
+ *
+ */
+
+#ifndef mrvAudioRing_h
+#define mrvAudioRing_h
+
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstddef>
+
+namespace mrv {
+
+//
+// Single-producer/single-consumer byte ring.  The audio thread writes
+// decoded PCM and the device (or sink) thread reads it, without either
+// side taking a lock.  The producer owns _tail and the consumer owns
+// _head, and both indices grow monotonically.
+//
+// clear() may be called from the producer side.  It only raises a flag;
+// the consumer discards everything up to the tail on its next read().
+//
+class AudioRing
+{
+  private:
+    AudioRing( const AudioRing& b );
+    AudioRing& operator=( const AudioRing& b );
+
+  public:
+    AudioRing() :
+    _head( 0 ),
+    _tail( 0 ),
+    _clear( false ),
+    _mask( 0 )
+    {
+    }
+
+    /// Capacity is rounded up to a power of two.  Not thread safe: only
+    /// call it while neither side is using the ring.
+    void resize( size_t bytes )
+    {
+        size_t n = 1024;
+        while ( n < bytes ) n <<= 1;
+        _data.resize( n );
+        _mask = n - 1;
+        _head = _tail = 0;
+        _clear = false;
+    }
+
+    inline size_t capacity() const { return _data.size(); }
+
+    /// Bytes ready to be read.  Safe from any thread.
+    inline size_t available() const
+    {
+        return _tail.load( std::memory_order_acquire ) -
+               _head.load( std::memory_order_acquire );
+    }
+
+    /// Bytes that can be written without overwriting unread data.
+    inline size_t space() const
+    {
+        return capacity() - available();
+    }
+
+    /// Producer only.  Returns the number of bytes actually written.
+    size_t write( const char* data, size_t size )
+    {
+        const size_t t = _tail.load( std::memory_order_relaxed );
+        const size_t h = _head.load( std::memory_order_acquire );
+        const size_t free = capacity() - ( t - h );
+        if ( size > free ) size = free;
+        if ( size == 0 ) return 0;
+
+        const size_t off = t & _mask;
+        const size_t first = std::min( size, capacity() - off );
+        memcpy( &_data[off], data, first );
+        if ( first < size )
+            memcpy( &_data[0], data + first, size - first );
+
+        _tail.store( t + size, std::memory_order_release );
+        return size;
+    }
+
+    /// Consumer only.  Returns the number of bytes actually read.
+    size_t read( char* data, size_t size )
+    {
+        size_t h = _head.load( std::memory_order_relaxed );
+        const size_t t = _tail.load( std::memory_order_acquire );
+        if ( _clear.exchange( false, std::memory_order_acq_rel ) )
+        {
+            h = t;
+            _head.store( h, std::memory_order_release );
+        }
+
+        const size_t avail = t - h;
+        if ( size > avail ) size = avail;
+        if ( size == 0 ) return 0;
+
+        const size_t off = h & _mask;
+        const size_t first = std::min( size, capacity() - off );
+        memcpy( data, &_data[off], first );
+        if ( first < size )
+            memcpy( data + first, &_data[0], size - first );
+
+        _head.store( h + size, std::memory_order_release );
+        return size;
+    }
+
+    /// Ask the consumer to drop all pending data.
+    inline void clear()
+    {
+        _clear.store( true, std::memory_order_release );
+    }
+
+  protected:
+    // Padding keeps the indices on separate cache lines.  alignas() is
+    // avoided since engines holding a ring are allocated with plain new.
+    std::atomic<size_t> _head;
+    char                _pad0[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> _tail;
+    char                _pad1[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<bool>   _clear;
+    size_t              _mask;
+    std::vector< char > _data;
+};
+
+} // namespace mrv
+
+#endif // mrvAudioRing_h
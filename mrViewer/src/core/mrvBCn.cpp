@@ -0,0 +1,266 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvBCn.cpp
+ * @author gga
+ * @date   Sun Oct 18 20:31:09 2026
+ *
+ * @brief  Decompression of BC1/BC2/BC3 (DXT1 to DXT5) texture blocks to
+ *         8-bit RGBA.
+ *
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include "core/mrvParallel.h"
+#include "core/mrvBCn.h"
+
+#if defined(MR_SSE) && ( defined(__SSE2__) || defined(_M_X64) || \
+                         ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+#  define MRV_BCN_SSE2
+#  include <emmintrin.h>
+#endif
+
+namespace {
+
+using namespace mrv::bcn;
+
+// Rows of blocks handed to a thread at a time
+const size_t kGrain = 8;
+
+inline unsigned read16( const uint8_t* p )
+{
+    return unsigned(p[0]) | ( unsigned(p[1]) << 8 );
+}
+
+inline uint32_t read32( const uint8_t* p )
+{
+    return uint32_t(p[0]) | ( uint32_t(p[1]) << 8 ) |
+           ( uint32_t(p[2]) << 16 ) | ( uint32_t(p[3]) << 24 );
+}
+
+// Palette entries are stored as bytes r, g, b, a in memory order
+inline void expand565( unsigned c, uint8_t* out )
+{
+    out[0] = uint8_t( ( ( c >> 11 ) & 0x1F ) << 3 );
+    out[1] = uint8_t( ( ( c >> 5 ) & 0x3F ) << 2 );
+    out[2] = uint8_t( ( c & 0x1F ) << 3 );
+    out[3] = 0xFF;
+}
+
+//
+// Four colors of a block.  Colors 2 and 3 are 2/3 and 1/3 of the way
+// between 0 and 1, or (in BC1 three-color mode) the midpoint and a
+// transparent one.
+//
+void palette( const uint8_t* block, const bool four, uint32_t* pal )
+{
+    uint8_t c[16];
+    expand565( read16( block ), c );
+    expand565( read16( block + 2 ), c + 4 );
+
+#ifdef MRV_BCN_SSE2
+    // Both interpolated colors at once, in 16-bit lanes:
+    //   lo = c0 c1, hi = c1 c0  ->  (2 lo + hi + 1) / 3 = c2 c3
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8( _mm_cvtsi32_si128( read32( c ) ), zero );
+    lo = _mm_unpacklo_epi64( lo, _mm_unpacklo_epi8(
+                                 _mm_cvtsi32_si128( read32( c + 4 ) ), zero ) );
+    __m128i hi = _mm_shuffle_epi32( lo, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+    __m128i r;
+    if ( four )
+    {
+        r = _mm_add_epi16( _mm_add_epi16( lo, lo ), hi );
+        r = _mm_add_epi16( r, _mm_set1_epi16( 1 ) );
+        // x / 3 == ( x * 21846 ) >> 16 for every sum that can happen here
+        r = _mm_mulhi_epu16( r, _mm_set1_epi16( 21846 ) );
+    }
+    else
+    {
+        __m128i mid = _mm_srli_epi16( _mm_add_epi16( lo, hi ), 1 );
+        __m128i third = _mm_add_epi16( _mm_add_epi16( hi, hi ), lo );
+        third = _mm_add_epi16( third, _mm_set1_epi16( 1 ) );
+        third = _mm_mulhi_epu16( third, _mm_set1_epi16( 21846 ) );
+        // c2 = midpoint, c3 = 1/3 of the way (made transparent below)
+        r = _mm_unpacklo_epi64( mid, _mm_unpacklo_epi64( third, third ) );
+    }
+    _mm_storel_epi64( (__m128i*) ( c + 8 ), _mm_packus_epi16( r, zero ) );
+#else
+    for ( int i = 0; i < 3; ++i )
+    {
+        unsigned a = c[i], b = c[4+i];
+        if ( four )
+        {
+            c[8+i]  = uint8_t( ( 2 * a + b + 1 ) / 3 );
+            c[12+i] = uint8_t( ( a + 2 * b + 1 ) / 3 );
+        }
+        else
+        {
+            c[8+i]  = uint8_t( ( a + b ) / 2 );
+            c[12+i] = uint8_t( ( a + 2 * b + 1 ) / 3 );
+        }
+    }
+#endif
+    c[11] = 0xFF;
+    c[15] = four ? 0xFF : 0x00;
+
+    memcpy( pal, c, sizeof(c) );
+}
+
+// Alphas of a BC3 block
+void alpha_palette( const uint8_t* block, uint8_t* alphas )
+{
+    unsigned a0 = alphas[0] = block[0];
+    unsigned a1 = alphas[1] = block[1];
+    if ( a0 > a1 )
+    {
+        for ( unsigned i = 1; i < 7; ++i )
+            alphas[i+1] = uint8_t( ( ( 7 - i ) * a0 + i * a1 + 3 ) / 7 );
+    }
+    else
+    {
+        for ( unsigned i = 1; i < 5; ++i )
+            alphas[i+1] = uint8_t( ( ( 5 - i ) * a0 + i * a1 + 2 ) / 5 );
+        alphas[6] = 0x00;
+        alphas[7] = 0xFF;
+    }
+}
+
+struct Job
+{
+    Format         format;
+    const uint8_t* src;
+    uint8_t*       dst;
+    unsigned       width;
+    unsigned       height;
+};
+
+void decode_rows( const Job* job, const size_t first, const size_t last )
+{
+    const unsigned w = job->width;
+    const unsigned h = job->height;
+    const unsigned bw = ( w + 3 ) / 4;
+    const unsigned bsize = block_size( job->format );
+
+    uint32_t texels[16];
+    uint32_t pal[4];
+    uint8_t  alphas[8];
+
+    for ( size_t by = first; by < last; ++by )
+    {
+        const uint8_t* block = job->src + by * bw * bsize;
+        for ( unsigned bx = 0; bx < bw; ++bx, block += bsize )
+        {
+            const uint8_t* color = block;
+            if ( job->format != kBC1 ) color += 8;
+
+            unsigned c0 = read16( color );
+            unsigned c1 = read16( color + 2 );
+            bool four = job->format != kBC1 || c0 > c1;
+            palette( color, four, pal );
+
+            uint32_t bits = read32( color + 4 );
+            for ( unsigned k = 0; k < 16; ++k, bits >>= 2 )
+                texels[k] = pal[ bits & 3 ];
+
+            uint8_t* t = (uint8_t*) texels;
+            if ( job->format == kBC2 )
+            {
+                for ( unsigned k = 0; k < 16; ++k )
+                {
+                    unsigned a = ( block[k / 2] >> ( 4 * ( k & 1 ) ) ) & 0x0F;
+                    t[4*k+3] = uint8_t( a | ( a << 4 ) );
+                }
+            }
+            else if ( job->format == kBC3 )
+            {
+                alpha_palette( block, alphas );
+                // Two groups of eight 3-bit indices in 24 bits each
+                for ( unsigned g = 0; g < 2; ++g )
+                {
+                    const uint8_t* m = block + 2 + 3 * g;
+                    uint32_t abits = m[0] | ( m[1] << 8 ) | ( m[2] << 16 );
+                    for ( unsigned k = 8 * g; k < 8 * g + 8; ++k, abits >>= 3 )
+                        t[4*k+3] = alphas[ abits & 7 ];
+                }
+            }
+
+            // Copy the rows of the block that fall inside the image
+            unsigned x = bx * 4;
+            unsigned cols = std::min( 4U, w - x );
+            for ( unsigned j = 0; j < 4; ++j )
+            {
+                unsigned y = unsigned(by) * 4 + j;
+                if ( y >= h ) break;
+                memcpy( job->dst + ( size_t(y) * w + x ) * 4,
+                        texels + j * 4, cols * 4 );
+            }
+        }
+    }
+}
+
+void unpremultiply_range( uint8_t* rgba, const size_t first,
+                          const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        uint8_t* p = rgba + i * 4;
+        unsigned a = p[3];
+        if ( a == 0 || a == 255 ) continue;
+        for ( int c = 0; c < 3; ++c )
+            p[c] = uint8_t( std::min( 255U, ( p[c] * 255U + a / 2 ) / a ) );
+    }
+}
+
+}
+
+namespace mrv {
+
+namespace bcn {
+
+unsigned block_size( const Format f )
+{
+    return f == kBC1 ? 8 : 16;
+}
+
+void decode( const Format f, const uint8_t* src, uint8_t* dst,
+             const unsigned width, const unsigned height )
+{
+    Job job;
+    job.format = f;
+    job.src    = src;
+    job.dst    = dst;
+    job.width  = width;
+    job.height = height;
+
+    parallel_for( 0, ( height + 3 ) / 4, kGrain,
+                  boost::bind( decode_rows, &job, _1, _2 ) );
+}
+
+void unpremultiply( uint8_t* rgba, const size_t pixels )
+{
+    parallel_for( 0, pixels, 65536,
+                  boost::bind( unpremultiply_range, rgba, _1, _2 ) );
+}
+
+} // namespace bcn
+
+} // namespace mrv
@@ -0,0 +1,60 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvBCn.h
+ * @author gga
+ * @date   Sun Oct 18 20:31:09 2026
+ *
+ * @brief  Decompression of BC1/BC2/BC3 (DXT1 to DXT5) texture blocks to
+ *         8-bit RGBA.
+ *
+ */
+
+#ifndef mrvBCn_h
+#define mrvBCn_h
+
+#include <cstddef>
+#include <inttypes.h>
+
+namespace mrv {
+
+namespace bcn {
+
+enum Format
+{
+    kBC1,   //!< DXT1: 4x4 colors in 8 bytes, optional 1-bit alpha
+    kBC2,   //!< DXT2/DXT3: explicit 4-bit alpha plus BC1 colors
+    kBC3,   //!< DXT4/DXT5: interpolated alpha plus BC1 colors
+};
+
+/// Bytes in a 4x4 block of format
+unsigned block_size( const Format f );
+
+/// Decode a width x height image of blocks from src to 8-bit RGBA in
+/// dst.  Rows of blocks are split across threads.
+void decode( const Format f, const uint8_t* src, uint8_t* dst,
+             const unsigned width, const unsigned height );
+
+/// Undo premultiplied alpha (DXT2 and DXT4) of 8-bit RGBA pixels
+void unpremultiply( uint8_t* rgba, const size_t pixels );
+
+} // namespace bcn
+
+} // namespace mrv
+
+#endif // mrvBCn_h
@@ -0,0 +1,228 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvBackgroundCache.cpp
+ * @author gga
+ * @date   Sun Oct 18 14:10:12 2026
+ *
+ * @brief  Worker threads, memory LRU and files shared by the caches
+ *         filled in the background (thumbnails, peaks, keyframes...).
+ *
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <boost/filesystem.hpp>
+
+#include <FL/fl_utf8.h>
+
+#include "core/mrvI8N.h"
+#include "core/mrvBackgroundCache.h"
+#include "gui/mrvIO.h"
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const char* kModule = "cache";
+}
+
+namespace mrv {
+
+// Collisions are caught by the key stored in the file.
+boost::uint64_t CacheFile::hash( const std::string& key )
+{
+    boost::uint64_t h = 14695981039346656037ULL;
+    for ( size_t i = 0; i < key.size(); ++i )
+    {
+        h ^= (unsigned char) key[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::string CacheFile::name( const std::string& dir, const std::string& key,
+                             const char* ext )
+{
+    char buf[32];
+    sprintf( buf, "%016" PRIx64, hash( key ) );
+    return dir + buf + ext;
+}
+
+FILE* CacheFile::open( const std::string& file, const char* magic,
+                       const std::string& key )
+{
+    FILE* f = fl_fopen( file.c_str(), "rb" );
+    if ( !f ) return NULL;
+
+    // Whitespace is never skipped after a number, as the body that
+    // follows may start with a byte that looks like it.
+    char stored_magic[32];
+    unsigned long len;
+    if ( fscanf( f, "%31[^\n]", stored_magic ) == 1 && fgetc( f ) == '\n' &&
+         strcmp( stored_magic, magic ) == 0 &&
+         fscanf( f, "%lu", &len ) == 1 && fgetc( f ) == '\n' &&
+         len == key.size() )
+    {
+        std::string stored( len, ' ' );
+        if ( fread( &stored[0], 1, len, f ) == len && stored == key &&
+             fgetc( f ) == '\n' )
+            return f;
+    }
+
+    fclose( f );
+    return NULL;
+}
+
+namespace {
+
+bool write_with_header( FILE* f, const char* magic, const std::string& key,
+                        const CacheFile::Writer& body )
+{
+    fprintf( f, "%s\n%lu\n", magic, (unsigned long) key.size() );
+    fwrite( key.c_str(), 1, key.size(), f );
+    fputc( '\n', f );
+    return body( f );
+}
+
+}
+
+bool CacheFile::save( const std::string& file, const char* magic,
+                      const std::string& key, const Writer& body )
+{
+    return write( file, boost::bind( write_with_header, _1, magic,
+                                     boost::cref( key ),
+                                     boost::cref( body ) ) );
+}
+
+bool CacheFile::write( const std::string& file, const Writer& body )
+{
+    try
+    {
+        fs::create_directories( fs::path( file ).parent_path() );
+    }
+    catch( const fs::filesystem_error& e )
+    {
+        LOG_ERROR( e.what() );
+        return false;
+    }
+
+    // Each thread of each process writes its own temporary file
+    std::ostringstream tmp;
+    tmp << file << '.' << getpid() << '.' << boost::this_thread::get_id()
+        << ".tmp";
+    std::string tmpfile = tmp.str();
+
+    FILE* f = fl_fopen( tmpfile.c_str(), "wb" );
+    if ( !f ) return false;
+
+    bool ok = body( f );
+    ok &= ( fclose( f ) == 0 );
+
+    try
+    {
+        if ( ok )
+            fs::rename( tmpfile, file );
+        else
+            fs::remove( tmpfile );
+    }
+    catch( const fs::filesystem_error& e )
+    {
+        LOG_ERROR( e.what() );
+        ok = false;
+    }
+    return ok;
+}
+
+unsigned long CacheFile::remaining( FILE* f )
+{
+    long pos = ftell( f );
+    if ( pos < 0 || fseek( f, 0, SEEK_END ) != 0 ) return 0;
+    long end = ftell( f );
+    if ( end < pos || fseek( f, pos, SEEK_SET ) != 0 ) return 0;
+    return (unsigned long)( end - pos );
+}
+
+void CacheFile::trim( const std::string& dir, const char* ext,
+                      const size_t max )
+{
+    typedef std::pair< std::time_t, fs::path > File;
+    std::vector< File > files;
+    try
+    {
+        if ( !fs::is_directory( dir ) ) return;
+
+        fs::directory_iterator e;
+        for ( fs::directory_iterator i( dir ); i != e; ++i )
+        {
+            if ( i->path().extension() != ext ) continue;
+            files.push_back( File( fs::last_write_time( i->path() ),
+                                   i->path() ) );
+        }
+
+        if ( files.size() <= max ) return;
+
+        std::sort( files.begin(), files.end() );
+        size_t n = files.size() - max;
+        for ( size_t i = 0; i < n; ++i )
+            fs::remove( files[i].second );
+    }
+    catch( const fs::filesystem_error& e )
+    {
+        LOG_ERROR( e.what() );
+    }
+}
+
+void lower_thread_priority()
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_LOWEST );
+#else
+    int policy;
+    sched_param p;
+    if ( pthread_getschedparam( pthread_self(), &policy, &p ) != 0 ) return;
+#  ifdef SCHED_IDLE
+    policy = SCHED_IDLE;
+    p.sched_priority = 0;
+#  else
+    p.sched_priority = sched_get_priority_min( policy );
+#  endif
+    if ( pthread_setschedparam( pthread_self(), policy, &p ) != 0 )
+        LOG_WARNING( _("Could not lower the priority of a thread") );
+#endif
+}
+
+} // namespace mrv
@@ -0,0 +1,361 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvBackgroundCache.h
+ * @author gga
+ * @date   Sun Oct 18 14:10:12 2026
+ *
+ * @brief  Worker threads, memory LRU and files shared by the caches
+ *         filled in the background (thumbnails, peaks, keyframes...).
+ *
+ */
+
+#ifndef mrvBackgroundCache_h
+#define mrvBackgroundCache_h
+
+#include <cstdio>
+#include <string>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "core/mrvThread.h"
+
+namespace mrv {
+
+//
+// Files kept across sessions by the caches.  Each is named by a hash of
+// its key and starts with a magic line, the length of the key and the
+// key itself, so a collision or a file of another version reads as a
+// miss.  Files are written to a temporary name and renamed, so readers
+// never see a partial one.
+//
+class CacheFile
+{
+  public:
+    /// Writes the body of a file.  False on error.
+    typedef boost::function< bool ( FILE* ) > Writer;
+
+  public:
+    /// 64-bit FNV-1a of a key
+    static boost::uint64_t hash( const std::string& key );
+
+    /// File for key in dir, with extension ext (".thumb", ".peaks"...)
+    static std::string name( const std::string& dir, const std::string& key,
+                             const char* ext );
+
+    /// Open file and check its magic line and key.  Returns it
+    /// positioned at the body, or NULL if it is missing or for
+    /// something else.
+    static FILE* open( const std::string& file, const char* magic,
+                       const std::string& key );
+
+    /// Write the magic line, the key and then the body.
+    static bool save( const std::string& file, const char* magic,
+                      const std::string& key, const Writer& body );
+
+    /// Write file with body alone, creating its directory.
+    static bool write( const std::string& file, const Writer& body );
+
+    /// Bytes left to read in f, so a count read from a truncated or
+    /// corrupt file is never trusted for an allocation.
+    static unsigned long remaining( FILE* f );
+
+    /// Remove the least recently written files with extension ext
+    /// from dir, until max are left.
+    static void trim( const std::string& dir, const char* ext,
+                      const size_t max );
+};
+
+/// Run the calling thread at the lowest priority
+void lower_thread_priority();
+
+//
+// Values built from requests by background threads and kept in a memory
+// LRU.  A key is queued once: pending() is true from request() until its
+// value is stored.  ready() is true once after one or more values were
+// built, so the interface knows when to look again.
+//
+template< class Request, class Value >
+class BackgroundCache
+{
+  public:
+    /// Builds the value of a request in a worker thread.  False if it
+    /// could not be built.
+    typedef boost::function< bool ( const Request&, Value& ) > Build;
+
+    /// Run once by the first worker thread, like trimming the files.
+    typedef boost::function< void () > Startup;
+
+    enum Flags
+    {
+        kNewestFirst      = 1,  //!< serve the latest request first
+        kRememberFailures = 2,  //!< do not queue again keys that failed
+        kLowPriority      = 4   //!< run the workers at the lowest priority
+    };
+
+  protected:
+    typedef boost::mutex Mutex;
+    typedef std::list< std::string > LRU;
+
+    struct Entry
+    {
+        Value value;
+        typename LRU::iterator lru;
+    };
+
+    typedef std::map< std::string, Entry > Memory;
+    typedef std::map< std::string, Request > Requests;
+
+  private:
+    BackgroundCache( const BackgroundCache& b );
+    BackgroundCache& operator=( const BackgroundCache& b );
+
+  public:
+    /// max_queue, if not 0, drops the oldest requests when more are
+    /// waiting.
+    BackgroundCache( const Build& build, const Startup& startup,
+                     const size_t max_memory, const unsigned flags = 0,
+                     const unsigned threads = 1,
+                     const size_t max_queue = 0 ) :
+    _build( build ),
+    _startup( startup ),
+    _max_memory( max_memory ),
+    _flags( flags ),
+    _threads( std::max( 1U, threads ) ),
+    _max_queue( max_queue ),
+    _stop( false ),
+    _ready( false ),
+    _started( false ),
+    _paused( false )
+    {
+    }
+
+    /// Value of key, if in memory.  Marks it as recently used.
+    bool find( const std::string& key, Value& v )
+    {
+        SCOPED_LOCK( _mutex );
+        typename Memory::iterator i = _memory.find( key );
+        if ( i == _memory.end() ) return false;
+        _lru.splice( _lru.begin(), _lru, i->second.lru );
+        v = i->second.value;
+        return true;
+    }
+
+    /// Add or replace the value of key in memory
+    void store( const std::string& key, const Value& v )
+    {
+        SCOPED_LOCK( _mutex );
+        typename Memory::iterator i = _memory.find( key );
+        if ( i != _memory.end() )
+        {
+            i->second.value = v;
+            _lru.splice( _lru.begin(), _lru, i->second.lru );
+            return;
+        }
+
+        _lru.push_front( key );
+        Entry& e = _memory[ key ];
+        e.value = v;
+        e.lru = _lru.begin();
+
+        while ( _memory.size() > _max_memory )
+        {
+            _memory.erase( _lru.back() );
+            _lru.pop_back();
+        }
+    }
+
+    /// Whether key is queued or being built
+    bool pending( const std::string& key )
+    {
+        SCOPED_LOCK( _mutex );
+        return _pending.find( key ) != _pending.end();
+    }
+
+    /// Queue r to build the value of key, unless it is pending or failed
+    /// before.  Starts the worker threads on first use.
+    void request( const std::string& key, const Request& r )
+    {
+        SCOPED_LOCK( _mutex );
+        if ( _stop || _failed.find( key ) != _failed.end() ) return;
+
+        if ( _pending.find( key ) != _pending.end() )
+        {
+            // Still waiting.  Serve it next.
+            if ( ( _flags & kNewestFirst ) &&
+                 _requests.find( key ) != _requests.end() )
+            {
+                std::deque< std::string >::iterator q =
+                    std::find( _queue.begin(), _queue.end(), key );
+                if ( q != _queue.end() && q + 1 != _queue.end() )
+                {
+                    _queue.erase( q );
+                    _queue.push_back( key );
+                }
+            }
+            return;
+        }
+
+        _pending.insert( key );
+        _requests[ key ] = r;
+        _queue.push_back( key );
+
+        while ( _max_queue > 0 && _queue.size() > _max_queue )
+        {
+            _requests.erase( _queue.front() );
+            _pending.erase( _queue.front() );
+            _queue.pop_front();
+        }
+
+        if ( _workers.empty() )
+        {
+            for ( unsigned i = 0; i < _threads; ++i )
+                _workers.push_back( new boost::thread(
+                    boost::bind( &BackgroundCache::worker, this ) ) );
+        }
+
+        _cond.notify_one();
+    }
+
+    /// Hold the worker threads, for example while playing
+    void pause( const bool p )
+    {
+        SCOPED_LOCK( _mutex );
+        _paused = p;
+        _cond.notify_all();
+    }
+
+    /// True once after one or more values were built
+    bool ready()
+    {
+        return _ready.exchange( false );
+    }
+
+    /// Set by shutdown().  Long builds check it to give up.
+    bool stopped() const
+    {
+        return _stop;
+    }
+
+    /// Stop the worker threads, dropping queued requests.
+    void shutdown()
+    {
+        std::vector< boost::thread* > workers;
+        {
+            SCOPED_LOCK( _mutex );
+            _stop = true;
+            _queue.clear();
+            _requests.clear();
+            _pending.clear();
+            _cond.notify_all();
+            workers.swap( _workers );
+        }
+
+        std::vector< boost::thread* >::iterator i = workers.begin();
+        std::vector< boost::thread* >::iterator e = workers.end();
+        for ( ; i != e; ++i )
+        {
+            (*i)->join();
+            delete *i;
+        }
+    }
+
+  protected:
+    void worker()
+    {
+        if ( _flags & kLowPriority ) lower_thread_priority();
+        if ( _startup && !_started.exchange( true ) ) _startup();
+
+        for (;;)
+        {
+            std::string key;
+            Request r;
+            {
+                SCOPED_LOCK( _mutex );
+                while ( ( _queue.empty() || _paused ) && !_stop )
+                    CONDITION_WAIT( _cond, _mutex );
+                if ( _stop ) return;
+
+                if ( _flags & kNewestFirst )
+                {
+                    key = _queue.back();
+                    _queue.pop_back();
+                }
+                else
+                {
+                    key = _queue.front();
+                    _queue.pop_front();
+                }
+
+                typename Requests::iterator i = _requests.find( key );
+                r = i->second;
+                _requests.erase( i );
+            }
+
+            Value v;
+            bool ok = _build( r, v );
+            if ( ok ) store( key, v );
+
+            {
+                SCOPED_LOCK( _mutex );
+                _pending.erase( key );
+                if ( !ok && !_stop && ( _flags & kRememberFailures ) )
+                    _failed.insert( key );
+            }
+            _ready = true;
+        }
+    }
+
+  protected:
+    Build                         _build;
+    Startup                       _startup;
+    const size_t                  _max_memory;
+    const unsigned                _flags;
+    const unsigned                _threads;
+    const size_t                  _max_queue;
+
+    Mutex                         _mutex;
+    boost::condition_variable     _cond;
+    std::deque< std::string >     _queue;     //!< keys, oldest first
+    Requests                      _requests;  //!< of the keys in _queue
+    std::set< std::string >       _pending;   //!< queued or being built
+    std::set< std::string >       _failed;
+    std::vector< boost::thread* > _workers;
+    std::atomic<bool>             _stop;
+    std::atomic<bool>             _ready;
+    std::atomic<bool>             _started;
+    bool                          _paused;
+    Memory                        _memory;
+    LRU                           _lru;       //!< of _memory, newest first
+};
+
+} // namespace mrv
+
+#endif // mrvBackgroundCache_h
@@ -37,12 +37,19 @@
 #include <boost/asio/read_until.hpp>
 #include <boost/asio/streambuf.hpp>
 #include <boost/asio/write.hpp>
+#ifndef __STDC_FORMAT_MACROS
+#  define __STDC_FORMAT_MACROS
+#endif
+#include <inttypes.h>  // for PRId64
+
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include "mrvServer.h"
 #include "mrvClient.h"
 #include "mrViewer.h"
 #include "gui/mrvIO.h"
+#include "gui/mrvPreferences.h"
 #include "mrvImageView.h"
 
 using boost::asio::deadline_timer;
@@ -118,7 +125,8 @@ client::client(boost::asio::io_service& io_service,
                ViewerUI* v) :
     Parser( boost::ref(io_service), boost::ref(v) ),
     stopped_(false),
-    io_service_( io_service )
+    io_service_( io_service ),
+    clock_timer_( io_service )
 {
    // The non_empty_output_queue_ deadline_timer is set to pos_infin
    // whenever the output queue is empty. This ensures that the output
@@ -153,12 +161,14 @@ void client::start(tcp::resolver::iterator endpoint_iter)
 // response to graceful termination or an unrecoverable error.
 void client::stop()
 {
+    if ( connected ) log_stats();
 
     connected = false;
     stopped_ = true;
 
     deadline_.cancel();
     non_empty_output_queue_.cancel();
+    clock_timer_.cancel();
     socket_.close();
 
     if ( ui && ui->uiView )
@@ -263,9 +273,44 @@ void client::handle_connect(const boost::system::error_code& ec,
 
       // Start the input actor.
       start_read();
+
+      // Start the clock actor.
+      clock.reset();
+      start_clock_ping();
    }
 }
 
+// The clock actor pings the server to estimate the offset between our
+// clock and the server's, which is the clock used for synchronized
+// playback.  It pings quickly until the filter is full and then every
+// few seconds to follow any drift between the machines' clocks.
+void client::start_clock_ping()
+{
+    if (stopped_)
+        return;
+
+    char buf[64];
+    sprintf( buf, N_("ClockPing %" PRId64), ClockSync::now() );
+    deliver( buf );
+
+    if ( clock.samples() < ClockSync::kMaxSamples )
+        clock_timer_.expires_from_now(boost::posix_time::milliseconds(250));
+    else
+        clock_timer_.expires_from_now(boost::posix_time::seconds(5));
+
+    clock_timer_.async_wait( boost::bind( &client::handle_clock_ping,
+                                          shared_from_this(),
+                                          boost::asio::placeholders::error ) );
+}
+
+void client::handle_clock_ping( const boost::system::error_code& ec )
+{
+    if ( stopped_ || ec )
+        return;
+
+    start_clock_ping();
+}
+
 
 
 void client::deliver( const std::string& msg )
@@ -273,9 +318,9 @@ void client::deliver( const std::string& msg )
 
     SCOPED_LOCK( mtx );
 
-   output_queue_.push_back(msg + "\n");
+   deadline_timer::time_type t = enqueue( msg );
 
-   non_empty_output_queue_.expires_from_now(boost::posix_time::seconds(0));
+   non_empty_output_queue_.expires_at( t );
 }
 
 void client::start_read()
@@ -325,6 +370,20 @@ void client::handle_read(const boost::system::error_code& ec)
                 {
                     LOG_INFO( _("Not OK") );
                 }
+                else if ( msg.compare( 0, 9, N_("ClockPong") ) == 0 )
+                {
+                    int64_t t3 = ClockSync::now();
+                    std::istringstream ps( msg.substr( 9 ) );
+                    int64_t t0, t1, t2;
+                    if ( ps >> t0 >> t1 >> t2 )
+                    {
+                        clock.add_sample( t0, t1, t2, t3 );
+                        if ( Preferences::debug )
+                            LOG_CONN( _("Clock offset ") << clock.offset()
+                                      << _(" latency ") << clock.latency()
+                                      << N_(" us") );
+                    }
+                }
                 else if ( parse( msg ) )
                 {
                 }
@@ -376,6 +435,14 @@ void client::await_output()
                        shared_from_this() ) );
 
    }
+   else if ( throttled() )
+   {
+      // Wait for the coalescing time slice to end.
+      non_empty_output_queue_.expires_at( next_slice_ );
+      non_empty_output_queue_.async_wait(
+          boost::bind( &mrv::client::await_output,
+                       shared_from_this() ) );
+   }
    else
    {
       start_write();
@@ -386,10 +453,15 @@ void client::start_write()
 {
     SCOPED_LOCK( mtx );
 
-    // Start an asynchronous operation to send a message.
+    if ( !build_packet() )
+    {
+        await_output();
+        return;
+    }
+
+    // Start an asynchronous operation to send all queued messages.
     boost::asio::async_write(socket_,
-                             boost::asio::buffer(output_queue_.front(),
-                                                 output_queue_.front().size()),
+                             boost::asio::buffer(packet_, packet_.size()),
                              boost::bind(&client::handle_write,
                                          shared_from_this(),
                                          boost::asio::placeholders::error));
@@ -404,9 +476,10 @@ void client::handle_write(const boost::system::error_code& ec)
 
    if (!ec)
    {
-       assert0( !output_queue_.empty() );
-
-       output_queue_.pop_front();
+       {
+           SCOPED_LOCK( mtx );
+           packet_.clear();
+       }
 
        await_output();
    }
@@ -67,12 +67,16 @@ class client : public Parser,
 
     void check_deadline();
 
+    void start_clock_ping();
+    void handle_clock_ping( const boost::system::error_code& ec );
+
     static void create( ViewerUI* main );
     static void remove( ViewerUI* main );
 
   private:
     bool stopped_;
     boost::asio::io_service& io_service_;
+    deadline_timer clock_timer_;
 };
 
 typedef boost::shared_ptr< client > client_ptr;
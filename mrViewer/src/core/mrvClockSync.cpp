@@ -0,0 +1,141 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvClockSync.cpp
+ * @author gga
+ * @date   Sun Oct 18 10:12:31 2026
+ *
+ * @brief  NTP-style clock offset/latency estimation between sync peers
+ *
+ */
+
+#include <cmath>
+#include <chrono>
+#include <limits>
+
+#include "core/mrvClockSync.h"
+
+namespace {
+
+// Maximum speed change used to correct drift (10%)
+const double kMaxNudge = 0.1;
+
+// Seconds over which a drift is corrected by nudging the play rate
+const double kCorrectionTime = 1.0;
+
+}
+
+namespace mrv {
+
+ClockSync::ClockSync() :
+_offset( 0 ),
+_delay( 0 )
+{
+}
+
+ClockSync::~ClockSync()
+{
+}
+
+int64_t ClockSync::now()
+{
+    using namespace std::chrono;
+    return duration_cast< microseconds >( system_clock::now().
+                                          time_since_epoch() ).count();
+}
+
+void ClockSync::add_sample( const int64_t t0, const int64_t t1,
+                            const int64_t t2, const int64_t t3 )
+{
+    Sample s;
+    s.offset = ( ( t1 - t0 ) + ( t2 - t3 ) ) / 2;
+    s.delay  = ( t3 - t0 ) - ( t2 - t1 );
+    if ( s.delay < 0 ) s.delay = 0;
+
+    SCOPED_LOCK( _mutex );
+    _samples.push_back( s );
+    if ( _samples.size() > kMaxSamples ) _samples.pop_front();
+    filter();
+}
+
+void ClockSync::filter()
+{
+    int64_t best = std::numeric_limits<int64_t>::max();
+    std::deque<Sample>::const_iterator i = _samples.begin();
+    std::deque<Sample>::const_iterator e = _samples.end();
+    for ( ; i != e; ++i )
+    {
+        if ( i->delay < best )
+        {
+            best = i->delay;
+            _offset = i->offset;
+            _delay  = i->delay;
+        }
+    }
+}
+
+void ClockSync::reset()
+{
+    SCOPED_LOCK( _mutex );
+    _samples.clear();
+    _offset = _delay = 0;
+}
+
+bool ClockSync::valid() const
+{
+    SCOPED_LOCK( _mutex );
+    return !_samples.empty();
+}
+
+size_t ClockSync::samples() const
+{
+    SCOPED_LOCK( _mutex );
+    return _samples.size();
+}
+
+int64_t ClockSync::offset() const
+{
+    SCOPED_LOCK( _mutex );
+    return _offset;
+}
+
+int64_t ClockSync::latency() const
+{
+    SCOPED_LOCK( _mutex );
+    return _delay / 2;
+}
+
+
+double PlaybackAnchor::expected_frame( const int64_t t ) const
+{
+    return double(frame) + double( t - start ) * fps / 1000000.0;
+}
+
+double PlaybackAnchor::corrected_fps( const double drift ) const
+{
+    if ( std::abs( drift ) < 0.5 ) return fps;
+
+    // Remove the drift over kCorrectionTime seconds, without changing
+    // speed more than kMaxNudge.
+    double nudge = -drift / ( fps * kCorrectionTime );
+    if ( nudge > kMaxNudge ) nudge = kMaxNudge;
+    else if ( nudge < -kMaxNudge ) nudge = -kMaxNudge;
+    return fps * ( 1.0 + nudge );
+}
+
+} // namespace mrv
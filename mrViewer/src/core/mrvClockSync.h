@@ -0,0 +1,139 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvClockSync.h
+ * @author gga
+ * @date   Sun Oct 18 10:12:31 2026
+ *
+ * @brief  NTP-style clock offset/latency estimation between sync peers
+ *         and drift correction for synchronized playback.
+ *
+ */
+
+#ifndef mrvClockSync_h
+#define mrvClockSync_h
+
+#include <deque>
+#include <inttypes.h>
+
+#include <boost/thread/recursive_mutex.hpp>
+
+#include "mrvThread.h"
+
+namespace mrv {
+
+//
+// Estimates the offset between the local wall clock and the clock of the
+// sync server.  The client sends "ClockPing t0", the server answers with
+// "ClockPong t0 t1 t2" (t1 = receive time, t2 = send time) and the client
+// records t3 when the pong arrives.  As in NTP, the sample with the
+// smallest round trip of the last kMaxSamples is the one trusted.
+//
+// All times are in microseconds.  "Session time" is the server's clock.
+//
+class ClockSync
+{
+  public:
+    typedef boost::recursive_mutex Mutex;
+
+    static const unsigned kMaxSamples = 8;
+
+  public:
+    ClockSync();
+    ~ClockSync();
+
+    /// Wall clock of this machine in microseconds since the epoch
+    static int64_t now();
+
+    /// Add a ping/pong round trip sample
+    void add_sample( const int64_t t0, const int64_t t1,
+                     const int64_t t2, const int64_t t3 );
+
+    /// Forget all samples (on reconnect)
+    void reset();
+
+    /// Whether at least one sample has been received
+    bool valid() const;
+
+    /// Number of samples in filter
+    size_t samples() const;
+
+    /// Server clock minus local clock
+    int64_t offset() const;
+
+    /// Estimated one-way latency to server
+    int64_t latency() const;
+
+    /// Convert a local time to session (server) time
+    inline int64_t to_session( const int64_t local ) const {
+        return local + offset();
+    }
+
+    /// Convert a session (server) time to local time
+    inline int64_t to_local( const int64_t session ) const {
+        return session - offset();
+    }
+
+    /// Current session time
+    inline int64_t session_now() const {
+        return to_session( now() );
+    }
+
+  protected:
+    struct Sample
+    {
+        int64_t offset;
+        int64_t delay;
+    };
+
+    void filter();
+
+  protected:
+    mutable Mutex       _mutex;
+    std::deque<Sample>  _samples;
+    int64_t             _offset;
+    int64_t             _delay;
+};
+
+
+//
+// Anchor of a synchronized playback: at session time 'start' all stations
+// show frame 'frame' and from there advance at 'fps'.  Used to compute the
+// frame each station should be displaying and how much to nudge its
+// playback rate to get back in step.
+//
+struct PlaybackAnchor
+{
+    PlaybackAnchor() : start(0), frame(0), fps(24.0), active(false) {}
+
+    /// Frame (fractional) that should be shown at session time t
+    double expected_frame( const int64_t t ) const;
+
+    /// Play rate to use to correct a drift (in frames, positive means
+    /// ahead).  Returns fps unchanged if within half a frame.
+    double corrected_fps( const double drift ) const;
+
+    int64_t start;    //!< session time in microseconds
+    int64_t frame;    //!< frame shown at start
+    double  fps;      //!< nominal play rate
+    bool    active;   //!< whether an anchor is in effect
+};
+
+} // namespace mrv
+
+#endif // mrvClockSync_h
@@ -17,6 +17,10 @@
 */
 
 #include <math.h>
+#include <map>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
 
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OCIO_NAMESPACE;
@@ -102,11 +106,56 @@ AVPixelFormat ffmpeg_pixel_format( const mrv::image_type::Format& f,
     }
 }
 
-void bake_ocio( const mrv::image_type_ptr& pic, const CMedia* img )
+typedef std::map< std::string, OCIO::ConstProcessorRcPtr > ProcessorCache;
+static ProcessorCache   _processors;
+static boost::mutex     _processors_mutex;
+
+// Key a display processor by everything that changes its result.
+static std::string processor_key( OCIO::ConstConfigRcPtr config,
+                                  const std::string& ics )
+{
+    std::string key = config->getCacheID();
+    key += '|';
+    key += ics;
+    key += '|';
+    key += mrv::Preferences::OCIO_Display;
+    key += '|';
+    key += mrv::Preferences::OCIO_View;
+    return key;
+}
+
+static OCIO::ConstProcessorRcPtr cached_processor( const std::string& key )
+{
+    boost::mutex::scoped_lock lk( _processors_mutex );
+    ProcessorCache::const_iterator i = _processors.find( key );
+    if ( i == _processors.end() ) return OCIO::ConstProcessorRcPtr();
+    return i->second;
+}
+
+static void apply_processor( const mrv::image_type_ptr& pic,
+                             const OCIO::ConstProcessorRcPtr& processor )
+{
+    float* p = (float*)pic->data().get();
+    ptrdiff_t chanstride = pic->pixel_size();
+    ptrdiff_t xstride = pic->pixel_size() * pic->channels();
+    ptrdiff_t ystride = xstride * pic->width();
+    OCIO::PackedImageDesc baker(p, pic->width(), pic->height(),
+                                pic->channels(), chanstride, xstride,
+                                ystride );
+#ifdef OCIO_v2_1
+    OCIO::ConstCPUProcessorRcPtr cpu = processor->getDefaultCPUProcessor();
+    cpu->apply( baker );
+#else
+    processor->apply( baker );
+#endif
+}
+
+bool prepare_ocio( const std::string& input_color_space )
 {
     setlocale(LC_NUMERIC, "C" );
     std::locale::global( std::locale("C") );
 
+    bool ok = false;
     try
     {
         const std::string& display = mrv::Preferences::OCIO_Display;
@@ -114,9 +163,7 @@ void bake_ocio( const mrv::image_type_ptr& pic, const CMedia* img )
 
         OCIO::ConstConfigRcPtr config = mrv::Preferences::OCIOConfig();
 
-        OCIO::DisplayTransformRcPtr transform = OCIO::DisplayTransform::Create();
-
-        std::string ics = img->ocio_input_color_space();
+        std::string ics = input_color_space;
         if ( ics.empty() )
         {
             OCIO::ConstColorSpaceRcPtr defaultcs = config->getColorSpace(OCIO::ROLE_SCENE_LINEAR);
@@ -125,25 +172,27 @@ void bake_ocio( const mrv::image_type_ptr& pic, const CMedia* img )
             ics = defaultcs->getName();
         }
 
-        transform->setInputColorSpaceName( ics.c_str() );
-        transform->setDisplay( display.c_str() );
-        transform->setView( view.c_str() );
-
-        OCIO::ConstProcessorRcPtr processor = config->getProcessor( transform );
-
-        float* p = (float*)pic->data().get();
-        ptrdiff_t chanstride = pic->pixel_size();
-        ptrdiff_t xstride = pic->pixel_size() * pic->channels();
-        ptrdiff_t ystride = xstride * pic->width();
-        OCIO::PackedImageDesc baker(p, pic->width(), pic->height(),
-                                    pic->channels(), chanstride, xstride,
-                                    ystride );
-#ifdef OCIO_v2_1
-        OCIO::ConstCPUProcessorRcPtr cpu = processor->getDefaultCPUProcessor();
-        cpu->apply( baker );
-#else
-        processor->apply( baker );
-#endif
+        // Keyed by the name as given, so empty maps to the default role.
+        std::string key = processor_key( config, input_color_space );
+        if ( cached_processor( key ) )
+        {
+            ok = true;
+        }
+        else
+        {
+            OCIO::DisplayTransformRcPtr transform =
+                OCIO::DisplayTransform::Create();
+            transform->setInputColorSpaceName( ics.c_str() );
+            transform->setDisplay( display.c_str() );
+            transform->setView( view.c_str() );
+
+            OCIO::ConstProcessorRcPtr processor =
+                config->getProcessor( transform );
+
+            boost::mutex::scoped_lock lk( _processors_mutex );
+            _processors[ key ] = processor;
+            ok = true;
+        }
     }
     catch( OCIO::Exception& e )
     {
@@ -156,6 +205,37 @@ void bake_ocio( const mrv::image_type_ptr& pic, const CMedia* img )
 
     std::locale::global( std::locale(N_("")) );
     setlocale(LC_NUMERIC, N_("") );
+    return ok;
+}
+
+bool apply_ocio( const mrv::image_type_ptr& pic, const std::string& ics )
+{
+    try
+    {
+        OCIO::ConstConfigRcPtr config = mrv::Preferences::OCIOConfig();
+        OCIO::ConstProcessorRcPtr processor =
+            cached_processor( processor_key( config, ics ) );
+        if ( !processor ) return false;
+
+        apply_processor( pic, processor );
+        return true;
+    }
+    catch( OCIO::Exception& e )
+    {
+        LOG_ERROR( e.what() );
+    }
+    catch( std::exception& e )
+    {
+        LOG_ERROR( e.what() );
+    }
+    return false;
+}
+
+void bake_ocio( const mrv::image_type_ptr& pic, const CMedia* img )
+{
+    const std::string& ics = img->ocio_input_color_space();
+    if ( ! prepare_ocio( ics ) ) return;
+    apply_ocio( pic, ics );
 }
 
 bool prepare_image( mrv::image_type_ptr& pic, const CMedia* img,
@@ -23,6 +23,8 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
+#include <string>
+
 #include "core/mrvFrame.h"
 
 namespace mrv {
@@ -37,6 +39,15 @@ bool prepare_image( mrv::image_type_ptr& pic, const CMedia* img,
                     const image_type::PixelType pt );
 void bake_ocio( const mrv::image_type_ptr& ptr, const CMedia* img );
 
+// Build (or find) the display processor for an input color space.
+// Processors are cached, so repeated bakes do not rebuild them.  This
+// switches the global locale, so only call it from the main thread.
+bool prepare_ocio( const std::string& ics );
+
+// Apply a processor built by prepare_ocio().  Safe from any thread.
+// Returns false if it was not prepared.
+bool apply_ocio( const mrv::image_type_ptr& ptr, const std::string& ics );
+
 }
 
 
@@ -0,0 +1,219 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDeepSamples.cpp
+ * @author gga
+ * @date   Sun Oct 18 19:52:40 2026
+ *
+ * @brief  Storage for the samples of a deep image, one contiguous block
+ *         per channel.
+ *
+ */
+
+#include <limits>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvParallel.h"
+#include "core/mrvDeepSamples.h"
+
+namespace {
+
+// Pixels handed to a thread at a time
+const size_t kGrain = 16384;
+
+}
+
+namespace mrv {
+
+struct DeepSamples::Bound
+{
+    float zmin;
+    float zmax;
+    boost::mutex mtx;
+};
+
+DeepSamples::DeepSamples() :
+_width( 0 ),
+_height( 0 ),
+_color( false ),
+_total( 0 )
+{
+}
+
+DeepSamples::~DeepSamples()
+{
+}
+
+void DeepSamples::resize( const int width, const int height,
+                          const bool color )
+{
+    _width  = width;
+    _height = height;
+    _color  = color;
+    _total  = 0;
+
+    size_t n = size_t(width) * height;
+    _counts.assign( n, 0 );
+    _offsets.clear();
+
+    _zp.assign( n, NULL );
+    _ap.assign( n, NULL );
+    if ( color )
+    {
+        _rp.assign( n, NULL );
+        _gp.assign( n, NULL );
+        _bp.assign( n, NULL );
+    }
+    else
+    {
+        _rp.clear();
+        _gp.clear();
+        _bp.clear();
+    }
+}
+
+void DeepSamples::allocate()
+{
+    size_t n = _counts.size();
+    _offsets.resize( n + 1 );
+
+    uint64_t total = 0;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        _offsets[i] = total;
+        total += _counts[i];
+    }
+    _offsets[n] = total;
+    _total = total;
+
+    // Keep pointers valid for pixels without samples too
+    size_t size = std::max( total, uint64_t(1) );
+    _z.reset( new float[size] );
+    _a.reset( new half[size] );
+    if ( _color )
+    {
+        _r.reset( new half[size] );
+        _g.reset( new half[size] );
+        _b.reset( new half[size] );
+    }
+
+    parallel_for( 0, n, kGrain,
+                  boost::bind( &DeepSamples::point, this, _1, _2 ) );
+}
+
+void DeepSamples::point( const size_t first, const size_t last )
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        uint64_t o = _offsets[i];
+        _zp[i] = _z.get() + o;
+        _ap[i] = _a.get() + o;
+        if ( _color )
+        {
+            _rp[i] = _r.get() + o;
+            _gp[i] = _g.get() + o;
+            _bp[i] = _b.get() + o;
+        }
+    }
+}
+
+void DeepSamples::z_bound( float& zmin, float& zmax,
+                           const float farPlane ) const
+{
+    Bound b;
+    b.zmax = std::numeric_limits<float>::min();
+    b.zmin = std::numeric_limits<float>::max();
+
+    parallel_for( 0, _counts.size(), kGrain,
+                  boost::bind( &DeepSamples::bound, this, &b, farPlane,
+                               _1, _2 ) );
+
+    zmin = b.zmin;
+    zmax = b.zmax;
+    if ( zmax < zmin ) std::swap( zmin, zmax );
+}
+
+void DeepSamples::bound( Bound* b, const float farPlane,
+                         const size_t first, const size_t last ) const
+{
+    float zmax = std::numeric_limits<float>::min();
+    float zmin = std::numeric_limits<float>::max();
+
+    // Samples of consecutive pixels are consecutive in the block
+    const float* z = _z.get() + _offsets[first];
+    const float* e = _z.get() + _offsets[last];
+    for ( ; z != e; ++z )
+    {
+        float val = *z;
+        if ( val > zmax && val < farPlane ) zmax = val;
+        if ( val < zmin ) zmin = val;
+    }
+
+    boost::mutex::scoped_lock lk( b->mtx );
+    if ( zmax > b->zmax ) b->zmax = zmax;
+    if ( zmin < b->zmin ) b->zmin = zmin;
+}
+
+void DeepSamples::flatten( Imf::Rgba* pixels, const bool composite ) const
+{
+    parallel_for( 0, _counts.size(), kGrain,
+                  boost::bind( &DeepSamples::flatten_range, this, pixels,
+                               composite, _1, _2 ) );
+}
+
+void DeepSamples::flatten_range( Imf::Rgba* pixels, const bool composite,
+                                 const size_t first, const size_t last ) const
+{
+    for ( size_t i = first; i < last; ++i )
+    {
+        unsigned count = _counts[i];
+        if ( count == 0 ) continue;
+
+        const uint64_t o = _offsets[i];
+        Imf::Rgba& p = pixels[i];
+        p.a = _a[o];
+
+        if ( !_color )
+        {
+            p.r = p.g = p.b = _z[o];
+            continue;
+        }
+
+        p.r = _r[o];
+        p.g = _g[o];
+        p.b = _b[o];
+
+        if ( !composite ) continue;
+
+        for ( unsigned s = 1; s < count; ++s )
+        {
+            float a = p.a;
+            if ( a >= 1.f ) break;
+
+            p.r += (1.f - a) * _r[o+s];
+            p.g += (1.f - a) * _g[o+s];
+            p.b += (1.f - a) * _b[o+s];
+            p.a += (1.f - a) * _a[o+s];
+        }
+    }
+}
+
+} // namespace mrv
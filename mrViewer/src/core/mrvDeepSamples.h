@@ -0,0 +1,122 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDeepSamples.h
+ * @author gga
+ * @date   Sun Oct 18 19:52:40 2026
+ *
+ * @brief  Storage for the samples of a deep image, one contiguous block
+ *         per channel.
+ *
+ */
+
+#ifndef mrvDeepSamples_h
+#define mrvDeepSamples_h
+
+#include <vector>
+#include <inttypes.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <ImfRgba.h>  // for half and Rgba
+
+namespace mrv {
+
+//
+// OpenEXR reads deep samples through a table with a pointer per pixel.
+// Instead of allocating each pixel's samples on its own, resize() sets up
+// the sample count and pointer tables, and once the counts are read
+// allocate() lays out every channel in a single block and points each
+// pixel at its run of samples.  Z and alpha are always stored; red,
+// green and blue only if asked for.
+//
+class DeepSamples
+{
+  public:
+    DeepSamples();
+    ~DeepSamples();
+
+    /// Set up tables for a data window of width x height pixels
+    void resize( const int width, const int height, const bool color );
+
+    /// Allocate sample storage from the sample counts
+    void allocate();
+
+    inline int width() const  { return _width; }
+    inline int height() const { return _height; }
+    inline size_t pixels() const { return _counts.size(); }
+
+    /// Total number of samples (valid after allocate())
+    inline uint64_t samples() const { return _total; }
+
+    inline bool has_color() const { return _color; }
+
+    inline unsigned* sample_counts() { return &_counts[0]; }
+    inline const unsigned* sample_counts() const { return &_counts[0]; }
+
+    inline float** z()    { return &_zp[0]; }
+    inline half**  alpha() { return &_ap[0]; }
+    inline half**  red()   { return _color ? &_rp[0] : NULL; }
+    inline half**  green() { return _color ? &_gp[0] : NULL; }
+    inline half**  blue()  { return _color ? &_bp[0] : NULL; }
+
+    /// Nearest and farthest depth.  Samples at or past farPlane do not
+    /// count for the farthest.
+    void z_bound( float& zmin, float& zmax, const float farPlane ) const;
+
+    /// Flatten to one RGBA pixel per sample list.  If composite is set and
+    /// there is color, samples are composited front to back, otherwise
+    /// the first sample is taken (gray from depth when there is no color).
+    void flatten( Imf::Rgba* pixels, const bool composite ) const;
+
+  protected:
+    struct Bound;
+
+    void point( const size_t first, const size_t last );
+    void bound( Bound* b, const float farPlane,
+                const size_t first, const size_t last ) const;
+    void flatten_range( Imf::Rgba* pixels, const bool composite,
+                        const size_t first, const size_t last ) const;
+
+  protected:
+    int                    _width;
+    int                    _height;
+    bool                   _color;
+    uint64_t               _total;
+    std::vector<unsigned>  _counts;
+    std::vector<uint64_t>  _offsets;
+
+    boost::scoped_array<float> _z;
+    boost::scoped_array<half>  _a;
+    boost::scoped_array<half>  _r;
+    boost::scoped_array<half>  _g;
+    boost::scoped_array<half>  _b;
+
+    std::vector<float*>    _zp;
+    std::vector<half*>     _ap;
+    std::vector<half*>     _rp;
+    std::vector<half*>     _gp;
+    std::vector<half*>     _bp;
+};
+
+typedef boost::shared_ptr< DeepSamples > DeepSamplesPtr;
+
+} // namespace mrv
+
+#endif // mrvDeepSamples_h
@@ -0,0 +1,528 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDiskCache.cpp
+ * @author gga
+ * @date   Sun Oct 18 21:47:05 2026
+ *
+ * @brief  Second level of the image sequence cache, on local disk.
+ *
+ */
+
+#define __STDC_LIMIT_MACROS
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <FL/fl_utf8.h>
+
+#include "core/mrvThread.h"
+#include "core/mrvBackgroundCache.h"
+#include "core/mrvDiskCache.h"
+#include "gui/mrvIO.h"
+
+namespace fs  = boost::filesystem;
+namespace bip = boost::interprocess;
+
+namespace
+{
+const char* kModule = "spill";
+
+// Pixels start here, on a page of their own
+const size_t kDataOffset = 4096;
+
+// Frames waiting to be written before more are dropped instead
+const size_t kMaxQueued = 16;
+
+const char kMagic[8] = { 'm', 'r', 'v', 's', 'p', 'i', 'l', 'l' };
+const boost::uint32_t kVersion = 1;
+
+struct Header
+{
+    char            magic[8];
+    boost::uint32_t version;
+    boost::uint32_t key_size;
+    boost::int64_t  frame;
+    boost::int64_t  pts;
+    boost::int64_t  repeat;
+    boost::int64_t  ctime;
+    boost::int64_t  mtime;
+    boost::uint64_t width;
+    boost::uint64_t height;
+    boost::uint64_t data_size;
+    boost::uint32_t channels;
+    boost::uint32_t format;
+    boost::uint32_t type;
+    boost::uint32_t valid;
+    boost::uint32_t proxy;
+    boost::int32_t  full[4];    // x, y, w, h
+};
+
+typedef boost::mutex Mutex;
+
+typedef std::list< std::string > LRU;
+struct Entry
+{
+    std::string     file;
+    boost::uint64_t size;
+    unsigned short  proxy;
+    mrv::Recti      full;
+    LRU::iterator   lru;
+};
+typedef std::map< std::string, Entry > Index;
+
+typedef std::pair< std::string, mrv::image_type_ptr > Job;
+
+Mutex                     _mutex;
+boost::condition_variable _cond;
+std::deque< Job >         _queue;
+std::set< std::string >   _pending;
+boost::thread*            _thread = NULL;
+bool                      _stop = false;
+bool                      _scanned = false;
+Index                     _index;
+LRU                       _lru;
+boost::uint64_t           _used = 0;
+boost::int64_t            _quota = 0;
+std::string               _directory;
+
+// Keeps the mapping of a frame alive while its pixels are in use
+struct Unmap
+{
+    boost::shared_ptr< bip::mapped_region > region;
+    void operator()( mrv::aligned16_uint8_t* ) const {}
+};
+
+// Collisions are caught by the key stored in the file.
+std::string filename( const std::string& dir, const std::string& key )
+{
+    return mrv::CacheFile::name( dir, key, ".frame" );
+}
+
+// Header page, then the pixels
+bool write_frame( FILE* f, const std::vector< char >& page,
+                  const mrv::image_type_ptr& pic )
+{
+    bool ok = ( fwrite( &page[0], 1, kDataOffset, f ) == kDataOffset );
+    ok &= ( fwrite( pic->data().get(), 1, pic->data_size(), f ) ==
+            pic->data_size() );
+    return ok;
+}
+
+// Read the header and key of a file
+bool read_header( const std::string& file, Header& h, std::string& key )
+{
+    FILE* f = fl_fopen( file.c_str(), "rb" );
+    if ( !f ) return false;
+
+    bool ok = false;
+    if ( fread( &h, sizeof(h), 1, f ) == 1 &&
+         memcmp( h.magic, kMagic, sizeof(kMagic) ) == 0 &&
+         h.version == kVersion &&
+         h.key_size <= kDataOffset - sizeof(h) )
+    {
+        key.resize( h.key_size );
+        ok = ( h.key_size == 0 ||
+               fread( &key[0], 1, h.key_size, f ) == h.key_size );
+    }
+    fclose( f );
+    return ok;
+}
+
+// Forget key.  _mutex must be held.
+void forget( const std::string& key )
+{
+    Index::iterator i = _index.find( key );
+    if ( i == _index.end() ) return;
+    _used -= i->second.size;
+    _lru.erase( i->second.lru );
+    _index.erase( i );
+}
+
+// Add or replace key.  _mutex must be held.
+void remember( const std::string& key, const std::string& file,
+               const boost::uint64_t size, const mrv::image_type_ptr& pic )
+{
+    forget( key );
+    _lru.push_front( key );
+    Entry& e = _index[ key ];
+    e.file  = file;
+    e.size  = size;
+    e.proxy = pic->proxy();
+    e.full  = pic->full_window();
+    e.lru   = _lru.begin();
+    _used += size;
+}
+
+}
+
+namespace mrv {
+
+bool DiskCache::enabled()
+{
+    SCOPED_LOCK( _mutex );
+    return _quota > 0;
+}
+
+void DiskCache::quota( const boost::int64_t bytes )
+{
+    SCOPED_LOCK( _mutex );
+    _quota = bytes;
+    // Turning the cache off leaves the files for a later session
+    if ( _scanned && _quota > 0 ) trim();
+}
+
+boost::int64_t DiskCache::quota()
+{
+    SCOPED_LOCK( _mutex );
+    return _quota;
+}
+
+void DiskCache::directory( const std::string& dir )
+{
+    std::string d = dir;
+    if ( !d.empty() && d[d.size()-1] != '/' ) d += '/';
+
+    SCOPED_LOCK( _mutex );
+    if ( d == _directory ) return;
+
+    // Files of the old directory stay there for a later session
+    _directory = d;
+    _index.clear();
+    _lru.clear();
+    _used = 0;
+    _scanned = false;
+    _cond.notify_one();
+}
+
+std::string DiskCache::directory()
+{
+    SCOPED_LOCK( _mutex );
+    if ( !_directory.empty() ) return _directory;
+
+    try
+    {
+        return ( fs::temp_directory_path() / "mrViewer" / "frames" ).string()
+               + '/';
+    }
+    catch( const fs::filesystem_error& e )
+    {
+        LOG_ERROR( e.what() );
+    }
+    return "";
+}
+
+void DiskCache::spill( const std::string& key, const image_type_ptr& pic )
+{
+    if ( key.empty() || !pic || !pic->data() ) return;
+    if ( key.size() > kDataOffset - sizeof(Header) ) return;
+
+    SCOPED_LOCK( _mutex );
+    if ( _stop || _quota <= 0 ) return;
+    if ( _pending.find( key ) != _pending.end() ) return;
+
+    // Already on disk as it is.  Just mark it as used.
+    Index::iterator i = _index.find( key );
+    if ( i != _index.end() && i->second.proxy == pic->proxy() &&
+         i->second.full == pic->full_window() &&
+         i->second.size == kDataOffset + pic->data_size() )
+    {
+        _lru.splice( _lru.begin(), _lru, i->second.lru );
+        return;
+    }
+
+    if ( _queue.size() >= kMaxQueued ) return;
+
+    _pending.insert( key );
+    _queue.push_back( Job( key, pic ) );
+
+    if ( !_thread )
+        _thread = new boost::thread( &DiskCache::writer );
+
+    _cond.notify_one();
+}
+
+image_type_ptr DiskCache::map( const std::string& key )
+{
+    std::string file;
+    {
+        SCOPED_LOCK( _mutex );
+        if ( _pending.find( key ) != _pending.end() ) return image_type_ptr();
+
+        Index::iterator i = _index.find( key );
+        if ( i == _index.end() ) return image_type_ptr();
+
+        _lru.splice( _lru.begin(), _lru, i->second.lru );
+        file = i->second.file;
+    }
+
+    Header h;
+    std::string stored;
+    image_type_ptr pic;
+    if ( read_header( file, h, stored ) && stored == key )
+    {
+        try
+        {
+            // A short file would fault when its pixels are read
+            if ( fs::file_size( file ) < kDataOffset + h.data_size )
+                throw bip::interprocess_exception( "file too short" );
+
+            bip::file_mapping fm( file.c_str(), bip::read_only );
+
+            // Private pages, so the frame may still be written to
+            Unmap unmap;
+            unmap.region.reset( new bip::mapped_region( fm, bip::copy_on_write,
+                                                        kDataOffset,
+                                                        h.data_size ) );
+            VideoFrame::PixelData data( (aligned16_uint8_t*)
+                                        unmap.region->get_address(), unmap );
+
+            pic.reset( new image_type( h.frame, h.width, h.height,
+                                       h.channels,
+                                       (image_type::Format) h.format,
+                                       (image_type::PixelType) h.type,
+                                       data, h.repeat, h.pts,
+                                       (bool) h.valid ) );
+            pic->ctime( h.ctime );
+            pic->mtime( h.mtime );
+            pic->proxy( h.proxy );
+            pic->full_window( mrv::Recti( h.full[0], h.full[1],
+                                          h.full[2], h.full[3] ) );
+            if ( pic->data_size() != h.data_size ) pic.reset();
+        }
+        catch( const bip::interprocess_exception& e )
+        {
+            LOG_ERROR( file << ": " << e.what() );
+            pic.reset();
+        }
+        catch( const fs::filesystem_error& e )
+        {
+            LOG_ERROR( e.what() );
+            pic.reset();
+        }
+    }
+
+    if ( !pic )
+    {
+        // Removed or overwritten by someone else
+        SCOPED_LOCK( _mutex );
+        forget( key );
+    }
+    return pic;
+}
+
+bool DiskCache::save( const std::string& key, const image_type_ptr& pic,
+                      std::string& file, boost::uint64_t& size )
+{
+    std::string dir = directory();
+    if ( dir.empty() ) return false;
+
+    Header h;
+    memset( &h, 0, sizeof(h) );
+    memcpy( h.magic, kMagic, sizeof(kMagic) );
+    h.version   = kVersion;
+    h.key_size  = key.size();
+    h.frame     = pic->frame();
+    h.pts       = pic->pts();
+    h.repeat    = pic->repeat();
+    h.ctime     = pic->ctime();
+    h.mtime     = pic->mtime();
+    h.width     = pic->width();
+    h.height    = pic->height();
+    h.data_size = pic->data_size();
+    h.channels  = pic->channels();
+    h.format    = pic->format();
+    h.type      = pic->pixel_type();
+    h.valid     = pic->valid();
+    h.proxy     = pic->proxy();
+    const mrv::Recti& full = pic->full_window();
+    h.full[0] = full.x();
+    h.full[1] = full.y();
+    h.full[2] = full.w();
+    h.full[3] = full.h();
+
+    std::vector< char > page( kDataOffset, 0 );
+    memcpy( &page[0], &h, sizeof(h) );
+    memcpy( &page[sizeof(h)], key.c_str(), key.size() );
+
+    // Written to a temporary name and renamed, so a file is never
+    // mapped half written.
+    file = filename( dir, key );
+    bool ok = CacheFile::write( file, boost::bind( write_frame, _1,
+                                                   boost::cref( page ),
+                                                   boost::cref( pic ) ) );
+
+    size = kDataOffset + h.data_size;
+    return ok;
+}
+
+//
+// Index the files left by earlier sessions, oldest first in the LRU.
+//
+void DiskCache::scan()
+{
+    std::string dir = directory();
+
+    typedef std::pair< std::time_t, std::string > File;
+    std::vector< File > files;
+    try
+    {
+        if ( dir.empty() || !fs::is_directory( dir ) ) return;
+
+        fs::directory_iterator e;
+        for ( fs::directory_iterator i( dir ); i != e; ++i )
+        {
+            if ( i->path().extension() != ".frame" ) continue;
+            files.push_back( File( fs::last_write_time( i->path() ),
+                                   i->path().string() ) );
+        }
+    }
+    catch( const fs::filesystem_error& e )
+    {
+        LOG_ERROR( e.what() );
+        return;
+    }
+
+    std::sort( files.begin(), files.end() );
+
+    for ( size_t i = 0; i < files.size(); ++i )
+    {
+        Header h;
+        std::string key;
+        if ( !read_header( files[i].second, h, key ) ) continue;
+
+        SCOPED_LOCK( _mutex );
+        if ( _stop ) return;
+
+        forget( key );
+        _lru.push_front( key );
+        Entry& e = _index[ key ];
+        e.file  = files[i].second;
+        e.size  = kDataOffset + h.data_size;
+        e.proxy = h.proxy;
+        e.full  = mrv::Recti( h.full[0], h.full[1], h.full[2], h.full[3] );
+        e.lru   = _lru.begin();
+        _used += e.size;
+    }
+
+    SCOPED_LOCK( _mutex );
+    trim();
+}
+
+//
+// Remove the least recently used files until the quota is met.
+// _mutex must be held.
+//
+void DiskCache::trim()
+{
+    while ( _used > (boost::uint64_t) std::max( _quota, boost::int64_t(0) ) &&
+            !_lru.empty() )
+    {
+        std::string key = _lru.back();
+        std::string file = _index[ key ].file;
+        forget( key );
+        try
+        {
+            fs::remove( file );
+        }
+        catch( const fs::filesystem_error& e )
+        {
+            // Still mapped on some systems.  It is rewritten when needed.
+            LOG_ERROR( e.what() );
+        }
+    }
+}
+
+void DiskCache::writer()
+{
+    for (;;)
+    {
+        Job job;
+        bool rescan = false;
+        {
+            SCOPED_LOCK( _mutex );
+            while ( _queue.empty() && _scanned && !_stop )
+                CONDITION_WAIT( _cond, _mutex );
+            if ( _stop ) return;
+            if ( !_scanned )
+            {
+                _scanned = true;
+                rescan = true;
+            }
+            else
+            {
+                job = _queue.front();
+                _queue.pop_front();
+            }
+        }
+
+        if ( rescan )
+        {
+            scan();
+            continue;
+        }
+
+        std::string file;
+        boost::uint64_t size = 0;
+        bool ok = save( job.first, job.second, file, size );
+
+        SCOPED_LOCK( _mutex );
+        _pending.erase( job.first );
+        if ( ok )
+        {
+            remember( job.first, file, size, job.second );
+            trim();
+        }
+    }
+}
+
+void DiskCache::shutdown()
+{
+    {
+        SCOPED_LOCK( _mutex );
+        _stop = true;
+        _queue.clear();
+        _pending.clear();
+        _cond.notify_all();
+    }
+
+    if ( _thread )
+    {
+        _thread->join();
+        delete _thread;
+        _thread = NULL;
+    }
+}
+
+} // namespace mrv
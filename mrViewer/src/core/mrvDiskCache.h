@@ -0,0 +1,81 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvDiskCache.h
+ * @author gga
+ * @date   Sun Oct 18 21:47:05 2026
+ *
+ * @brief  Second level of the image sequence cache, on local disk.
+ *
+ */
+
+#ifndef mrvDiskCache_h
+#define mrvDiskCache_h
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+#include "core/mrvFrame.h"
+
+namespace mrv {
+
+//
+// Decoded frames dropped from memory are written by a background thread
+// to files of a local directory, one per frame, with a header page and
+// the pixels starting on the next page.  A hit maps the file back and
+// the frame uses the mapped pages as its pixels, without a copy.  Files
+// are keyed by CMedia::cache_key() and the least recently used are
+// removed when the directory grows over its quota.  Files of previous
+// sessions are found again on start.
+//
+class DiskCache
+{
+  public:
+    /// Whether frames are written to disk at all
+    static bool enabled();
+
+    /// Bytes the directory may hold.  0 turns the cache off.
+    static void quota( const boost::int64_t bytes );
+    static boost::int64_t quota();
+
+    /// Directory for the files.  Empty selects one in the temporary
+    /// directory of the system.
+    static void directory( const std::string& dir );
+    static std::string directory();
+
+    /// Queue pic to be written under key, unless it is there already.
+    static void spill( const std::string& key, const image_type_ptr& pic );
+
+    /// Map the frame stored under key.  NULL if there is none.
+    static image_type_ptr map( const std::string& key );
+
+    /// Stop the background thread, dropping queued frames.
+    static void shutdown();
+
+  protected:
+    static void writer();
+    static void scan();
+    static bool save( const std::string& key, const image_type_ptr& pic,
+                      std::string& file, boost::uint64_t& size );
+    static void trim();
+};
+
+} // namespace mrv
+
+#endif // mrvDiskCache_h
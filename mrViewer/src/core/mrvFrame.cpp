@@ -268,6 +268,33 @@ size_t VideoFrame::data_size() const
 }
 
 
+VideoFrame::VideoFrame( const boost::int64_t& frame,
+                        const size_t w, const size_t h,
+                        const unsigned short c,
+                        const Format format,
+                        const PixelType type,
+                        const PixelData& d,
+                        const boost::int64_t repeat,
+                        const boost::int64_t pts,
+                        const bool valid ) :
+    _frame( frame ),
+    _pts( pts ),
+    _repeat( repeat ),
+    _width( w ),
+    _height( h ),
+    _channels( c ),
+    _ctime( 0 ),
+    _mtime( 0 ),
+    _format( format ),
+    _type( type ),
+    _valid( valid ),
+    _proxy( 0 ),
+    _data( d )
+{
+    gettimeofday( &_ptime, NULL );
+    CMedia::memory_used += data_size();
+}
+
 VideoFrame::~VideoFrame()
 {
     CMedia::memory_used -= data_size();
@@ -638,6 +665,8 @@ VideoFrame::self& VideoFrame::operator=( const VideoFrame::self& b ) noexcept
     _ctime    = time(NULL);
     _mtime    = b.mtime();
     _type     = b.pixel_type();
+    _proxy    = b.proxy();
+    _full     = b.full_window();
     allocate();
     memcpy( _data.get(), b.data().get(), data_size() );
     return *this;
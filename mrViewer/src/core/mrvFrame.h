@@ -52,6 +52,7 @@
 #include "core/mrvAssert.h"
 #include "core/mrvAlignedData.h"
 #include "core/mrvImagePixel.h"
+#include "core/mrvRectangle.h"
 
 struct SwsContext;
 
@@ -138,6 +139,8 @@ private:
     Format                      _format; //!< rgb/yuv format
     PixelType                   _type;   //!< pixel type
     bool                       _valid;   //! invalid frame
+    unsigned short              _proxy;  //!< resolution reduction (2^n)
+    mrv::Recti                  _full;   //!< data window, if partial frame
     PixelData                   _data;   //!< video data
 
 public:
@@ -154,7 +157,8 @@ public:
         _mtime( 0 ),
         _format( kRGBA ),
         _type( kByte ),
-        _valid( true )
+        _valid( true ),
+        _proxy( 0 )
     {
         gettimeofday( &_ptime, NULL );
     }
@@ -170,7 +174,9 @@ public:
         _mtime( b._mtime ),
         _format( b._format ),
         _type( b._type ),
-        _valid( true )
+        _valid( true ),
+        _proxy( b._proxy ),
+        _full( b._full )
     {
         gettimeofday( &_ptime, NULL );
         allocate();
@@ -195,12 +201,25 @@ public:
         _mtime( 0 ),
         _format( format ),
         _type( type ),
-        _valid( valid )
+        _valid( valid ),
+        _proxy( 0 )
     {
         gettimeofday( &_ptime, NULL );
         allocate();
     }
 
+    // Wrap pixels that live somewhere else, like a mapped file, instead
+    // of allocating them.  The deleter of d releases them.
+    VideoFrame( const boost::int64_t& frame,
+                const size_t w, const size_t h,
+                const unsigned short c,
+                const Format format,
+                const PixelType type,
+                const PixelData& d,
+                const boost::int64_t repeat = 0,
+                const boost::int64_t pts = 0,
+                const bool valid = true );
+
     ~VideoFrame();
 
     void allocate();
@@ -304,6 +323,29 @@ public:
         return _valid;
     }
 
+    // Frames decoded at reduced resolution for display keep the size of
+    // the image's data window but hold 1/2^proxy of its pixels.
+    inline void proxy( const unsigned short p ) {
+        _proxy = p;
+    }
+    inline unsigned short proxy() const {
+        return _proxy;
+    }
+
+    // Frames decoded for a region of interest hold only part of the
+    // image.  Their image's data window is the region held and
+    // full_window() the data window of the whole image.  Empty for
+    // complete frames.
+    inline void full_window( const mrv::Recti& r ) {
+        _full = r;
+    }
+    inline const mrv::Recti& full_window() const {
+        return _full;
+    }
+    inline bool partial() const {
+        return !_full.empty();
+    }
+
     inline const PixelData data() const {
         return _data;
     }
@@ -0,0 +1,163 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFrameRegistry.cpp
+ * @author gga
+ * @date   Sun Oct 18 22:26:48 2026
+ *
+ * @brief  Decoded frames shared by all images showing the same pixels.
+ *
+ */
+
+#include <map>
+
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvThread.h"
+#include "core/mrvFrameRegistry.h"
+
+namespace {
+
+// Registrations between sweeps of keys whose frames are all gone
+const size_t kSweep = 1024;
+
+typedef boost::mutex Mutex;
+
+struct Weak
+{
+    boost::weak_ptr< mrv::image_type > pic;
+    mrv::Recti data;
+    mrv::Recti display;
+};
+
+typedef std::vector< Weak > Variants;
+typedef std::map< std::string, Variants > Registry;
+
+Mutex    _mutex;
+Registry _registry;
+size_t   _added = 0;
+
+// Drop the variants that are gone.  _mutex must be held.
+void prune( Variants& v )
+{
+    Variants::iterator i = v.begin();
+    while ( i != v.end() )
+    {
+        if ( i->pic.expired() ) i = v.erase( i );
+        else ++i;
+    }
+}
+
+void sweep()
+{
+    Registry::iterator i = _registry.begin();
+    while ( i != _registry.end() )
+    {
+        prune( i->second );
+        if ( i->second.empty() ) _registry.erase( i++ );
+        else ++i;
+    }
+}
+
+bool same( const mrv::image_type& a, const mrv::image_type& b )
+{
+    return ( a.frame() == b.frame() && a.width() == b.width() &&
+             a.height() == b.height() && a.channels() == b.channels() &&
+             a.format() == b.format() && a.pixel_type() == b.pixel_type() &&
+             a.proxy() == b.proxy() && a.full_window() == b.full_window() &&
+             a.valid() == b.valid() );
+}
+
+}
+
+namespace mrv {
+
+image_type_ptr FrameRegistry::share( const std::string& key,
+                                     const image_type_ptr& pic,
+                                     const mrv::Recti& data,
+                                     const mrv::Recti& display )
+{
+    if ( key.empty() || !pic || !pic->valid() ) return pic;
+
+    SCOPED_LOCK( _mutex );
+
+    Variants& v = _registry[ key ];
+    prune( v );
+
+    for ( size_t i = 0; i < v.size(); ++i )
+    {
+        image_type_ptr old = v[i].pic.lock();
+        if ( old == pic ) return pic;
+        if ( old && same( *old, *pic ) ) return old;
+    }
+
+    Weak w;
+    w.pic     = pic;
+    w.data    = data;
+    w.display = display;
+    v.push_back( w );
+
+    if ( ++_added % kSweep == 0 ) sweep();
+    return pic;
+}
+
+void FrameRegistry::find( const std::string& key, Entries& found )
+{
+    found.clear();
+    if ( key.empty() ) return;
+
+    SCOPED_LOCK( _mutex );
+
+    Registry::iterator it = _registry.find( key );
+    if ( it == _registry.end() ) return;
+
+    const Variants& v = it->second;
+    for ( size_t i = 0; i < v.size(); ++i )
+    {
+        Entry e;
+        e.pic = v[i].pic.lock();
+        if ( !e.pic ) continue;
+        e.data    = v[i].data;
+        e.display = v[i].display;
+        found.push_back( e );
+    }
+}
+
+void FrameRegistry::stats( size_t& frames, size_t& shared )
+{
+    frames = shared = 0;
+
+    SCOPED_LOCK( _mutex );
+
+    Registry::const_iterator i = _registry.begin();
+    Registry::const_iterator e = _registry.end();
+    for ( ; i != e; ++i )
+    {
+        const Variants& v = i->second;
+        for ( size_t j = 0; j < v.size(); ++j )
+        {
+            long n = v[j].pic.use_count();
+            if ( n == 0 ) continue;
+            ++frames;
+            if ( n > 1 ) ++shared;
+        }
+    }
+}
+
+} // namespace mrv
@@ -0,0 +1,76 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFrameRegistry.h
+ * @author gga
+ * @date   Sun Oct 18 22:26:48 2026
+ *
+ * @brief  Decoded frames shared by all images showing the same pixels.
+ *
+ */
+
+#ifndef mrvFrameRegistry_h
+#define mrvFrameRegistry_h
+
+#include <string>
+#include <vector>
+
+#include "core/mrvFrame.h"
+#include "core/mrvRectangle.h"
+
+namespace mrv {
+
+//
+// Frames in the caches of sequences are registered here under the key
+// of CMedia::cache_key(), which names the file, its modification time,
+// the frame, the layer and the cache settings.  Clones, split clips and
+// the same plate loaded twice then hold the same frame instead of
+// decoding and keeping one each, and the memory of a frame is counted
+// once.  Only weak references are kept: a frame goes away when the last
+// image caching it drops it.  Registered frames must not be changed.
+//
+class FrameRegistry
+{
+  public:
+    struct Entry
+    {
+        image_type_ptr pic;
+        mrv::Recti     data;      //!< data window of the frame
+        mrv::Recti     display;   //!< display window of the frame
+    };
+
+    typedef std::vector< Entry > Entries;
+
+    /// Register pic under key.  Returns the frame to keep instead of
+    /// pic: an identical frame registered before, or pic itself.
+    static image_type_ptr share( const std::string& key,
+                                 const image_type_ptr& pic,
+                                 const mrv::Recti& data,
+                                 const mrv::Recti& display );
+
+    /// Frames alive under key.  There may be several, at different
+    /// resolutions or for different regions.
+    static void find( const std::string& key, Entries& found );
+
+    /// Frames registered and held by more than one image
+    static void stats( size_t& frames, size_t& shared );
+};
+
+} // namespace mrv
+
+#endif // mrvFrameRegistry_h
@@ -0,0 +1,258 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvKeyframeIndex.cpp
+ * @author gga
+ * @date   Mon Oct 19 00:20:35 2026
+ *
+ * @brief  Index of the keyframes of movie files, kept across sessions.
+ *
+ */
+
+#define __STDC_FORMAT_MACROS
+#define __STDC_LIMIT_MACROS
+#define __STDC_CONSTANT_MACROS
+#include <inttypes.h>
+
+#include <cstdio>
+#include <algorithm>
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+
+#include "core/mrvHome.h"
+#include "core/mrvI8N.h"
+#include "core/mrvBackgroundCache.h"
+#include "core/mrvKeyframeIndex.h"
+#include "gui/mrvIO.h"
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const char* kModule = "keys";
+
+// Indices kept in memory.  An hour of one second GOPs is about 86Kb.
+const size_t kMaxMemoryIndices = 64;
+
+// Files kept on disk before the oldest ones are removed.
+const size_t kMaxDiskIndices = 4096;
+
+const char* kMagic = "mrvkeys 1";
+
+typedef mrv::BackgroundCache< mrv::KeyframeIndex::Request,
+                              mrv::KeyframeIndex::IndexPtr > Cache;
+
+Cache _cache( &mrv::KeyframeIndex::process, &mrv::KeyframeIndex::trim_disk,
+              kMaxMemoryIndices, Cache::kRememberFailures );
+
+std::string filename( const std::string& key )
+{
+    return mrv::CacheFile::name( mrv::KeyframeIndex::directory(), key,
+                                 ".keys" );
+}
+
+bool pts_less( const mrv::KeyframeIndex::Keyframe& a,
+               const mrv::KeyframeIndex::Keyframe& b )
+{
+    return a.pts < b.pts;
+}
+
+}
+
+namespace mrv {
+
+bool KeyframeIndex::Index::before( const boost::int64_t pts,
+                                   Keyframe& k ) const
+{
+    Keyframe t;
+    t.pts = pts;
+    std::vector< Keyframe >::const_iterator i =
+        std::upper_bound( keys.begin(), keys.end(), t, pts_less );
+    if ( i == keys.begin() ) return false;
+    k = *(--i);
+    return true;
+}
+
+std::string KeyframeIndex::directory()
+{
+    return mrv::prefspath() + "keyframes/";
+}
+
+std::string KeyframeIndex::key( const std::string& path, const int stream )
+{
+    if ( path.empty() || stream < 0 ) return "";
+
+    std::time_t mtime;
+    boost::uintmax_t size;
+    try
+    {
+        if ( !fs::is_regular_file( path ) ) return "";
+        mtime = fs::last_write_time( path );
+        size  = fs::file_size( path );
+    }
+    catch( const fs::filesystem_error& )
+    {
+        return "";
+    }
+
+    char buf[96];
+    sprintf( buf, "\n%" PRIu64 "\n%" PRId64 "\n%d\n", uint64_t(size),
+             int64_t(mtime), stream );
+    return path + buf;
+}
+
+KeyframeIndex::IndexPtr KeyframeIndex::find( const std::string& path,
+                                             const int stream )
+{
+    std::string k = key( path, stream );
+    if ( k.empty() ) return IndexPtr();
+
+    IndexPtr idx;
+    if ( _cache.find( k, idx ) ) return idx;
+
+    Request r;
+    r.key    = k;
+    r.file   = path;
+    r.stream = stream;
+    _cache.request( k, r );
+    return IndexPtr();
+}
+
+bool KeyframeIndex::known( const std::string& path, const int stream )
+{
+    std::string k = key( path, stream );
+    if ( k.empty() ) return false;
+
+    IndexPtr idx;
+    if ( _cache.find( k, idx ) ) return true;
+
+    try
+    {
+        return fs::is_regular_file( filename( k ) );
+    }
+    catch( const fs::filesystem_error& )
+    {
+        return false;
+    }
+}
+
+bool KeyframeIndex::process( const Request& r, IndexPtr& ptr )
+{
+    Index* idx = new Index;
+    ptr.reset( idx );
+    if ( load( r.key, *idx ) ) return true;
+    if ( !build( r.file, r.stream, *idx ) ) return false;
+    save( r.key, *idx );
+    return true;
+}
+
+bool KeyframeIndex::build( const std::string& file, const int stream,
+                           Index& idx )
+{
+    AVFormatContext* ctx = NULL;
+    if ( avformat_open_input( &ctx, file.c_str(), NULL, NULL ) < 0 )
+    {
+        LOG_ERROR( _("Could not open ") << file );
+        return false;
+    }
+
+    // Only the packets of the stream are of interest.  Streams found
+    // later in the file are skipped by index below.
+    for ( unsigned i = 0; i < ctx->nb_streams; ++i )
+        if ( int(i) != stream ) ctx->streams[i]->discard = AVDISCARD_ALL;
+
+    AVPacket pkt;
+    av_init_packet( &pkt );
+    pkt.data = NULL;
+    pkt.size = 0;
+
+    bool sorted = true;
+    while ( !_cache.stopped() && av_read_frame( ctx, &pkt ) >= 0 )
+    {
+        if ( pkt.stream_index == stream && ( pkt.flags & AV_PKT_FLAG_KEY ) )
+        {
+            Keyframe k;
+            k.dts = pkt.dts;
+            k.pts = pkt.pts != AV_NOPTS_VALUE ? pkt.pts : pkt.dts;
+            k.pos = pkt.pos;
+            if ( k.pts != AV_NOPTS_VALUE )
+            {
+                if ( k.dts == AV_NOPTS_VALUE ) k.dts = k.pts;
+                if ( !idx.keys.empty() && k.pts < idx.keys.back().pts )
+                    sorted = false;
+                idx.keys.push_back( k );
+            }
+        }
+        av_packet_unref( &pkt );
+    }
+
+    bool ok = !_cache.stopped() && !idx.keys.empty();
+    avformat_close_input( &ctx );
+
+    if ( !sorted )
+        std::stable_sort( idx.keys.begin(), idx.keys.end(), pts_less );
+    return ok;
+}
+
+bool KeyframeIndex::load( const std::string& key, Index& idx )
+{
+    FILE* f = CacheFile::open( filename( key ), kMagic, key );
+    if ( !f ) return false;
+
+    bool ok = false;
+    unsigned long count;
+    if ( fscanf( f, "%lu", &count ) == 1 && fgetc( f ) == '\n' &&
+         count > 0 && count <= CacheFile::remaining( f ) / sizeof(Keyframe) )
+    {
+        idx.keys.resize( count );
+        ok = ( fread( &idx.keys[0], sizeof(Keyframe), count, f ) == count );
+    }
+    fclose( f );
+    return ok;
+}
+
+bool KeyframeIndex::write( FILE* f, const Index& idx )
+{
+    fprintf( f, "%lu\n", (unsigned long) idx.keys.size() );
+    return ( fwrite( &idx.keys[0], sizeof(Keyframe), idx.keys.size(), f ) ==
+             idx.keys.size() );
+}
+
+void KeyframeIndex::save( const std::string& key, const Index& idx )
+{
+    CacheFile::save( filename( key ), kMagic, key,
+                     boost::bind( &KeyframeIndex::write, _1,
+                                  boost::cref( idx ) ) );
+}
+
+void KeyframeIndex::trim_disk()
+{
+    CacheFile::trim( directory(), ".keys", kMaxDiskIndices );
+}
+
+void KeyframeIndex::shutdown()
+{
+    _cache.shutdown();
+}
+
+} // namespace mrv
@@ -0,0 +1,111 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvKeyframeIndex.h
+ * @author gga
+ * @date   Mon Oct 19 00:20:35 2026
+ *
+ * @brief  Index of the keyframes of movie files, kept across sessions.
+ *
+ */
+
+#ifndef mrvKeyframeIndex_h
+#define mrvKeyframeIndex_h
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace mrv {
+
+//
+// The first time a movie is opened, a background thread reads all the
+// packets of its video stream and keeps the timestamps and byte offset
+// of each keyframe.  Seeks then go to the keyframe before the frame
+// asked for, instead of letting the demuxer guess.  Indices are stored
+// in ~/.filmaura/keyframes, keyed by path, size and modification time,
+// so later sessions have them at once.
+//
+class KeyframeIndex
+{
+  public:
+    struct Keyframe
+    {
+        boost::int64_t pts;
+        boost::int64_t dts;
+        boost::int64_t pos;   //!< byte offset of the packet, or -1
+    };
+
+    struct Index
+    {
+        std::vector< Keyframe > keys;   //!< in increasing pts order
+
+        /// Last keyframe at or before pts.  False if there is none.
+        bool before( const boost::int64_t pts, Keyframe& k ) const;
+    };
+
+    typedef boost::shared_ptr< const Index > IndexPtr;
+
+    struct Request
+    {
+        std::string key;
+        std::string file;
+        int         stream;
+    };
+
+  public:
+    /// Build the key for a stream of a file.  Empty for anything that
+    /// is not a regular file on disk.
+    static std::string key( const std::string& path, const int stream );
+
+    /// Index of a stream of a file.  If it is not in memory, it is
+    /// queued to be read or built in the background and NULL is
+    /// returned.
+    static IndexPtr find( const std::string& path, const int stream );
+
+    /// Whether the stream was indexed before, in this or an earlier
+    /// session.
+    static bool known( const std::string& path, const int stream );
+
+    /// Stop the background thread, dropping queued files.
+    static void shutdown();
+
+    /// Directory where indices are stored
+    static std::string directory();
+
+    /// Read or build the index of a stream.  Run by the background
+    /// thread.
+    static bool process( const Request& r, IndexPtr& idx );
+
+    /// Remove the oldest files when there are too many
+    static void trim_disk();
+
+  protected:
+    static bool build( const std::string& file, const int stream,
+                       Index& idx );
+    static bool load( const std::string& key, Index& idx );
+    static bool write( FILE* f, const Index& idx );
+    static void save( const std::string& key, const Index& idx );
+};
+
+} // namespace mrv
+
+#endif // mrvKeyframeIndex_h
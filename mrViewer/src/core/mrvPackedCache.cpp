@@ -0,0 +1,445 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPackedCache.cpp
+ * @author gga
+ * @date   Sun Oct 18 21:12:36 2026
+ *
+ * @brief  Losslessly compressed tier of the image sequence cache.
+ *
+ */
+
+#include <cstring>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <zlib.h>
+
+#include <boost/bind.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "core/CMedia.h"
+#include "core/mrvParallel.h"
+#include "core/mrvThread.h"
+#include "core/mrvPackedCache.h"
+#include "gui/mrvIO.h"
+
+namespace {
+const char* kModule = "cache";
+
+// Bytes compressed on their own.  A multiple of every pixel size.
+const size_t kChunkSize = 1 << 20;
+
+// Frames waiting for the background thread before pack() compresses in
+// the caller instead
+const size_t kMaxQueued = 8;
+
+std::atomic< size_t > s_frames( 0 );
+std::atomic< size_t > s_raw( 0 );
+std::atomic< size_t > s_packed( 0 );
+
+boost::mutex s_speed_mtx;
+double       s_mbps = 0.0;
+
+}
+
+namespace mrv {
+
+struct PackJob
+{
+    boost::weak_ptr< PackedCache > cache;
+    size_t                         idx;
+    image_type_ptr                 pic;
+
+    void run() const
+    {
+        PackedFramePtr packed;
+        try
+        {
+            packed.reset( new PackedFrame( *pic ) );
+        }
+        catch( const std::exception& e )
+        {
+            LOG_ERROR( _("Could not compress frame: ") << e.what() );
+        }
+
+        PackedCachePtr c = cache.lock();
+        if ( c ) c->store( idx, pic, packed );
+    }
+};
+
+namespace {
+
+// The background thread and its jobs.  Never destroyed, as the thread
+// may still wait on them at exit.
+struct PackQueue
+{
+    boost::mutex              mtx;
+    boost::condition_variable cond;
+    std::deque< PackJob >     jobs;
+
+    PackQueue()
+    {
+        boost::thread t( boost::bind( &PackQueue::run, this ) );
+        t.detach();
+    }
+
+    void run()
+    {
+        for (;;)
+        {
+            PackJob job;
+            {
+                boost::mutex::scoped_lock lk( mtx );
+                while ( jobs.empty() ) cond.wait( lk );
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            job.run();
+        }
+    }
+};
+
+PackQueue* pack_queue()
+{
+    static PackQueue* q = new PackQueue;
+    return q;
+}
+
+}
+
+
+PackedFrame::PackedFrame( const image_type& pic ) :
+_frame( pic.frame() ),
+_pts( pic.pts() ),
+_repeat( pic.repeat() ),
+_width( pic.width() ),
+_height( pic.height() ),
+_channels( pic.channels() ),
+_ctime( pic.ctime() ),
+_mtime( pic.mtime() ),
+_format( pic.format() ),
+_type( pic.pixel_type() ),
+_valid( pic.valid() ),
+_proxy( pic.proxy() ),
+_full( pic.full_window() ),
+_pixel_size( pic.pixel_size() ),
+_raw_size( pic.data_size() ),
+_size( 0 )
+{
+    gettimeofday( &_ptime, NULL );
+
+    _chunks.resize( ( _raw_size + kChunkSize - 1 ) / kChunkSize );
+    parallel_for( 0, _chunks.size(), 1,
+                  boost::bind( &PackedFrame::pack_chunks, this,
+                               pic.data().get(), _1, _2 ) );
+
+    for ( size_t i = 0; i < _chunks.size(); ++i )
+        _size += _chunks[i].data.size();
+
+    CMedia::memory_used += _size;
+    ++s_frames;
+    s_raw += _raw_size;
+    s_packed += _size;
+}
+
+PackedFrame::~PackedFrame()
+{
+    CMedia::memory_used -= _size;
+    if ( CMedia::memory_used < 0 ) CMedia::memory_used = 0;
+    --s_frames;
+    s_raw -= _raw_size;
+    s_packed -= _size;
+}
+
+void PackedFrame::pack_chunks( const boost::uint8_t* src, const size_t first,
+                               const size_t last )
+{
+    std::vector< unsigned char > planes( kChunkSize );
+    std::vector< unsigned char > out( compressBound( kChunkSize ) );
+    const size_t ps = _pixel_size;
+
+    for ( size_t c = first; c < last; ++c )
+    {
+        const size_t start = c * kChunkSize;
+        const size_t n = std::min( kChunkSize, _raw_size - start );
+        const boost::uint8_t* in = src + start;
+
+        // Byte planes, then differences between neighbouring bytes
+        const size_t count = n / ps;
+        unsigned char* t = &planes[0];
+        for ( size_t p = 0; p < ps; ++p )
+            for ( size_t i = 0; i < count; ++i )
+                *t++ = in[ i * ps + p ];
+
+        unsigned char prev = 0;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            unsigned char v = planes[i];
+            planes[i] = (unsigned char)( v - prev );
+            prev = v;
+        }
+
+        Chunk& chunk = _chunks[c];
+        uLongf len = (uLongf) out.size();
+        if ( compress2( &out[0], &len, &planes[0], (uLong) n,
+                        Z_BEST_SPEED ) == Z_OK && len < n )
+        {
+            chunk.data.assign( out.begin(), out.begin() + len );
+            chunk.stored = false;
+        }
+        else
+        {
+            chunk.data.assign( in, in + n );
+            chunk.stored = true;
+        }
+    }
+}
+
+void PackedFrame::unpack_chunks( boost::uint8_t* dst, const size_t first,
+                                 const size_t last ) const
+{
+    std::vector< unsigned char > planes( kChunkSize );
+    const size_t ps = _pixel_size;
+
+    for ( size_t c = first; c < last; ++c )
+    {
+        const size_t start = c * kChunkSize;
+        const size_t n = std::min( kChunkSize, _raw_size - start );
+        boost::uint8_t* out = dst + start;
+
+        const Chunk& chunk = _chunks[c];
+        if ( chunk.stored )
+        {
+            memcpy( out, &chunk.data[0], n );
+            continue;
+        }
+
+        uLongf len = (uLongf) n;
+        if ( uncompress( &planes[0], &len, &chunk.data[0],
+                         (uLong) chunk.data.size() ) != Z_OK || len != n )
+            throw std::runtime_error( "corrupt packed frame" );
+
+        unsigned char prev = 0;
+        for ( size_t i = 0; i < n; ++i )
+        {
+            prev = (unsigned char)( prev + planes[i] );
+            planes[i] = prev;
+        }
+
+        const size_t count = n / ps;
+        const unsigned char* t = &planes[0];
+        for ( size_t p = 0; p < ps; ++p )
+            for ( size_t i = 0; i < count; ++i )
+                out[ i * ps + p ] = *t++;
+    }
+}
+
+image_type_ptr PackedFrame::unpack() const
+{
+    image_type_ptr pic( new image_type( _frame, _width, _height, _channels,
+                                        _format, _type, _repeat, _pts,
+                                        _valid ) );
+    pic->ctime( _ctime );
+    pic->mtime( _mtime );
+    pic->proxy( _proxy );
+    pic->full_window( _full );
+
+    parallel_for( 0, _chunks.size(), 1,
+                  boost::bind( &PackedFrame::unpack_chunks, this,
+                               pic->data().get(), _1, _2 ) );
+    return pic;
+}
+
+
+PackedCache::PackedCache( const size_t frames ) :
+_frames( frames ),
+_pending_bytes( 0 )
+{
+}
+
+PackedCache::~PackedCache()
+{
+}
+
+void PackedCache::pack( const size_t idx, const image_type_ptr& pic )
+{
+    if ( !pic || idx >= _frames.size() ) return;
+
+    {
+        SCOPED_LOCK( _mutex );
+        std::map< size_t, image_type_ptr >::iterator i = _pending.find( idx );
+        if ( i != _pending.end() )
+            _pending_bytes -= i->second->data_size();
+        _pending[idx] = pic;
+        _pending_bytes += pic->data_size();
+        _frames[idx].reset();
+    }
+
+    PackJob job;
+    job.cache = shared_from_this();
+    job.idx   = idx;
+    job.pic   = pic;
+
+    PackQueue* q = pack_queue();
+    {
+        boost::mutex::scoped_lock lk( q->mtx );
+        if ( q->jobs.size() < kMaxQueued )
+        {
+            q->jobs.push_back( job );
+            q->cond.notify_one();
+            return;
+        }
+    }
+
+    // The background thread is behind.  Do this one here.
+    job.run();
+}
+
+void PackedCache::store( const size_t idx, const image_type_ptr& pic,
+                         const PackedFramePtr& packed )
+{
+    SCOPED_LOCK( _mutex );
+
+    // Taken back or replaced while it was being compressed
+    std::map< size_t, image_type_ptr >::iterator i = _pending.find( idx );
+    if ( i == _pending.end() || i->second != pic ) return;
+
+    _pending_bytes -= pic->data_size();
+    _pending.erase( i );
+    _frames[idx] = packed;
+}
+
+bool PackedCache::has( const size_t idx ) const
+{
+    SCOPED_LOCK( _mutex );
+    if ( idx >= _frames.size() ) return false;
+    return _frames[idx] || _pending.find( idx ) != _pending.end();
+}
+
+image_type_ptr PackedCache::take( const size_t idx )
+{
+    image_type_ptr pic;
+    PackedFramePtr packed;
+    {
+        SCOPED_LOCK( _mutex );
+        if ( idx >= _frames.size() ) return pic;
+
+        std::map< size_t, image_type_ptr >::iterator i = _pending.find( idx );
+        if ( i != _pending.end() )
+        {
+            pic = i->second;
+            _pending_bytes -= pic->data_size();
+            _pending.erase( i );
+            return pic;
+        }
+
+        packed = _frames[idx];
+        _frames[idx].reset();
+    }
+
+    if ( !packed ) return pic;
+
+    using namespace std::chrono;
+    steady_clock::time_point start = steady_clock::now();
+    try
+    {
+        pic = packed->unpack();
+    }
+    catch( const std::exception& e )
+    {
+        LOG_ERROR( _("Could not decompress frame: ") << e.what() );
+        return image_type_ptr();
+    }
+    decompressed( packed->raw_size(),
+                  duration< double >( steady_clock::now() - start ).count() );
+    return pic;
+}
+
+void PackedCache::erase( const size_t idx )
+{
+    SCOPED_LOCK( _mutex );
+    if ( idx >= _frames.size() ) return;
+
+    _frames[idx].reset();
+    std::map< size_t, image_type_ptr >::iterator i = _pending.find( idx );
+    if ( i != _pending.end() )
+    {
+        _pending_bytes -= i->second->data_size();
+        _pending.erase( i );
+    }
+}
+
+void PackedCache::clear()
+{
+    SCOPED_LOCK( _mutex );
+    std::fill( _frames.begin(), _frames.end(), PackedFramePtr() );
+    _pending.clear();
+    _pending_bytes = 0;
+}
+
+bool PackedCache::drop_oldest( size_t& idx )
+{
+    SCOPED_LOCK( _mutex );
+
+    size_t oldest = _frames.size();
+    for ( size_t i = 0; i < _frames.size(); ++i )
+    {
+        if ( !_frames[i] ) continue;
+        if ( oldest == _frames.size() ||
+             timercmp( &_frames[i]->ptime(), &_frames[oldest]->ptime(), < ) )
+            oldest = i;
+    }
+
+    if ( oldest == _frames.size() ) return false;
+
+    _frames[oldest].reset();
+    idx = oldest;
+    return true;
+}
+
+size_t PackedCache::pending_bytes() const
+{
+    SCOPED_LOCK( _mutex );
+    return _pending_bytes;
+}
+
+void PackedCache::decompressed( const size_t bytes, const double secs )
+{
+    if ( secs <= 0.0 ) return;
+
+    double mbps = double( bytes ) / secs / 1000000.0;
+    boost::mutex::scoped_lock lk( s_speed_mtx );
+    s_mbps = s_mbps == 0.0 ? mbps : s_mbps + 0.2 * ( mbps - s_mbps );
+}
+
+void PackedCache::stats( size_t& frames, double& ratio, double& mbps )
+{
+    frames = s_frames;
+    size_t packed = s_packed;
+    ratio = packed ? double( s_raw ) / double( packed ) : 0.0;
+
+    boost::mutex::scoped_lock lk( s_speed_mtx );
+    mbps = s_mbps;
+}
+
+} // namespace mrv
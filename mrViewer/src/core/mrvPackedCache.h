@@ -0,0 +1,163 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPackedCache.h
+ * @author gga
+ * @date   Sun Oct 18 21:12:36 2026
+ *
+ * @brief  Losslessly compressed tier of the image sequence cache.
+ *
+ */
+
+#ifndef mrvPackedCache_h
+#define mrvPackedCache_h
+
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "core/mrvFrame.h"
+
+namespace mrv {
+
+//
+// A video frame compressed in memory.  Pixels are cut in chunks that are
+// compressed and decompressed in parallel.  Each chunk has its bytes
+// split in planes by the size of a pixel channel and delta encoded
+// before zlib sees them, as EXR's ZIP compression does, so the exponent
+// bytes of half and float pictures end up together and compress well.
+//
+class PackedFrame
+{
+  public:
+    /// Compress pic.  pic is left untouched.
+    explicit PackedFrame( const image_type& pic );
+    ~PackedFrame();
+
+    /// Decompress to a new frame
+    image_type_ptr unpack() const;
+
+    /// Bytes held compressed
+    inline size_t size() const { return _size; }
+
+    /// Bytes of the frame uncompressed
+    inline size_t raw_size() const { return _raw_size; }
+
+    /// When the frame was packed
+    inline const timeval& ptime() const { return _ptime; }
+
+  protected:
+    struct Chunk
+    {
+        std::vector< unsigned char > data;
+        bool stored;  //!< data did not compress and is kept as is
+    };
+
+    void pack_chunks( const boost::uint8_t* src, const size_t first,
+                      const size_t last );
+    void unpack_chunks( boost::uint8_t* dst, const size_t first,
+                        const size_t last ) const;
+
+  protected:
+    boost::int64_t        _frame;
+    boost::int64_t        _pts;
+    boost::int64_t        _repeat;
+    size_t                _width;
+    size_t                _height;
+    unsigned short        _channels;
+    time_t                _ctime;
+    time_t                _mtime;
+    timeval               _ptime;
+    image_type::Format    _format;
+    image_type::PixelType _type;
+    bool                  _valid;
+    unsigned short        _proxy;
+    mrv::Recti            _full;
+
+    unsigned short        _pixel_size;
+    size_t                _raw_size;
+    size_t                _size;
+    std::vector< Chunk >  _chunks;
+};
+
+typedef boost::shared_ptr< PackedFrame > PackedFramePtr;
+
+//
+// The frames of a sequence that left the playback window.  Frames handed
+// to pack() are compressed by a background thread and stay available
+// through take() while they wait.  Compressed bytes count in
+// CMedia::memory_used like any other frame.
+//
+class PackedCache : public boost::enable_shared_from_this< PackedCache >
+{
+  public:
+    typedef boost::mutex Mutex;
+
+    explicit PackedCache( const size_t frames );
+    ~PackedCache();
+
+    /// Queue frame idx for compression
+    void pack( const size_t idx, const image_type_ptr& pic );
+
+    /// Whether frame idx is packed or waiting to be
+    bool has( const size_t idx ) const;
+
+    /// Remove frame idx and return it uncompressed (NULL if not here)
+    image_type_ptr take( const size_t idx );
+
+    /// Forget frame idx
+    void erase( const size_t idx );
+
+    /// Forget all frames
+    void clear();
+
+    /// Drop the frame packed longest ago and set idx to it.  Returns
+    /// false if none was left.
+    bool drop_oldest( size_t& idx );
+
+    /// Bytes of frames waiting to be compressed
+    size_t pending_bytes() const;
+
+    /// Totals for all caches: frames held, uncompressed to compressed
+    /// size and decompression speed in MB/s (0 if nothing was
+    /// decompressed yet)
+    static void stats( size_t& frames, double& ratio, double& mbps );
+
+  protected:
+    friend struct PackJob;
+
+    void store( const size_t idx, const image_type_ptr& pic,
+                const PackedFramePtr& packed );
+
+    static void decompressed( const size_t bytes, const double secs );
+
+  protected:
+    mutable Mutex                          _mutex;
+    std::vector< PackedFramePtr >          _frames;
+    std::map< size_t, image_type_ptr >     _pending;
+    size_t                                 _pending_bytes;
+};
+
+typedef boost::shared_ptr< PackedCache > PackedCachePtr;
+
+} // namespace mrv
+
+#endif // mrvPackedCache_h
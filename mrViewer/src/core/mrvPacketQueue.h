@@ -31,8 +31,10 @@
 #include <cassert>
 #include <iostream>
 #include <deque>
+#include <atomic>
 
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/cstdint.hpp>
 
@@ -51,6 +53,13 @@ namespace mrv {
 
 class CMedia;
 
+//
+// Packets demuxed for one kind of stream, with flush/seek/loop markers
+// in line.  This is a locked deque and not a single-producer ring:
+// markers are queued by the playback threads, the decode thread and the
+// viewer's preload (which also pops when stopped), and loop handling
+// erases packets from the middle of the queue (CMedia::loop_at_end).
+//
 class PacketQueue
 {
 private:
@@ -69,10 +78,25 @@ public:
 
     static bool inited;
 
-    inline PacketQueue() : _bytes(0)
+    inline PacketQueue() : _bytes(0), _size(0)
     {
     }
 
+    /// Returns true for the special flush/seek/loop packets and for
+    /// empty packets, which carry no data to account or unref.
+    static inline bool is_marker( const AVPacket& pkt )
+    {
+        return ( pkt.data == _flush.data ||
+                 pkt.data == _seek.data  ||
+                 pkt.data == _seek_end.data  ||
+                 pkt.data == _jump.data ||
+                 pkt.data == _preroll.data ||
+                 pkt.data == _loop_start.data ||
+                 pkt.data == _loop_end.data ||
+                 pkt.data == NULL ||
+                 pkt.size == 0 );
+    }
+
     inline Condition& cond()
     {
         return _cond;
@@ -88,10 +112,12 @@ public:
         return _packets;
     }
 
-    inline uint64_t bytes()
+    // bytes(), size() and empty() are polled by the decode thread and
+    // by the viewer's preload while the video thread holds the mutex
+    // decoding, so they are kept in atomics and read without locking.
+    inline uint64_t bytes() const
     {
-        Mutex::scoped_lock lk( _mutex );
-        return _bytes;
+        return _bytes.load( std::memory_order_acquire );
     }
 
     inline iterator begin()
@@ -167,16 +193,10 @@ public:
 
         _packets.push_back( pkt );
 
+        ++_size;
 
-        if ( pkt.data != _flush.data &&
-             pkt.data != _seek.data  &&
-             pkt.data != _seek_end.data  &&
-             pkt.data != _jump.data &&
-             pkt.data != _preroll.data &&
-             pkt.data != _loop_start.data &&
-             pkt.data != _loop_end.data &&
-             pkt.data != NULL &&
-             pkt.size != 0 )
+
+        if ( !is_marker( pkt ) )
         {
             // std::cerr << this << " #" << _packets.size()
             //          << " push back " << &pkt << " at "
@@ -210,16 +230,14 @@ public:
 
     }
 
-    inline size_t size()
+    inline size_t size() const
     {
-        Mutex::scoped_lock lk( _mutex );
-        return _packets.size();
+        return _size.load( std::memory_order_acquire );
     }
 
-    inline bool empty()
+    inline bool empty() const
     {
-        Mutex::scoped_lock lk( _mutex );
-        return _packets.empty();
+        return size() == 0;
     }
 
     inline const AVPacket& front() const
@@ -259,15 +277,7 @@ public:
 
         AVPacket& pkt = *it;
 
-        if ( pkt.data != _flush.data &&
-             pkt.data != _seek.data  &&
-             pkt.data != _seek_end.data  &&
-             pkt.data != _jump.data &&
-             pkt.data != _preroll.data &&
-             pkt.data != _loop_start.data &&
-             pkt.data != _loop_end.data &&
-             pkt.data != NULL &&
-             pkt.size !=0 )
+        if ( !is_marker( pkt ) )
         {
             // std::cerr << this << " #" << _packets.size()
             //          << " erase " << &pkt << std::endl;
@@ -289,6 +299,7 @@ public:
             av_packet_unref( &pkt );
         }
 
+        --_size;
         return _packets.erase( it );
     }
 
@@ -301,15 +312,7 @@ public:
 
         AVPacket& pkt = _packets.front();
 
-        if ( pkt.data != _flush.data &&
-             pkt.data != _seek.data  &&
-             pkt.data != _seek_end.data  &&
-             pkt.data != _jump.data &&
-             pkt.data != _preroll.data &&
-             pkt.data != _loop_start.data &&
-             pkt.data != _loop_end.data &&
-             pkt.data != NULL &&
-             pkt.size != 0 )
+        if ( !is_marker( pkt ) )
         {
 #ifdef DEBUG_PACKET_QUEUE
             std::cerr << "POP FRONT " << std::dec << pkt.stream_index
@@ -346,6 +349,7 @@ public:
         }
 
         _packets.pop_front();
+        --_size;
     }
 
 
@@ -476,6 +480,7 @@ public:
     {
         Mutex::scoped_lock lk( _mutex );
         _packets.push_back( _flush );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
         _cond.notify_one();
@@ -485,6 +490,7 @@ public:
     {
         Mutex::scoped_lock lk( _mutex );
         _packets.push_back( _jump );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
         _cond.notify_one();
@@ -495,6 +501,7 @@ public:
         Mutex::scoped_lock lk( _mutex );
         flush(pts);
         _packets.push_back( _preroll );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
         _cond.notify_one();
@@ -504,6 +511,7 @@ public:
     {
         Mutex::scoped_lock lk( _mutex );
         _packets.push_back( _loop_start );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = frame;
         _cond.notify_one();
@@ -523,6 +531,7 @@ public:
         Mutex::scoped_lock lk( _mutex );
         flush(pts);
         _packets.push_back( _seek );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
         _cond.notify_one();
@@ -532,6 +541,7 @@ public:
     {
         Mutex::scoped_lock lk( _mutex );
         _packets.push_back( _seek_end );
+        ++_size;
         AVPacket& pkt = _packets.back();
         pkt.dts = pkt.pts = pts;
         _cond.notify_one();
@@ -579,7 +589,8 @@ public:
 
 
 protected:
-    uint64_t      _bytes;
+    std::atomic<uint64_t> _bytes;  //!< bytes of data in queue
+    std::atomic<size_t>   _size;   //!< number of packets in queue
     Packets_t    _packets;
     mutable Mutex  _mutex;
     Condition       _cond;
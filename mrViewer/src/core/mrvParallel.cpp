@@ -0,0 +1,232 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvParallel.cpp
+ * @author gga
+ * @date   Sun Oct 18 19:48:03 2026
+ *
+ * @brief  Split a loop over several threads.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "core/mrvParallel.h"
+
+namespace mrv {
+
+struct ParallelLoop
+{
+    typedef boost::function< void( size_t, size_t ) > Function;
+
+    ParallelLoop( size_t b, size_t e, size_t g, const Function& f ) :
+        begin( b ), end( e ), grain( g ), fn( f ), next( 0 ), failed( false ),
+        wanted( 0 ), helpers( 0 )
+    {
+        chunks = ( end - begin + grain - 1 ) / grain;
+    }
+
+    void run()
+    {
+        while ( !failed )
+        {
+            size_t c = next++;
+            if ( c >= chunks ) break;
+
+            size_t first = begin + c * grain;
+            size_t last  = std::min( first + grain, end );
+            try
+            {
+                fn( first, last );
+            }
+            catch( ... )
+            {
+                boost::mutex::scoped_lock lk( mtx );
+                if ( !failed ) error = std::current_exception();
+                failed = true;
+            }
+        }
+    }
+
+    size_t              begin;
+    size_t              end;
+    size_t              grain;
+    size_t              chunks;
+    const Function&     fn;
+    std::atomic<size_t> next;
+    std::atomic<bool>   failed;
+    std::exception_ptr  error;
+    boost::mutex        mtx;
+    size_t              wanted;   //!< pool threads to join, under Pool::mtx
+    size_t              helpers;  //!< pool threads in run(), under Pool::mtx
+};
+
+} // namespace mrv
+
+namespace {
+
+using mrv::ParallelLoop;
+
+//
+// Threads kept for the life of the program, so a loop does not pay for
+// starting and joining threads each time.  Each loop is offered to as
+// many of them as it wants; the thread that called parallel_for works
+// through it as well, so nested or concurrent loops always finish even
+// when every thread of the pool is busy.
+//
+class Pool
+{
+  public:
+    Pool( const unsigned n )
+    {
+        for ( unsigned i = 0; i < n; ++i )
+        {
+            boost::thread t( boost::bind( &Pool::worker, this ) );
+            t.detach();
+        }
+    }
+
+    void post( ParallelLoop* loop, const size_t n )
+    {
+        boost::mutex::scoped_lock lk( mtx );
+        loop->wanted = n;
+        loops.push_back( loop );
+        work.notify_all();
+    }
+
+    // Stop offering loop and wait for the threads that joined it
+    void finish( ParallelLoop* loop )
+    {
+        boost::mutex::scoped_lock lk( mtx );
+        std::deque< ParallelLoop* >::iterator i =
+            std::find( loops.begin(), loops.end(), loop );
+        if ( i != loops.end() ) loops.erase( i );
+        while ( loop->helpers > 0 ) done.wait( lk );
+    }
+
+  protected:
+    void worker()
+    {
+        for (;;)
+        {
+            ParallelLoop* loop;
+            {
+                boost::mutex::scoped_lock lk( mtx );
+                while ( loops.empty() ) work.wait( lk );
+                loop = loops.front();
+                ++loop->helpers;
+                if ( --loop->wanted == 0 ) loops.pop_front();
+            }
+
+            loop->run();
+
+            boost::mutex::scoped_lock lk( mtx );
+            if ( --loop->helpers == 0 ) done.notify_all();
+        }
+    }
+
+    boost::mutex              mtx;
+    boost::condition_variable work;
+    boost::condition_variable done;
+    std::deque< ParallelLoop* >       loops;
+};
+
+void run_task( const mrv::ParallelTask::Function& fn, size_t, size_t )
+{
+    fn();
+}
+
+// Never destroyed, as its threads run until the program exits
+Pool* pool()
+{
+    static Pool* p = new Pool( mrv::parallel_threads() - 1 );
+    return p;
+}
+
+}
+
+namespace mrv {
+
+unsigned parallel_threads()
+{
+    unsigned n = boost::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+void parallel_for( const size_t begin, const size_t end, const size_t grain,
+                   const boost::function< void( size_t, size_t ) >& fn )
+{
+    if ( end <= begin ) return;
+
+    ParallelLoop loop( begin, end, std::max( grain, size_t(1) ), fn );
+
+    size_t threads = std::min( size_t( parallel_threads() ), loop.chunks );
+    if ( threads <= 1 )
+    {
+        fn( begin, end );
+        return;
+    }
+
+    Pool* p = pool();
+    p->post( &loop, threads - 1 );
+    loop.run();
+    p->finish( &loop );
+
+    if ( loop.error ) std::rethrow_exception( loop.error );
+}
+
+ParallelTask::ParallelTask( const Function& fn ) :
+    _fn( boost::bind( run_task, fn, _1, _2 ) ),
+    _loop( new ParallelLoop( 0, 1, 1, _fn ) ),
+    _waited( false )
+{
+    pool()->post( _loop, 1 );
+}
+
+ParallelTask::~ParallelTask()
+{
+    try
+    {
+        wait();
+    }
+    catch( ... )
+    {
+    }
+    delete _loop;
+}
+
+void ParallelTask::wait()
+{
+    if ( _waited ) return;
+
+    _loop->run();
+    pool()->finish( _loop );
+    _waited = true;
+
+    if ( _loop->error ) std::rethrow_exception( _loop->error );
+}
+
+} // namespace mrv
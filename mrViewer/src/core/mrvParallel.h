@@ -0,0 +1,78 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvParallel.h
+ * @author gga
+ * @date   Sun Oct 18 19:48:03 2026
+ *
+ * @brief  Split a loop over several threads.
+ *
+ */
+
+#ifndef mrvParallel_h
+#define mrvParallel_h
+
+#include <cstddef>
+
+#include <boost/function.hpp>
+
+namespace mrv {
+
+/// Threads parallel_for uses at most (one per core)
+unsigned parallel_threads();
+
+//
+// Call fn( first, last ) for consecutive ranges of at most grain items
+// covering [begin, end).  The calling thread works too and returns once
+// all ranges are done.  If fn throws, the remaining ranges are skipped
+// and the first exception is rethrown in the calling thread.
+//
+void parallel_for( const size_t begin, const size_t end, const size_t grain,
+                   const boost::function< void( size_t, size_t ) >& fn );
+
+struct ParallelLoop;
+
+//
+// Run fn on a thread of the parallel_for pool while the caller goes on.
+// wait() returns once it ran, running it in the calling thread if no
+// thread of the pool took it, and rethrows what it threw.  The
+// destructor waits too.
+//
+class ParallelTask
+{
+  public:
+    typedef boost::function< void() > Function;
+
+  public:
+    ParallelTask( const Function& fn );
+    ~ParallelTask();
+
+    void wait();
+
+  protected:
+    ParallelTask( const ParallelTask& b );
+    ParallelTask& operator=( const ParallelTask& b );
+
+    boost::function< void( size_t, size_t ) > _fn;
+    ParallelLoop* _loop;
+    bool          _waited;
+};
+
+} // namespace mrv
+
+#endif // mrvParallel_h
@@ -1108,6 +1108,8 @@ void video_thread( PlaybackData* data )
         if ( step == 0 ) break;
 
 
+        int64_t started = av_gettime_relative();
+
         CMedia::DecodeStatus status = img->decode_video( frame );
 
         int64_t first, last;
@@ -1317,6 +1319,10 @@ void video_thread( PlaybackData* data )
             LOG_ERROR( _("Could not find image ") << frame );
         }
 
+        // Let the governor know how long this frame took to get ready
+        if ( fg && img->is_left_eye() )
+            view->governor().decode_time( av_gettime_relative() - started );
+
 
         if ( reel->edl && fg && img->is_left_eye() )
         {
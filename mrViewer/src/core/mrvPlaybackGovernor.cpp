@@ -0,0 +1,185 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPlaybackGovernor.cpp
+ * @author gga
+ * @date   Sun Oct 18 19:02:15 2026
+ *
+ * @brief  Lowers playback quality in steps when frames cannot be decoded
+ *         and drawn in time, and raises it back when they can.
+ *
+ */
+
+#include <algorithm>
+
+#include "gui/mrvIO.h"
+#include "core/mrvPlaybackGovernor.h"
+
+namespace {
+
+const char* kModule = "governor";
+
+// Weight of a new sample in the smoothed costs
+const double kSmoothing = 0.15;
+
+// Frames decoded at a tier before judging it
+const unsigned kMinSamples = 8;
+
+// Over this fraction of the frame period drop a tier
+const double kOverBudget = 1.1;
+
+// Under this fraction of the frame period climb a tier.  Each tier
+// roughly halves or quarters the cost, so leave plenty of room.
+const double kUnderBudget = 0.35;
+
+// Minimum time between two drops
+const int64_t kDropWait = 500000;
+
+// Time under budget before climbing, and its limit after backing off
+const int64_t kClimbHold = 2000000;
+const int64_t kMaxClimbHold = 16000000;
+
+}
+
+namespace mrv {
+
+PlaybackGovernor::PlaybackGovernor() :
+_budget( 41666 ),
+_decode( 0.0 ),
+_draw( 0.0 ),
+_samples( 0 ),
+_changed( 0 ),
+_hold( kClimbHold ),
+_under( 0 ),
+_climbed( false ),
+_tier( kFull )
+{
+}
+
+PlaybackGovernor::~PlaybackGovernor()
+{
+}
+
+void PlaybackGovernor::start( const double fps )
+{
+    SCOPED_LOCK( _mutex );
+    _budget = fps > 0.0 ? int64_t( 1000000.0 / fps ) : 41666;
+    _decode = _draw = 0.0;
+    _samples = 0;
+    _under = 0;
+}
+
+void PlaybackGovernor::reset()
+{
+    SCOPED_LOCK( _mutex );
+    _decode = _draw = 0.0;
+    _samples = 0;
+    _changed = 0;
+    _hold = kClimbHold;
+    _under = 0;
+    _climbed = false;
+    _tier = kFull;
+}
+
+void PlaybackGovernor::decode_time( const int64_t us )
+{
+    SCOPED_LOCK( _mutex );
+    if ( _samples == 0 ) _decode = double(us);
+    else _decode += kSmoothing * ( double(us) - _decode );
+    ++_samples;
+}
+
+void PlaybackGovernor::draw_time( const int64_t us )
+{
+    SCOPED_LOCK( _mutex );
+    if ( _draw == 0.0 ) _draw = double(us);
+    else _draw += kSmoothing * ( double(us) - _draw );
+}
+
+int64_t PlaybackGovernor::cost() const
+{
+    SCOPED_LOCK( _mutex );
+    // Decoding and drawing run in different threads, so a frame costs
+    // whichever of the two is slower, not their sum.
+    return int64_t( std::max( _decode, _draw ) );
+}
+
+bool PlaybackGovernor::update( const int64_t now )
+{
+    SCOPED_LOCK( _mutex );
+    if ( _samples < kMinSamples ) return false;
+
+    double c = std::max( _decode, _draw );
+
+    if ( c > kOverBudget * _budget )
+    {
+        _under = 0;
+        if ( _tier == kLastTier || now - _changed < kDropWait ) return false;
+
+        // Climbed into a tier that cannot keep up.  Be slower to try again.
+        if ( _climbed && now - _changed < _hold )
+            _hold = std::min( 2 * _hold, kMaxClimbHold );
+
+        _tier = Tier( _tier + 1 );
+        _climbed = false;
+    }
+    else if ( c < kUnderBudget * _budget && _tier != kFull )
+    {
+        if ( _under == 0 ) _under = now;
+        if ( now - _under < _hold ) return false;
+
+        _tier = Tier( _tier - 1 );
+        _climbed = true;
+    }
+    else
+    {
+        _under = 0;
+        return false;
+    }
+
+    LOG_INFO( _("Playback quality ") << tier_name( _tier )
+              << _(" - frame cost ") << int64_t(c) / 1000
+              << _(" ms of ") << _budget / 1000 << " ms" );
+
+    // Measure the new tier from scratch
+    _changed = now;
+    _decode = _draw = 0.0;
+    _samples = 0;
+    _under = 0;
+    return true;
+}
+
+unsigned PlaybackGovernor::proxy_level() const
+{
+    return std::min( unsigned(_tier), unsigned(kEighth) );
+}
+
+const char* PlaybackGovernor::tier_name( const int t )
+{
+    static const char* names[] = {
+        N_("Full"),
+        N_("Half"),
+        N_("Quarter"),
+        N_("Eighth"),
+        N_("Eighth 8-bit"),
+    };
+    if ( t < 0 || t > kLastTier ) return "?";
+    return _( names[t] );
+}
+
+} // namespace mrv
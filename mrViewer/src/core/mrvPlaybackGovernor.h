@@ -0,0 +1,114 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPlaybackGovernor.h
+ * @author gga
+ * @date   Sun Oct 18 19:02:15 2026
+ *
+ * @brief  Lowers playback quality in steps when frames cannot be decoded
+ *         and drawn in time, and raises it back when they can.
+ *
+ */
+
+#ifndef mrvPlaybackGovernor_h
+#define mrvPlaybackGovernor_h
+
+#include <inttypes.h>
+
+#include <boost/thread/recursive_mutex.hpp>
+
+#include "mrvThread.h"
+
+namespace mrv {
+
+//
+// The video threads report how long each frame took to decode and the
+// view reports how long each frame took to upload and draw.  Both are
+// smoothed and compared against the frame period.  When the cost stays
+// over budget the governor drops one tier; when it stays well under
+// budget for a while it climbs one tier back.  A climb that is quickly
+// undone makes the next climb wait twice as long, so a clip that sits
+// right at the limit does not flicker between tiers.
+//
+// All times are in microseconds.
+//
+class PlaybackGovernor
+{
+  public:
+    typedef boost::recursive_mutex Mutex;
+
+    enum Tier
+    {
+        kFull    = 0,  //!< full resolution, user's cache settings
+        kHalf    = 1,  //!< half resolution proxy or mipmap
+        kQuarter = 2,  //!< quarter resolution
+        kEighth  = 3,  //!< eighth resolution
+        kEightBit = 4, //!< eighth resolution and 8-bit cache
+        kLastTier = kEightBit
+    };
+
+  public:
+    PlaybackGovernor();
+    ~PlaybackGovernor();
+
+    /// Start measuring for playback at fps.  Keeps the current tier.
+    void start( const double fps );
+
+    /// Forget measurements and go back to full quality
+    void reset();
+
+    /// Cost of decoding one frame (video threads)
+    void decode_time( const int64_t us );
+
+    /// Cost of uploading and drawing one frame (view)
+    void draw_time( const int64_t us );
+
+    /// Re-evaluate the tier at time now.  Returns true if it changed.
+    bool update( const int64_t now );
+
+    /// Current tier
+    Tier tier() const { return _tier; }
+
+    /// Resolution reduction (as in CMedia::proxy_level) for current tier
+    unsigned proxy_level() const;
+
+    /// Whether current tier wants 8-bit caches
+    bool eight_bit() const { return _tier >= kEightBit; }
+
+    /// Smoothed cost of a frame
+    int64_t cost() const;
+
+    /// Name of tier for display
+    static const char* tier_name( const int t );
+
+  protected:
+    mutable Mutex _mutex;
+    int64_t       _budget;    //!< frame period
+    double        _decode;    //!< smoothed decode time
+    double        _draw;      //!< smoothed draw time
+    unsigned      _samples;   //!< decode samples since last change
+    int64_t       _changed;   //!< time of last tier change
+    int64_t       _hold;      //!< time under budget needed to climb
+    int64_t       _under;     //!< start of current run under budget
+    bool          _climbed;   //!< last change was a climb
+    Tier          _tier;
+};
+
+} // namespace mrv
+
+#endif // mrvPlaybackGovernor_h
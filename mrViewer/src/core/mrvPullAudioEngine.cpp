@@ -0,0 +1,227 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPullAudioEngine.cpp
+ * @author gga
+ * @date   Sun Oct 18 16:41:12 2026
+ *
+ * @brief  Base class for audio engines whose device pulls samples from
+ *         a mixer instead of being pushed to.
+ *
+ */
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "gui/mrvIO.h"
+#include "core/mrvPullAudioEngine.h"
+
+namespace {
+const char* kModule = "audio";
+}
+
+namespace mrv {
+
+const double PullAudioEngine::kRingSeconds = 0.25;
+
+// Give up on a write after the sink stopped draining for this long,
+// so a stalled device cannot hang the audio thread.
+static const double kStallSeconds = 1.0;
+
+PullAudioEngine::PullAudioEngine() :
+    AudioEngine(),
+    _source( -1 ),
+    _frequency( 0 ),
+    _primed( false ),
+    _pushed( 0 ),
+    _pulled( 0 ),
+    _underruns( 0 ),
+    _writer( NULL ),
+    _writing( false )
+{
+}
+
+PullAudioEngine::~PullAudioEngine()
+{
+    // Derived engines close first; name() is gone by now, so no stats.
+    if ( _source >= 0 ) _mixer.remove_source( _source );
+}
+
+bool PullAudioEngine::open_ring( const unsigned channels,
+                                 const unsigned frequency,
+                                 const AudioFormat format )
+{
+    close_ring();
+
+    _mixer.format( format, channels );
+    _mixer.volume( _volume );
+
+    size_t bytes = size_t( frequency * kRingSeconds ) * _mixer.frame_size();
+    _source = _mixer.add_source( bytes );
+    if ( _source < 0 ) return false;
+
+    _frequency = frequency;
+    _channels = channels;
+    _audio_format = format;
+    _primed = false;
+    _pushed = _pulled = _underruns = 0;
+    return true;
+}
+
+void PullAudioEngine::close_ring()
+{
+    if ( _source < 0 ) return;
+
+    log_stats();
+    _mixer.remove_source( _source );
+    _source = -1;
+}
+
+void PullAudioEngine::start_writer( const size_t period )
+{
+    stop_writer();
+
+    _period.resize( period );
+    _mixer.period( period );
+
+    _writing = true;
+    _writer = new boost::thread( boost::bind( &PullAudioEngine::writer,
+                                              this ) );
+}
+
+void PullAudioEngine::stop_writer()
+{
+    if ( !_writer ) return;
+
+    _writing = false;
+    _writer->join();
+    delete _writer;
+    _writer = NULL;
+}
+
+bool PullAudioEngine::write_period( const char* data, const size_t bytes )
+{
+    return false;
+}
+
+void PullAudioEngine::writer()
+{
+    const size_t bytes = _period.size();
+    while ( _writing )
+    {
+        // When starved this is silence, which keeps the device running
+        // the way a callback driven one does.
+        pull( &_period[0], bytes );
+        if ( !write_period( &_period[0], bytes ) )
+        {
+            LOG_ERROR( name() << _(": could not write to audio device") );
+            _enabled = false;
+            break;
+        }
+    }
+}
+
+bool PullAudioEngine::play( const char* data, const size_t size )
+{
+    if ( !_enabled || _source < 0 ) return true;
+
+    AudioRing* ring = _mixer.source( _source );
+
+    const double bytes_per_sec = double(_frequency) * _mixer.frame_size();
+    double stalled = 0.0;
+    size_t done = 0;
+    while ( done < size && _enabled )
+    {
+        size_t n = ring->write( data + done, size - done );
+        done += n;
+        _pushed += n;
+        if ( done == size ) break;
+
+        if ( n > 0 ) stalled = 0.0;
+
+        // Sleep roughly as long as the sink needs to make room for the
+        // rest, but wake up often enough to notice a close().
+        double wait = double( size - done ) / bytes_per_sec;
+        if ( wait > 0.01 ) wait = 0.01;
+        if ( wait < 0.001 ) wait = 0.001;
+        stalled += wait;
+        if ( stalled > kStallSeconds )
+        {
+            LOG_WARNING( name() << _(": audio sink stalled, dropped ")
+                         << size - done << _(" bytes") );
+            break;
+        }
+        boost::this_thread::sleep( boost::posix_time::microseconds(
+                                       int64_t( wait * 1000000.0 ) ) );
+    }
+
+    _primed = true;
+    return true;
+}
+
+size_t PullAudioEngine::pull( char* out, const size_t bytes )
+{
+    size_t got = _mixer.mix( out, bytes );
+    _pulled += got;
+
+    // Running dry before anything was queued, or after a flush, is just
+    // silence.  Running dry mid-stream is what the user hears as a click.
+    if ( got < bytes && _primed && _mixer.sources() > 0 )
+    {
+        ++_underruns;
+        _primed = false;
+    }
+
+    return got;
+}
+
+double PullAudioEngine::latency() const
+{
+    if ( _source < 0 || _frequency == 0 ) return 0.0;
+    AudioMixer& m = const_cast< AudioMixer& >( _mixer );
+    return double( m.source( _source )->available() ) /
+           ( double(_frequency) * m.frame_size() );
+}
+
+float PullAudioEngine::volume() const
+{
+    return _volume;
+}
+
+void PullAudioEngine::volume( float v )
+{
+    _volume = v;
+    _mixer.volume( v );
+}
+
+void PullAudioEngine::flush()
+{
+    if ( _source < 0 ) return;
+    _mixer.source( _source )->clear();
+    _primed = false;
+}
+
+void PullAudioEngine::log_stats()
+{
+    if ( _pushed == 0 ) return;
+    LOG_INFO( name() << _(": queued ") << _pushed << _(" bytes, played ")
+              << _pulled << _(" bytes, ") << _underruns
+              << _(" underruns") );
+}
+
+} // namespace mrv
@@ -0,0 +1,120 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvPullAudioEngine.h
+ * @author gga
+ * @date   Sun Oct 18 16:41:12 2026
+ *
+ * @brief  Base class for audio engines whose device pulls samples from
+ *         a mixer instead of being pushed to.
+ *
+ */
+
+#ifndef mrvPullAudioEngine_h
+#define mrvPullAudioEngine_h
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "core/mrvAudioEngine.h"
+#include "core/mrvAudioMixer.h"
+
+namespace mrv {
+
+//
+// play() copies the decoded PCM into this engine's mixer source and
+// returns as soon as it fits, so the audio thread is only held back when
+// more than kRingSeconds of audio is already queued.  Derived engines
+// call pull() from their device callback (or sink thread) to get the
+// mixed samples.  A short pull after audio started flowing is counted
+// as an underrun.  Devices that are fed by blocking writes instead of
+// a callback (ALSA, AO, Wave) start a writer thread that pulls one
+// period at a time and passes it to write_period().
+//
+class PullAudioEngine : public AudioEngine
+{
+  public:
+    /// Seconds of audio buffered between play() and the device
+    static const double kRingSeconds;
+
+  public:
+    PullAudioEngine();
+    virtual ~PullAudioEngine();
+
+    virtual bool play( const char* data, const size_t size );
+
+    virtual float volume() const;
+    virtual void volume( float f );
+
+    virtual void flush();
+
+    /// Device side.  Always fills bytes, with silence if starved.
+    size_t pull( char* out, const size_t bytes );
+
+    inline AudioMixer& mixer() { return _mixer; }
+
+    inline unsigned frequency() const { return _frequency; }
+
+    inline uint64_t underruns() const { return _underruns; }
+    inline uint64_t bytes_played() const { return _pulled; }
+
+    /// Seconds of audio queued but not yet pulled
+    double latency() const;
+
+  protected:
+    /// Set up the mixer and our source for a new stream
+    bool open_ring( const unsigned channels, const unsigned frequency,
+                    const AudioFormat format );
+    void close_ring();
+
+    /// Start the writer thread, pulling period bytes at a time.  Also
+    /// sizes the mixer for them.
+    void start_writer( const size_t period );
+
+    /// Stop the writer thread.  Derived engines call it in close(),
+    /// before letting go of their device.
+    void stop_writer();
+
+    /// Writer thread side.  Blocks until the device took bytes of data.
+    /// Returns false on an error the device cannot recover from, which
+    /// stops the thread.
+    virtual bool write_period( const char* data, const size_t bytes );
+
+    void writer();
+
+    void log_stats();
+
+  protected:
+    AudioMixer             _mixer;
+    int                    _source;
+    unsigned               _frequency;
+    std::atomic<bool>      _primed;
+    std::atomic<uint64_t>  _pushed;
+    std::atomic<uint64_t>  _pulled;
+    std::atomic<uint64_t>  _underruns;
+    boost::thread*         _writer;
+    std::atomic<bool>      _writing;
+    std::vector< char >    _period;     //!< written by _writer
+};
+
+} // namespace mrv
+
+#endif // mrvPullAudioEngine_h
@@ -43,6 +43,7 @@
 #include <iostream>
 #include <fstream>
 #include <set>
+#include <sstream>
 
 #include <boost/locale.hpp>
 #include <boost/thread.hpp>
@@ -59,6 +60,8 @@
 #include <boost/asio/write.hpp>
 #include <boost/asio.hpp>
 
+#include <FL/Fl.H>
+
 #include <ImfStandardAttributes.h>
 #include <ImfVecAttribute.h>
 #include <ImfIntAttribute.h>
@@ -90,6 +93,73 @@ using boost::asio::ip::tcp;
 
 namespace {
 const char* const kModule = "parser";
+
+// Commands that carry absolute state.  Only the last one queued in a
+// time slice is sent.
+const char* kCoalescable[] = {
+    "Zoom",
+    "Offset",
+    "MovePicture",
+    "ScalePicture",
+    "Rotation",
+    "Spin",
+    "Selection",
+    "Gain",
+    "Gamma",
+    "Volume",
+    "AudioVolume",
+    "VRangle",
+    "seek",
+    NULL
+};
+
+// Time slice over which coalescable commands are gathered
+const boost::posix_time::milliseconds kCoalesceSlice( 16 );
+
+// Maximum size of a packet of batched messages
+const size_t kMaxPacketSize = 65536;
+
+inline std::string command_name( const std::string& m )
+{
+    return m.substr( 0, m.find_first_of( " \n" ) );
+}
+
+// Points of a stroke a peer is drawing, added by the interface thread
+struct PathPoints
+{
+    mrv::ImageView* view;
+    unsigned        stroke;
+    std::string     points;
+};
+
+void append_path_points( void* data )
+{
+    PathPoints* p = (PathPoints*) data;
+
+    mrv::media fg = p->view->foreground();
+    if ( fg )
+    {
+        // Most likely the last shape, unless a peer drew meanwhile
+        const mrv::GLShapeList& shapes = fg->image()->shapes();
+        mrv::GLShapeList::const_reverse_iterator i = shapes.rbegin();
+        mrv::GLShapeList::const_reverse_iterator e = shapes.rend();
+        for ( ; i != e; ++i )
+        {
+            mrv::GLPathShape* s =
+                dynamic_cast< mrv::GLPathShape* >( (*i).get() );
+            if ( !s || s->stroke != p->stroke ) continue;
+
+            std::istringstream is( p->points );
+            is.imbue( std::locale() );
+            s->receive_points( is );
+            p->view->redraw();
+            break;
+        }
+    }
+
+    delete p;
+}
+
 }
 
 
@@ -104,7 +174,13 @@ Parser::Parser( boost::asio::io_service& io_service, ViewerUI* v ) :
     socket_( io_service ),
     ui( v ),
     deadline_(io_service),
-    non_empty_output_queue_(io_service)
+    non_empty_output_queue_(io_service),
+    next_slice_( boost::posix_time::neg_infin ),
+    messages_( 0 ),
+    coalesced_( 0 ),
+    urgent_( 0 ),
+    packets_( 0 ),
+    bytes_( 0 )
 {
 }
 
@@ -112,6 +188,121 @@ Parser::~Parser()
 {
 }
 
+bool Parser::urgent( const std::string& cmd )
+{
+    return cmd == N_("ClockPing") || cmd == N_("ClockPong");
+}
+
+bool Parser::coalescable( const std::string& cmd )
+{
+    for ( const char** c = kCoalescable; *c; ++c )
+    {
+        if ( cmd == *c ) return true;
+    }
+    return false;
+}
+
+deadline_timer::time_type Parser::enqueue( const std::string& m )
+{
+    SCOPED_LOCK( mtx );
+
+    ++messages_;
+
+    deadline_timer::time_type now = deadline_timer::traits_type::now();
+    std::string cmd = command_name( m );
+
+    // Clock pings carry the time they were sent at.  They go ahead of
+    // everything else and are never held, so the offset estimate is not
+    // skewed by the coalescing slice.
+    if ( urgent( cmd ) )
+    {
+        output_queue_.insert( output_queue_.begin() + urgent_, m + "\n" );
+        ++urgent_;
+        return now;
+    }
+
+    // Coalescable commands set an absolute state, so a queued one of the
+    // same command is replaced where it is.  It keeps its place among
+    // others, like a Zoom and an Offset sent interleaved.
+    bool replaced = false;
+    if ( coalescable( cmd ) )
+    {
+        std::deque< std::string >::iterator i = output_queue_.begin() +
+                                                urgent_;
+        std::deque< std::string >::iterator e = output_queue_.end();
+        for ( ; i != e; ++i )
+        {
+            if ( command_name( *i ) == cmd )
+            {
+                *i = m + "\n";
+                ++coalesced_;
+                replaced = true;
+                break;
+            }
+        }
+    }
+
+    if ( !replaced ) output_queue_.push_back( m + "\n" );
+
+    if ( Preferences::debug && ( messages_ % 1000 ) == 0 )
+        log_stats();
+
+    return next_slice_ > now ? next_slice_ : now;
+}
+
+bool Parser::build_packet()
+{
+    SCOPED_LOCK( mtx );
+
+    packet_.clear();
+
+    // Within a slice only clock pings go out
+    size_t n = output_queue_.size();
+    if ( throttled_slice() ) n = urgent_;
+
+    bool slice = false;
+    for ( ; n > 0; --n )
+    {
+        const std::string& m = output_queue_.front();
+        if ( !packet_.empty() && packet_.size() + m.size() > kMaxPacketSize )
+            break;
+        if ( coalescable( command_name( m ) ) ) slice = true;
+        packet_ += m;
+        output_queue_.pop_front();
+        if ( urgent_ > 0 ) --urgent_;
+    }
+
+    if ( packet_.empty() ) return false;
+
+    ++packets_;
+    bytes_ += packet_.size();
+
+    // Hold further coalescable commands until the slice ends, so only
+    // the latest of them goes in the next packet.
+    if ( slice )
+        next_slice_ = deadline_timer::traits_type::now() + kCoalesceSlice;
+
+    return true;
+}
+
+bool Parser::throttled_slice() const
+{
+    return next_slice_ > deadline_timer::traits_type::now();
+}
+
+bool Parser::throttled() const
+{
+    return urgent_ == 0 && throttled_slice();
+}
+
+void Parser::log_stats() const
+{
+    LOG_CONN( _("Messages sent: ") << messages_ - coalesced_
+              << _(" coalesced: ") << coalesced_
+              << _(" packets: ") << packets_
+              << _(" bytes: ") << bytes_ );
+}
+
 void Parser::write( const std::string& s, const std::string& id )
 {
     if ( !connected || !ui || !ui->uiView ) {
@@ -230,6 +421,50 @@ bool Parser::parse( const std::string& s )
         v->redraw();
         ok = true;
     }
+    else if ( cmd == N_("GLPathShapeD") )
+    {
+        std::string points;
+        GLPathShape* shape = new GLPathShape;
+        std::getline( is, points );
+        is.str( points );
+        is.clear();
+        is >> shape->stroke >> shape->r >> shape->g >> shape->b >> shape->a
+           >> shape->pen_size >> shape->frame;
+        shape->receive_points( is );
+        v->add_shape( mrv::shape_type_ptr(shape) );
+        v->redraw();
+        ok = true;
+    }
+    else if ( cmd == N_("GLErasePathShapeD") )
+    {
+        std::string points;
+        GLErasePathShape* shape = new GLErasePathShape;
+        std::getline( is, points );
+        is.str( points );
+        is.clear();
+        is >> shape->stroke >> shape->pen_size >> shape->frame;
+        shape->receive_points( is );
+        v->add_shape( mrv::shape_type_ptr(shape) );
+        v->redraw();
+        ok = true;
+    }
+    else if ( cmd == N_("GLPathShapeAppend") )
+    {
+        // More points of the stroke a peer is drawing.  The shapes
+        // are drawn from, so they are changed in the interface thread.
+        PathPoints* p = new PathPoints;
+        p->view = v;
+        if ( is >> p->stroke )
+        {
+            std::getline( is, p->points );
+            Fl::awake( append_path_points, p );
+            ok = true;
+        }
+        else
+        {
+            delete p;
+        }
+    }
     else if ( cmd == N_("GLErasePathShape") )
     {
         Point xy;
@@ -1295,7 +1530,7 @@ bool Parser::parse( const std::string& s )
                 mrv::GLShapeList::const_iterator e = shapes.end();
                 for ( ; k != e; ++k )
                 {
-                    std::string s = (*k)->send();
+                    std::string s = (*k)->network_message();
                     deliver( s );
                 }
 
@@ -1506,6 +1741,32 @@ bool Parser::parse( const std::string& s )
         v->commands.push_back( c );
         ok = true;
     }
+    else if ( cmd == N_("PlayAt") )
+    {
+        int64_t start, f;
+        double fps;
+        is >> start >> f >> fps;
+
+        ImageView::Command c;
+        c.type = ImageView::kPlayAt;
+        c.frame = f;
+        c.data = new Imf::V2dAttribute( Imath::V2d( double(start), fps ) );
+        v->commands.push_back( c );
+
+        ok = true;
+    }
+    else if ( cmd == N_("QualityTier") )
+    {
+        int tier;
+        is >> tier;
+
+        ImageView::Command c;
+        c.type = ImageView::kQualityTier;
+        c.data = new Imf::IntAttribute( tier );
+        v->commands.push_back( c );
+
+        ok = true;
+    }
     else if ( cmd == N_("playback") )
     {
         ImageView::Command c;
@@ -1762,16 +2023,18 @@ void tcp_session::deliver( const std::string& msg )
             LOG_INFO( "SEND CMD: " << msg );
 #endif
 
-    output_queue_.push_back(msg + "\n");
+    deadline_timer::time_type t = enqueue( msg );
 
     // Signal that the output queue contains messages. Modifying the expiry
     // will wake the output actor, if it is waiting on the timer.
-    non_empty_output_queue_.expires_from_now(boost::posix_time::seconds(0));
+    non_empty_output_queue_.expires_at( t );
 }
 
 
 void tcp_session::stop()
 {
+    if ( connected ) log_stats();
+
     connected = false;
 
     deadline_.cancel();
@@ -1849,6 +2112,20 @@ void tcp_session::handle_read(const boost::system::error_code& ec)
                 {
                     LOG_CONN( N_("Not OK") );
                 }
+                else if ( msg.compare( 0, 9, N_("ClockPing") ) == 0 )
+                {
+                    // Answer clock pings directly.  They are not
+                    // broadcast to the other clients.
+                    int64_t t1 = ClockSync::now();
+                    std::istringstream ps( msg.substr( 9 ) );
+                    int64_t t0 = 0;
+                    ps >> t0;
+                    char buf[128];
+                    sprintf( buf, N_("ClockPong %" PRId64 " %" PRId64
+                                     " %" PRId64), t0, t1,
+                             ClockSync::now() );
+                    deliver( buf );
+                }
                 else if ( parse( msg ) )
                 {
                     // send message to all clients
@@ -1899,6 +2176,15 @@ void tcp_session::await_output()
                             shared_from_this())
             );
         }
+        else if ( throttled() )
+        {
+            // Wait for the coalescing time slice to end.
+            non_empty_output_queue_.expires_at( next_slice_ );
+            non_empty_output_queue_.async_wait(
+                boost::bind(&tcp_session::await_output,
+                            shared_from_this())
+            );
+        }
         else
         {
             start_write();
@@ -1914,9 +2200,15 @@ void tcp_session::start_write()
 {
     SCOPED_LOCK( mtx );
 
-    // Start an asynchronous operation to send a message.
+    if ( !build_packet() )
+    {
+        await_output();
+        return;
+    }
+
+    // Start an asynchronous operation to send all queued messages.
     boost::asio::async_write(socket(),
-                             boost::asio::buffer(output_queue_.front()),
+                             boost::asio::buffer(packet_),
                              boost::bind(&tcp_session::handle_write,
                                          shared_from_this(),
                                          boost::asio::placeholders::error));
@@ -1929,7 +2221,10 @@ void tcp_session::handle_write(const boost::system::error_code& ec)
 
     if (!ec)
     {
-        output_queue_.pop_front();
+        {
+            SCOPED_LOCK( mtx );
+            packet_.clear();
+        }
 
         await_output();
     }
@@ -37,6 +37,7 @@
 #include <boost/asio/write.hpp>
 #include <boost/asio.hpp>
 
+#include "core/mrvClockSync.h"
 #include "gui/mrvReel.h"
 
 class ViewerUI;
@@ -71,6 +72,32 @@ class Parser
     virtual void deliver( const std::string& m ) = 0;
     virtual void stop() = 0;
 
+    /// Whether only the last message of command cmd needs to be sent
+    static bool coalescable( const std::string& cmd );
+
+    /// Whether cmd is sent at once, ahead of other messages and outside
+    /// the coalescing slice (clock pings).
+    static bool urgent( const std::string& cmd );
+
+    /// Queue a message for sending, replacing in place a queued message
+    /// of the same coalescable command.  Returns the time the output
+    /// actor should wake at to send it.
+    deadline_timer::time_type enqueue( const std::string& m );
+
+    /// Move queued messages into a single packet to write.  Returns
+    /// false if there is nothing to send.
+    bool build_packet();
+
+    /// Whether output is being held until the current time slice ends.
+    /// Never while urgent messages wait.
+    bool throttled() const;
+
+    /// Whether the current time slice has not ended
+    bool throttled_slice() const;
+
+    /// Log messages sent vs. coalesced
+    void log_stats() const;
+
 
   public:
     bool connected;
@@ -83,6 +110,14 @@ class Parser
     deadline_timer deadline_;
     deadline_timer non_empty_output_queue_;
     std::deque< std::string > output_queue_;
+    std::string packet_;    //!< batch of messages being written
+    deadline_timer::time_type next_slice_; //!< end of coalescing slice
+    uint64_t messages_;     //!< messages queued
+    uint64_t coalesced_;    //!< messages replaced by a later one
+    size_t   urgent_;       //!< urgent messages at the front of the queue
+    uint64_t packets_;      //!< packets written
+    uint64_t bytes_;        //!< bytes written
+    ClockSync clock;   //!< offset/latency to the server's clock
 };
 
 
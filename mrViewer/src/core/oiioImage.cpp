@@ -333,12 +333,57 @@ bool oiioImage::fetch( mrv::image_type_ptr& canvas, const boost::int64_t frame )
         return false;
     }
 
-    if ( allocate_pixels( canvas, frame, channels, type, pixel_type, dw, dh ) )
+    // Zoomed in on a very large image, read only what is shown.
+    // Scanline files are read in whole lines, tiled files in whole tiles.
+    mrv::Recti full( 0, 0, dw, dh );
+    mrv::Recti region;
+    bool tiled = spec.tile_width > 0;
+    bool partial = ( spec.depth <= 1 &&
+                     roi_region( full, region,
+                                 tiled ? spec.tile_width : 0,
+                                 tiled ? spec.tile_height : 1 ) );
+    if ( !partial ) region = full;
+
+    // Once a region was read, windows are kept for all frames
+    if ( partial || _dataWindow )
+    {
+        data_window( region.x(), region.y(), region.r() - 1, region.b() - 1,
+                     frame );
+        display_window( 0, 0, dw - 1, dh - 1, frame );
+    }
+
+    if ( allocate_pixels( canvas, frame, channels, type, pixel_type,
+                          region.w(), region.h() ) )
     {
         try
         {
             Pixel* pixels = (Pixel*)canvas->data().get();
-            in->read_image (format, &pixels[0]);
+            if ( !partial )
+            {
+                in->read_image (format, &pixels[0]);
+            }
+            else
+            {
+                bool ok;
+                if ( tiled )
+                    ok = in->read_tiles( spec.x + region.x(),
+                                         spec.x + region.r(),
+                                         spec.y + region.y(),
+                                         spec.y + region.b(),
+                                         spec.z, spec.z + 1,
+                                         format, &pixels[0] );
+                else
+                    ok = in->read_scanlines( spec.y + region.y(),
+                                             spec.y + region.b(),
+                                             spec.z, format, &pixels[0] );
+                if ( !ok )
+                {
+                    IMG_ERROR( in->geterror() );
+                    in->close();
+                    return false;
+                }
+                canvas->full_window( full );
+            }
         }
         catch ( const std::runtime_error& e )
         {
@@ -360,6 +405,76 @@ bool oiioImage::fetch( mrv::image_type_ptr& canvas, const boost::int64_t frame )
 }
 
 
+// Read the region of interest of the frame of a partial picture, keeping
+// the pixels it holds already and reading only the scanlines or tiles it
+// lacks.  Touches nothing in the image but its own file.
+bool oiioImage::fill_region( mrv::image_type_ptr& canvas,
+                             const mrv::image_type_ptr& held,
+                             mrv::Recti& region ) const
+{
+    const boost::int64_t frame = held->frame();
+    std::string file = sequence_filename( frame );
+    std::unique_ptr<ImageInput> in = ImageInput::open( file.c_str() );
+    if (!in) return false;
+
+    ImageSpec spec;
+    if ( ! in->seek_subimage( 0, std::max( 0, _level ), spec ) ||
+         spec.depth > 1 || spec.nchannels != held->channels() )
+    {
+        in->close();
+        return false;
+    }
+
+    mrv::Recti full( 0, 0, spec.width, spec.height );
+    if ( full != held->full_window() )
+    {
+        in->close();
+        return false;
+    }
+
+    bool tiled = spec.tile_width > 0;
+    if ( !roi_region( full, region,
+                      tiled ? spec.tile_width : 0,
+                      tiled ? spec.tile_height : 1 ) )
+        region = full;
+
+    std::vector< mrv::Recti > bands;
+    if ( region == data_window( frame ) ||
+         !roi_canvas( canvas, held, region, bands ) )
+    {
+        in->close();
+        return false;
+    }
+
+    const stride_t xstride = stride_t( held->pixel_size() ) *
+                             held->channels();
+    const stride_t ystride = xstride * region.w();
+    uint8_t* pixels = (uint8_t*)canvas->data().get();
+
+    bool ok = true;
+    std::vector< mrv::Recti >::const_iterator b = bands.begin();
+    std::vector< mrv::Recti >::const_iterator e = bands.end();
+    for ( ; b != e && ok; ++b )
+    {
+        uint8_t* dst = pixels + ( b->y() - region.y() ) * ystride +
+                       ( b->x() - region.x() ) * xstride;
+        if ( tiled )
+            ok = in->read_tiles( spec.x + b->x(), spec.x + b->r(),
+                                 spec.y + b->y(), spec.y + b->b(),
+                                 spec.z, spec.z + 1,
+                                 spec.format, dst, xstride, ystride );
+        else
+            ok = in->read_scanlines( spec.y + b->y(), spec.y + b->b(),
+                                     spec.z, spec.format, dst,
+                                     xstride, ystride );
+    }
+    if ( !ok ) IMG_ERROR( in->geterror() );
+
+    in->close();
+    return ok;
+}
+
+
 bool oiioImage::save( const char* path, const CMedia* img,
                       const OIIOOpts* opts )
 {
@@ -83,6 +83,10 @@ public:
     static bool save( const char* path, const CMedia* img,
                       const OIIOOpts* opts );
 protected:
+    virtual bool fill_region( mrv::image_type_ptr& canvas,
+                              const mrv::image_type_ptr& held,
+                              mrv::Recti& region ) const;
+
     char* _format;
     std::string _compression;
     int _level;  // current mipmap level
@@ -179,7 +179,10 @@ bool rawImage::fetch( mrv::image_type_ptr& canvas,
         }
     }
 
-    iprc->params.half_size = 0; /* no dcraw -h */
+    // When playing zoomed out, half size is all the view can show
+    const unsigned short proxy = proxy_level() > 0 ? 1 : 0;
+
+    iprc->params.half_size = proxy; /* dcraw -h */
     iprc->params.use_camera_wb = use_camera_wb;
     iprc->params.use_auto_wb = use_auto_wb;
 
@@ -323,7 +326,10 @@ bool rawImage::fetch( mrv::image_type_ptr& canvas,
         lumma_layers();
 
         pixel_ratio( iprc->sizes.pixel_aspect );
-        image_size( dw, dh );
+        if ( proxy )
+            image_size( iprc->sizes.width, iprc->sizes.height );
+        else
+            image_size( dw, dh );
 
         std::cerr << "dw, dh " << dw << ", " << dh << std::endl;
 
@@ -333,6 +339,7 @@ bool rawImage::fetch( mrv::image_type_ptr& canvas,
         image_type::Format type = image_type::kRGBA;
         allocate_pixels( canvas, frame, _num_channels, type, pixel_type,
                          dw, dh );
+        canvas->proxy( proxy );
 
         {
             Pixel* pixels = (Pixel*)canvas->data().get();
@@ -1067,7 +1067,7 @@ static void save_attribute( const CMedia* img,
     mrvALERT( _("Unknown data type to convert to string") );
 }
 
-bool CMedia::save( const char* file, const ImageOpts* opts ) const
+bool CMedia::save( const char* file, const ImageOpts* opts )
 {
     if ( dynamic_cast< const EXROpts* >( opts ) != NULL )
     {
@@ -1583,15 +1583,12 @@ bool CMedia::save( const char* file, const ImageOpts* opts ) const
     //
     {
         setlocale( LC_NUMERIC, "C" );  // Set locale to C
-        AttributesFrame::const_iterator j = _attrs.find( _frame );
-        if ( j != _attrs.end() )
+        const Attributes& fattrs = attributes();
+        Attributes::const_iterator i = fattrs.begin();
+        Attributes::const_iterator e = fattrs.end();
+        for ( ; i != e; ++i )
         {
-            Attributes::const_iterator i = j->second.begin();
-            Attributes::const_iterator e = j->second.end();
-            for ( ; i != e; ++i )
-            {
-                save_attribute( this, wand, i );
-            }
+            save_attribute( this, wand, i );
         }
 
         if ( opts->OCIO_color_space() && !ocio_input_color_space().empty() )
@@ -27,11 +27,16 @@ void Element::make_thumbnail()
     }
     else
     {
-        uchar* d = new uchar[64*64];
-        memset( d, 0, 64*64 );
-        Fl_RGB_Image* rgb = new Fl_RGB_Image( d, 64, 64, 1 );
-        rgb->alloc_array = 1;
-        b = rgb;
+        // Shown while the thumbnail is rendered in the background.
+        static Fl_RGB_Image* placeholder = NULL;
+        if ( !placeholder )
+        {
+            uchar* d = new uchar[64*64];
+            memset( d, 0, 64*64 );
+            placeholder = new Fl_RGB_Image( d, 64, 64, 1 );
+            placeholder->alloc_array = 1;
+        }
+        b = placeholder;
     }
     if ( !b || b->w() < 1 )
     {
@@ -42,6 +47,13 @@ void Element::make_thumbnail()
         image = new Fl_Box(0,VMARGIN,b->w(), b->h());
         image->box( FL_NO_BOX );
     }
+    else if ( b && image->image() != b && image->w() != b->w() )
+    {
+        // Placeholder replaced by the real thumbnail.  Make room for it.
+        image->size( b->w(), b->h() );
+        if ( label ) label->position( image->x() + b->w(), label->y() );
+        redraw();
+    }
     if ( b && image ) image->image( b );
 
 }
@@ -49,6 +61,7 @@ void Element::make_thumbnail()
     Element::Element(mrv::media m) :
         Fl_Group(0,0,1,64+VMARGIN*2),
         image(NULL),
+        label(NULL),
         _elem( m )
     {	// VMARGIN makes group slightly larger than items
         // Create widget to hold image
@@ -85,7 +85,7 @@ Fl_Image* fltk_handler( const char* filename, uchar* header,
     if ( ! img->left() ) return NULL;
 
     mrv::gui::media m( img );
-    m.create_thumbnail();
+    m.create_thumbnail( false );
 
     return (Fl_Image*) m.thumbnail()->copy();
 }
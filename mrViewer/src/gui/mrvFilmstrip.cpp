@@ -0,0 +1,227 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFilmstrip.cpp
+ * @author gga
+ * @date   Sun Oct 18 23:58:40 2026
+ *
+ * @brief  Filmstrips of frames drawn along the media tracks of the EDL.
+ *
+ */
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include <cstdio>
+#include <list>
+
+#include "core/CMedia.h"
+#include "core/aviImage.h"
+#include "core/mrvI8N.h"
+#include "core/mrvBackgroundCache.h"
+#include "gui/mrvIO.h"
+#include "gui/mrvFilmstrip.h"
+
+namespace
+{
+const char* kModule = "strip";
+
+// Tiles kept in memory.  At 114x64 this is about 5Mb.
+const size_t kMaxMemoryTiles = 256;
+
+// Requests waiting.  Older ones are dropped, as they were for a zoom or
+// a scroll position that is likely gone.
+const size_t kMaxQueue = 128;
+
+// Clips kept open by the thread
+const size_t kMaxOpen = 2;
+
+typedef mrv::BackgroundCache< mrv::Filmstrip::Request,
+                              mrv::Filmstrip::Tile > Cache;
+
+// The newest requests first, at low priority, as tiles are only a
+// preview of what is being scrolled to.
+Cache _cache( &mrv::Filmstrip::render, Cache::Startup(), kMaxMemoryTiles,
+              Cache::kNewestFirst | Cache::kLowPriority, 1, kMaxQueue );
+
+}
+
+namespace mrv {
+
+bool Filmstrip::find( const CMedia* img, const int64_t frame,
+                      const unsigned height, Tile& t )
+{
+    if ( !img || !img->fileroot() || height == 0 ) return false;
+
+    char buf[256];
+    sprintf( buf, "\n%" PRId64 "-%" PRId64 "\n%" PRId64 "\n%u\n%g\n%d%d\n",
+             img->first_frame(), img->last_frame(), frame, height,
+             img->gamma(), (int)img->flipX(), (int)img->flipY() );
+    std::string key = img->fileroot();
+    key += buf;
+
+    if ( _cache.find( key, t ) ) return true;
+
+    Request r;
+    r.key    = key;
+    r.file   = img->fileroot();
+    r.first  = img->first_frame();
+    r.last   = img->last_frame();
+    r.frame  = frame;
+    r.height = height;
+    r.gamma  = img->gamma();
+    r.flipX  = img->flipX();
+    r.flipY  = img->flipY();
+
+    _cache.request( key, r );
+    return false;
+}
+
+namespace {
+
+// Copies of the clips, opened for the thread alone
+struct Open
+{
+    std::string file;
+    int64_t     first;
+    int64_t     last;
+    unsigned    height;
+    CMedia*     img;
+};
+
+std::list< Open > _open;    // most recently used first
+
+CMedia* open_clip( const std::string& file, const int64_t first,
+                   const int64_t last, const unsigned height )
+{
+    std::list< Open >::iterator i = _open.begin();
+    std::list< Open >::iterator e = _open.end();
+    for ( ; i != e; ++i )
+    {
+        if ( i->file == file && i->first == first && i->last == last &&
+             i->height == height )
+        {
+            _open.splice( _open.begin(), _open, i );
+            return _open.front().img;
+        }
+    }
+
+    CMedia* img = CMedia::guess_image( file.c_str(), NULL, 0, true,
+                                       first, last );
+    if ( !img )
+    {
+        LOG_ERROR( _("Could not open ") << file );
+        return NULL;
+    }
+
+    img->audio_stream( -1 );
+
+    // Decode at the coarsest resolution still as tall as the tile
+    unsigned level = 0;
+    while ( ( img->height() >> ( level + 1 ) ) >= height ) ++level;
+    img->proxy_level( level );
+
+    Open o;
+    o.file   = file;
+    o.first  = first;
+    o.last   = last;
+    o.height = height;
+    o.img    = img;
+    _open.push_front( o );
+
+    while ( _open.size() > kMaxOpen )
+    {
+        delete _open.back().img;
+        _open.pop_back();
+    }
+
+    return img;
+}
+
+void close_clips()
+{
+    std::list< Open >::iterator i = _open.begin();
+    std::list< Open >::iterator e = _open.end();
+    for ( ; i != e; ++i )
+        delete i->img;
+    _open.clear();
+}
+
+}
+
+bool Filmstrip::render( const Request& r, Tile& t )
+{
+    CMedia* img = open_clip( r.file, r.first, r.last, r.height );
+    if ( !img ) return false;
+
+    int64_t f = r.frame;
+    if ( f < img->first_frame() ) f = img->first_frame();
+    if ( f > img->last_frame() )  f = img->last_frame();
+
+    // On long GOP movies decode just the keyframe before the frame
+    // instead of the whole group up to it.
+    aviImage* avi = dynamic_cast< aviImage* >( img );
+    if ( avi ) f = avi->keyframe_before( f );
+
+    // The clip is stopped, so this decodes the frame
+    img->seek( f );
+
+    ThumbnailCache::Request tr;
+    {
+        CMedia::Mutex::scoped_lock lk( img->video_mutex() );
+
+        mrv::image_type_ptr pic = img->left();
+        if ( !pic || pic->width() == 0 || pic->height() == 0 ) return false;
+
+        // The proxy keeps the aspect of the full image
+        double aspect = double( img->width() ) / double( img->height() );
+        unsigned w = unsigned( r.height * aspect + 0.5 );
+        if ( w == 0 ) w = 1;
+
+        tr.pic.reset( pic->quick_resize( w, r.height ) );
+        tr.width  = w;
+        tr.height = r.height;
+    }
+
+    tr.gamma = r.gamma;
+    tr.flipX = r.flipX;
+    tr.flipY = r.flipY;
+    tr.ocio  = false;     // processors are only built on the main thread
+
+    return ThumbnailCache::render( tr, t );
+}
+
+void Filmstrip::pause( const bool p )
+{
+    _cache.pause( p );
+}
+
+bool Filmstrip::ready()
+{
+    return _cache.ready();
+}
+
+void Filmstrip::shutdown()
+{
+    _cache.shutdown();
+
+    // The thread that used them is gone
+    close_clips();
+}
+
+} // namespace mrv
@@ -0,0 +1,90 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvFilmstrip.h
+ * @author gga
+ * @date   Sun Oct 18 23:58:40 2026
+ *
+ * @brief  Filmstrips of frames drawn along the media tracks of the EDL.
+ *
+ */
+
+#ifndef mrvFilmstrip_h
+#define mrvFilmstrip_h
+
+#include <string>
+
+#include "gui/mrvThumbnailCache.h"
+
+namespace mrv {
+
+class CMedia;
+
+//
+// Tiles of a filmstrip are small pictures of single frames of a clip.
+// They are decoded by one background thread from its own copy of each
+// clip, so the clips being played are never touched, and at the
+// coarsest resolution that still fills the tile (a mipmap level of
+// tiled EXRs).  Movies with a keyframe index show the keyframe at or
+// before each frame, so only that one picture is decoded.  The thread
+// runs at low priority and waits while anything plays.  Tiles are kept
+// in a small in-memory LRU; the newest requests are served first, so
+// the tiles of the current zoom arrive before the stale ones.
+//
+class Filmstrip
+{
+  public:
+    typedef ThumbnailCache::Thumbnail Tile;
+
+    struct Request
+    {
+        std::string key;
+        std::string file;
+        int64_t     first;
+        int64_t     last;
+        int64_t     frame;
+        unsigned    height;
+        float       gamma;
+        bool        flipX;
+        bool        flipY;
+    };
+
+  public:
+    /// Tile for frame of img, height pixels high.  If it is not in
+    /// memory, it is queued and false is returned; ready() tells when
+    /// to look again.
+    static bool find( const CMedia* img, const int64_t frame,
+                      const unsigned height, Tile& t );
+
+    /// Hold the background thread while playing
+    static void pause( const bool p );
+
+    /// True once after one or more queued tiles became available.
+    static bool ready();
+
+    /// Stop the background thread, dropping queued tiles.
+    static void shutdown();
+
+    /// Decode and scale the frame of a request.  Run by the background
+    /// thread.
+    static bool render( const Request& r, Tile& t );
+};
+
+} // namespace mrv
+
+#endif // mrvFilmstrip_h
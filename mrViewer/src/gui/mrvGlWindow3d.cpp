@@ -62,6 +62,8 @@
 #include <windows.h>
 #endif
 
+#include <GL/glew.h>
+
 #ifdef OSX
 #include <OpenGL/gl.h>
 #else
@@ -77,6 +79,8 @@
 #include <math.h>
 #include <string.h>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
 
 #include "mrvThread.h"
 
@@ -89,6 +93,27 @@ using std::cout;
 using std::endl;
 using std::cerr;
 
+namespace {
+
+// Points packed and uploaded per redraw while the cloud fills in
+const size_t kPointsPerSlice = 1 << 20;
+
+// Level of detail of pixel x, y
+inline int pixel_level( int x, int y )
+{
+    int level = 0;
+    while ( level < mrv::GlWindow3d::kMaxLevel &&
+            ( x & 1 ) == 0 && ( y & 1 ) == 0 )
+    {
+        x >>= 1;
+        y >>= 1;
+        ++level;
+    }
+    return level;
+}
+
+}
+
 namespace mrv {
 
 
@@ -109,6 +134,13 @@ GlWindow3d::init()
 {
     _dataZ = NULL;
     _sampleCount = NULL;
+    _packed = 0;
+    _pack_level = -1;
+    _pack_row = 0;
+    _vbo = 0;
+    _realloc = false;
+    _fps = 0.0;
+    for ( int i = 0; i <= kMaxLevel; ++i ) _level_end[i] = 0;
     _dx = 100;
     _dy = 80;
     _zmax = 100.0f;
@@ -130,6 +162,13 @@ GlWindow3d::load_data( int zsize,
                        float farPlane )
 {
     SCOPED_LOCK( _mutex );
+
+    _points.clear();
+    _packed = 0;
+    _pack_level = -1;
+    _realloc = true;
+    for ( int i = 0; i <= kMaxLevel; ++i ) _level_end[i] = 0;
+
     if ( zsize != dx * dy) {
         _dataZ = NULL;
         _sampleCount = NULL;
@@ -157,10 +196,39 @@ GlWindow3d::load_data( int zsize,
     if (_zmax != _zmin)
         _fitScale = 1.0 / (_zmax - _zmin);
 
+    // Count the points of each level and lay them out coarsest first
+    size_t count[kMaxLevel+1] = { 0 };
+    for (int y = 0; y < _dy; y++)
+    {
+        const unsigned* c = _sampleCount + size_t(y) * _dx;
+        for (int x = 0; x < _dx; x++)
+            count[ pixel_level( x, y ) ] += c[x];
+    }
+
+    size_t end = 0;
+    for ( int i = kMaxLevel; i >= 0; --i )
+    {
+        end += count[i];
+        _level_end[i] = end;
+    }
+
+    _points.resize( end * 3 );
+    _pack_level = kMaxLevel;
+    _pack_row = 0;
+
+    redraw();
 }
 
 GlWindow3d::~GlWindow3d ()
 {
+    Fl::remove_timeout( (Fl_Timeout_Handler) refine_cb, this );
+
+    if ( _vbo && context() )
+    {
+        make_current();
+        glDeleteBuffers( 1, &_vbo );
+    }
+
     // if ( _dataZ )
     // {
     //     for (int y = 0; y < _dy; y++)
@@ -295,6 +363,8 @@ drawOutLine(float dx, float dy, float z)
 void
 GlWindow3d::draw()
 {
+    _draw_start = std::chrono::steady_clock::now();
+
     if ( !valid() )
     {
         GlInit();
@@ -328,39 +398,42 @@ GlWindow3d::draw()
     glScaled (1.0, 1.0, _fitScale);
     glTranslated (0.0, 0.0, -_fitTran);
 
-    // loop dataZ to draw points
+    // draw the points of the current level of detail
     glPointSize (2);
-
-    glBegin (GL_POINTS);
     glColor3f (0.0, 1.0, 1.0);
 
-    if ( _dataZ && _sampleCount )
+    size_t shown = 0;
     {
         SCOPED_LOCK( _mutex );
-        for (int y = 0; y < _dy; y++)
+
+        // Keep filling the cloud in on the next redraws
+        if ( !upload() )
+            Fl::add_timeout( 0.0, (Fl_Timeout_Handler) refine_cb, this );
+
+        shown = std::min( _packed, _level_end[ level() ] );
+        if ( shown > 0 )
         {
-            for (int x = 0; x < _dx; x++)
+            glEnableClientState( GL_VERTEX_ARRAY );
+            if ( _vbo )
+            {
+                glBindBuffer( GL_ARRAY_BUFFER, _vbo );
+                glVertexPointer( 3, GL_FLOAT, 0, NULL );
+            }
+            else
             {
-                if( x % _displayFactor == 0 && y % _displayFactor == 0)
-                {
-                    float* z = _dataZ[y * _dx + x];
-                    unsigned int count = _sampleCount[y * _dx + x];
-
-                    for (unsigned int i = 0; i < count; i++)
-                    {
-                        float val = z[i];
-                        glVertex3f (float(x), float(_dy) - float(y) -1, -val);
-                    }
-                }
+                glVertexPointer( 3, GL_FLOAT, 0, _points.data() );
             }
+            glDrawArrays( GL_POINTS, 0, GLsizei( shown ) );
+            if ( _vbo ) glBindBuffer( GL_ARRAY_BUFFER, 0 );
+            glDisableClientState( GL_VERTEX_ARRAY );
         }
     }
 
-    glEnd();
-
     // draw the display window OutLine
     drawOutLine (float(_dx), float(_dy), -(_zmax + _zmin) / 2.0f);
 
+    draw_stats( shown );
+
     // Check gl errors
     GLenum err = glGetError();
     if ( err != GL_NO_ERROR )
@@ -369,6 +442,141 @@ GlWindow3d::draw()
     }
 }
 
+int GlWindow3d::level() const
+{
+    // Data pixels per screen pixel.  The image is one unit wide at the
+    // origin, seen from 8 units away (see ReshapeViewport()).
+    double fov = min (max (30.0 + _zoom, 1.0), 179.0);
+    double visible = 2.0 * 8.0 * tan( fov * M_PI / 360.0 );
+    double density = double(_dx) * visible / double( std::max( h(), 1 ) );
+
+    int l = 0;
+    while ( l < kMaxLevel && ( 2 << l ) <= density ) ++l;
+
+    int user = 0;
+    while ( user < kMaxLevel && ( 1 << ( user + 1 ) ) <= _displayFactor )
+        ++user;
+
+    return std::max( l, user );
+}
+
+bool GlWindow3d::upload()
+{
+    if ( _pack_level < 0 ) return true;
+
+    size_t total = _level_end[0];
+    if ( _realloc )
+    {
+        _realloc = false;
+        if ( !_vbo && GLEW_VERSION_1_5 ) glGenBuffers( 1, &_vbo );
+        if ( _vbo )
+        {
+            glBindBuffer( GL_ARRAY_BUFFER, _vbo );
+            glBufferData( GL_ARRAY_BUFFER, total * 3 * sizeof(float),
+                          NULL, GL_STATIC_DRAW );
+            glBindBuffer( GL_ARRAY_BUFFER, 0 );
+            if ( glGetError() == GL_OUT_OF_MEMORY )
+            {
+                // Too big for the card.  Draw from memory instead.
+                glDeleteBuffers( 1, &_vbo );
+                _vbo = 0;
+            }
+        }
+    }
+
+    // Pack whole rows of the current level until the slice is full
+    size_t first = _packed;
+    float* p = _points.data() + _packed * 3;
+    while ( _pack_level >= 0 && _packed - first < kPointsPerSlice )
+    {
+        const int step = 1 << _pack_level;
+        const int y = _pack_row;
+        const bool odd_row = ( y & step ) != 0;
+
+        for ( int x = 0; x < _dx; x += step )
+        {
+            // Pixels on both even multiples belong to a coarser level
+            if ( _pack_level < kMaxLevel && !odd_row && ( x & step ) == 0 )
+                continue;
+
+            size_t idx = size_t(y) * _dx + x;
+            const float* z = _dataZ[idx];
+            unsigned count = _sampleCount[idx];
+            for ( unsigned i = 0; i < count; ++i, p += 3 )
+            {
+                p[0] = float(x);
+                p[1] = float(_dy) - float(y) - 1;
+                p[2] = -z[i];
+            }
+            _packed += count;
+        }
+
+        _pack_row += step;
+        if ( _pack_row >= _dy )
+        {
+            --_pack_level;
+            _pack_row = 0;
+        }
+    }
+
+    if ( _vbo && _packed > first )
+    {
+        glBindBuffer( GL_ARRAY_BUFFER, _vbo );
+        glBufferSubData( GL_ARRAY_BUFFER, first * 3 * sizeof(float),
+                         ( _packed - first ) * 3 * sizeof(float),
+                         _points.data() + first * 3 );
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    }
+
+    if ( _pack_level >= 0 ) return false;
+
+    // All on the card.  No need to keep a copy.
+    if ( _vbo ) std::vector<float>().swap( _points );
+    return true;
+}
+
+void GlWindow3d::draw_stats( size_t points )
+{
+    using namespace std::chrono;
+
+    // Wait for the points to be drawn, so the rate is that of the
+    // renderer (Mesa's software one included), not of queuing commands.
+    glFinish();
+    double secs = duration< double >( steady_clock::now() -
+                                      _draw_start ).count();
+    if ( secs > 0.0 )
+    {
+        double fps = 1.0 / secs;
+        _fps = _fps == 0.0 ? fps : _fps + 0.2 * ( fps - _fps );
+    }
+
+    char buf[128];
+    sprintf( buf, "%zu / %zu points  level %d  %.1f fps", points,
+             _level_end[0], level(), _fps );
+
+    glMatrixMode( GL_PROJECTION );
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho( 0, w(), 0, h(), -1, 1 );
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+
+    glColor3f( 1.0f, 1.0f, 1.0f );
+    gl_font( FL_HELVETICA, 12 );
+    gl_draw( buf, 5.0f, 5.0f );
+
+    glPopMatrix();
+    glMatrixMode( GL_PROJECTION );
+    glPopMatrix();
+    glMatrixMode( GL_MODELVIEW );
+}
+
+void GlWindow3d::refine_cb( GlWindow3d* w )
+{
+    w->redraw();
+}
+
 int
 GlWindow3d::handle (int event)
 {
@@ -506,7 +714,8 @@ GlWindow3d::handle (int event)
         if ( kDensityDown.match(rawkey) ) //decrease pixel samples
         {
             _displayFactor *= 2;
-            if (_displayFactor > _dx || _displayFactor > _dy )
+            if (_displayFactor > _dx || _displayFactor > _dy ||
+                _displayFactor > (1 << kMaxLevel) )
                 _displayFactor /= 2;
             redraw();
             return 1;
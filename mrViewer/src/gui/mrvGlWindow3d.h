@@ -58,6 +58,9 @@
 //
 //----------------------------------------------------------------------------
 
+#include <vector>
+#include <chrono>
+
 #include <boost/thread/recursive_mutex.hpp>
 
 #include <FL/Fl.H>
@@ -72,11 +75,23 @@ namespace mrv {
 
 const float kFPS = 1.0f / 24.0f;
 
+//
+// Deep samples are drawn as a point cloud from a vertex buffer.  Points
+// are stored coarsest level of detail first: level k holds the pixels
+// whose x and y are both multiples of 2^k (but not both of 2^(k+1)), so
+// showing every 2^k-th pixel is drawing a prefix of the buffer.  The
+// level shown follows how many data pixels fall on a screen pixel, or
+// the density keys if coarser.  The buffer is filled a slice per redraw,
+// coarse levels first, so a large cloud shows up at once and refines.
+//
 class GlWindow3d : public Fl_Gl_Window
 {
 public:
     typedef boost::recursive_mutex Mutex;
 
+    /// Finest decimation is one pixel in 2^kMaxLevel on each axis
+    static const int kMaxLevel = 8;
+
     GlWindow3d (int x, int y, int w, int h, const char *l = 0);
     GlWindow3d (int w, int h, const char* l = 0 );
     ~GlWindow3d ();
@@ -99,6 +114,17 @@ public:
 protected:
     void init();
 
+    /// Level of detail fitting the current view
+    int level() const;
+
+    /// Pack and upload the next slice of points.  Returns true when done.
+    bool upload();
+
+    /// Draw how many points are shown and how fast
+    void draw_stats( size_t points );
+
+    static void refine_cb( GlWindow3d* w );
+
     float**                              _dataZ;
     unsigned int *                       _sampleCount;
     int                                  _dx;
@@ -107,6 +133,16 @@ protected:
     float                                _zmin;
     float                                _farPlane;
 
+    size_t              _level_end[kMaxLevel+1]; //<- points up to level
+    std::vector<float>  _points;    //<- packed x, y, z of each sample
+    size_t              _packed;    //<- points packed so far
+    int                 _pack_level; //<- level being packed
+    int                 _pack_row;  //<- next row of level to pack
+    unsigned            _vbo;       //<- vertex buffer, 0 if none
+    bool                _realloc;   //<- vertex buffer must be reallocated
+    double              _fps;       //<- measured draw rate
+    std::chrono::steady_clock::time_point _draw_start;
+
 private:
     double      _zoom;
     double      _translateX;
@@ -34,6 +34,7 @@
 using namespace std;
 
 #include <algorithm>
+#include <chrono>
 
 
 #include <ImfBoxAttribute.h>
@@ -58,6 +59,7 @@ using namespace std;
 
 #include <core/mrvRectangle.h>
 #include <FL/Fl_Int_Input.H>
+#include <FL/Fl_Valuator.H>
 #include <FL/names.h>
 
 #include "core/oiioImage.h"
@@ -85,6 +87,17 @@ using namespace std;
 
 namespace {
 const char* kModule = "info";
+
+// Shortest time between two updates of the values, about one refresh of
+// the display
+const double kUpdatePeriod = 1.0 / 60.0;
+
+double now()
+{
+    using namespace std::chrono;
+    return duration< double >( steady_clock::now().time_since_epoch() ).count();
+}
+
 }
 
 namespace mrv
@@ -676,6 +689,7 @@ static void add_attribute_cb( Fl_Box* widget, ImageInformation* info )
     std::string key = uiKey->value();
     std::string value = uiValue->value();
 
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attrs = img->attributes();
     add_attribute( attrs, img );
     info->filled = false;
@@ -691,10 +705,16 @@ static void remove_attribute_cb( Fl_Box* widget, ImageInformation* info )
     CMedia* img = info->get_image();
     if (!img) return;
 
-    CMedia::Attributes& attrs = img->attributes();
+    Fl_Window* w;
+    {
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
+        CMedia::Attributes& attrs = img->attributes();
 
-    Fl_Group::current(0);
-    Fl_Window* w = make_remove_window( attrs );
+        Fl_Group::current(0);
+        w = make_remove_window( attrs );
+    }
+
+    // Not locked while the user picks, so decoding goes on
     w->set_modal();
     w->show();
     while ( w->visible() )
@@ -703,6 +723,9 @@ static void remove_attribute_cb( Fl_Box* widget, ImageInformation* info )
 
     if ( ! ( w->damage() & FL_DAMAGE_ALL ) ) return;
 
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
+    CMedia::Attributes& attrs = img->attributes();
+
     char picked[1024];
     int ok = uiKeyRemove->item_pathname( picked, sizeof(picked)-1 );
     if ( ok < 0 )
@@ -747,6 +770,13 @@ ImageInformation::ImageInformation( int x, int y, int w, int h,
                                     const char* l ) :
 Fl_Scroll( x, y, w, h, l ),
 img( NULL ),
+m_update( false ),
+m_stale( false ),
+m_table( 0 ),
+m_next( 0 ),
+m_last( 0.0 ),
+m_pending( false ),
+filled( false ),
 menu( new Fl_Menu_Button( 0, 0, 0, 0, _("Attributes Menu") ) )
 {
     menu->type( Fl_Menu_Button::POPUP3 );
@@ -790,6 +820,12 @@ menu( new Fl_Menu_Button( 0, 0, 0, 0, _("Attributes Menu") ) )
 
 }
 
+ImageInformation::~ImageInformation()
+{
+    Fl::remove_timeout( (Fl_Timeout_Handler)update_cb, this );
+    clear_callback_data();
+}
+
 
 int ImageInformation::handle( int event )
 {
@@ -807,6 +843,7 @@ int ImageInformation::handle( int event )
                    (Fl_Callback*)add_attribute_cb,
                    this);
         {
+            CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
             CMedia::Attributes& attrs = img->attributes();
             if ( !attrs.empty() )
             {
@@ -892,6 +929,7 @@ static void timecode_cb( Fl_Input* w, ImageInformation* info )
     CMedia* img = dynamic_cast<CMedia*>( info->get_image() );
     if ( !img ) return;
 
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attrs = img->attributes();
     CMedia::Attributes::iterator i = attrs.begin();
     CMedia::Attributes::iterator e = attrs.end();
@@ -1346,6 +1384,7 @@ static void change_float_cb( Fl_Float_Input* w, ImageInformation* info )
     if ( !widget->label() ) return;
 
     std::string key = widget->label();
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attributes = img->attributes();
     CMedia::Attributes::iterator i = attributes.find( key );
     if ( i != attributes.end() )
@@ -1401,6 +1440,7 @@ static void change_string_cb( Fl_Input* w, ImageInformation* info )
     }
 
     std::string key = box->label();
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attributes = img->attributes();
     CMedia::Attributes::iterator i = attributes.find( key );
     if ( i != attributes.end() )
@@ -1425,6 +1465,7 @@ static void change_int_cb( Fl_Int_Input* w, ImageInformation* info )
     if ( !widget->label() ) return;
 
     std::string key = widget->label();
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attributes = img->attributes();
     CMedia::Attributes::iterator i = attributes.find( key );
     if ( i != attributes.end() )
@@ -1451,6 +1492,7 @@ static void change_keycode_cb( Fl_Int_Input* w, ImageInformation* info )
         subattr = key.substr( p+1, key.size() );
         key  = key.substr( 0, p );
     }
+    CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
     CMedia::Attributes& attributes = img->attributes();
     CMedia::Attributes::iterator i = attributes.find( key );
     if ( i != attributes.end() )
@@ -2119,9 +2161,10 @@ double ImageInformation::to_memory( long double value,
 void ImageInformation::set_image( CMedia* i )
 {
     DBG3;
-    filled = false;
+    // The same image only gets its values updated
+    if ( i != img ) filled = false;
     img = i;
-    refresh();
+    update();
 }
 
 void ImageInformation::clear_callback_data()
@@ -2894,8 +2937,12 @@ void ImageInformation::fill_data()
 
 
     const CMedia::Attributes& cattrs = img->clip_attributes();
-    const CMedia::Attributes& attrs = img->attributes();
-    if ( ! attrs.empty() || !cattrs.empty() )
+    bool has_attrs;
+    {
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
+        has_attrs = !img->attributes().empty();
+    }
+    if ( has_attrs || !cattrs.empty() )
     {
         m_curr = add_browser( m_attributes );
 
@@ -3151,6 +3198,8 @@ void ImageInformation::fill_data()
         }
 
         // Then, parse frame attributes
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
+        const CMedia::Attributes& attrs = img->attributes();
         i = attrs.begin();
         e = attrs.end();
         for ( ; i != e; ++i )
@@ -3400,10 +3449,44 @@ void ImageInformation::refresh()
         return;
     }
 
+    update();
+}
+
+void ImageInformation::update_cb( ImageInformation* v )
+{
+    v->m_pending = false;
+    if ( v->img ) v->update();
+}
+
+void ImageInformation::update()
+{
+    if ( img )
+        img->image_damage( img->image_damage() & ~CMedia::kDamageData );
+
+    if ( filled && img && visible_r() )
+    {
+        // During playback this is asked for every frame
+        double t = now();
+        if ( t - m_last < kUpdatePeriod )
+        {
+            if ( !m_pending )
+            {
+                m_pending = true;
+                Fl::add_timeout( kUpdatePeriod - ( t - m_last ),
+                                 (Fl_Timeout_Handler)update_cb, this );
+            }
+            return;
+        }
+        m_last = t;
+
+        if ( update_values() ) return;
+    }
+
     filled = false;
 
     hide_tabs();
 
+    m_tables.clear();
     m_image->clear();
     m_video->clear();
     m_audio->clear();
@@ -3461,11 +3544,115 @@ void ImageInformation::refresh()
     m_all->show();
 
     filled = true;
+    m_last = now();
 
     Fl_Group::current(0);
     DBG3;
 }
 
+/**
+ * Update the values shown without adding the rows again.
+ *
+ * @return false if the rows are not the same as the ones shown, in which
+ *         case the panel has to be filled again.
+ */
+bool ImageInformation::update_values()
+{
+    if ( m_tables.empty() ) return false;
+
+    if ( img->is_stereo() && (img->right_eye() || !img->is_left_eye()) )
+        m_button->show();
+    else
+        m_button->hide();
+
+    m_update = true;
+    m_stale  = false;
+    m_table  = 0;
+    m_next   = 0;
+    m_curr   = NULL;
+
+    fill_data();
+
+    if ( m_curr && m_next != m_curr->children() ) m_stale = true;
+    if ( m_table != m_tables.size() ) m_stale = true;
+
+    m_update = false;
+    m_curr   = NULL;
+
+    Fl_Group::current(0);
+    return !m_stale;
+}
+
+/**
+ * Value widget of the next row when updating, if that row is the one for
+ * name.  If not, the update is marked stale and NULL is returned.
+ */
+Fl_Widget* ImageInformation::next_row( const char* name )
+{
+    if ( m_stale || !m_curr || m_next + 1 >= m_curr->children() )
+    {
+        m_stale = true;
+        return NULL;
+    }
+
+    Fl_Group* g = dynamic_cast< Fl_Group* >( m_curr->child( m_next ) );
+    if ( !g || g->children() == 0 || !g->child(0)->label() ||
+         strcmp( g->child(0)->label(), name ) != 0 )
+    {
+        m_stale = true;
+        return NULL;
+    }
+
+    Fl_Widget* w = m_curr->child( m_next + 1 );
+    m_next += 2;
+    return w;
+}
+
+void ImageInformation::update_input( Fl_Widget* w, const char* text )
+{
+    if ( !w ) return;
+
+    Fl_Input_* in = dynamic_cast< Fl_Input_* >( w );
+    if ( !in )
+    {
+        m_stale = true;
+        return;
+    }
+
+    // Do not change what the user is typing
+    if ( Fl::focus() == in ) return;
+
+    if ( !text ) text = "";
+    if ( strcmp( in->value(), text ) != 0 ) in->value( text );
+}
+
+void ImageInformation::update_number( Fl_Widget* w, const char* text,
+                                      const double value )
+{
+    if ( !w ) return;
+
+    Fl_Group* p = dynamic_cast< Fl_Group* >( w );
+    if ( !p || p->children() == 0 )
+    {
+        m_stale = true;
+        return;
+    }
+
+    update_input( p->child(0), text );
+    if ( p->children() < 2 ) return;
+
+    Fl_Valuator* slider = dynamic_cast< Fl_Valuator* >( p->child(1) );
+    if ( !slider || Fl::pushed() == slider ) return;
+
+    // The range of the slider depends on the value
+    if ( value > slider->maximum() )
+    {
+        m_stale = true;
+        return;
+    }
+    if ( slider->value() != value ) slider->value( value );
+}
+
 void
 ImageInformation::resize( int x, int y, int w, int h )
 {
@@ -3478,6 +3665,20 @@ mrv::Table* ImageInformation::add_browser( mrv::CollapsibleGroup* g )
 {
     if (!g) return NULL;
 
+    if ( m_update )
+    {
+        if ( m_curr && m_next != m_curr->children() ) m_stale = true;
+        if ( m_table >= m_tables.size() ||
+             m_tables[m_table]->parent() != g->contents() )
+        {
+            m_stale = true;
+            return m_tables.back();
+        }
+        m_next = 0;
+        group = row = 0;
+        return m_tables[m_table++];
+    }
+
     X = 0;
     Y = g->y() + line_height();
 
@@ -3498,6 +3699,7 @@ mrv::Table* ImageInformation::add_browser( mrv::CollapsibleGroup* g )
     //  g->end();
 
     g->add( table );
+    m_tables.push_back( table );
 
     group = row = 0; // controls line colors
 
@@ -3572,6 +3774,14 @@ void ImageInformation::add_icc( const char* name,
     if ( !editable )
         return add_text( name, tooltip, content );
 
+    if ( m_update )
+    {
+        Fl_Group* sg = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( sg && sg->children() ) update_input( sg->child(0), content );
+        else m_stale = true;
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3626,6 +3836,12 @@ void ImageInformation::add_button( const char* name,
                                    Fl_Callback* callback,
                                    Fl_Callback* callback2 )
 {
+    if ( m_update )
+    {
+        next_row( name );
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3671,6 +3887,22 @@ void ImageInformation::add_scale( const char* name,
                                   int num_scales,
                                   Fl_Callback* callback )
 {
+    if ( m_update )
+    {
+        Fl_Group* g = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( !g || g->children() != num_scales )
+        {
+            m_stale = true;
+            return;
+        }
+        for ( int i = 0; i < num_scales; ++i )
+        {
+            Fl_Button* b = dynamic_cast< Fl_Button* >( g->child(i) );
+            if ( b ) b->value( pressed == i );
+        }
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3747,6 +3979,13 @@ void ImageInformation::add_ctl( const char* name,
     if ( !editable )
         return add_text( name, tooltip, content );
 
+    if ( m_update )
+    {
+        Fl_Group* sg = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( sg && sg->children() ) update_input( sg->child(0), content );
+        else m_stale = true;
+        return;
+    }
 
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
@@ -3802,6 +4041,14 @@ void ImageInformation::add_ocio_ics( const char* name,
     if ( !editable )
         return add_text( name, tooltip, content );
 
+    if ( m_update )
+    {
+        Fl_Group* sg = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( sg && sg->children() ) update_input( sg->child(0), content );
+        else m_stale = true;
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3854,6 +4101,14 @@ void ImageInformation::add_ctl_idt( const char* name,
     if ( !editable )
         return add_text( name, tooltip, content );
 
+    if ( m_update )
+    {
+        Fl_Group* sg = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( sg && sg->children() ) update_input( sg->child(0), content );
+        else m_stale = true;
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3912,6 +4167,18 @@ void ImageInformation::add_ctl_lmt( const char* name,
     if ( !editable )
         return add_text( name, tooltip, content );
 
+    if ( m_update )
+    {
+        // Its buttons depend on the transform
+        Fl_Group* sg = dynamic_cast< Fl_Group* >( next_row( name ) );
+        Fl_Input_* in = NULL;
+        if ( sg && sg->children() )
+            in = dynamic_cast< Fl_Input_* >( sg->child(0) );
+        if ( !in || strcmp( in->value(), content ? content : "" ) != 0 )
+            m_stale = true;
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -3993,7 +4260,11 @@ void ImageInformation::add_text( const char* name,
                                  const bool active,
                                  Fl_Callback* callback )
 {
-
+    if ( m_update )
+    {
+        update_input( next_row( name ), content );
+        return;
+    }
 
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
@@ -4066,6 +4337,13 @@ void ImageInformation::add_int( const char* name, const char* tooltip,
                                 const int minV, const int maxV,
                                 const int when )
 {
+    if ( m_update )
+    {
+        char buf[64];
+        sprintf( buf, "%d", content );
+        update_number( next_row( name ), buf, content );
+        return;
+    }
 
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
@@ -4162,6 +4440,23 @@ void ImageInformation::add_enum( const char* name,
                                  Fl_Callback* callback
                                )
 {
+    if ( m_update )
+    {
+        mrv::PopupMenu* m = dynamic_cast< mrv::PopupMenu* >( next_row( name ) );
+        if ( !m || m->size() != int(num) + 1 )
+        {
+            m_stale = true;
+            return;
+        }
+        if ( m->value() != int(content) )
+        {
+            m->value( unsigned(content) );
+            m->copy_label( _( options[content] ) );
+            m->redraw();
+        }
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -4258,6 +4553,14 @@ void ImageInformation::add_int( const char* name,
                                 const unsigned int maxV )
 {
     assert0( m_curr != NULL );
+    if ( m_update )
+    {
+        char buf[64];
+        sprintf( buf, "%d", content );
+        update_number( next_row( name ), buf, content );
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -4396,6 +4699,25 @@ void ImageInformation::add_rect( const char* name, const char* tooltip,
                                  const bool editable, Fl_Callback* callback )
 {
     assert0( m_curr != NULL );
+    if ( m_update )
+    {
+        Fl_Group* g2 = dynamic_cast< Fl_Group* >( next_row( name ) );
+        if ( !g2 || g2->children() != 6 )
+        {
+            m_stale = true;
+            return;
+        }
+        const int v[] = { content.l(), content.t(), content.r(), content.b(),
+                          content.w(), content.h() };
+        char buf[64];
+        for ( int i = 0; i < 6; ++i )
+        {
+            sprintf( buf, "%d", v[i] );
+            update_input( g2->child(i), buf );
+        }
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -4541,6 +4863,14 @@ void ImageInformation::add_float( const char* name,
 {
     assert0( m_curr != NULL );
 
+    if ( m_update )
+    {
+        char buf[64];
+        sprintf( buf, "%g", content );
+        update_number( next_row( name ), buf, content );
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -4633,6 +4963,12 @@ void ImageInformation::add_bool( const char* name,
                                  const bool editable,
                                  Fl_Callback* callback )
 {
+    if ( m_update )
+    {
+        update_input( next_row( name ), content? _("Yes") : _("No") );
+        return;
+    }
+
     Fl_Color colA = get_title_color();
     Fl_Color colB = get_widget_color();
 
@@ -34,6 +34,7 @@
 #endif
 
 #include <inttypes.h>  // for PRId64
+#include <vector>
 
 #include <FL/Fl_Button.H>
 #include <FL/Fl_Pack.H>
@@ -67,9 +68,7 @@ class ImageInformation : public Fl_Scroll
 
 public:
     ImageInformation( int x, int y, int w, int h, const char* l = NULL );
-    ~ImageInformation() {
-        clear_callback_data();
-    }
+    ~ImageInformation();
 
     CMedia* get_image() {
         return img;
@@ -77,6 +76,7 @@ public:
     void set_image( CMedia* img );
 
     void refresh();
+    void update();
     virtual int handle( int event );
 
     void main( ViewerUI* m ) {
@@ -98,6 +98,13 @@ protected:
 
     void hide_tabs();
 
+    bool update_values();
+    static void update_cb( ImageInformation* v );
+
+    Fl_Widget* next_row( const char* name );
+    void update_input( Fl_Widget* w, const char* text );
+    void update_number( Fl_Widget* w, const char* text, const double value );
+
     static void ctl_callback( Fl_Widget* t, ImageInformation* v );
     static void ctl_lmt_callback( Fl_Widget* t, CtlLMTData* v );
     static void ctl_idt_callback( Fl_Widget* t, ImageInformation* v );
@@ -230,6 +237,15 @@ protected:
     unsigned int row;
     unsigned int X, Y, W, H;
 
+    // Values of the rows are updated in place while the rows stay the same
+    std::vector< mrv::Table* > m_tables;   //!< tables of the last fill
+    bool              m_update;  //!< updating values instead of adding rows
+    bool              m_stale;   //!< rows changed, the panel must be refilled
+    size_t            m_table;   //!< next table to update
+    int               m_next;    //!< next child of m_curr to update
+    double            m_last;    //!< time of the last update, in seconds
+    bool              m_pending; //!< an update is waiting for its time
+
 public:
     bool                         filled;
     mrv::CollapsibleGroup*       m_attributes;
@@ -64,6 +64,8 @@
 #include <iomanip>
 #include <sstream>
 #include <set>
+#include <atomic>
+#include <random>
 
 #include "video/mrvGLLut3d.h"
 #include "core/CMedia.h"
@@ -77,6 +79,8 @@
 
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <FL/fl_utf8.h>
 #include <FL/Enumerations.H>
@@ -103,6 +107,7 @@ static Atom fl_NET_WM_STATE_FULLSCREEN;
 #include <ImfRationalAttribute.h>
 #include <ImfIntAttribute.h>
 #include <ImfStringAttribute.h>
+#include <ImfVecAttribute.h>
 #include <ImfStandardAttributes.h>
 
 // CORE classes
@@ -119,6 +124,8 @@ static Atom fl_NET_WM_STATE_FULLSCREEN;
 #include "core/mrvThread.h"
 #include "core/mrvColorSpaces.h"
 #include "core/mrvFrame.h"
+#include "core/mrvFrameRegistry.h"
+#include "core/mrvAudioPeaks.h"
 #include "core/mrvHome.h"
 #include "core/mrStackTrace.h"
 #include "core/exrImage.h"
@@ -138,6 +145,8 @@ static Atom fl_NET_WM_STATE_FULLSCREEN;
 #include "gui/mrvTimeline.h"
 #include "gui/mrvHotkey.h"
 #include "gui/mrvEvents.h"
+#include "gui/mrvThumbnailCache.h"
+#include "gui/mrvFilmstrip.h"
 #include "mrvEDLWindowUI.h"
 #include "mrvWaveformUI.h"
 #include "mrvVectorscopeUI.h"
@@ -185,6 +194,15 @@ namespace fs = boost::filesystem;
 namespace
 {
 const char* kModule = "gui";
+
+// Lead time given to sync stations to receive a PlayAt (microseconds)
+const int64_t kSyncLead = 250000;
+
+// How often synchronized playback checks for drift (microseconds)
+const int64_t kDriftCheckInterval = 500000;
+
+// Drift in frames above which we skip frames instead of nudging fps
+const double kMaxDriftFrames = 4.0;
 }
 
 
@@ -969,6 +987,7 @@ void ImageView::toggle_window( const ImageView::WindowList idx, const bool force
         if ( force || !uiMain->uiGL3dView->uiMain->visible() )
         {
             uiMain->uiGL3dView->uiMain->show();
+            reload_3d_data();
             send_network( "GL3dView 1" );
         }
         else
@@ -1444,6 +1463,29 @@ bool ImageView::in_presentation() const
     return presentation;
 }
 
+void ImageView::send_path_points( GLPathShape* s )
+{
+    if ( !_network_active || _clients.empty() ) return;
+
+    if ( _sent_points == 0 )
+    {
+        // Peers find the stroke by this id when more points arrive
+        if ( ++_stroke_id == 0 ) ++_stroke_id;
+        s->stroke = _stroke_id;
+        send_network( s->network_message() );
+    }
+    else
+    {
+        char buf[32];
+        sprintf( buf, "GLPathShapeAppend %u", (unsigned) s->stroke );
+        std::string msg = buf;
+        const size_t len = msg.size();
+        s->send_points( msg, _sent_points );
+        if ( msg.size() > len ) send_network( msg );
+    }
+    _sent_points = s->pts.size();
+}
+
 void ImageView::send_network( std::string m ) const
 {
     if ( !_network_active) return;
@@ -1457,6 +1499,323 @@ void ImageView::send_network( std::string m ) const
     }
 }
 
+int64_t ImageView::session_time() const
+{
+    int64_t t = ClockSync::now();
+
+    // The server's clock is the session clock.  Clients have a single
+    // connection (to the server) which keeps the offset to it.
+    if ( _server || _clients.empty() ) return t;
+
+    return _clients.front()->clock.to_session( t );
+}
+
+static void static_play_at( mrv::ImageView* v )
+{
+    v->play_at_reached();
+}
+
+void ImageView::play_at( const int64_t start, const int64_t f,
+                         const double fps )
+{
+    stop();
+
+    Fl::remove_timeout( (Fl_Timeout_Handler) static_play_at, this );
+
+    _sync_anchor.start  = start;
+    _sync_anchor.frame  = f;
+    _sync_anchor.fps    = fps;
+    _sync_anchor.active = true;
+    _sync_check = 0;
+
+    bool old = _network_active;
+    _network_active = false;
+    if ( frame() != f ) seek( f );
+    this->fps( fps );
+    _network_active = old;
+
+    double delay = double( start - session_time() ) / 1000000.0;
+    if ( delay < 0.0 ) delay = 0.0;
+
+    if ( Preferences::debug )
+        LOG_INFO( "Sync playback at frame " << f << " in " << delay
+                  << " secs." );
+
+    Fl::add_timeout( delay, (Fl_Timeout_Handler) static_play_at, this );
+}
+
+void ImageView::play_at_reached()
+{
+    if ( !_sync_anchor.active ) return;
+
+    // Keep the anchor, so correct_drift() follows it
+    bool old = _network_active;
+    _network_active = false;
+    _sync_starting = true;
+    play( CMedia::kForwards );
+    _sync_starting = false;
+    _network_active = old;
+}
+
+void ImageView::correct_drift()
+{
+    if ( !_sync_anchor.active || playback() != CMedia::kForwards ) return;
+
+    int64_t now = session_time();
+    if ( now - _sync_check < kDriftCheckInterval ) return;
+    _sync_check = now;
+
+    mrv::media fg = foreground();
+    if ( !fg ) return;
+
+    int64_t first = (int64_t) timeline()->display_minimum();
+    int64_t last  = (int64_t) timeline()->display_maximum();
+    double length = double( last - first + 1 );
+    if ( length <= 1.0 ) return;
+
+    CMedia::Looping loop = looping();
+
+    double expected = _sync_anchor.expected_frame( now );
+    if ( expected > double(last) + 1.0 )
+    {
+        if ( loop != CMedia::kLoop ) return;
+        expected = first + std::fmod( expected - first, length );
+    }
+
+    double drift = double( frame() ) - expected;
+
+    // Take the shortest way around the loop
+    if ( loop == CMedia::kLoop )
+    {
+        if ( drift > length / 2 ) drift -= length;
+        else if ( drift < -length / 2 ) drift += length;
+    }
+
+    double fps = _sync_anchor.fps;
+
+    if ( std::abs( drift ) >= kMaxDriftFrames )
+    {
+        // Too far out of step.  Skip frames instead of nudging.
+        int64_t f = int64_t( expected + 0.5 );
+        if ( f > last ) f = first + ( f - last - 1 );
+
+        bool old = _network_active;
+        _network_active = false;
+        seek( f );
+        _network_active = old;
+    }
+    else
+    {
+        fps = _sync_anchor.corrected_fps( drift );
+    }
+
+    if ( Preferences::debug )
+        LOG_INFO( "Sync drift " << drift << " frames, play rate " << fps );
+
+    fg->image()->play_fps( fps );
+
+    mrv::media bg = background();
+    if ( bg && bg != fg ) bg->image()->play_fps( fps );
+}
+
+void ImageView::update_proxy_level()
+{
+    unsigned level = 0;
+    if ( playback() != CMedia::kStopped && _zoom < 1.0f && !vr() )
+    {
+        level = unsigned( std::floor( std::log2( 1.0 / _zoom ) ) );
+        if ( level > CMedia::kMaxProxyLevel ) level = CMedia::kMaxProxyLevel;
+    }
+    if ( playback() != CMedia::kStopped )
+        level = std::max( level, _governor.proxy_level() );
+
+    if ( level < _proxy_level ) _proxy_refetch = true;
+    _proxy_level = level;
+
+    mrv::media fg = foreground();
+    mrv::media bg = background();
+
+    bool pending = false;
+    for ( int i = 0; i < 2; ++i )
+    {
+        mrv::media m = i == 0 ? fg : bg;
+        if ( !m || ( i == 1 && m == fg ) ) continue;
+
+        CMedia* img = m->image();
+        img->proxy_level( level );
+
+        if ( !_proxy_refetch || playback() != CMedia::kStopped ) continue;
+
+        // Wait for the decode threads to stop before seeking
+        if ( !img->stopped() )
+        {
+            pending = true;
+            continue;
+        }
+
+        // Replace the proxy on screen with the full resolution frame
+        mrv::image_type_ptr pic = img->left();
+        if ( pic && pic->proxy() > level )
+        {
+            img->seek( img->frame() );
+            redraw();
+        }
+    }
+
+    if ( playback() == CMedia::kStopped && !pending ) _proxy_refetch = false;
+}
+
+void ImageView::update_quality()
+{
+    if ( playback() == CMedia::kStopped ) return;
+    if ( !_governor.update( ClockSync::now() ) ) return;
+
+    // Frames cached at the old depth must not be mixed with new ones
+    bool old = CMedia::eight_bit_caches();
+    CMedia::eight_bit_caches( _user_8bit || _governor.eight_bit() );
+    if ( CMedia::eight_bit_caches() != old ) clear_caches();
+
+    char buf[64];
+    sprintf( buf, N_("QualityTier %d"), int( _governor.tier() ) );
+    send_network( buf );
+
+    redraw();
+}
+
+// Decode of the region of interest of an image on its own thread.  Kept
+// by the view until the thread ends, so the image outlives it.
+struct RoiFill
+{
+    mrv::media        fg;
+    std::atomic<bool> stop;
+    std::atomic<bool> done;
+    std::atomic<bool> ready;   //<- a step was decoded since last looked
+    boost::thread*    thread;
+
+    RoiFill( const mrv::media& m ) :
+        fg( m ),
+        stop( false ),
+        done( false ),
+        ready( false ),
+        thread( NULL )
+    {
+    }
+
+    ~RoiFill()
+    {
+        if ( thread )
+        {
+            thread->join();
+            delete thread;
+        }
+    }
+};
+
+static void roi_fill( RoiFill* s )
+{
+    CMedia* img = s->fg->image();
+
+    // What is shown, first
+    if ( img->roi_stale( img->left() ) )
+    {
+        img->roi_grow( 0 );
+        img->fetch_roi();
+        s->ready = true;
+    }
+
+    // Once the view has settled, fill the surroundings, doubling the
+    // margin each step, until the whole image or CMedia::kRoiMaxPixels
+    // is decoded.  Each step reads only what the last one did not.
+    static const int kRoiIdle = 500;  // in milliseconds
+    for ( int i = 0; i < kRoiIdle / 20 && !s->stop; ++i )
+        boost::this_thread::sleep( boost::posix_time::milliseconds( 20 ) );
+
+    unsigned grow = img->roi_grow();
+    while ( !s->stop )
+    {
+        mrv::image_type_ptr pic = img->left();
+        if ( !pic || !pic->partial() ) break;
+
+        img->roi_grow( ++grow );
+        if ( !img->fetch_roi() ) break;
+        s->ready = true;
+    }
+
+    s->done = true;
+}
+
+void ImageView::stop_roi_fill()
+{
+    std::list< boost::shared_ptr< RoiFill > >::iterator i = _roi_fills.begin();
+    std::list< boost::shared_ptr< RoiFill > >::iterator e = _roi_fills.end();
+    for ( ; i != e; ++i )
+        (*i)->stop = true;
+    _roi_filled = false;
+}
+
+void ImageView::update_roi()
+{
+    // Show the steps decoded and forget the fills that ended
+    std::list< boost::shared_ptr< RoiFill > >::iterator i = _roi_fills.begin();
+    while ( i != _roi_fills.end() )
+    {
+        if ( (*i)->ready.exchange( false ) ) redraw();
+        if ( (*i)->done ) i = _roi_fills.erase( i );
+        else ++i;
+    }
+
+    mrv::media fg = foreground();
+    if ( !fg || vr() )
+    {
+        stop_roi_fill();
+        return;
+    }
+
+    CMedia* img = fg->image();
+    mrv::image_type_ptr pic = img->left();
+    if ( !pic ) return;
+
+    // Whole data window, even when only part of it is decoded
+    mrv::Recti full = pic->partial() ? pic->full_window() :
+                      img->data_window();
+
+    // Corners of the view in image pixels
+    double x0 = 0, y0 = 0;
+    double x1 = w(), y1 = h();
+    image_coordinates( img, x0, y0 );
+    image_coordinates( img, x1, y1 );
+
+    int rx0 = (int) std::floor( std::min( x0, x1 ) - img->x() );
+    int ry0 = (int) std::floor( std::min( y0, y1 ) + img->y() );
+    int rx1 = (int) std::ceil( std::max( x0, x1 ) - img->x() );
+    int ry1 = (int) std::ceil( std::max( y0, y1 ) + img->y() );
+
+    mrv::Recti r( rx0, ry0, rx1 - rx0 + 1, ry1 - ry0 + 1 );
+    r.intersect( full );
+    if ( r.w() <= 0 || r.h() <= 0 ) return;
+
+    // A fill of another region or frame is of no use any more.  It is
+    // not waited for; it stops after the step it is decoding.
+    if ( r != img->roi() || img->frame() != _roi_frame )
+    {
+        stop_roi_fill();
+        img->roi( r );
+        _roi_frame = img->frame();
+    }
+
+    if ( playback() != CMedia::kStopped || !img->stopped() )
+    {
+        stop_roi_fill();
+        return;
+    }
+
+    if ( _roi_filled || !pic->partial() ) return;
+
+    boost::shared_ptr< RoiFill > f( new RoiFill( fg ) );
+    f->thread = new boost::thread( boost::bind( roi_fill, f.get() ) );
+    _roi_fills.push_back( f );
+    _roi_filled = true;
+}
 
 static void static_timeout( mrv::ImageView* v )
 {
@@ -1499,6 +1858,8 @@ posY( 22 ),
 flags( 0 ),
 _ghost_previous( 5 ),
 _ghost_next( 5 ),
+_sent_points( 0 ),
+_stroke_id( std::random_device()() ),
 _channel( 0 ),
 _old_channel( 0 ),
 _channelType( kRGB ),
@@ -1525,6 +1886,14 @@ _selected_image( NULL ),
 _selection( mrv::Rectd(0,0) ),
 _playback( CMedia::kStopped ),
 _network_active( true ),
+_sync_check( 0 ),
+_sync_starting( false ),
+_proxy_level( 0 ),
+_proxy_refetch( false ),
+_user_8bit( false ),
+_peer_tier( 0 ),
+_roi_frame( MRV_NOPTS_VALUE ),
+_roi_filled( false ),
 _interactive( true ),
 _frame( 1 ),
 _lastFrame( 0 )
@@ -1571,6 +1940,10 @@ ImageView::~ImageView()
 
     _clients.clear();
 
+    // Wait for the region of interest threads
+    stop_roi_fill();
+    _roi_fills.clear();
+
     // make sure to stop any playback
     stop_playback();
 
@@ -1898,7 +2271,8 @@ void ImageView::copy_pixel() const
     int xpr = int((double)xp / img->width());
     int ypr = pic->height() - int((double)yp / img->height()) - 1;
 
-    CMedia::Pixel rgba = pic->pixel( xpr, ypr );
+    CMedia::Pixel rgba = pic->pixel( xpr >> pic->proxy(),
+                                     ypr >> pic->proxy() );
     pixel_processed( img, rgba );
 
     mrv::Recti daw[2];
@@ -1938,6 +2312,12 @@ void ImageView::copy_pixel() const
             }
         }
 
+        if ( pic )
+        {
+            xp >>= pic->proxy();
+            yp >>= pic->proxy();
+        }
+
         if ( pic && xp < (int)pic->width() && yp < (int)pic->height() )
         {
             float r = rgba.r;
@@ -2507,6 +2887,10 @@ bool ImageView::should_update( mrv::media fg )
             img->image_damage( img->image_damage() & ~CMedia::kDamageThumbnail );
         }
 
+        // Headers read in the background for the attributes shown
+        if ( mrv::exrImage::attributes_ready() )
+            img->image_damage( img->image_damage() | CMedia::kDamageData );
+
         if ( img->image_damage() & CMedia::kDamageData )
         {
             update_image_info();
@@ -2540,19 +2924,9 @@ bool ImageView::should_update( mrv::media fg )
              uiMain->uiGL3dView->uiMain->shown() &&
              (img->image_damage() & CMedia::kDamage3DData) )
         {
-            int zsize = 0;
-            static Imf::Array< float* > zbuff;
-            static Imf::Array< unsigned > sampleCount;
-
-            size_t num = zbuff.size();
-            for ( size_t i = 0; i < num; ++i )
-            {
-                delete [] zbuff[i];
-            }
-
-
-            zbuff.resizeErase( 0 );
-            sampleCount.resizeErase( 0 );
+            // The 3D view points into the samples, so hold on to them
+            // until the next ones are loaded.
+            static mrv::DeepSamplesPtr deep;
 
             mrv::exrImage* exr = dynamic_cast< mrv::exrImage* >( img );
             if ( exr )
@@ -2561,17 +2935,18 @@ bool ImageView::should_update( mrv::media fg )
                 {
                     float zmin, zmax;
                     float farPlane = 1000000.0f;
-                    const mrv::Recti& daw = exr->data_window();
-                    exr->loadDeepData( zsize, zbuff, sampleCount );
-                    exr->findZBound( zmin, zmax, farPlane, zsize,
-                                     zbuff, sampleCount );
-                    uiMain->uiGL3dView->uiMain->load_data( zsize,
-                                                           zbuff,
-                                                           sampleCount,
-                                                           daw.w(), daw.h(),
-                                                           zmin, zmax,
-                                                           farPlane );
-                    uiMain->uiGL3dView->uiMain->redraw();
+                    mrv::DeepSamplesPtr samples = exr->loadDeepData();
+                    if ( samples )
+                    {
+                        samples->z_bound( zmin, zmax, farPlane );
+                        uiMain->uiGL3dView->uiMain->load_data(
+                            int( samples->pixels() ), samples->z(),
+                            samples->sample_counts(),
+                            samples->width(), samples->height(),
+                            zmin, zmax, farPlane );
+                        deep = samples;
+                        uiMain->uiGL3dView->uiMain->redraw();
+                    }
                 }
                 catch( const std::exception& e )
                 {
@@ -2580,6 +2955,14 @@ bool ImageView::should_update( mrv::media fg )
             }
             img->image_damage( img->image_damage() & ~CMedia::kDamage3DData );
         }
+        else if ( uiMain->uiGL3dView &&
+                  ( img->image_damage() & CMedia::kDamage3DData ) )
+        {
+            // Hidden.  Stop reading deep samples with each frame.
+            mrv::exrImage* exr = dynamic_cast< mrv::exrImage* >( img );
+            if ( exr ) exr->drop_deep();
+            img->image_damage( img->image_damage() & ~CMedia::kDamage3DData );
+        }
     }
 
     mrv::media bg = background();
@@ -3110,6 +3493,7 @@ again:
     case kSeek:
     {
         NET( "seek " << c.frame );
+        _sync_anchor.active = false;
         seek( c.frame );
         break;
     }
@@ -3119,6 +3503,32 @@ again:
         play_forwards();
         break;
     }
+    case kPlayAt:
+    {
+        Imf::V2dAttribute* attr = dynamic_cast< Imf::V2dAttribute* >( c.data );
+        if ( !attr )
+        {
+            LOG_ERROR( "PlayAt failed" );
+            break;
+        }
+        const Imath::V2d& v = attr->value();
+        NET( "playat " << c.frame << " at " << v[0] );
+        play_at( int64_t( v[0] ), c.frame, v[1] );
+        break;
+    }
+    case kQualityTier:
+    {
+        Imf::IntAttribute* attr = dynamic_cast< Imf::IntAttribute* >( c.data );
+        if ( !attr )
+        {
+            LOG_ERROR( "QualityTier failed" );
+            break;
+        }
+        NET( "qualitytier " << attr->value() );
+        _peer_tier = attr->value();
+        redraw();
+        break;
+    }
     case kPlayBackwards:
     {
         NET( "playbwd" );
@@ -3436,6 +3846,29 @@ void ImageView::timeout()
     }
 
 
+    correct_drift();
+
+    update_quality();
+
+    update_proxy_level();
+
+    update_roi();
+
+    // Thumbnails finished in the background are picked up on redraw
+    if ( ThumbnailCache::ready() ) b->redraw();
+
+    // So are waveforms
+    if ( AudioPeaks::ready() )
+    {
+        timeline()->redraw();
+        if ( uiMain->uiEDLWindow )
+            uiMain->uiEDLWindow->uiEDLGroup->redraw();
+    }
+
+    // And filmstrip tiles
+    if ( Filmstrip::ready() && uiMain->uiEDLWindow )
+        uiMain->uiEDLWindow->uiEDLGroup->redraw();
+
     double delay = 0.005;
     if ( fg )
     {
@@ -3729,7 +4162,10 @@ void ImageView::draw()
         SCOPED_LOCK( mtx );
 
         DBGM3( __FUNCTION__ << " " << __LINE__ );
+        int64_t start = ClockSync::now();
         _engine->draw_images( images );
+        if ( playback() != CMedia::kStopped )
+            _governor.draw_time( ClockSync::now() - start );
     }
 
     TRACE("");
@@ -4026,6 +4462,18 @@ void ImageView::draw()
             hud << buf;
             sprintf( buf, _("FPS: %.3f" ), img->actual_frame_rate() );
             hud << buf;
+            if ( _governor.tier() != PlaybackGovernor::kFull )
+            {
+                sprintf( buf, _(" Q: %s"),
+                         PlaybackGovernor::tier_name( _governor.tier() ) );
+                hud << buf;
+            }
+            if ( _peer_tier != PlaybackGovernor::kFull )
+            {
+                sprintf( buf, _(" Peer Q: %s"),
+                         PlaybackGovernor::tier_name( _peer_tier ) );
+                hud << buf;
+            }
         }
 
 
@@ -4072,10 +4520,32 @@ void ImageView::draw()
 
         draw_text( r, g, b, 5, y, buf );
         y -= yi;
+
+        size_t frames;
+        double ratio, mbps;
+        mrv::PackedCache::stats( frames, ratio, mbps );
+        if ( frames > 0 )
+        {
+            sprintf( buf, _("Packed: %" PRIu64 " frames  %.1f:1  %.0f MB/s"),
+                     (uint64_t) frames, ratio, mbps );
+            draw_text( r, g, b, 5, y, buf );
+            y -= yi;
+        }
+
+        size_t shared;
+        mrv::FrameRegistry::stats( frames, shared );
+        if ( shared > 0 )
+        {
+            sprintf( buf, _("Shared: %" PRIu64 " of %" PRIu64 " frames"),
+                     (uint64_t) shared, (uint64_t) frames );
+            draw_text( r, g, b, 5, y, buf );
+            y -= yi;
+        }
     }
 
     if ( _hud & kHudAttributes )
     {
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
         const CMedia::Attributes& attributes = img->attributes();
         CMedia::Attributes::const_iterator i = attributes.begin();
         CMedia::Attributes::const_iterator e = attributes.end();
@@ -4314,7 +4784,7 @@ int ImageView::leftMouseDown(int x, int y)
                         _selected_image = img;
                         return 1;
                     }
-                    p = pic->pixel( xp, yp );
+                    p = pic->pixel( xp >> pic->proxy(), yp >> pic->proxy() );
                 }
                 if ( outside || !pic || (img->has_alpha() && p.a < 0.0001f) ) {
                     // draw image without borders (in case this was selected
@@ -4409,6 +4879,7 @@ int ImageView::leftMouseDown(int x, int y)
 
             mrv::Point p( xf, yf );
             s->pts.push_back( p );
+            _sent_points = 0;
 
             send_network( str );
 
@@ -4886,7 +5357,7 @@ void ImageView::leftMouseUp( int x, int y )
         }
         else
         {
-            send_network( s->send() );
+            send_path_points( s );
         }
     }
     else if ( _mode == kErase )
@@ -4899,7 +5370,7 @@ void ImageView::leftMouseUp( int x, int y )
         }
         else
         {
-            send_network( s->send() );
+            send_path_points( s );
         }
     }
     else if ( _mode == kText )
@@ -4921,6 +5392,7 @@ void ImageView::leftMouseUp( int x, int y )
     //     _mode = kNoAction;
     // }
 
+    _sent_points = 0;
 }
 
 bool ImageView::has_redo() const
@@ -5501,9 +5973,13 @@ void ImageView::picture_coordinates( const CMedia* const img, const int x,
 
     if (!pic) return;
 
+    // A proxy holds 1/2^proxy of the pixels but covers the full data window
+    const unsigned short proxy = pic->proxy();
+    const int pw = int( pic->width() ) << proxy;
+    const int ph = int( pic->height() ) << proxy;
 
-    if ( xp < 0 || xp >= (int)((double)pic->width()*img->scale_x()) ||
-            yp < 0 || yp >= (int)((double)pic->height()*img->scale_y()) )
+    if ( xp < 0 || xp >= (int)((double)pw*img->scale_x()) ||
+            yp < 0 || yp >= (int)((double)ph*img->scale_y()) )
     {
         outside = true;
     }
@@ -5559,7 +6035,7 @@ void ImageView::mouseMove(int x, int y)
     double xpct = 1.0 / img->scale_x();
     double ypct = 1.0 / img->scale_y();
 
-    int ypr = pic->height() - yp - 1;
+    int ypr = ( int( pic->height() ) << pic->proxy() ) - yp - 1;
     char buf[40];
     sprintf( buf, "%5d, %5d", xp, ypr );
     uiMain->uiCoord->value(buf);
@@ -5578,7 +6054,7 @@ void ImageView::mouseMove(int x, int y)
 
         xp = int( (double)xp * xpct );
         yp = int( (double)yp * ypct );
-        rgba = pic->pixel( xp, yp );
+        rgba = pic->pixel( xp >> pic->proxy(), yp >> pic->proxy() );
 
 
 
@@ -5631,15 +6107,16 @@ void ImageView::mouseMove(int x, int y)
             }
             if ( pic )
             {
+                const unsigned short proxy = pic->proxy();
                 outside = false;
-                if ( xp < 0 || xp >= (int)pic->width() ||
-                     yp < 0 || yp >= (int)pic->height() )
+                if ( xp < 0 || xp >= ( int( pic->width() ) << proxy ) ||
+                     yp < 0 || yp >= ( int( pic->height() ) << proxy ) )
                     outside = true;
 
                 if (!outside)
                 {
                     float r = rgba.r;
-                    rgba = pic->pixel( xp, yp );
+                    rgba = pic->pixel( xp >> proxy, yp >> proxy );
                     pixel_processed( img, rgba );
 
                     if ( normalize() )
@@ -5716,7 +6193,7 @@ void ImageView::mouseMove(int x, int y)
             }
             else
             {
-                bg = picb->pixel( xp, yp );
+                bg = picb->pixel( xp >> picb->proxy(), yp >> picb->proxy() );
                 pixel_processed( bgr, bg );
             }
 
@@ -6206,6 +6683,9 @@ void ImageView::mouseDrag(int x,int y)
 
                     mrv::Point p( xn, yn );
                     s->pts.push_back( p );
+
+                    // Stream the stroke while it is drawn
+                    send_path_points( s );
                 }
             }
             else if ( _mode == kText )
@@ -7346,9 +7826,21 @@ void ImageView::toggle_3d_view( bool show )
     else
     {
         uiMain->uiGL3dView->uiMain->show();
+        reload_3d_data();
     }
 }
 
+// Samples are dropped while the 3D view is hidden
+void ImageView::reload_3d_data()
+{
+    mrv::media fg = foreground();
+    if ( !fg ) return;
+
+    CMedia* img = fg->image();
+    img->image_damage( img->image_damage() | CMedia::kDamage3DData );
+    redraw();
+}
+
 void ImageView::toggle_media_info( bool show )
 {
     if ( !show )
@@ -8158,6 +8650,7 @@ float ImageView::calculate_fstop( float exposure ) const
     {
         CMedia* img = fg->image();
 
+        CMedia::Mutex::scoped_lock lk_attrs( img->attrs_mutex() );
         CMedia::Attributes& attrs = img->attributes();
         CMedia::Attributes::const_iterator i = attrs.find( N_("F Number") );
         if ( i == attrs.end() )
@@ -9432,6 +9925,9 @@ void ImageView::playback( const CMedia::Playback b )
 
     _playback = b;
 
+    // Filmstrips are decoded only while stopped
+    Filmstrip::pause( b != CMedia::kStopped );
+
     _lastFrame = frame();
     _last_fps = 0.0;
 
@@ -9477,7 +9973,29 @@ void ImageView::play( const CMedia::Playback dir )
 
     if ( dir == CMedia::kForwards )
     {
-        send_network(N_("playfwd"));
+        if ( _network_active && !_clients.empty() )
+        {
+            // Start all stations at the same wall-clock time, leaving
+            // enough lead for the message to reach them.
+            int64_t lead = kSyncLead;
+            if ( !_server )
+            {
+                int64_t latency = _clients.front()->clock.latency();
+                if ( 4 * latency > lead ) lead = 4 * latency;
+            }
+            int64_t start = session_time() + lead;
+            double fps = uiMain->uiFPS->value();
+            int64_t f = frame();
+
+            char buf[256];
+            sprintf( buf, N_("PlayAt %" PRId64 " %" PRId64 " %g"),
+                     start, f, fps );
+            send_network( buf );
+
+            play_at( start, f, fps );
+            return;
+        }
+        if ( !_sync_starting ) _sync_anchor.active = false;
     }
     else if ( dir == CMedia::kBackwards )
     {
@@ -9508,6 +10026,8 @@ void ImageView::play( const CMedia::Playback dir )
         _preframe = frame();
     }
 
+    // The region of interest threads would decode alongside playback
+    stop_roi_fill();
 
     playback( dir );
 
@@ -9515,6 +10035,9 @@ void ImageView::play( const CMedia::Playback dir )
 
     double fps = uiMain->uiFPS->value();
 
+    _user_8bit = CMedia::eight_bit_caches();
+    _governor.start( fps );
+
     create_timeout( 0.5/fps );
 
     // if ( !img->is_sequence() || img->is_cache_full() || (bg && fg != bg) ||
@@ -9583,16 +10106,38 @@ void ImageView::stop()
 {
 
     if ( playback() == CMedia::kStopped ) {
+        // Cancel a pending synchronized start
+        _sync_anchor.active = false;
         return;
     }
 
     _playback = CMedia::kStopped;
+    Filmstrip::pause( false );
 
     _last_fps = 0.0;
     _real_fps = 0.0;
 
     stop_playback();
 
+    // Back to full quality.  update_proxy_level() fetches the full
+    // resolution frame in place of the proxy.
+    if ( _governor.tier() != PlaybackGovernor::kFull )
+    {
+        if ( _governor.eight_bit() ) CMedia::eight_bit_caches( _user_8bit );
+        _governor.reset();
+        send_network( N_("QualityTier 0") );
+    }
+
+    if ( _sync_anchor.active )
+    {
+        // Restore the play rate the drift correction may have nudged
+        _sync_anchor.active = false;
+        mrv::media fg = foreground();
+        if ( fg ) fg->image()->play_fps( _sync_anchor.fps );
+        mrv::media bg = background();
+        if ( bg ) bg->image()->play_fps( _sync_anchor.fps );
+    }
+
 
     if ( uiMain->uiPlayForwards )
         uiMain->uiPlayForwards->value(0);
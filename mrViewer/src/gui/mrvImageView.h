@@ -29,6 +29,7 @@
 #define mrvImageView_h
 
 #include <map>
+#include <list>
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
 
@@ -39,6 +40,8 @@
 
 #include "core/mrvRectangle.h"
 #include "core/mrvTimer.h"
+#include "core/mrvClockSync.h"
+#include "core/mrvPlaybackGovernor.h"
 #include "core/mrvServer.h"
 #include "core/mrvClient.h"
 #include "core/Sequence.h"
@@ -62,6 +65,7 @@ class DrawEngine;
 class Event;
 class Parser;
 class server;
+struct RoiFill;
 
 class ImageView : public Fl_Gl_Window
 {
@@ -113,6 +117,8 @@ public:
         kLUT_CHANGE = 42,
         kZoomChange = 43,
         kOCIOViewChange = 44,
+        kPlayAt        = 45,
+        kQualityTier   = 46,
         kLastCommand
     };
 
@@ -487,12 +493,24 @@ public:
     /// Play backwards
     void play_backwards();
 
+    /// Start playing forwards at session time start (in microseconds),
+    /// from frame f at fps.  Used to start all sync stations together.
+    void play_at( const int64_t start, const int64_t f, const double fps );
+
+    /// Called when the time set in play_at is reached
+    void play_at_reached();
+
     /// Scrub sequence
     void scrub( double dy );
 
     /// Stop
     void stop();
 
+    /// Playback quality governor, fed by the video threads
+    inline PlaybackGovernor& governor() {
+        return _governor;
+    }
+
     /// Change audio stream
     void audio_stream( unsigned int idx );
 
@@ -548,6 +566,9 @@ public:
     void toggle_stereo_options(bool show);
     void toggle_paint_tools(bool show);
     void toggle_3d_view(bool show);
+
+    // Have the 3D view load the deep samples of the foreground again
+    void reload_3d_data();
     void toggle_histogram(bool show);
     void toggle_vectorscope(bool show);
     void toggle_waveform(bool show);
@@ -682,6 +703,36 @@ public:
 
     void send_network( std::string msg ) const;
 
+    /// Send the points of path shape s not sent yet, or the whole shape
+    /// if none were.
+    void send_path_points( GLPathShape* s );
+
+    /// Current time of the sync session's clock (the server's) in
+    /// microseconds.
+    int64_t session_time() const;
+
+    /// Nudge play rate or skip frames to stay in step with the
+    /// synchronized playback anchor.
+    void correct_drift();
+
+    /// Let the images decode at the coarsest resolution the current zoom
+    /// shows without loss while playing.  Full resolution is fetched
+    /// again on stop.
+    void update_proxy_level();
+
+    /// Let the governor pick a playback quality tier from the measured
+    /// frame costs and apply it.
+    void update_quality();
+
+    /// Pass the visible part of the foreground image down to it, so very
+    /// large images decode only that.  A background thread decodes it
+    /// and, once the view settles, the surroundings progressively up to
+    /// the whole image.
+    void update_roi();
+
+    /// Ask the threads decoding the region of interest to stop
+    void stop_roi_fill();
+
     GLShapeList& shapes();
 
     void add_shape( shape_type_ptr shape );
@@ -918,6 +969,9 @@ protected:
     short       _ghost_previous;
     short       _ghost_next;
 
+    size_t      _sent_points;  //<- points of the stroke being drawn sent
+    boost::uint32_t _stroke_id; //<- id of the last stroke sent, random start
+
     //! Channel index
     unsigned short     _channel;
     unsigned short     _old_channel; // previously selected color channel
@@ -977,6 +1031,17 @@ protected:
     std::atomic<CMedia::Playback>   _playback;         //!< status of view
 
     bool _network_active;  //<- whether to send commands across the network
+    mrv::PlaybackAnchor _sync_anchor;  //<- synchronized playback start
+    int64_t  _sync_check;  //<- session time of last drift correction
+    bool     _sync_starting; //<- play() called for a synchronized start
+    unsigned _proxy_level; //<- resolution reduction requested from images
+    bool     _proxy_refetch; //<- full resolution must replace proxies
+    mrv::PlaybackGovernor _governor; //<- playback quality tier
+    bool     _user_8bit;   //<- 8-bit caches setting before governor
+    int      _peer_tier;   //<- quality tier of the sync peer
+    int64_t  _roi_frame;   //<- frame the region of interest was filled for
+    bool     _roi_filled;  //<- a fill was started for the region and frame
+    std::list< boost::shared_ptr< RoiFill > > _roi_fills; //<- running fills
     bool _interactive;     //<- whether fltk should update (Fl::check)
 
     ///////////////////
@@ -32,9 +32,9 @@
 
 #include <math.h>
 
+#include <string.h>
+
 #include <FL/Fl_Shared_Image.H>
-#include <ImathMath.h>   // for Imath::clamp
-// #include <ImathFun.h>   // for Imath::pow
 
 #include "core/mrvThread.h"
 #include "core/CMedia.h"
@@ -44,10 +44,6 @@
 #include "gui/mrvPreferences.h"
 #include "gui/mrvMedia.h"
 
-#ifdef _WIN32
-#define isfinite(x) _finite(x)
-#endif
-
 #undef IMG_ERROR
 #define IMG_ERROR(x) LOG_ERROR( name() << " - " << x )
 
@@ -92,131 +88,107 @@ int64_t media::position() const {
     return _image->position();
 }
 
-void media::thumbnail_pixel( uchar*& ptr, uchar r, uchar g, uchar b )
+void media::thumbnail( const ThumbnailCache::Thumbnail& t,
+                       const std::string& key )
 {
-    *ptr++ = r;
-    *ptr++ = g;
-    *ptr++ = b;
-}
+    delete _thumbnail;
 
+    size_t size = size_t(t.width) * t.height * 3;
+    uchar* data = new uchar[ size ];
+    memcpy( data, t.data.get(), size );
+    _thumbnail = new Fl_RGB_Image( data, t.width, t.height, 3 );
+    _thumbnail->alloc_array = 1;
+    _thumbnail_key = key;
+}
 
-void media::create_thumbnail()
+void media::create_thumbnail( const bool async )
 {
     if ( (!_image->stopped()) || thumbnail_frozen() ) return;
 
+    ThumbnailCache::Request r;
 
-    // Make sure frame memory is not deleted
-    Mutex& mutex = _image->video_mutex();
-    SCOPED_LOCK( mutex );
-
+    {
+        // Make sure frame memory is not deleted
+        Mutex& mutex = _image->video_mutex();
+        SCOPED_LOCK( mutex );
 
-    // Audio only clip?  Return
-    mrv::image_type_ptr pic = _image->left();
 
-    if ( !pic ) {
-        LOG_ERROR( _("Empty pic file for media ") << _image->name() );
-        return;
-    }
+        // Audio only clip?  Return
+        mrv::image_type_ptr pic = _image->left();
 
-    unsigned dw = pic->width();
-    unsigned dh = pic->height();
-    if ( dw == 0 || dh == 0 ) {
-        LOG_ERROR( _("Media file has zero size in width or height") );
-        return;
-    }
+        if ( !pic ) {
+            LOG_ERROR( _("Empty pic file for media ") << _image->name() );
+            return;
+        }
 
-    unsigned int h = _thumbnail_height;
+        unsigned dw = pic->width();
+        unsigned dh = pic->height();
+        if ( dw == 0 || dh == 0 ) {
+            LOG_ERROR( _("Media file has zero size in width or height") );
+            return;
+        }
 
-    float yScale = (float)(h+0.5) / (float)dh;
-    unsigned int w = unsigned( (float)(dw+0.5) * (float)yScale );
-    if ( w > 150 ) w = 150;
+        unsigned int h = _thumbnail_height;
 
-    // Resize image to thumbnail size
-    pic.reset( pic->quick_resize( w, h ) );
+        float yScale = (float)(h+0.5) / (float)dh;
+        unsigned int w = unsigned( (float)(dw+0.5) * (float)yScale );
+        if ( w > 150 ) w = 150;
 
-    if ( mrv::Preferences::use_ocio )
-    {
-        mrv::image_type_ptr ptr;
-        if ( pic->pixel_type() == mrv::image_type::kFloat )
-        {
-            ptr = pic;
-        }
-        else if ( pic->pixel_type() == mrv::image_type::kHalf )
-        {
-            ptr = image_type_ptr( new image_type(
-                                  pic->frame(),
-                                  w, h, 3,
-                                  image_type::kRGB,
-                                  image_type::kFloat ) );
-            copy_image( ptr, pic );
-        }
-        if ( pic->pixel_type() == mrv::image_type::kFloat ||
-             pic->pixel_type() == mrv::image_type::kHalf )
+        // The file is only looked at once, not on every redraw
+        std::string path = ThumbnailCache::path( _image, pic->frame() );
+        if ( path != _thumbnail_path )
         {
-            bake_ocio( ptr, _image );
-            pic = ptr;
+            _thumbnail_path  = path;
+            _thumbnail_stamp = ThumbnailCache::stamp( path );
         }
-    }
 
-    w = pic->width();
-    h = pic->height();
-
-    delete _thumbnail;
+        r.key = ThumbnailCache::key( _image, pic, w, h, _thumbnail_stamp );
+        if ( ! r.key.empty() )
+        {
+            // Browser redraws call us all the time.  Nothing changed.
+            if ( _thumbnail && r.key == _thumbnail_key ) return;
 
-    uchar* data = new uchar[ w * h * 3 ];
-    _thumbnail = new Fl_RGB_Image( data, w, h, 3 );
-    _thumbnail->alloc_array = 1;
+            ThumbnailCache::Thumbnail t;
+            if ( ThumbnailCache::find( r.key, t ) )
+            {
+                thumbnail( t, r.key );
+                _image->image_damage( _image->image_damage() &
+                                      ~CMedia::kDamageThumbnail );
+                return;
+            }
+        }
 
-    if ( !_thumbnail )
-    {
-        IMG_ERROR( _("Could not create thumbnail picture for '")
-                   << _image->fileroot() << "'" );
-        return;
+        // Resize image to thumbnail size.  This is a copy, so the rest
+        // can be done without the lock.
+        r.pic.reset( pic->quick_resize( w, h ) );
+        r.width = w;
+        r.height = h;
     }
 
-    uchar* ptr = data;
+    r.gamma = _image->gamma();
+    r.flipX = _image->flipX();
+    r.flipY = _image->flipY();
+    r.ocio = mrv::Preferences::use_ocio;
+    r.ics = _image->ocio_input_color_space();
 
-    // Copy to thumbnail and gamma it
-    float gamma = 1.0f / _image->gamma();
-    int yinc = 1;
-    int ymin = 0;
-    int ymax = h;
-    if ( _image->flipY() )
-    {
-        yinc = -1;
-        ymin = h - 1;
-        ymax = -1;
-    }
-    int xinc = 1;
-    int xmin = 0;
-    int xmax = w;
-    if ( _image->flipX() )
+    // Processors must be built on this thread (see prepare_ocio).
+    if ( r.ocio ) prepare_ocio( r.ics );
+
+    if ( async && ! r.key.empty() )
     {
-        xinc = -1;
-        xmin = w - 1;
-        xmax = -1;
+        ThumbnailCache::request( r );
     }
-    for (int y = ymin; y != ymax; y += yinc )
+    else
     {
-        for (int x = xmin; x != xmax; x += xinc )
+        ThumbnailCache::Thumbnail t;
+        if ( ! ThumbnailCache::render( r, t ) )
         {
-            CMedia::Pixel fp = pic->pixel( x, y );
-            if ( gamma != 1.0f )
-            {
-                using namespace std;
-                if ( isfinite( fp.r ) )
-                    fp.r = Imath::Math<float>::pow( fp.r, gamma );
-                if ( isfinite( fp.g ) )
-                    fp.g = Imath::Math<float>::pow( fp.g, gamma );
-                if ( isfinite( fp.b ) )
-                    fp.b = Imath::Math<float>::pow( fp.b, gamma );
-            }
-
-            uchar r = (uchar)(Imath::clamp(fp.r, 0.f, 1.f) * 255.0f);
-            uchar g = (uchar)(Imath::clamp(fp.g, 0.f, 1.f) * 255.0f);
-            uchar b = (uchar)(Imath::clamp(fp.b, 0.f, 1.f) * 255.0f);
-            thumbnail_pixel( ptr, r, g, b );
+            IMG_ERROR( _("Could not create thumbnail picture for '")
+                       << _image->fileroot() << "'" );
+            return;
         }
+        if ( ! r.key.empty() ) ThumbnailCache::insert( r.key, t );
+        thumbnail( t, r.key );
     }
 
     _image->image_damage( _image->image_damage() &
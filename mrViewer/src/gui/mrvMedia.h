@@ -33,6 +33,7 @@
 #include <boost/shared_ptr.hpp>
 
 #include "core/CMedia.h"
+#include "gui/mrvThumbnailCache.h"
 
 
 namespace mrv {
@@ -91,13 +92,20 @@ public:
         _thumbnail_frozen = t;
     }
 
-    void create_thumbnail();
+    // Update the thumbnail from the current picture.  Thumbnails come
+    // from ThumbnailCache; on a miss they are rendered in the background
+    // unless async is false.
+    void create_thumbnail( const bool async = true );
 
 protected:
-    void thumbnail_pixel( uchar*& ptr, uchar r, uchar g, uchar b );
+    void thumbnail( const ThumbnailCache::Thumbnail& t,
+                    const std::string& key );
 
     CMedia*   _image;
     Fl_RGB_Image* _thumbnail;
+    std::string   _thumbnail_key;
+    std::string   _thumbnail_path;   //!< file of the last thumbnail
+    std::string   _thumbnail_stamp;  //!< and its ThumbnailCache::stamp()
     bool         _thumbnail_frozen;
     bool         _own_image;
 
@@ -34,6 +34,7 @@
 #include "gui/mrvReelList.h"
 #include "gui/mrvElement.h"
 #include "gui/mrvImageInformation.h"
+#include "gui/mrvFilmstrip.h"
 #include "gui/mrvHotkey.h"
 #include "gui/mrvIO.h"
 #include "gui/mrvPreferences.h"
@@ -772,6 +773,18 @@ void media_track::draw()
             mrv::Recti ra(rx+dx, h()+y()-20, dw, 20 );
             fl_rectf( ra.x(), ra.y(), ra.w(), ra.h() );
 
+            AudioPeaks::PyramidPtr peaks = AudioPeaks::find( img, stream );
+            if ( peaks && fps > 0.0 )
+            {
+                // The box starts offset frames into the audio
+                double t0 = offset >= 0 ? offset / fps : 0.0;
+                double t1 = t0 + ( pos + last - offset - first ) / fps;
+                Fl_Color c = fl_color();
+                fl_color( fl_darker( c ) );
+                Timeline::draw_peaks( *peaks, ra, t0, t1 );
+                fl_color( c );
+            }
+
             if ( _selected && _selected->media() == fg )
                 fl_color( FL_WHITE );
             else
@@ -811,7 +824,33 @@ void media_track::draw()
 
         Fl_Image* thumb = fg->thumbnail();
 
-        if ( thumb && dw > thumb->w() )
+        // Filmstrip of frames along the clip, above the audio box.  Tiles
+        // not decoded yet are filled in as they arrive.
+        unsigned th = h() > 28 ? unsigned( h() - 26 ) : 0;
+        int tw = 0;
+        if ( th > 0 && img->height() > 0 )
+            tw = int( th * double( img->width() ) / img->height() + 0.5 );
+        if ( tw > 0 && dw > tw && img->has_picture() )
+        {
+            fl_push_clip( r.x(), r.y(), r.w(), r.h() );
+            for ( int tx = 0; tx < dw; tx += tw )
+            {
+                if ( !fl_not_clipped( r.x() + tx, y() + 2, tw, th ) )
+                    continue;
+
+                int64_t f = img->first_frame() +
+                            int64_t( ( tx + tw / 2 ) * double( fg->duration() )
+                                     / dw );
+                Filmstrip::Tile tile;
+                if ( Filmstrip::find( img, f, th, tile ) )
+                    fl_draw_image( tile.data.get(), r.x() + tx, y() + 2,
+                                   tile.width, tile.height, 3 );
+                else if ( tx == 0 && thumb )
+                    thumb->draw( r.x() + 2, y() + 2 );
+            }
+            fl_pop_clip();
+        }
+        else if ( thumb && dw > thumb->w() )
         {
             thumb->draw( r.x()+2, y()+2 );
         }
@@ -52,10 +52,12 @@ namespace fs = boost::filesystem;
 
 // CORE classes
 #include "core/exrImage.h"
+#include "core/hdrImage.h"
 #include "core/R3dImage.h"
 #include "core/mrvAudioEngine.h"
 #include "core/mrvException.h"
 #include "core/mrvColorProfile.h"
+#include "core/mrvDiskCache.h"
 #include "core/mrvHome.h"
 #include "core/mrvI8N.h"
 #include "core/mrvOS.h"
@@ -786,6 +788,23 @@ Preferences::Preferences( PreferencesUI* uiPrefs )
     uiPrefs->uiPrefs8BitCaches->value( (bool) tmp );
     CMedia::eight_bit_caches( (bool) tmp );
 
+    caches.get( "hdr_half", tmp, 0 );
+    uiPrefs->uiPrefsHDRHalf->value( (bool) tmp );
+    hdrImage::half_float( (bool) tmp );
+
+    caches.get( "packed_caches", tmp, 0 );
+    uiPrefs->uiPrefsPackedCache->value( (bool) tmp );
+    CMedia::packed_caches( (bool) tmp );
+
+    caches.get( "exr_all_layers", tmp, 0 );
+    uiPrefs->uiPrefsEXRLayers->value( (bool) tmp );
+    exrImage::joint_layers( (bool) tmp );
+
+    caches.get( "disk_cache_size", tmpF, 0.0f );
+    uiPrefs->uiPrefsDiskCacheSize->value( tmpF );
+    caches.get( "disk_cache_dir", tmpS, "", 2048 );
+    uiPrefs->uiPrefsDiskCacheDir->value( tmpS );
+
     DBG3;
 
     caches.get( "fps", tmp, 1 );
@@ -1891,9 +1910,19 @@ void Preferences::run( ViewerUI* main )
 					 1000000000.0 );
     if ( max_memory <= 0 ) max_memory = 1000000000;
 	DBG3;
+    DiskCache::directory( uiPrefs->uiPrefsDiskCacheDir->value() );
+    DiskCache::quota( (int64_t)( uiPrefs->uiPrefsDiskCacheSize->value() *
+                                 1000000000.0 ) );
     bool old = CMedia::eight_bit_caches();
     CMedia::eight_bit_caches( (bool) uiPrefs->uiPrefs8BitCaches->value() );
+    bool old_half = hdrImage::half_float();
+    hdrImage::half_float( (bool) uiPrefs->uiPrefsHDRHalf->value() );
+    exrImage::joint_layers( (bool) uiPrefs->uiPrefsEXRLayers->value() );
+    bool old_packed = CMedia::packed_caches();
+    CMedia::packed_caches( (bool) uiPrefs->uiPrefsPackedCache->value() );
     if ( !CMedia::cache_active() || CMedia::eight_bit_caches() != old ||
+	 hdrImage::half_float() != old_half ||
+	 CMedia::packed_caches() != old_packed ||
 	    CMedia::cache_scale() != scale )
     {
 	view->clear_caches();
@@ -2339,10 +2368,16 @@ void Preferences::save()
     caches.set( "preload", (int) uiPrefs->uiPrefsPreloadCache->value() );
     caches.set( "scale", (int) uiPrefs->uiPrefsCacheScale->value() );
     caches.set( "8bit_caches", (int) uiPrefs->uiPrefs8BitCaches->value() );
+    caches.set( "hdr_half", (int) uiPrefs->uiPrefsHDRHalf->value() );
+    caches.set( "packed_caches", (int) uiPrefs->uiPrefsPackedCache->value() );
+    caches.set( "exr_all_layers", (int) uiPrefs->uiPrefsEXRLayers->value() );
     caches.set( "fps", (int) uiPrefs->uiPrefsCacheFPS->value() );
     caches.set( "size", (int) uiPrefs->uiPrefsCacheSize->value() );
 
     caches.set( "cache_memory", (float)uiPrefs->uiPrefsCacheMemory->value() );
+    caches.set( "disk_cache_size",
+                (float)uiPrefs->uiPrefsDiskCacheSize->value() );
+    caches.set( "disk_cache_dir", uiPrefs->uiPrefsDiskCacheDir->value() );
 
     Fl_Preferences loading( base, "loading" );
     loading.set( "load_library", uiPrefs->uiPrefsLoadLibrary->value() );
@@ -0,0 +1,314 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvThumbnailCache.cpp
+ * @author gga
+ * @date   Sun Oct 18 18:10:22 2026
+ *
+ * @brief  Persistent, content addressed cache of reel thumbnails with
+ *         background generation.
+ *
+ */
+
+#define __STDC_LIMIT_MACROS
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include <math.h>
+#include <cstdio>
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/filesystem.hpp>
+
+#include <ImathMath.h>   // for Imath::clamp
+
+#include "core/CMedia.h"
+#include "core/mrvHome.h"
+#include "core/mrvColorOps.h"
+#include "core/mrvBackgroundCache.h"
+#include "gui/mrvIO.h"
+#include "gui/mrvPreferences.h"
+#include "gui/mrvThumbnailCache.h"
+
+#ifdef _WIN32
+#define isfinite(x) _finite(x)
+#endif
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+const char* kModule = "thumb";
+
+// Thumbnails kept in memory.  At 150x64 this is about 15Mb.
+const size_t kMaxMemoryThumbnails = 512;
+
+// Thumbnails kept on disk before the oldest ones are removed.
+const size_t kMaxDiskThumbnails = 8192;
+
+const unsigned kMaxWorkers = 4;
+
+const char* kMagic = "mrvthumb 1";
+
+typedef mrv::BackgroundCache< mrv::ThumbnailCache::Request,
+                              mrv::ThumbnailCache::Thumbnail > Cache;
+
+Cache _cache( &mrv::ThumbnailCache::process,
+              &mrv::ThumbnailCache::trim_disk,
+              kMaxMemoryThumbnails, 0,
+              std::min( kMaxWorkers,
+                        boost::thread::hardware_concurrency() ) );
+
+std::string filename( const std::string& key )
+{
+    return mrv::CacheFile::name( mrv::ThumbnailCache::directory(), key,
+                                 ".thumb" );
+}
+
+}
+
+namespace mrv {
+
+std::string ThumbnailCache::directory()
+{
+    return mrv::prefspath() + "thumbnails/";
+}
+
+std::string ThumbnailCache::path( const CMedia* img, const int64_t frame )
+{
+    if ( img->is_sequence() )
+        return img->sequence_filename( frame );
+    return img->fileroot();
+}
+
+std::string ThumbnailCache::stamp( const std::string& path )
+{
+    std::time_t mtime;
+    try
+    {
+        if ( !fs::is_regular_file( path ) ) return "";
+        mtime = fs::last_write_time( path );
+    }
+    catch( const fs::filesystem_error& )
+    {
+        return "";
+    }
+
+    char buf[32];
+    sprintf( buf, "\n%" PRId64, int64_t(mtime) );
+    return path + buf;
+}
+
+std::string ThumbnailCache::key( const CMedia* img,
+                                 const image_type_ptr& pic,
+                                 const unsigned width,
+                                 const unsigned height,
+                                 const std::string& stamp )
+{
+    if ( !img || !pic || stamp.empty() ) return "";
+
+    const int64_t frame = pic->frame();
+
+    char buf[256];
+    sprintf( buf, "\n%" PRId64 "\n%ux%u\n%g\n%d%d\n",
+             frame, width, height, img->gamma(),
+             (int)img->flipX(), (int)img->flipY() );
+
+    std::string key = stamp + buf;
+    if ( img->channel() ) key += img->channel();
+    key += '\n';
+
+    if ( Preferences::use_ocio && Preferences::OCIOConfig() )
+    {
+        key += Preferences::OCIOConfig()->getCacheID();
+        key += '|';
+        key += img->ocio_input_color_space();
+        key += '|';
+        key += Preferences::OCIO_Display;
+        key += '|';
+        key += Preferences::OCIO_View;
+    }
+    return key;
+}
+
+bool ThumbnailCache::find( const std::string& key, Thumbnail& t )
+{
+    if ( _cache.find( key, t ) ) return true;
+
+    // Being rendered.  Do not read a half written file.
+    if ( _cache.pending( key ) ) return false;
+
+    if ( ! load( key, t ) ) return false;
+
+    _cache.store( key, t );
+    return true;
+}
+
+bool ThumbnailCache::load( const std::string& key, Thumbnail& t )
+{
+    FILE* f = CacheFile::open( filename( key ), kMagic, key );
+    if ( !f ) return false;
+
+    bool ok = false;
+    unsigned w, h;
+    if ( fscanf( f, "%u %u", &w, &h ) == 2 && fgetc( f ) == '\n' &&
+         w > 0 && h > 0 && w <= 4096 && h <= 4096 )
+    {
+        size_t size = size_t(w) * h * 3;
+        boost::shared_array< unsigned char > data( new unsigned char[size] );
+        if ( fread( data.get(), 1, size, f ) == size )
+        {
+            t.width = w;
+            t.height = h;
+            t.data = data;
+            ok = true;
+        }
+    }
+    fclose( f );
+    return ok;
+}
+
+bool ThumbnailCache::write( FILE* f, const Thumbnail& t )
+{
+    fprintf( f, "%u %u\n", t.width, t.height );
+    size_t size = size_t(t.width) * t.height * 3;
+    return ( fwrite( t.data.get(), 1, size, f ) == size );
+}
+
+void ThumbnailCache::save( const std::string& key, const Thumbnail& t )
+{
+    CacheFile::save( filename( key ), kMagic, key,
+                     boost::bind( &ThumbnailCache::write, _1,
+                                  boost::cref( t ) ) );
+}
+
+void ThumbnailCache::trim_disk()
+{
+    CacheFile::trim( directory(), ".thumb", kMaxDiskThumbnails );
+}
+
+bool ThumbnailCache::render( const Request& r, Thumbnail& t )
+{
+    image_type_ptr pic = r.pic;
+    if ( !pic ) return false;
+
+    if ( r.ocio )
+    {
+        image_type_ptr ptr;
+        if ( pic->pixel_type() == image_type::kFloat )
+        {
+            ptr = pic;
+        }
+        else if ( pic->pixel_type() == image_type::kHalf )
+        {
+            ptr = image_type_ptr( new image_type( pic->frame(),
+                                                  pic->width(),
+                                                  pic->height(), 3,
+                                                  image_type::kRGB,
+                                                  image_type::kFloat ) );
+            copy_image( ptr, pic );
+        }
+        if ( ptr && apply_ocio( ptr, r.ics ) )
+            pic = ptr;
+    }
+
+    const unsigned w = pic->width();
+    const unsigned h = pic->height();
+
+    t.width = w;
+    t.height = h;
+    t.data.reset( new unsigned char[ w * h * 3 ] );
+
+    unsigned char* ptr = t.data.get();
+
+    // Copy to thumbnail and gamma it
+    float gamma = 1.0f / r.gamma;
+    int yinc = 1;
+    int ymin = 0;
+    int ymax = h;
+    if ( r.flipY )
+    {
+        yinc = -1;
+        ymin = h - 1;
+        ymax = -1;
+    }
+    int xinc = 1;
+    int xmin = 0;
+    int xmax = w;
+    if ( r.flipX )
+    {
+        xinc = -1;
+        xmin = w - 1;
+        xmax = -1;
+    }
+    for (int y = ymin; y != ymax; y += yinc )
+    {
+        for (int x = xmin; x != xmax; x += xinc )
+        {
+            CMedia::Pixel fp = pic->pixel( x, y );
+            if ( gamma != 1.0f )
+            {
+                using namespace std;
+                if ( isfinite( fp.r ) )
+                    fp.r = Imath::Math<float>::pow( fp.r, gamma );
+                if ( isfinite( fp.g ) )
+                    fp.g = Imath::Math<float>::pow( fp.g, gamma );
+                if ( isfinite( fp.b ) )
+                    fp.b = Imath::Math<float>::pow( fp.b, gamma );
+            }
+
+            *ptr++ = (unsigned char)(Imath::clamp(fp.r, 0.f, 1.f) * 255.0f);
+            *ptr++ = (unsigned char)(Imath::clamp(fp.g, 0.f, 1.f) * 255.0f);
+            *ptr++ = (unsigned char)(Imath::clamp(fp.b, 0.f, 1.f) * 255.0f);
+        }
+    }
+
+    return true;
+}
+
+void ThumbnailCache::request( const Request& r )
+{
+    _cache.request( r.key, r );
+}
+
+bool ThumbnailCache::process( const Request& r, Thumbnail& t )
+{
+    if ( ! render( r, t ) ) return false;
+    save( r.key, t );
+    return true;
+}
+
+void ThumbnailCache::insert( const std::string& key, const Thumbnail& t )
+{
+    save( key, t );
+    _cache.store( key, t );
+}
+
+bool ThumbnailCache::ready()
+{
+    return _cache.ready();
+}
+
+void ThumbnailCache::shutdown()
+{
+    _cache.shutdown();
+}
+
+} // namespace mrv
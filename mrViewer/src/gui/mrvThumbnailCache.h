@@ -0,0 +1,124 @@
+/*
+    mrViewer - the professional movie and flipbook playback
+    Copyright (C) 2007-2020  Gonzalo Garramuño
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file   mrvThumbnailCache.h
+ * @author gga
+ * @date   Sun Oct 18 18:10:22 2026
+ *
+ * @brief  Persistent, content addressed cache of reel thumbnails with
+ *         background generation.
+ *
+ */
+
+#ifndef mrvThumbnailCache_h
+#define mrvThumbnailCache_h
+
+#include <cstdio>
+#include <string>
+
+#include <boost/shared_array.hpp>
+
+#include "core/mrvFrame.h"
+
+namespace mrv {
+
+class CMedia;
+
+//
+// Thumbnails are keyed by everything that changes their pixels: file
+// path and modification time, frame, layer, size, gamma, flips and the
+// OCIO display transform.  Hits are served from memory or from
+// ~/.filmaura/thumbnails.  Misses are rendered by a small pool of worker
+// threads; ready() tells the UI when to redraw and look again.
+//
+class ThumbnailCache
+{
+  public:
+    struct Thumbnail
+    {
+        unsigned width;
+        unsigned height;
+        boost::shared_array< unsigned char > data;   // RGB, 8 bits
+
+        Thumbnail() : width( 0 ), height( 0 ) {}
+    };
+
+    struct Request
+    {
+        std::string    key;
+        image_type_ptr pic;     // already resized to thumbnail size
+        unsigned       width;
+        unsigned       height;
+        float          gamma;
+        bool           flipX;
+        bool           flipY;
+        bool           ocio;
+        std::string    ics;     // OCIO input color space
+    };
+
+  public:
+    /// File a frame of img comes from
+    static std::string path( const CMedia* img, const int64_t frame );
+
+    /// Path and modification time of a file.  Empty for anything that
+    /// is not a file on disk, which must not be cached.
+    static std::string stamp( const std::string& path );
+
+    /// Build the cache key for a picture of img, from the stamp() of
+    /// its file.  Empty if the stamp is.
+    static std::string key( const CMedia* img, const image_type_ptr& pic,
+                            const unsigned width, const unsigned height,
+                            const std::string& stamp );
+
+    /// Look up a thumbnail in memory, then on disk.
+    static bool find( const std::string& key, Thumbnail& t );
+
+    /// Queue a thumbnail for the worker threads, unless already queued.
+    static void request( const Request& r );
+
+    /// Render a thumbnail in the calling thread.  If r.ocio is set,
+    /// prepare_ocio() must have been called for r.ics.
+    static bool render( const Request& r, Thumbnail& t );
+
+    /// Add a thumbnail to memory and disk.
+    static void insert( const std::string& key, const Thumbnail& t );
+
+    /// True once after one or more queued thumbnails became available.
+    static bool ready();
+
+    /// Stop the worker threads, dropping queued requests.
+    static void shutdown();
+
+    /// Directory where thumbnails are stored
+    static std::string directory();
+
+    /// Render and save a queued thumbnail.  Run by the worker threads.
+    static bool process( const Request& r, Thumbnail& t );
+
+    /// Remove the oldest files when there are too many
+    static void trim_disk();
+
+  protected:
+    static bool load( const std::string& key, Thumbnail& t );
+    static bool write( FILE* f, const Thumbnail& t );
+    static void save( const std::string& key, const Thumbnail& t );
+};
+
+} // namespace mrv
+
+#endif // mrvThumbnailCache_h
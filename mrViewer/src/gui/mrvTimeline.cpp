@@ -504,6 +504,35 @@ void Timeline::draw_cacheline( CMedia* img, int64_t pos, int64_t size,
 }
 
 
+void Timeline::draw_peaks( const AudioPeaks::Pyramid& p,
+                           const mrv::Recti& r,
+                           const double t0, const double t1 )
+{
+    if ( r.w() <= 0 || r.h() <= 0 || t1 <= t0 ) return;
+
+    int mid  = r.y() + r.h() / 2;
+    int half = r.h() / 2;
+    double spp = ( t1 - t0 ) / r.w();
+
+    fl_line_style( FL_SOLID, 1 );
+    for ( int i = 0; i < r.w(); ++i )
+    {
+        int x = r.x() + i;
+        if ( !fl_not_clipped( x, r.y(), 1, r.h() ) ) continue;
+
+        float lo, hi;
+        if ( !p.range( t0 + i * spp, t0 + ( i + 1 ) * spp, lo, hi ) )
+            continue;
+
+        if ( lo < -1.0f ) lo = -1.0f;
+        if ( hi >  1.0f ) hi =  1.0f;
+
+        int y0 = mid - int( hi * half + 0.5f );
+        int y1 = mid - int( lo * half - 0.5f );
+        fl_yxline( x, y0, y1 );
+    }
+}
+
 void Timeline::draw_selection( const mrv::Recti& r )
 {
     int rx = r.x() + int(slider_size()-1)/2;
@@ -669,6 +698,28 @@ void Timeline::draw()
             }
         };
 
+        mrv::media m = browser()->current_image();
+        int stream = m ? m->image()->audio_stream() : -1;
+        AudioPeaks::PyramidPtr peaks;
+        if ( stream >= 0 ) peaks = AudioPeaks::find( m->image(), stream );
+        if ( peaks )
+        {
+            // Audio seconds of each frame, shifted by the audio offset
+            const CMedia* img = m->image();
+            double fps = img->fps();
+            int64_t first = img->first_frame() - img->audio_offset();
+            int rx = r.x() + int(slider_size()-1)/2;
+            int dx = rx + slider_position( mn, r.w() );
+            int end = rx + slider_position( mx, r.w() );
+
+            mrv::Recti wr( dx, r.y() + r.h()/2, end - dx, r.h()/2 - 8 );
+            fl_push_clip( wr.x(), wr.y(), wr.w(), wr.h() );
+            fl_color( fl_darker( FL_BLUE ) );
+            draw_peaks( *peaks, wr, ( mn - first ) / fps,
+                        ( mx - first ) / fps );
+            fl_pop_clip();
+        }
+
         if ( ( ! uiMain->uiPrefs->uiPrefsTimelineSelectionDisplay->value() ) &&
              ( _display_min > minimum() || _display_max < maximum() ) )
         {
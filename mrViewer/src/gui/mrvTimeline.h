@@ -30,6 +30,7 @@
 #include <vector>
 
 #include "core/mrvRectangle.h"
+#include "core/mrvAudioPeaks.h"
 #include "gui/mrvSlider.h"
 #include "gui/mrvTimecode.h"
 #include "gui/mrvMedia.h"
@@ -146,6 +147,12 @@ public:
 
     ImageBrowser* browser() const;
 
+    /// Draw the waveform of seconds t0 to t1 of an audio stream, filling
+    /// the width of r, one line per pixel.
+    static void draw_peaks( const AudioPeaks::Pyramid& p,
+                            const mrv::Recti& r,
+                            const double t0, const double t1 );
+
 protected:
     bool draw(const mrv::Recti& sr, int flags, bool slot);
     void draw_ticks(const mrv::Recti& r, int min_spacing);
@@ -59,6 +59,10 @@ namespace fs = boost::filesystem;
 #include "core/mrvException.h"
 #include "core/mrvColorProfile.h"
 #include "core/mrvCPU.h"
+#include "core/mrvDiskCache.h"
+#include "core/mrvAudioPeaks.h"
+#include "core/mrvKeyframeIndex.h"
+#include "core/exrImage.h"
 
 #include "gui/mrvImageBrowser.h"
 #include "gui/mrvImageView.h"
@@ -66,6 +70,8 @@ namespace fs = boost::filesystem;
 #include "gui/mrvVersion.h"
 #include "gui/mrvIO.h"
 #include "gui/mrvMainWindow.h"
+#include "gui/mrvThumbnailCache.h"
+#include "gui/mrvFilmstrip.h"
 
 #include "standalone/mrvCommandLine.h"
 #include "standalone/mrvRoot.h"
@@ -530,6 +536,13 @@ int main( int argc, const char** argv )
       break;
   }
 
+  mrv::ThumbnailCache::shutdown();
+  mrv::AudioPeaks::shutdown();
+  mrv::Filmstrip::shutdown();
+  mrv::KeyframeIndex::shutdown();
+  mrv::exrImage::shutdown();
+  mrv::DiskCache::shutdown();
+
   MagickWandTerminus();
 
   return ok;
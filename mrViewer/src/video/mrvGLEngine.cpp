@@ -2608,13 +2608,20 @@ void GLEngine::draw_annotation( const GLShapeList& shapes )
     CHECK_GL;
 
     {
-	GLShapeList::const_reverse_iterator i = shapes.rbegin();
-	GLShapeList::const_reverse_iterator e = shapes.rend();
+	// Only the shapes of this frame and of the ghosted frames around it
+	// (draw_shape() picks how they are drawn)
+	const boost::int64_t frame = _view->frame();
+	_shape_index.find( shapes, frame - _view->ghost_next(),
+			   frame + _view->ghost_previous(), _shape_positions );
 
+	std::vector< size_t >::const_reverse_iterator i =
+	_shape_positions.rbegin();
+	std::vector< size_t >::const_reverse_iterator e =
+	_shape_positions.rend();
 
 	for ( ; i != e; ++i )
 	{
-	    GLShape* shape = (*i).get();
+	    GLShape* shape = shapes[*i].get();
 	    draw_shape( shape );
 	}
 
@@ -32,6 +32,7 @@
 
 #include "core/mrvAlignedData.h"
 #include "gui/mrvImageView.h"
+#include "video/mrvGLShape.h"
 #include "mrvDrawEngine.h"
 
 #include "gui/mrvIO.h"
@@ -268,6 +269,9 @@ protected:
     double  _rotX, _rotY; // Sphere start rotation
     QuadList  _quads;
 
+    GLShapeIndex          _shape_index;     //!< annotations by frame
+    std::vector< size_t > _shape_positions; //!< annotations of this frame
+
     const CMedia* _image;
 
     //
@@ -21,6 +21,8 @@
 #define __STDC_LIMIT_MACROS
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>  // for PRId64
+#include <cmath>
+#include <algorithm>
 
 #if defined(WIN32) || defined(WIN64)
 #  include <winsock2.h>  // to avoid winsock issues
@@ -94,94 +96,211 @@ void glCircle( const Point& p, const double radius )
     glEnd();
 }
 
-void glPolyline( const vector<mrv::Point>& polyline, float width )
+namespace {
+
+// Triangles around a circle, as in glCircle
+void add_circle( std::vector< float >& tris, const Point& p,
+                 const double radius )
 {
-    if( polyline.size() < 2 ) return;
-    float w = width / 2.0f;
+    const int triangleAmount = 20;
+    const double twoPi = M_PI * 2.0;
 
-    DBGM1("");
-    glBegin(GL_TRIANGLES);
-    for( size_t i = 0; i < polyline.size()-1; ++i )
+    for ( int i = 0; i < triangleAmount; ++i )
     {
-        DBGM1("");
-        const Point& cur = polyline[ i ];
-        const Point& nxt = polyline[i+1];
-
-        Point b = (nxt - cur).normalized();
-        Point b_perp( -b.y, b.x );
-
-        Point p0( cur + b_perp*w );
-        Point p1( cur - b_perp*w );
-        Point p2( nxt + b_perp*w );
-        Point p3( nxt - b_perp*w );
-
-        // first triangle
-        glVertex2dv( &p0.x );
-        glVertex2dv( &p1.x );
-        glVertex2dv( &p2.x );
-        // second triangle
-        glVertex2dv( &p2.x );
-        glVertex2dv( &p1.x );
-        glVertex2dv( &p3.x );
-
-        // only do joins when we have a prv
-        if( i == 0 ) continue;
-
-        const Point& prv = polyline[i-1];
-        Point a = (prv - cur).normalized();
-        Point a_perp( a.y, -a.x );
-
-        DBGM1("");
-        double det = a.x*b.y - b.x*a.y;
-        if( det > 0 )
-        {
-            a_perp.x = -a_perp.x;
-            a_perp.y = -a_perp.y;
-            b_perp.x = -b_perp.x;
-            b_perp.y = -b_perp.y;
-        }
+        double a0 = i * twoPi / triangleAmount;
+        double a1 = ( i + 1 ) * twoPi / triangleAmount;
+        tris.push_back( float( p.x ) );
+        tris.push_back( float( p.y ) );
+        tris.push_back( float( p.x + radius * cos( a0 ) ) );
+        tris.push_back( float( p.y + radius * sin( a0 ) ) );
+        tris.push_back( float( p.x + radius * cos( a1 ) ) );
+        tris.push_back( float( p.y + radius * sin( a1 ) ) );
+    }
+}
+
+inline void add_vertex( std::vector< float >& tris, const Point& p )
+{
+    tris.push_back( float( p.x ) );
+    tris.push_back( float( p.y ) );
+}
 
-        // TODO: do inner miter calculation
+// Triangles of the segment from polyline[i] to polyline[i+1], plus the
+// round join with the segment before it
+void add_segment( std::vector< float >& tris,
+                  const GLPathShape::PointList& polyline,
+                  const size_t i, const float width )
+{
+    float w = width / 2.0f;
 
-        // flip around normals and calculate round join points
+    const Point& cur = polyline[ i ];
+    const Point& nxt = polyline[i+1];
+
+    Point b = (nxt - cur).normalized();
+    Point b_perp( -b.y, b.x );
+
+    Point p0( cur + b_perp*w );
+    Point p1( cur - b_perp*w );
+    Point p2( nxt + b_perp*w );
+    Point p3( nxt - b_perp*w );
+
+    // first triangle
+    add_vertex( tris, p0 );
+    add_vertex( tris, p1 );
+    add_vertex( tris, p2 );
+    // second triangle
+    add_vertex( tris, p2 );
+    add_vertex( tris, p1 );
+    add_vertex( tris, p3 );
+
+    // only do joins when we have a prv
+    if( i == 0 ) return;
+
+    const Point& prv = polyline[i-1];
+    Point a = (prv - cur).normalized();
+    Point a_perp( a.y, -a.x );
+
+    double det = a.x*b.y - b.x*a.y;
+    if( det > 0 )
+    {
         a_perp.x = -a_perp.x;
         a_perp.y = -a_perp.y;
         b_perp.x = -b_perp.x;
         b_perp.y = -b_perp.y;
+    }
+
+    // TODO: do inner miter calculation
 
-        DBGM1("");
-        size_t num_pts = 4;
-        vector< Point > round( 1 + num_pts + 1 );
-        for( size_t j = 0; j <= num_pts+1; ++j )
+    // flip around normals and calculate round join points
+    a_perp.x = -a_perp.x;
+    a_perp.y = -a_perp.y;
+    b_perp.x = -b_perp.x;
+    b_perp.y = -b_perp.y;
+
+    const size_t num_pts = 4;
+    Point round[ 1 + num_pts + 1 ];
+    for( size_t j = 0; j <= num_pts+1; ++j )
+    {
+        float t = (float)j/(float)(num_pts+1);
+        if( det > 0 )
+            round[j] = cur + (slerp2d( b_perp, a_perp, 1.0f-t ) * w);
+        else
+            round[j] = cur + (slerp2d( a_perp, b_perp, t ) * w);
+    }
+
+    for( size_t j = 0; j < num_pts+1; ++j )
+    {
+        add_vertex( tris, cur );
+        if( det > 0 )
         {
-            float t = (float)j/(float)(num_pts+1);
-            if( det > 0 )
-                round[j] = cur + (slerp2d( b_perp, a_perp, 1.0f-t ) * w);
-            else
-                round[j] = cur + (slerp2d( a_perp, b_perp, t ) * w);
+            add_vertex( tris, round[j+1] );
+            add_vertex( tris, round[j+0] );
         }
-        DBGM1("");
-
-        for( size_t j = 0; j < round.size()-1; ++j )
+        else
         {
-            glVertex2dv( &cur.x );
-            if( det > 0 )
-            {
-                glVertex2dv( &(round[j+1].x) );
-                glVertex2dv( &(round[j+0].x) );
-            }
-            else
-            {
-                glVertex2dv( &(round[j+0].x) );
-                glVertex2dv( &(round[j+1].x) );
-            }
+            add_vertex( tris, round[j+0] );
+            add_vertex( tris, round[j+1] );
         }
-        DBGM1("");
     }
-    glEnd();
+}
+
+}
+
+void GLPathShape::invalidate()
+{
+    _tris.clear();
+    _segments = 0;
+    _cap.clear();
+    _cap_points = 0;
+}
+
+void GLPathShape::tessellate()
+{
+    // Points removed or pen resized.  Start over.
+    if ( _tris.empty() || pen_size != _tess_size ||
+         pts.size() < _segments + 1 )
+    {
+        invalidate();
+        _tess_size = pen_size;
+        add_circle( _tris, pts[0], pen_size / 2.0 );
+    }
+
+    // Only the segments of points appended since the last time
+    for ( size_t i = _segments; i + 1 < pts.size(); ++i )
+        add_segment( _tris, pts, i, pen_size );
+    _segments = pts.size() - 1;
+
+    // The end cap moves with the last point
+    if ( _cap_points != pts.size() )
+    {
+        _cap.clear();
+        add_circle( _cap, pts.back(), pen_size / 2.0 );
+        _cap_points = pts.size();
+    }
+}
+
+void GLPathShape::draw_triangles()
+{
+    tessellate();
+
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    glEnableClientState( GL_VERTEX_ARRAY );
+
+    glVertexPointer( 2, GL_FLOAT, 0, &_tris[0] );
+    glDrawArrays( GL_TRIANGLES, 0, GLsizei( _tris.size() / 2 ) );
+
+    glVertexPointer( 2, GL_FLOAT, 0, &_cap[0] );
+    glDrawArrays( GL_TRIANGLES, 0, GLsizei( _cap.size() / 2 ) );
+
+    glDisableClientState( GL_VERTEX_ARRAY );
 }
 
 
+void GLPathShape::send_points( std::string& buf, const size_t first ) const
+{
+    if ( first >= pts.size() ) return;
+
+    char tmp[64];
+    int64_t ox = 0, oy = 0;
+    GLPathShape::PointList::const_iterator i = pts.begin() + first;
+    GLPathShape::PointList::const_iterator e = pts.end();
+    if ( first > 0 )
+    {
+        // The other side already has the point before first
+        ox = llround( (*(i-1)).x * kPointScale );
+        oy = llround( (*(i-1)).y * kPointScale );
+    }
+    for ( ; i != e; ++i )
+    {
+        int64_t x = llround( (*i).x * kPointScale );
+        int64_t y = llround( (*i).y * kPointScale );
+        // Skip repeated points, but always send the first one.
+        if ( ( first > 0 || i != pts.begin() ) && x == ox && y == oy )
+            continue;
+        sprintf( tmp, " %" PRId64 " %" PRId64, x - ox, y - oy );
+        buf += tmp;
+        ox = x;
+        oy = y;
+    }
+}
+
+void GLPathShape::receive_points( std::istream& is )
+{
+    int64_t x = 0, y = 0, dx, dy;
+    if ( !pts.empty() )
+    {
+        // Continue from the last point we have
+        x = llround( pts.back().x * kPointScale );
+        y = llround( pts.back().y * kPointScale );
+    }
+    while ( is >> dx >> dy )
+    {
+        x += dx;
+        y += dy;
+        pts.push_back( Point( double(x) / kPointScale,
+                              double(y) / kPointScale ) );
+    }
+}
+
 std::string GLPathShape::send() const
 {
     std::string buf = "GLPathShape ";
@@ -199,6 +318,17 @@ std::string GLPathShape::send() const
     return buf;
 }
 
+std::string GLPathShape::network_message() const
+{
+    std::string buf = "GLPathShapeD ";
+    char tmp[256];
+    sprintf( tmp, "%u %g %g %g %g %g %" PRId64, (unsigned) stroke, r, g, b, a,
+             pen_size, frame );
+    buf += tmp;
+    send_points( buf );
+    return buf;
+}
+
 void GLPathShape::draw( double z )
 {
     //Turn on Color Buffer and Depth Buffer
@@ -217,10 +347,7 @@ void GLPathShape::draw( double z )
 
     glColor4f( r, g, b, a );
 
-
-    glCircle( pts[0], pen_size / 2.0 );
-    glPolyline( pts, pen_size );
-    glCircle( pts[pts.size()-1], pen_size / 2.0 );
+    if ( !pts.empty() ) draw_triangles();
 
     glDisable( GL_BLEND );
 }
@@ -243,6 +370,18 @@ std::string GLErasePathShape::send() const
     return buf;
 }
 
+std::string GLErasePathShape::network_message() const
+{
+    std::string buf = "GLErasePathShapeD ";
+    char tmp[128];
+    sprintf( tmp, "%u %g %" PRId64, (unsigned) stroke, pen_size, frame );
+
+    buf += tmp;
+    send_points( buf );
+
+    return buf;
+}
+
 
 
 
@@ -254,9 +393,7 @@ void GLErasePathShape::draw( double z )
     glStencilFunc(GL_ALWAYS, 1, 0xFFFFFFFF);
     glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 
-    glCircle( pts[0], pen_size / 2.0 );
-    glPolyline( pts, pen_size );
-    glCircle( pts[pts.size()-1], pen_size / 2.0 );
+    if ( !pts.empty() ) draw_triangles();
 }
 
 
@@ -327,4 +464,50 @@ void GLTextShape::draw( double z )
 }
 
 
+void GLShapeIndex::update( const GLShapeList& shapes )
+{
+    const size_t num = shapes.size();
+    const GLShape* first = num ? shapes.front().get() : NULL;
+    const GLShape* last  = num ? shapes.back().get()  : NULL;
+    const boost::int64_t last_frame = num ? last->frame : 0;
+
+    if ( num == _size && first == _first && last == _last &&
+         last_frame == _last_frame )
+        return;
+
+    _size       = num;
+    _first      = first;
+    _last       = last;
+    _last_frame = last_frame;
+
+    _index.clear();
+    for ( size_t i = 0; i < num; ++i )
+        _index[ shapes[i]->frame ].push_back( i );
+}
+
+void GLShapeIndex::find( const GLShapeList& shapes,
+                         const boost::int64_t first,
+                         const boost::int64_t last,
+                         std::vector< size_t >& positions )
+{
+    update( shapes );
+
+    positions.clear();
+
+    FrameMap::const_iterator i = _index.find( MRV_NOPTS_VALUE );
+    if ( i != _index.end() )
+        positions.insert( positions.end(), i->second.begin(),
+                          i->second.end() );
+
+    FrameMap::const_iterator e = _index.upper_bound( last );
+    for ( i = _index.lower_bound( first ); i != e; ++i )
+    {
+        if ( i->first == MRV_NOPTS_VALUE ) continue;
+        positions.insert( positions.end(), i->second.begin(),
+                          i->second.end() );
+    }
+
+    std::sort( positions.begin(), positions.end() );
+}
+
 } // namespace mrv
@@ -21,6 +21,7 @@
 
 #include <float.h>
 #include <limits.h>
+#include <map>
 #include <vector>
 #include <iostream>
 
@@ -145,6 +146,12 @@ public:
     virtual ~GLShape() {};
 
     virtual std::string send() const = 0;
+
+    /// Line sent to sync peers.  Same as send() unless the shape has a
+    /// more compact form for the network.
+    virtual std::string network_message() const {
+        return send();
+    }
     virtual void draw( double z ) = 0;
 
     void color( float ri, float gi, float bi, float ai = 1.0 ) {
@@ -165,13 +172,49 @@ class GLPathShape : public GLShape
 {
 public:
 
-    GLPathShape() : GLShape()  {};
+    GLPathShape() : GLShape(), stroke( 0 ), _segments( 0 ), _tess_size( 0 ),
+                    _cap_points( 0 ) {};
     virtual ~GLPathShape() {};
     virtual void draw( double z );
     virtual std::string send() const;
+    virtual std::string network_message() const;
+
+    /// Points are sent to sync peers quantized to 1/kPointScale pixels.
+    /// Reels keep them at full precision.
+    static const int kPointScale = 8;
+
+    /// Append points from first on to buf, as deltas from the point
+    /// before first (or from the origin)
+    void send_points( std::string& buf, const size_t first = 0 ) const;
+
+    /// Append points sent with send_points
+    void receive_points( std::istream& is );
+
+    /// Forget the cached triangles.  Needed only after moving or removing
+    /// points; appended points and pen size changes are picked up on the
+    /// next draw.
+    void invalidate();
 
     typedef std::vector< Point > PointList;
     PointList pts;
+
+    /// Id peers know the stroke by while it is drawn, so points sent
+    /// later find it.  0 if never sent while drawn.
+    boost::uint32_t stroke;
+
+protected:
+    /// Bring the cached triangles up to date with pts
+    void tessellate();
+
+    /// Draw the cached triangles with the current color and stencil
+    void draw_triangles();
+
+protected:
+    std::vector< float > _tris;       //!< start cap and segments (x, y)
+    size_t               _segments;   //!< segments of pts in _tris
+    float                _tess_size;  //!< pen size _tris was made with
+    std::vector< float > _cap;        //!< end cap (x, y)
+    size_t               _cap_points; //!< pts.size() when _cap was made
 };
 
 class GLErasePathShape : public GLPathShape
@@ -182,6 +225,7 @@ public:
     virtual ~GLErasePathShape() {};
     virtual void draw( double z );
     virtual std::string send() const;
+    virtual std::string network_message() const;
 };
 
 class GLTextShape : public GLPathShape
@@ -221,6 +265,9 @@ public:
 
     virtual void draw( double z );
     virtual std::string send() const;
+    virtual std::string network_message() const {
+        return send();
+    }
 
 protected:
     Fl_Font _font;
@@ -234,6 +281,42 @@ protected:
 typedef boost::shared_ptr< GLShape > shape_type_ptr;
 typedef std::vector< shape_type_ptr > GLShapeList;
 
+//
+// Positions of the shapes of a GLShapeList by frame, so drawing a frame
+// does not walk every annotation of the clip.  Shapes are only added,
+// undone or redone at the end of the list, or the whole list replaced,
+// so the index is rebuilt when its size, its first or last shape or
+// the frame of the last one change.
+//
+class GLShapeIndex
+{
+public:
+    GLShapeIndex() :
+        _size( 0 ),
+        _first( NULL ),
+        _last( NULL ),
+        _last_frame( 0 )
+    {};
+
+    /// Fill positions with those of the shapes on frames first to last
+    /// or on all frames, in list order
+    void find( const GLShapeList& shapes, const boost::int64_t first,
+               const boost::int64_t last, std::vector< size_t >& positions );
+
+protected:
+    void update( const GLShapeList& shapes );
+
+protected:
+    typedef std::vector< size_t > Positions;
+    typedef std::map< boost::int64_t, Positions > FrameMap;
+
+    size_t                         _size;
+    const GLShape*                 _first;
+    const GLShape*                 _last;
+    boost::int64_t                 _last_frame;
+    FrameMap                       _index;
+};
+
 }
 
 